@@ -168,6 +168,101 @@ int fft_r2r_genuine_fht(const ArrayDescriptor *in_, ArrayDescriptor *out_,
   DUCC0_JULIA_TRY_END
   }
 
+struct TFftPlan
+  {
+  FftKind kind;
+  size_t real_type;
+  void *plan;
+  };
+
+template<typename T> FftPlanND<T> *fft_make_plan_helper(FftKind kind,
+  const ArrayDescriptor &in, const ArrayDescriptor &out, const vector<size_t> &axes,
+  size_t nthreads)
+  {
+  bool inplace = in.data==out.data;
+  fmav_info iinfo = (kind==FFT_R2C) ? fmav_info(to_cfmav<true,T>(in))
+                                    : fmav_info(to_cfmav<true,complex<T>>(in));
+  fmav_info oinfo = (kind==FFT_C2R) ? fmav_info(to_cfmav<true,T>(out))
+                                    : fmav_info(to_cfmav<true,complex<T>>(out));
+  return new FftPlanND<T>(kind, iinfo, oinfo, axes, nthreads, inplace);
+  }
+
+template<typename T> void fft_execute_plan_helper(TFftPlan &plan,
+  const ArrayDescriptor &in, ArrayDescriptor &out, int forward, T fct)
+  {
+  auto &rplan(*reinterpret_cast<FftPlanND<T> *>(plan.plan));
+  if (plan.kind==FFT_C2C)
+    {
+    auto myin(to_cfmav<true,complex<T>>(in));
+    auto myout(to_vfmav<true,complex<T>>(out));
+    rplan.exec(myin, myout, forward, fct);
+    }
+  else if (plan.kind==FFT_R2C)
+    {
+    auto myin(to_cfmav<true,T>(in));
+    auto myout(to_vfmav<true,complex<T>>(out));
+    rplan.exec(myin, myout, forward, fct);
+    }
+  else
+    {
+    auto myin(to_cfmav<true,complex<T>>(in));
+    auto myout(to_vfmav<true,T>(out));
+    rplan.exec(myin, myout, forward, fct);
+    }
+  }
+
+/* kind: 0 for c2c, 1 for r2c, 2 for c2r.
+   The arrays passed here only serve as templates for the layout of the arrays
+   passed to fft_execute_plan(). */
+DUCC0_INTERFACE_FUNCTION
+TFftPlan *fft_make_plan(int kind, const ArrayDescriptor *in_,
+  const ArrayDescriptor *out_, const ArrayDescriptor *axes_, size_t nthreads)
+  {
+  try
+    {
+    const auto &in(*in_);
+    const auto &out(*out_);
+    const auto &axes(*axes_);
+    MR_assert((kind>=0)&&(kind<=2), "bad transform kind");
+    auto mykind = FftKind(kind);
+    auto myaxes(to_vector_subtract_1<false, uint64_t, size_t>(axes));
+    for (auto &a: myaxes) a = in.ndim-1-a;
+    const auto &cplx((mykind==FFT_C2R) ? in : out);
+    if (cplx.dtype==Typecode<complex<double>>::value)
+      return new TFftPlan{mykind, Typecode<double>::value,
+        fft_make_plan_helper<double>(mykind, in, out, myaxes, nthreads)};
+    if (cplx.dtype==Typecode<complex<float>>::value)
+      return new TFftPlan{mykind, Typecode<float>::value,
+        fft_make_plan_helper<float>(mykind, in, out, myaxes, nthreads)};
+    MR_fail("bad datatype");
+    }
+  catch(const exception &e)
+    { cout << e.what() << endl; return nullptr; }
+  }
+
+DUCC0_INTERFACE_FUNCTION
+int fft_delete_plan(TFftPlan *plan)
+  {
+  DUCC0_JULIA_TRY_BEGIN
+  (plan->real_type==Typecode<double>::value) ?
+      delete reinterpret_cast<FftPlanND<double> *>(plan->plan)
+    : delete reinterpret_cast<FftPlanND<float> *>(plan->plan);
+  delete plan;
+  DUCC0_JULIA_TRY_END
+  }
+
+DUCC0_INTERFACE_FUNCTION
+int fft_execute_plan(TFftPlan *plan, const ArrayDescriptor *in_,
+  ArrayDescriptor *out_, int forward, double fct)
+  {
+  DUCC0_JULIA_TRY_BEGIN
+  if (plan->real_type==Typecode<double>::value)
+    fft_execute_plan_helper<double>(*plan, *in_, *out_, forward, fct);
+  else
+    fft_execute_plan_helper<float>(*plan, *in_, *out_, forward, float(fct));
+  DUCC0_JULIA_TRY_END
+  }
+
 // NUFFT
 
 DUCC0_INTERFACE_FUNCTION
@@ -189,6 +189,27 @@ def runbench(shape, npoints, nthreads, fname, singleprec=False):
             res.append(tres)
     plot(res, fname)
 
+def lockfree_bench(shape, npoints, nthreads_list, epsilon, singleprec=False):
+    """Compares the nu2u run times of the locking and the lock-free
+    spreading scheme for several numbers of threads."""
+    ndim = len(shape)
+    rdtype, dtype = (np.float32, np.complex64) if singleprec else (np.float64, np.complex128)
+    coord = (2*np.pi*np.random.uniform(size=(npoints,ndim)) - np.pi).astype(rdtype)
+    points = (np.random.uniform(size=npoints)-0.5
+              + 1j * np.random.uniform(size=npoints)-0.5j).astype(dtype)
+    print("shape={}, npoints={}, epsilon={}".format(shape, npoints, epsilon))
+    for nthreads in nthreads_list:
+        times = []
+        for lockfree in (False, True):
+            plan = ducc0.nufft.plan(nu2u=True, coord=coord, grid_shape=shape,
+                                    epsilon=epsilon, nthreads=nthreads,
+                                    lockfree_spreading=lockfree)
+            out = np.empty(shape, dtype=dtype)
+            t0 = time()
+            plan.nu2u(points=points, forward=True, out=out)
+            times.append(time()-t0)
+        print("  nthreads={:3d}: locking {:.4f}s, lock-free {:.4f}s".format(nthreads, *times))
+
 singleprec = False
 # FINUFFT benchmarks
 if True:
@@ -203,3 +224,8 @@ if True:
     runbench(( 512*512,),  512*512, 1, "bench_1d.png", singleprec)
     runbench(( 512,512,),  512*512, 1, "bench_2d.png", singleprec)
     runbench((64,64,64,), 64*64*64, 1, "bench_3d.png", singleprec)
+# locking vs. lock-free spreading
+if True:
+    lockfree_bench((  10000000,), 100000000, (1, 2, 4, 8, 16), 1e-6, singleprec)
+    lockfree_bench(( 3162,3162,), 100000000, (1, 2, 4, 8, 16), 1e-6, singleprec)
+    lockfree_bench((216,216,216), 100000000, (1, 2, 4, 8, 16), 1e-6, singleprec)
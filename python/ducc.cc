@@ -1,4 +1,5 @@
 #include "ducc0/infra/string_utils.cc"
+#include "ducc0/infra/system.cc"
 #include "ducc0/infra/threading.cc"
 #include "ducc0/infra/mav.cc"
 #include "ducc0/math/pointing.cc"
@@ -99,6 +99,34 @@ shape_t makeaxes(const py::array &in, const py::object &axes)
   throw std::runtime_error("unsupported data type"); \
   }
 
+// Arrays of 16-bit floating point types have no pybind11 counterpart, so
+// they are recognized by their dtype and wrapped manually.
+// Returns 1 for numpy.float16, 2 for ml_dtypes.bfloat16, 0 otherwise.
+int storage16_kind(const py::object &obj)
+  {
+  if (!isPyarr(obj)) return 0;
+  auto dt = py::array(obj).dtype();
+  if (dt.itemsize()!=2) return 0;
+#ifdef DUCC0_HAVE_FLOAT16
+  if (dt.kind()=='f') return 1;
+#endif
+  if (py::str(dt.attr("name")).cast<std::string>()=="bfloat16") return 2;
+  return 0;
+  }
+
+template<typename T> cfmav<T> to_cfmav16(const py::array &arr)
+  {
+  return cfmav<T>(reinterpret_cast<const T *>(arr.data()),
+    detail_pybind::copy_shape(arr),
+    detail_pybind::copy_strides<T>(arr, false));
+  }
+template<typename T> vfmav<T> to_vfmav16(py::array &arr)
+  {
+  return vfmav<T>(reinterpret_cast<T *>(arr.mutable_data()),
+    detail_pybind::copy_shape(arr),
+    detail_pybind::copy_strides<T>(arr, true));
+  }
+
 template<typename T> T norm_fct(int inorm, size_t N)
   {
   if (inorm==0) return T(1);
@@ -170,6 +198,67 @@ py::array c2c(const py::array &a, const py::object &axes_, bool forward,
            inorm, out_, nthreads))
   }
 
+template<typename T> py::array c2c_slabs_internal(py::array &a,
+  const py::object &axes_, bool forward, int inorm, size_t max_bytes,
+  size_t nthreads)
+  {
+  auto axes = makeaxes(a, axes_);
+  auto aa = to_vfmav<std::complex<T>>(a);
+  {
+  py::gil_scoped_release release;
+  T fct = norm_fct<T>(inorm, aa.shape(), axes);
+  ducc0::c2c_slabs(aa, axes, forward, fct, max_bytes, nthreads);
+  }
+  return a;
+  }
+py::array c2c_slabs(py::array &a, const py::object &axes_, bool forward,
+  int inorm, size_t max_bytes, size_t nthreads)
+  {
+  DISPATCH(a, c128, c64, clong, c2c_slabs_internal, (a, axes_, forward,
+           inorm, max_bytes, nthreads))
+  }
+
+std::vector<std::vector<slice>> makeranges(const py::sequence &ranges)
+  {
+  std::vector<std::vector<slice>> res;
+  for (auto axranges: ranges)
+    {
+    res.emplace_back();
+    for (auto rng: axranges.cast<py::sequence>())
+      {
+      auto lims = rng.cast<py::sequence>();
+      MR_assert(lims.size()==2, "ranges must be (start, stop) pairs");
+      size_t beg = lims[0].cast<size_t>();
+      size_t end = lims[1].is_none() ? MAXIDX : lims[1].cast<size_t>();
+      res.back().emplace_back(beg, end);
+      }
+    }
+  return res;
+  }
+
+template<typename T> py::array c2c_pruned_internal(py::array &a,
+  const py::object &axes_, const py::sequence &in_ranges_,
+  const py::sequence &out_ranges_, bool forward, int inorm, size_t nthreads)
+  {
+  auto axes = makeaxes(a, axes_);
+  auto in_ranges = makeranges(in_ranges_);
+  auto out_ranges = makeranges(out_ranges_);
+  auto aa = to_vfmav<std::complex<T>>(a);
+  {
+  py::gil_scoped_release release;
+  T fct = norm_fct<T>(inorm, aa.shape(), axes);
+  ducc0::c2c_pruned(aa, axes, in_ranges, out_ranges, forward, fct, nthreads);
+  }
+  return a;
+  }
+py::array c2c_pruned(py::array &a, const py::object &axes_,
+  const py::sequence &in_ranges, const py::sequence &out_ranges, bool forward,
+  int inorm, size_t nthreads)
+  {
+  DISPATCH(a, c128, c64, clong, c2c_pruned_internal, (a, axes_, in_ranges,
+           out_ranges, forward, inorm, nthreads))
+  }
+
 template<typename T> py::array r2c_internal(const py::array &in,
   const py::object &axes_, bool forward, int inorm, py::object &out_,
   size_t nthreads)
@@ -188,9 +277,33 @@ template<typename T> py::array r2c_internal(const py::array &in,
   return out;
   }
 
+template<typename Ti> py::array r2c_internal16(const py::array &in,
+  const py::object &axes_, bool forward, int inorm, py::object &out_,
+  size_t nthreads)
+  {
+  auto axes = makeaxes(in, axes_);
+  auto ain = to_cfmav16<Ti>(in);
+  auto dims_out(ain.shape());
+  dims_out[axes.back()] = (dims_out[axes.back()]>>1)+1;
+  auto out = get_optional_Pyarr<std::complex<float>>(out_, dims_out);
+  auto aout = to_vfmav<std::complex<float>>(out);
+  {
+  py::gil_scoped_release release;
+  float fct = norm_fct<float>(inorm, ain.shape(), axes);
+  ducc0::r2c(ain, aout, axes, forward, fct, nthreads);
+  }
+  return out;
+  }
+
 py::array r2c(const py::array &in, const py::object &axes_, bool forward,
   int inorm, py::object &out_, size_t nthreads)
   {
+#ifdef DUCC0_HAVE_FLOAT16
+  if (storage16_kind(in)==1)
+    return r2c_internal16<float16>(in, axes_, forward, inorm, out_, nthreads);
+#endif
+  if (storage16_kind(in)==2)
+    return r2c_internal16<bfloat16>(in, axes_, forward, inorm, out_, nthreads);
   DISPATCH(in, f64, f32, flong, r2c_internal, (in, axes_, forward, inorm, out_,
     nthreads))
   }
@@ -325,10 +438,54 @@ template<typename T> py::array c2r_internal(const py::array &in,
   return out;
   }
 
+template<typename To> py::array c2r_internal16(py::array &in,
+  const py::object &axes_, size_t lastsize, bool forward, int inorm,
+  py::array &out, size_t nthreads, bool allow_overwriting_input)
+  {
+  auto axes = makeaxes(in, axes_);
+  size_t axis = axes.back();
+  auto ain_c = to_cfmav<std::complex<float>>(in);
+  shape_t dims_out(ain_c.shape());
+  if (lastsize==0) lastsize=2*ain_c.shape(axis)-1;
+  if ((lastsize/2) + 1 != ain_c.shape(axis))
+    throw std::invalid_argument("bad lastsize");
+  dims_out[axis] = lastsize;
+  auto aout = to_vfmav16<To>(out);
+  MR_assert(aout.shape()==dims_out, "dimension mismatch");
+  float fct = norm_fct<float>(inorm, aout.shape(), axes);
+  if (allow_overwriting_input)
+    {
+    auto ain = to_vfmav<std::complex<float>>(in);
+    {
+    py::gil_scoped_release release;
+    ducc0::c2r_mut(ain, aout, axes, forward, fct, nthreads);
+    }
+    }
+  else
+    {
+    py::gil_scoped_release release;
+    ducc0::c2r(ain_c, aout, axes, forward, fct, nthreads);
+    }
+  return out;
+  }
+
 py::array c2r(py::array &in, const py::object &axes_, size_t lastsize,
   bool forward, int inorm, py::object &out_, size_t nthreads,
   bool allow_overwriting_input)
   {
+  if (storage16_kind(out_)!=0)
+    {
+    MR_assert(isPyarr<c64>(in),
+      "16-bit output requires single precision complex input");
+    py::array out(out_);
+#ifdef DUCC0_HAVE_FLOAT16
+    if (storage16_kind(out_)==1)
+      return c2r_internal16<float16>(in, axes_, lastsize, forward, inorm, out,
+        nthreads, allow_overwriting_input);
+#endif
+    return c2r_internal16<bfloat16>(in, axes_, lastsize, forward, inorm, out,
+      nthreads, allow_overwriting_input);
+    }
   DISPATCH(in, c128, c64, clong, c2r_internal, (in, axes_, lastsize, forward,
     inorm, out_, nthreads, allow_overwriting_input))
   }
@@ -476,6 +633,175 @@ py::array convolve_axis(const py::array &in, py::array &out, size_t axis,
       kernel, nthreads))
   }
 
+template<typename T> py::array convolve_internal(const py::array &in_,
+  const py::array &kernel_, const py::object &axes_, bool correlate,
+  py::object &out_, size_t nthreads)
+  {
+  auto axes = makeaxes(in_, axes_);
+  auto in = to_cfmav<T>(in_);
+  auto kernel = to_cfmav<T>(kernel_);
+  auto out_arr = get_optional_Pyarr<T>(out_, in.shape());
+  auto out = to_vfmav<T>(out_arr);
+  {
+  py::gil_scoped_release release;
+  ducc0::convolve(in, out, axes, kernel, correlate, nthreads);
+  }
+  return out_arr;
+  }
+
+py::array convolve(const py::array &in, const py::array &kernel,
+  const py::object &axes_, bool correlate, py::object &out_, size_t nthreads)
+  {
+  if (in.dtype().kind() == 'c')
+    DISPATCH(in, c128, c64, clong, convolve_internal, (in, kernel, axes_,
+      correlate, out_, nthreads))
+  else
+    DISPATCH(in, f64, f32, flong, convolve_internal, (in, kernel, axes_,
+      correlate, out_, nthreads))
+  }
+
+template<typename T> py::array convolve_axis_linear_internal(
+  const py::array &in_, py::array &out_, size_t axis, const py::array &kernel_,
+  size_t nthreads)
+  {
+  auto in = to_cfmav<T>(in_);
+  auto out = to_vfmav<T>(out_);
+  auto kernel = to_cmav<T,1>(kernel_);
+  {
+  py::gil_scoped_release release;
+  ducc0::convolve_axis_linear(in, out, axis, kernel, nthreads);
+  }
+  return out_;
+  }
+
+py::array convolve_axis_linear(const py::array &in, py::array &out,
+  size_t axis, const py::array &kernel, size_t nthreads)
+  {
+  if (in.dtype().kind() == 'c')
+    DISPATCH(in, c128, c64, clong, convolve_axis_linear_internal, (in, out,
+      axis, kernel, nthreads))
+  else
+    DISPATCH(in, f64, f32, flong, convolve_axis_linear_internal, (in, out,
+      axis, kernel, nthreads))
+  }
+
+py::dict plan_cache_info()
+  {
+  auto info = get_fft_plan_cache_info();
+  py::dict res;
+  res["hits"] = info.hits;
+  res["misses"] = info.misses;
+  res["evictions"] = info.evictions;
+  res["entries"] = info.entries;
+  res["bytes"] = info.bytes;
+  res["max_entries"] = info.max_entries;
+  res["max_bytes"] = info.max_bytes;
+  return res;
+  }
+
+void set_plan_cache_limits(size_t max_entries, size_t max_bytes)
+  { set_fft_plan_cache_limits(max_entries, max_bytes); }
+
+void tune_wisdom(size_t length, bool real, bool singleprec)
+  {
+  py::gil_scoped_release release;
+  singleprec ? tune_fft_wisdom<float>(length, real)
+             : tune_fft_wisdom<double>(length, real);
+  }
+
+class Py_FftPlanND
+  {
+  private:
+    FftKind kind;
+    shape_t axes, nshape;
+
+    std::unique_ptr<FftPlanND<f64>> pd;
+    std::unique_ptr<FftPlanND<f32>> pf;
+    std::unique_ptr<FftPlanND<flong>> pl;
+
+    template<typename T> void construct(std::unique_ptr<FftPlanND<T>> &ptr,
+      const py::array &a, const py::array &out, size_t nthreads)
+      {
+      bool inplace = a.data()==out.data();
+      fmav_info iinfo = (kind==FFT_R2C) ? fmav_info(to_cfmav<T>(a))
+                                        : fmav_info(to_cfmav<std::complex<T>>(a));
+      fmav_info oinfo = (kind==FFT_C2R) ? fmav_info(to_cfmav<T>(out))
+                                        : fmav_info(to_cfmav<std::complex<T>>(out));
+      {
+      py::gil_scoped_release release;
+      ptr = std::make_unique<FftPlanND<T>>(kind, iinfo, oinfo, axes, nthreads,
+        inplace);
+      }
+      }
+    template<typename T> py::array do_exec(const std::unique_ptr<FftPlanND<T>> &ptr,
+      const py::array &a, py::array &out, bool forward, int inorm) const
+      {
+      T fct = norm_fct<T>(inorm, nshape, axes);
+      if (kind==FFT_C2C)
+        {
+        auto ain = to_cfmav<std::complex<T>>(a);
+        auto aout = to_vfmav<std::complex<T>>(out);
+        py::gil_scoped_release release;
+        ptr->exec(ain, aout, forward, fct);
+        }
+      else if (kind==FFT_R2C)
+        {
+        auto ain = to_cfmav<T>(a);
+        auto aout = to_vfmav<std::complex<T>>(out);
+        py::gil_scoped_release release;
+        ptr->exec(ain, aout, forward, fct);
+        }
+      else
+        {
+        auto ain = to_cfmav<std::complex<T>>(a);
+        auto aout = to_vfmav<T>(out);
+        py::gil_scoped_release release;
+        ptr->exec(ain, aout, forward, fct);
+        }
+      return out;
+      }
+
+  public:
+    Py_FftPlanND(const std::string &kind_, const py::array &a, const py::array &out,
+      const py::object &axes_, size_t nthreads)
+      {
+      if (kind_=="c2c") kind = FFT_C2C;
+      else if (kind_=="r2c") kind = FFT_R2C;
+      else if (kind_=="c2r") kind = FFT_C2R;
+      else MR_fail("unknown transform kind '", kind_, "'");
+      axes = makeaxes(a, axes_);
+      // normalization always refers to the lengths of the real-space axes
+      const py::array &rspace((kind==FFT_C2R) ? out : a);
+      nshape = shape_t(size_t(rspace.ndim()));
+      for (size_t i=0; i<nshape.size(); ++i)
+        nshape[i] = size_t(rspace.shape(i));
+      const py::array &ref((kind==FFT_R2C) ? out : a);
+      if (isPyarr<c128>(ref))
+        construct(pd, a, out, nthreads);
+      else if (isPyarr<c64>(ref))
+        construct(pf, a, out, nthreads);
+      else if (isPyarr<clong>(ref))
+        construct(pl, a, out, nthreads);
+      else
+        MR_fail("unsupported data type");
+      }
+
+    py::array exec(const py::array &a, py::array &out, bool forward, int inorm)
+      {
+      if (pd) return do_exec(pd, a, out, forward, inorm);
+      if (pf) return do_exec(pf, a, out, forward, inorm);
+      if (pl) return do_exec(pl, a, out, forward, inorm);
+      MR_fail("unsupported");
+      }
+    size_t scratch_bytes() const
+      {
+      if (pd) return pd->scratch_bytes();
+      if (pf) return pf->scratch_bytes();
+      if (pl) return pl->scratch_bytes();
+      return 0;
+      }
+  };
+
 const char *fft_DS = R"""(Fast Fourier, sine/cosine, and Hartley transforms.
 
 This module supports
@@ -520,12 +846,89 @@ numpy.ndarray (same shape as `a`, complex type with same accuracy as `a`)
     The transformed data.
 )""";
 
+const char *c2c_slabs_DS = R"""(Performs a complex FFT in place, processing the data in slabs.
+
+This is intended for arrays which are larger than the available memory, e.g.
+a `numpy.memmap` of a file. Every pass copies slabs of at most `max_bytes`
+into memory, transforms them there and writes them back. If not all axes are
+transformed, the data are read and written once, otherwise twice.
+
+Parameters
+----------
+a : numpy.ndarray (any complex type, at least two dimensions)
+    The data to be transformed; it is overwritten with the result.
+axes : list of integers
+    The axes along which the FFT is carried out.
+    If not set, all axes will be transformed.
+forward : bool
+    If `True`, a negative sign is used in the exponent, else a positive one.
+inorm : int
+    Normalization type
+      | 0 : no normalization
+      | 1 : divide by sqrt(N)
+      | 2 : divide by N
+
+    where N is the product of the lengths of the transformed axes.
+max_bytes : int
+    Maximum size of a slab in bytes. Slabs consisting of a single layer of
+    the array are used if they are larger than this.
+nthreads : int
+    Number of threads to use. If 0, use the system default (typically the number
+    of hardware threads on the compute node).
+
+Returns
+-------
+numpy.ndarray
+    `a`, which now contains the transformed data.
+)""";
+
+const char *c2c_pruned_DS = R"""(Performs a complex FFT in place, skipping work on known zeros and on unneeded results.
+
+The result agrees with that of `c2c` within the requested output ranges.
+All entries of `a` outside these ranges have undefined values afterwards.
+
+Parameters
+----------
+a : numpy.ndarray (any complex type)
+    The data to be transformed; it is overwritten with the result.
+axes : list of integers
+    The axes along which the FFT is carried out.
+    If not set, all axes will be transformed. Every axis must occur only once.
+in_ranges : list of lists of (int, int or None) tuples
+    For every entry of `axes`, a list of index ranges (start, stop) along this
+    axis outside of which `a` is zero. A stop of None stands for the end of
+    the axis, an empty list for the full axis.
+    The ranges for every axis must be sorted and must not overlap.
+out_ranges : list of lists of (int, int or None) tuples
+    For every entry of `axes`, the index ranges along this axis for which
+    results are required, in the same format as `in_ranges`.
+forward : bool
+    If `True`, a negative sign is used in the exponent, else a positive one.
+inorm : int
+    Normalization type
+      | 0 : no normalization
+      | 1 : divide by sqrt(N)
+      | 2 : divide by N
+
+    where N is the product of the lengths of the transformed axes.
+nthreads : int
+    Number of threads to use. If 0, use the system default (typically the number
+    of hardware threads on the compute node).
+
+Returns
+-------
+numpy.ndarray
+    `a`, which now contains the transformed data.
+)""";
+
 const char *r2c_DS = R"""(Performs an FFT whose input is strictly real.
 
 Parameters
 ----------
 a : numpy.ndarray (any real type)
-    The input data
+    The input data.
+    Arrays of type `numpy.float16` or `ml_dtypes.bfloat16` are converted
+    to single precision on the fly; the output is then `numpy.complex64`.
 axes : list of integers
     The axes along which the FFT is carried out.
     If not set, this is assumed to be `list(range(a.ndim))`.
@@ -581,6 +984,8 @@ inorm : int
 out : numpy.ndarray (real type with same accuracy as `a`)
     For the required shape, see the `Returns` section.
     Must not overlap with `a`.
+    If `a` is `numpy.complex64`, `out` may also be of type `numpy.float16`
+    or `ml_dtypes.bfloat16`; the results are then rounded on the fly.
     If None, a new array is allocated to store the output.
 nthreads : int
     Number of threads to use. If 0, use the system default (typically the number
@@ -947,6 +1352,244 @@ truncation will be carried out after the convolution step.
 be at the same memory location, and all their strides must be equal.
 )""";
 
+const char *convolve_DS = R"""(Performs a multi-dimensional circular convolution or correlation.
+
+For convolution, the result is equivalent to
+
+.. code-block:: Python
+
+    import numpy as np
+    ax = range(in.ndim) if axes is None else axes
+    shp = [1]*in.ndim
+    for i, a in enumerate(ax):
+        shp[a] = kernel.shape[i]
+    fk = np.fft.fftn(kernel).reshape(shp)
+    out[()] = np.fft.ifftn(np.fft.fftn(in, axes=ax)*fk, axes=ax)
+    return out
+
+For correlation, `fk` is replaced by its complex conjugate.
+
+Parameters
+----------
+in : numpy.ndarray (any real or complex type)
+    The input data
+kernel : numpy.ndarray (same type as `in`)
+    The kernel to be used for convolution, given in the same domain as `in`.
+    It must have `len(axes)` dimensions, and `kernel.shape[i]` must be equal
+    to `in.shape[axes[i]]`.
+axes : list of integers
+    The axes along which the convolution is carried out.
+    If not set, all axes will be used.
+correlate : bool
+    If `True`, compute the cross-correlation `sum_m conj(kernel[m])*in[n+m]`
+    instead of the convolution.
+out : numpy.ndarray (same shape and type as `in`)
+    May be identical to `in`, but if it isn't, it must not overlap with `in`.
+    If None, a new array is allocated to store the output.
+nthreads : int
+    Number of threads to use. If 0, use the system default (typically the number
+    of hardware threads on the compute node).
+
+Returns
+-------
+numpy.ndarray (same shape and type as `in`)
+    The convolved input
+
+Notes
+-----
+The forward transform, the multiplication with the kernel spectrum and the
+backward transform along the axis with the smallest stride are carried out in
+a single pass over the data. For real input, the multiplication is performed
+on the half spectrum.
+)""";
+
+const char *convolve_axis_linear_DS = R"""(Performs a linear convolution along one axis.
+
+The result is equivalent to
+
+.. code-block:: Python
+
+    import numpy as np
+    out[()] = np.apply_along_axis(lambda x: np.convolve(x, kernel), axis, in)
+    return out
+
+Parameters
+----------
+in : numpy.ndarray (any real or complex type)
+    The input data
+out : numpy.ndarray (same type as `in`)
+    The output data. Must have the same shape as `in` except for the axis
+    to be convolved, where its length must be
+    `in.shape[axis]+kernel.shape[0]-1`.
+axis : integer
+    The axis along which the convolution is carried out.
+kernel : one-dimensional numpy.ndarray (same type as `in`)
+    The kernel to be used for convolution
+nthreads : int
+    Number of threads to use. If 0, use the system default (typically the number
+    of hardware threads on the compute node).
+
+Returns
+-------
+numpy.ndarray (identical to `out`)
+    The convolved input
+
+Notes
+-----
+The convolution is computed with the overlap-save method, using the FFT
+length with the lowest estimated cost. This is efficient for long signals and
+comparatively short kernels.
+
+`in` and `out` must not overlap in memory.
+)""";
+
+const char *plan_init_DS = R"""(Creates a reusable multi-dimensional FFT plan.
+
+The plan precomputes the 1D plans for all transformed axes, the order and
+threading of the individual axis passes, and all scratch buffers. Executing it
+repeatedly on arrays with identical layout avoids the per-call setup cost of
+`c2c`, `r2c` and `c2r`.
+
+Parameters
+----------
+kind : str
+    "c2c", "r2c" or "c2r"
+a : numpy.ndarray
+    Template for the input arrays that will be passed to `exec`.
+    Only its shape, strides and data type are used.
+out : numpy.ndarray
+    Template for the output arrays that will be passed to `exec`.
+    Only its shape, strides and data type are used, except that the plan will
+    perform in-place transforms if `out` is identical to `a`.
+    For "r2c", the length of `out` along `axes[-1]` must be
+    `a.shape[axes[-1]]//2+1`, for "c2r" the reverse holds.
+axes : list of integers
+    The axes along which the FFT is carried out.
+    If not set, all axes will be transformed.
+    For "r2c" and "c2r", the real-valued transform is carried out along
+    `axes[-1]`.
+nthreads : int
+    Number of threads to use. If 0, use the system default (typically the number
+    of hardware threads on the compute node).
+
+Notes
+-----
+A plan owns its scratch buffers and must therefore not be executed
+concurrently from several Python threads.
+)""";
+
+const char *plan_exec_DS = R"""(Executes the planned transform.
+
+Parameters
+----------
+a : numpy.ndarray
+    The input data. Must have the same shape, strides and data type as the
+    template used when creating the plan.
+out : numpy.ndarray
+    The output array. Must have the same shape, strides and data type as the
+    template used when creating the plan.
+forward : bool
+    If `True`, a negative sign is used in the exponent, else a positive one.
+inorm : int
+    Normalization type
+      | 0 : no normalization
+      | 1 : divide by sqrt(N)
+      | 2 : divide by N
+
+    where N is the product of the lengths of the transformed real-space axes.
+
+Returns
+-------
+numpy.ndarray (identical to `out`)
+    The transformed data.
+)""";
+
+const char *plan_cache_info_DS = R"""(Returns statistics about the internal cache of 1D FFT plans.
+
+Returns
+-------
+dict
+    with the entries
+      | hits : number of plan requests served from the cache
+      | misses : number of plan requests which required computing a new plan
+      | evictions : number of plans removed from the cache to respect the limits
+      | entries : number of plans currently held in the cache
+      | bytes : estimated memory footprint of the cached plans
+      | max_entries : maximum number of cached plans per plan type
+      | max_bytes : memory budget per plan type
+
+    The counters accumulate over all plan types and precisions since the
+    last call to `clear_plan_cache`.
+)""";
+
+const char *set_plan_cache_limits_DS = R"""(Sets the limits of the internal FFT plan cache.
+
+Parameters
+----------
+max_entries : int
+    Maximum number of plans cached for every plan type and precision.
+    If 0, plans are not cached at all.
+max_bytes : int
+    Memory budget (in bytes) for the plans of every plan type and precision.
+
+Notes
+-----
+If the cache exceeds the new limits, the least recently used plans are
+evicted immediately.
+)""";
+
+const char *clear_plan_cache_DS = R"""(Removes all plans from the internal FFT plan cache and resets its counters.
+)""";
+
+const char *tune_wisdom_DS = R"""(Measures the fastest way of computing 1D FFTs of a given length.
+
+The result is stored in the FFT wisdom and used for all plans created
+afterwards. Alternatives which are measured include different orderings of
+the factors of `length`, vectorized or scalar passes, computing real
+transforms via complex ones, and different convolution lengths for
+Bluestein's algorithm.
+
+Parameters
+----------
+length : int
+    Transform length
+real : bool
+    If True, tune real-valued transforms, else complex ones.
+singleprec : bool
+    If True, tune single precision transforms, else double precision ones.
+)""";
+
+const char *export_wisdom_DS = R"""(Returns the accumulated FFT wisdom.
+
+Returns
+-------
+str
+    The wisdom in a line-based text format.
+    If this is written to a file and the environment variable DUCC0_FFT_WISDOM
+    points to this file, it will be imported automatically when ducc0 starts.
+)""";
+
+const char *import_wisdom_DS = R"""(Adds FFT wisdom.
+
+Parameters
+----------
+wisdom : str
+    Wisdom in the format returned by `export_wisdom`.
+)""";
+
+const char *forget_wisdom_DS = R"""(Discards all FFT wisdom.
+)""";
+
+const char *set_wisdom_measure_DS = R"""(Switches automatic measurements of 1D FFT plans on or off.
+
+Parameters
+----------
+measure : bool
+    If True, the fastest algorithm for every transform length without existing
+    wisdom is measured when the first plan for this length is created.
+    This makes plan creation considerably more expensive.
+)""";
+
 const char * good_size_DS = R"""(Returns a good length to pad an FFT to.
 
 Parameters
@@ -972,6 +1615,12 @@ void add_fft(py::module_ &msup)
   m.doc() = fft_DS;
   m.def("c2c", c2c, c2c_DS, "a"_a, "axes"_a=None, "forward"_a=true,
     "inorm"_a=0, "out"_a=None, "nthreads"_a=1);
+  m.def("c2c_slabs", c2c_slabs, c2c_slabs_DS, "a"_a, "axes"_a=None,
+    "forward"_a=true, "inorm"_a=0, "max_bytes"_a=size_t(1)<<30,
+    "nthreads"_a=1);
+  m.def("c2c_pruned", c2c_pruned, c2c_pruned_DS, "a"_a, "axes"_a,
+    "in_ranges"_a, "out_ranges"_a, "forward"_a=true, "inorm"_a=0,
+    "nthreads"_a=1);
   m.def("r2c", r2c, r2c_DS, "a"_a, "axes"_a=None, "forward"_a=true,
     "inorm"_a=0, "out"_a=None, "nthreads"_a=1);
   m.def("c2r", c2r, c2r_DS, "a"_a, "axes"_a=None, "lastsize"_a=0,
@@ -995,6 +1644,31 @@ void add_fft(py::module_ &msup)
     "out"_a=None, "nthreads"_a=1);
   m.def("convolve_axis", convolve_axis, convolve_axis_DS, "in"_a, "out"_a,
     "axis"_a, "kernel"_a, "nthreads"_a=1);
+  m.def("convolve", convolve, convolve_DS, "in"_a, "kernel"_a,
+    "axes"_a=None, "correlate"_a=false, "out"_a=None, "nthreads"_a=1);
+  m.def("convolve_axis_linear", convolve_axis_linear,
+    convolve_axis_linear_DS, "in"_a, "out"_a, "axis"_a, "kernel"_a,
+    "nthreads"_a=1);
+
+  py::class_<Py_FftPlanND> (m, "plan", py::module_local())
+    .def(py::init<const std::string &, const py::array &, const py::array &,
+                  const py::object &, size_t>(),
+      plan_init_DS, "kind"_a, "a"_a, "out"_a, "axes"_a=None, "nthreads"_a=1)
+    .def("exec", &Py_FftPlanND::exec, plan_exec_DS, "a"_a, "out"_a,
+      "forward"_a=true, "inorm"_a=0)
+    .def("scratch_bytes", &Py_FftPlanND::scratch_bytes);
+
+  m.def("plan_cache_info", plan_cache_info, plan_cache_info_DS);
+  m.def("set_plan_cache_limits", set_plan_cache_limits,
+    set_plan_cache_limits_DS, "max_entries"_a, "max_bytes"_a);
+  m.def("clear_plan_cache", clear_fft_plan_cache, clear_plan_cache_DS);
+  m.def("tune_wisdom", tune_wisdom, tune_wisdom_DS, "length"_a,
+    "real"_a=false, "singleprec"_a=false);
+  m.def("export_wisdom", export_fft_wisdom, export_wisdom_DS);
+  m.def("import_wisdom", import_fft_wisdom, import_wisdom_DS, "wisdom"_a);
+  m.def("forget_wisdom", forget_fft_wisdom, forget_wisdom_DS);
+  m.def("set_wisdom_measure", set_fft_wisdom_measure, set_wisdom_measure_DS,
+    "measure"_a);
 
   static PyMethodDef good_size_meth[] =
     {{"good_size", good_size, METH_VARARGS, good_size_DS},
@@ -117,6 +117,48 @@ py::array Py_nu2u(const py::array &points,
   MR_fail("not yet supported");
   }
 
+template<typename Tpoints, typename Tcoord> py::array Py2_nu2nu(const py::array &points_,
+  const py::array &coord_, const py::array &coord_out_, bool forward,
+  double epsilon, size_t nthreads, py::object &out__, size_t verbosity,
+  double sigma_min, double sigma_max)
+  {
+  auto coord = to_cmav<Tcoord,2>(coord_);
+  auto coord_out = to_cmav<Tcoord,2>(coord_out_);
+  auto points = to_cmav<complex<Tpoints>,1>(points_);
+  auto out_ = get_optional_Pyarr<complex<Tpoints>>(out__, {coord_out.shape(0)});
+  auto out = to_vmav<complex<Tpoints>,1>(out_);
+  {
+  py::gil_scoped_release release;
+  nu2nu<Tpoints,Tpoints>(coord,points,coord_out,forward,epsilon,nthreads,out,
+                         verbosity,sigma_min,sigma_max);
+  }
+  return out_;
+  }
+py::array Py_nu2nu(const py::array &points, const py::array &coord,
+  const py::array &coord_out, bool forward, double epsilon, size_t nthreads,
+  py::object &out, size_t verbosity, double sigma_min, double sigma_max)
+  {
+  if (isPyarr<double>(coord))
+    {
+    if (isPyarr<complex<double>>(points))
+      return Py2_nu2nu<double, double>(points, coord, coord_out, forward,
+        epsilon, nthreads, out, verbosity, sigma_min, sigma_max);
+    else if (isPyarr<complex<float>>(points))
+      return Py2_nu2nu<float, double>(points, coord, coord_out, forward,
+        epsilon, nthreads, out, verbosity, sigma_min, sigma_max);
+    }
+  else if (isPyarr<float>(coord))
+    {
+    if (isPyarr<complex<double>>(points))
+      return Py2_nu2nu<double, float>(points, coord, coord_out, forward,
+        epsilon, nthreads, out, verbosity, sigma_min, sigma_max);
+    else if (isPyarr<complex<float>>(points))
+      return Py2_nu2nu<float, float>(points, coord, coord_out, forward,
+        epsilon, nthreads, out, verbosity, sigma_min, sigma_max);
+    }
+  MR_fail("not yet supported");
+  }
+
 class Py_Nufftplan
   {
   private:
@@ -129,6 +171,8 @@ class Py_Nufftplan
     unique_ptr<Nufft<double, double, double, 2>> pd2;
     unique_ptr<Nufft< float,  float,  float, 3>> pf3;
     unique_ptr<Nufft<double, double, double, 3>> pd3;
+    unique_ptr<Nufft< float,  float,  float, 4>> pf4;
+    unique_ptr<Nufft<double, double, double, 4>> pd4;
 
     template<typename T, size_t ndim> void construct(
       unique_ptr<Nufft<T,T,T,ndim>> &ptr,
@@ -137,14 +181,16 @@ class Py_Nufftplan
       double epsilon_, 
       size_t nthreads_, 
       double sigma_min, double sigma_max,
-      double periodicity, bool fft_order_)
+      double periodicity, bool fft_order_, bool lockfree_spreading_,
+      bool precompute_weights_, bool convert_coords_)
       {
       auto coord = to_cmav<T,2>(coord_);
       auto shp = to_array<size_t,ndim>(uniform_shape_);
       {
       py::gil_scoped_release release;
       ptr = make_unique<Nufft<T,T,T,ndim>> (gridding, coord, shp,
-        epsilon_, nthreads_, sigma_min, sigma_max, periodicity, fft_order_);
+        epsilon_, nthreads_, sigma_min, sigma_max, periodicity, fft_order_,
+        lockfree_spreading_, precompute_weights_, convert_coords_);
       }
       }
     template<typename T, size_t ndim> py::array do_nu2u(
@@ -152,6 +198,19 @@ class Py_Nufftplan
       bool forward, size_t verbosity, const py::array &points_,
       py::object &uniform__) const
       {
+      if (points_.ndim()==2)  // batch of transforms
+        {
+        auto points = to_cmav<complex<T>,2>(points_);
+        auto shp = uniform_shape;
+        shp.insert(shp.begin(), points.shape(0));
+        auto uniform_ = get_optional_Pyarr<complex<T>>(uniform__, shp);
+        auto uniform = to_vmav<complex<T>,ndim+1>(uniform_);
+        {
+        py::gil_scoped_release release;
+        ptr->nu2u(forward, verbosity, points, uniform);
+        }
+        return uniform_;
+        }
       auto points = to_cmav<complex<T>,1>(points_);
       auto uniform_ = get_optional_Pyarr<complex<T>>(uniform__, uniform_shape);
       auto uniform = to_vmav<complex<T>,ndim>(uniform_);
@@ -166,6 +225,18 @@ class Py_Nufftplan
       bool forward, size_t verbosity, const py::array &uniform_,
       py::object &points__) const
       {
+      if (size_t(uniform_.ndim())==ndim+1)  // batch of transforms
+        {
+        auto uniform = to_cmav<complex<T>,ndim+1>(uniform_);
+        auto points_ = get_optional_Pyarr<complex<T>>(points__,
+          {uniform.shape(0), npoints});
+        auto points = to_vmav<complex<T>,2>(points_);
+        {
+        py::gil_scoped_release release;
+        ptr->u2nu(forward, verbosity, uniform, points);
+        }
+        return points_;
+        }
       auto uniform = to_cmav<complex<T>,ndim>(uniform_);
       auto points_ = get_optional_Pyarr<complex<T>>(points__, {npoints});
       auto points = to_vmav<complex<T>,1>(points_);
@@ -176,41 +247,93 @@ class Py_Nufftplan
       return points_;
       }
 
+    template<typename T, size_t ndim> void do_prep_normal(
+      const unique_ptr<Nufft<T,T,T,ndim>> &ptr, bool forward,
+      const py::object &weights_)
+      {
+      auto weights = weights_.is_none() ? cmav<T,1>(vmav<T,1>({0}))
+                                        : to_cmav<T,1>(weights_);
+      {
+      py::gil_scoped_release release;
+      ptr->prep_normal(forward, weights);
+      }
+      }
+    template<typename T, size_t ndim> py::array do_apply_normal(
+      const unique_ptr<Nufft<T,T,T,ndim>> &ptr, const py::array &uniform_,
+      py::object &out__)
+      {
+      auto shp = uniform_shape;
+      if (size_t(uniform_.ndim())==ndim+1)  // batch of transforms
+        shp.insert(shp.begin(), size_t(uniform_.shape(0)));
+      auto out_ = get_optional_Pyarr<complex<T>>(out__, shp);
+      if (size_t(uniform_.ndim())==ndim+1)
+        {
+        auto uniform = to_cmav<complex<T>,ndim+1>(uniform_);
+        auto out = to_vmav<complex<T>,ndim+1>(out_);
+        py::gil_scoped_release release;
+        ptr->apply_normal(uniform, out);
+        }
+      else
+        {
+        auto uniform = to_cmav<complex<T>,ndim>(uniform_);
+        auto out = to_vmav<complex<T>,ndim>(out_);
+        py::gil_scoped_release release;
+        ptr->apply_normal(uniform, out);
+        }
+      return out_;
+      }
+
   public:
     Py_Nufftplan(bool gridding, const py::array &coord_,
                  const py::object &uniform_shape_,
                  double epsilon_, 
                  size_t nthreads_, 
                  double sigma_min, double sigma_max,
-                 double periodicity, bool fft_order_)
+                 double periodicity, bool fft_order_,
+                 bool lockfree_spreading_, bool precompute_weights_,
+                 bool convert_coords_)
       : uniform_shape(py::cast<vector<size_t>>(uniform_shape_)),
         npoints(coord_.shape(0))
       {
       auto ndim = uniform_shape.size();
-      MR_assert((ndim>=1)&&(ndim<=3), "unsupported dimensionality");
+      MR_assert((ndim>=1)&&(ndim<=4), "unsupported dimensionality");
       if (isPyarr<double>(coord_))
         {
         if (ndim==1)
           construct(pd1, gridding, coord_, uniform_shape_, epsilon_, nthreads_,
-                    sigma_min, sigma_max, periodicity, fft_order_);
+                    sigma_min, sigma_max, periodicity, fft_order_, lockfree_spreading_,
+                    precompute_weights_, convert_coords_);
         else if (ndim==2)
           construct(pd2, gridding, coord_, uniform_shape_, epsilon_, nthreads_,
-            sigma_min, sigma_max, periodicity, fft_order_);
+            sigma_min, sigma_max, periodicity, fft_order_, lockfree_spreading_,
+            precompute_weights_, convert_coords_);
         else if (ndim==3)
           construct(pd3, gridding, coord_, uniform_shape_, epsilon_, nthreads_,
-            sigma_min, sigma_max, periodicity, fft_order_);
+            sigma_min, sigma_max, periodicity, fft_order_, lockfree_spreading_,
+            precompute_weights_, convert_coords_);
+        else if (ndim==4)
+          construct(pd4, gridding, coord_, uniform_shape_, epsilon_, nthreads_,
+            sigma_min, sigma_max, periodicity, fft_order_, lockfree_spreading_,
+            precompute_weights_, convert_coords_);
         }
       else if (isPyarr<float>(coord_))
         {
         if (ndim==1)
           construct(pf1, gridding, coord_, uniform_shape_, epsilon_, nthreads_,
-            sigma_min, sigma_max, periodicity, fft_order_);
+            sigma_min, sigma_max, periodicity, fft_order_, lockfree_spreading_,
+            precompute_weights_, convert_coords_);
         else if (ndim==2)
           construct(pf2, gridding, coord_, uniform_shape_, epsilon_, nthreads_,
-            sigma_min, sigma_max, periodicity, fft_order_);
+            sigma_min, sigma_max, periodicity, fft_order_, lockfree_spreading_,
+            precompute_weights_, convert_coords_);
         else if (ndim==3)
           construct(pf3, gridding, coord_, uniform_shape_, epsilon_, nthreads_,
-            sigma_min, sigma_max, periodicity, fft_order_);
+            sigma_min, sigma_max, periodicity, fft_order_, lockfree_spreading_,
+            precompute_weights_, convert_coords_);
+        else if (ndim==4)
+          construct(pf4, gridding, coord_, uniform_shape_, epsilon_, nthreads_,
+            sigma_min, sigma_max, periodicity, fft_order_, lockfree_spreading_,
+            precompute_weights_, convert_coords_);
         }
       else
         MR_fail("unsupported");
@@ -225,6 +348,8 @@ class Py_Nufftplan
       if (pf2) return do_nu2u(pf2, forward, verbosity, points_, uniform_);
       if (pd3) return do_nu2u(pd3, forward, verbosity, points_, uniform_);
       if (pf3) return do_nu2u(pf3, forward, verbosity, points_, uniform_);
+      if (pd4) return do_nu2u(pd4, forward, verbosity, points_, uniform_);
+      if (pf4) return do_nu2u(pf4, forward, verbosity, points_, uniform_);
       MR_fail("unsupported");
       }
     py::array u2nu(bool forward, size_t verbosity,
@@ -236,17 +361,305 @@ class Py_Nufftplan
       if (pf2) return do_u2nu(pf2, forward, verbosity, uniform_, points_);
       if (pd3) return do_u2nu(pd3, forward, verbosity, uniform_, points_);
       if (pf3) return do_u2nu(pf3, forward, verbosity, uniform_, points_);
+      if (pd4) return do_u2nu(pd4, forward, verbosity, uniform_, points_);
+      if (pf4) return do_u2nu(pf4, forward, verbosity, uniform_, points_);
+      MR_fail("unsupported");
+      }
+    void prep_normal(bool forward, const py::object &weights_)
+      {
+      if (pd1) return do_prep_normal(pd1, forward, weights_);
+      if (pf1) return do_prep_normal(pf1, forward, weights_);
+      if (pd2) return do_prep_normal(pd2, forward, weights_);
+      if (pf2) return do_prep_normal(pf2, forward, weights_);
+      if (pd3) return do_prep_normal(pd3, forward, weights_);
+      if (pf3) return do_prep_normal(pf3, forward, weights_);
+      if (pd4) return do_prep_normal(pd4, forward, weights_);
+      if (pf4) return do_prep_normal(pf4, forward, weights_);
+      MR_fail("unsupported");
+      }
+    py::array apply_normal(const py::array &uniform_, py::object &out_)
+      {
+      if (pd1) return do_apply_normal(pd1, uniform_, out_);
+      if (pf1) return do_apply_normal(pf1, uniform_, out_);
+      if (pd2) return do_apply_normal(pd2, uniform_, out_);
+      if (pf2) return do_apply_normal(pf2, uniform_, out_);
+      if (pd3) return do_apply_normal(pd3, uniform_, out_);
+      if (pf3) return do_apply_normal(pf3, uniform_, out_);
+      if (pd4) return do_apply_normal(pd4, uniform_, out_);
+      if (pf4) return do_apply_normal(pf4, uniform_, out_);
+      MR_fail("unsupported");
+      }
+  };
+
+
+class Py_Nufft3plan
+  {
+  private:
+    size_t npoints_out;
+
+    unique_ptr<Nufft3< float,  float,  float, 1>> pf1;
+    unique_ptr<Nufft3<double, double, double, 1>> pd1;
+    unique_ptr<Nufft3< float,  float,  float, 2>> pf2;
+    unique_ptr<Nufft3<double, double, double, 2>> pd2;
+    unique_ptr<Nufft3< float,  float,  float, 3>> pf3;
+    unique_ptr<Nufft3<double, double, double, 3>> pd3;
+
+    template<typename T, size_t ndim> void construct(
+      unique_ptr<Nufft3<T,T,T,ndim>> &ptr, const py::array &coord_,
+      const py::array &coord_out_, double epsilon_, size_t nthreads_,
+      double sigma_min, double sigma_max)
+      {
+      auto coord = to_cmav<T,2>(coord_);
+      auto coord_out = to_cmav<T,2>(coord_out_);
+      {
+      py::gil_scoped_release release;
+      ptr = make_unique<Nufft3<T,T,T,ndim>> (coord, coord_out, epsilon_,
+        nthreads_, sigma_min, sigma_max);
+      }
+      }
+    template<typename T, size_t ndim> py::array do_nu2nu(
+      const unique_ptr<Nufft3<T,T,T,ndim>> &ptr,
+      bool forward, size_t verbosity, const py::array &points_,
+      py::object &out__) const
+      {
+      if (points_.ndim()==2)  // batch of transforms
+        {
+        auto points = to_cmav<complex<T>,2>(points_);
+        auto out_ = get_optional_Pyarr<complex<T>>(out__,
+          {points.shape(0), npoints_out});
+        auto out = to_vmav<complex<T>,2>(out_);
+        {
+        py::gil_scoped_release release;
+        ptr->nu2nu(forward, verbosity, points, out);
+        }
+        return out_;
+        }
+      auto points = to_cmav<complex<T>,1>(points_);
+      auto out_ = get_optional_Pyarr<complex<T>>(out__, {npoints_out});
+      auto out = to_vmav<complex<T>,1>(out_);
+      {
+      py::gil_scoped_release release;
+      ptr->nu2nu(forward, verbosity, points, out);
+      }
+      return out_;
+      }
+
+  public:
+    Py_Nufft3plan(const py::array &coord_, const py::array &coord_out_,
+                  double epsilon_, size_t nthreads_,
+                  double sigma_min, double sigma_max)
+      : npoints_out(coord_out_.shape(0))
+      {
+      MR_assert((coord_.ndim()==2) && (coord_out_.ndim()==2),
+        "coordinate arrays must be two-dimensional");
+      auto ndim = size_t(coord_.shape(1));
+      MR_assert((ndim>=1)&&(ndim<=3), "unsupported dimensionality");
+      if (isPyarr<double>(coord_))
+        {
+        if (ndim==1)
+          construct(pd1, coord_, coord_out_, epsilon_, nthreads_, sigma_min, sigma_max);
+        else if (ndim==2)
+          construct(pd2, coord_, coord_out_, epsilon_, nthreads_, sigma_min, sigma_max);
+        else if (ndim==3)
+          construct(pd3, coord_, coord_out_, epsilon_, nthreads_, sigma_min, sigma_max);
+        }
+      else if (isPyarr<float>(coord_))
+        {
+        if (ndim==1)
+          construct(pf1, coord_, coord_out_, epsilon_, nthreads_, sigma_min, sigma_max);
+        else if (ndim==2)
+          construct(pf2, coord_, coord_out_, epsilon_, nthreads_, sigma_min, sigma_max);
+        else if (ndim==3)
+          construct(pf3, coord_, coord_out_, epsilon_, nthreads_, sigma_min, sigma_max);
+        }
+      else
+        MR_fail("unsupported");
+      }
+
+    py::array nu2nu(bool forward, size_t verbosity,
+      const py::array &points_, py::object &out_)
+      {
+      if (pd1) return do_nu2nu(pd1, forward, verbosity, points_, out_);
+      if (pf1) return do_nu2nu(pf1, forward, verbosity, points_, out_);
+      if (pd2) return do_nu2nu(pd2, forward, verbosity, points_, out_);
+      if (pf2) return do_nu2nu(pf2, forward, verbosity, points_, out_);
+      if (pd3) return do_nu2nu(pd3, forward, verbosity, points_, out_);
+      if (pf3) return do_nu2nu(pf3, forward, verbosity, points_, out_);
       MR_fail("unsupported");
       }
   };
 
 
+class Py_Nu2uAccumulator
+  {
+  private:
+    vector<size_t> uniform_shape;
+    size_t ntrans;  // 0: no points added yet
+    bool batched;
+
+    unique_ptr<Nufft< float,  float,  float, 1>> pf1;
+    unique_ptr<Nufft<double, double, double, 1>> pd1;
+    unique_ptr<Nufft< float,  float,  float, 2>> pf2;
+    unique_ptr<Nufft<double, double, double, 2>> pd2;
+    unique_ptr<Nufft< float,  float,  float, 3>> pf3;
+    unique_ptr<Nufft<double, double, double, 3>> pd3;
+
+    template<typename T, size_t ndim> void construct(
+      unique_ptr<Nufft<T,T,T,ndim>> &ptr, size_t npoints, double epsilon_,
+      size_t nthreads_, double sigma_min, double sigma_max,
+      double periodicity, bool fft_order_)
+      {
+      array<size_t,ndim> shp;
+      for (size_t i=0; i<ndim; ++i) shp[i] = uniform_shape[i];
+      {
+      py::gil_scoped_release release;
+      ptr = make_unique<Nufft<T,T,T,ndim>> (true, npoints, shp, epsilon_,
+        nthreads_, sigma_min, sigma_max, periodicity, fft_order_);
+      }
+      }
+    template<typename T, size_t ndim> void do_add(
+      const unique_ptr<Nufft<T,T,T,ndim>> &ptr, const py::array &coord_,
+      const py::array &points_)
+      {
+      auto coord = to_cmav<T,2>(coord_);
+      bool batched_ = points_.ndim()==2;
+      auto points = batched_ ? to_cmav<complex<T>,2>(points_)
+                             : to_cmav<complex<T>,1>(points_).prepend_1();
+      if (ntrans==0)
+        { ntrans = points.shape(0); batched = batched_; }
+      MR_assert((points.shape(0)==ntrans) && (batched==batched_),
+        "number of transforms mismatch");
+      {
+      py::gil_scoped_release release;
+      ptr->nu2u_add(coord, points);
+      }
+      }
+    template<typename T, size_t ndim> py::array do_finish(
+      const unique_ptr<Nufft<T,T,T,ndim>> &ptr, bool forward,
+      size_t verbosity, py::object &uniform__)
+      {
+      auto shp = uniform_shape;
+      if (batched) shp.insert(shp.begin(), ntrans);
+      auto uniform_ = get_optional_Pyarr<complex<T>>(uniform__, shp);
+      auto uniform = batched ? to_vmav<complex<T>,ndim+1>(uniform_)
+                             : to_vmav<complex<T>,ndim>(uniform_).prepend_1();
+      {
+      py::gil_scoped_release release;
+      ptr->nu2u_finish(forward, verbosity, uniform);
+      }
+      ntrans = 0;
+      return uniform_;
+      }
+
+  public:
+    Py_Nu2uAccumulator(const py::object &uniform_shape_, size_t npoints,
+                       double epsilon_, bool singleprec, size_t nthreads_,
+                       double sigma_min, double sigma_max,
+                       double periodicity, bool fft_order_)
+      : uniform_shape(py::cast<vector<size_t>>(uniform_shape_)),
+        ntrans(0), batched(false)
+      {
+      auto ndim = uniform_shape.size();
+      MR_assert((ndim>=1)&&(ndim<=3), "unsupported dimensionality");
+      if (!singleprec)
+        {
+        if (ndim==1)
+          construct(pd1, npoints, epsilon_, nthreads_, sigma_min, sigma_max,
+            periodicity, fft_order_);
+        else if (ndim==2)
+          construct(pd2, npoints, epsilon_, nthreads_, sigma_min, sigma_max,
+            periodicity, fft_order_);
+        else if (ndim==3)
+          construct(pd3, npoints, epsilon_, nthreads_, sigma_min, sigma_max,
+            periodicity, fft_order_);
+        }
+      else
+        {
+        if (ndim==1)
+          construct(pf1, npoints, epsilon_, nthreads_, sigma_min, sigma_max,
+            periodicity, fft_order_);
+        else if (ndim==2)
+          construct(pf2, npoints, epsilon_, nthreads_, sigma_min, sigma_max,
+            periodicity, fft_order_);
+        else if (ndim==3)
+          construct(pf3, npoints, epsilon_, nthreads_, sigma_min, sigma_max,
+            periodicity, fft_order_);
+        }
+      }
+
+    void add(const py::array &coord_, const py::array &points_)
+      {
+      if (pd1) return do_add(pd1, coord_, points_);
+      if (pf1) return do_add(pf1, coord_, points_);
+      if (pd2) return do_add(pd2, coord_, points_);
+      if (pf2) return do_add(pf2, coord_, points_);
+      if (pd3) return do_add(pd3, coord_, points_);
+      if (pf3) return do_add(pf3, coord_, points_);
+      MR_fail("unsupported");
+      }
+    py::array finish(bool forward, size_t verbosity, py::object &uniform_)
+      {
+      if (pd1) return do_finish(pd1, forward, verbosity, uniform_);
+      if (pf1) return do_finish(pf1, forward, verbosity, uniform_);
+      if (pd2) return do_finish(pd2, forward, verbosity, uniform_);
+      if (pf2) return do_finish(pf2, forward, verbosity, uniform_);
+      if (pd3) return do_finish(pd3, forward, verbosity, uniform_);
+      if (pf3) return do_finish(pf3, forward, verbosity, uniform_);
+      MR_fail("unsupported");
+      }
+  };
+
+py::dict cost_model2dict(const GriddingCostModel &model)
+  {
+  py::dict res;
+  res["fft_cost"] = model.fft_cost;
+  res["gridding_cost"] = model.gridding_cost;
+  res["max_fft_scaling"] = model.max_fft_scaling;
+  res["fft_cost_single"] = model.fft_cost_single;
+  res["gridding_cost_single"] = model.gridding_cost_single;
+  return res;
+  }
+
+py::dict Py_get_cost_model()
+  { return cost_model2dict(getGriddingCostModel()); }
+
+void Py_set_cost_model(const py::object &model_)
+  {
+  GriddingCostModel model;
+  if (!model_.is_none())
+    {
+    model = getGriddingCostModel();
+    for (auto item: model_.cast<py::dict>())
+      {
+      auto key = item.first.cast<string>();
+      auto val = item.second.cast<double>();
+      if (key=="fft_cost") model.fft_cost = val;
+      else if (key=="gridding_cost") model.gridding_cost = val;
+      else if (key=="max_fft_scaling") model.max_fft_scaling = val;
+      else if (key=="fft_cost_single") model.fft_cost_single = val;
+      else if (key=="gridding_cost_single") model.gridding_cost_single = val;
+      else MR_fail("unknown cost model entry '", key, "'");
+      }
+    }
+  setGriddingCostModel(model);
+  }
+
+py::dict Py_calibrate_cost_model(size_t nthreads, size_t npoints, bool activate)
+  {
+  GriddingCostModel res;
+  {
+  py::gil_scoped_release release;
+  res = calibrateGriddingCostModel(nthreads, npoints, activate);
+  }
+  return cost_model2dict(res);
+  }
+
 constexpr const char *u2nu_DS = R"""(
 Type 2 non-uniform FFT (uniform to non-uniform)
 
 Parameters
 ----------
-grid : numpy.ndarray(1D/2D/3D, dtype=complex)
+grid : numpy.ndarray(1D/2D/3D/4D, dtype=complex)
     the grid of input data
 coord : numpy.ndarray((npoints, ndim), dtype=numpy.float32 or numpy.float64)
     the coordinates of the npoints non-uniform points.
@@ -303,7 +716,7 @@ epsilon : float
 nthreads : int >= 0
     the number of threads to use for the computation
     if 0, use as many threads as there are hardware threads available on the system
-out : numpy.ndarray(1D/2D/3D, same dtype as points)
+out : numpy.ndarray(1D/2D/3D/4D, same dtype as points)
     the grid of output data
     Note: this is a mandatory parameter, since its shape defines the grid dimensions!
 verbosity: int
@@ -320,11 +733,51 @@ fft_order: bool
 
 Returns
 -------
-numpy.ndarray(1D/2D/3D, same dtype as points)
+numpy.ndarray(1D/2D/3D/4D, same dtype as points)
     the computed grid values.
     Identical to `out`.
 )""";
 
+constexpr const char *nu2nu_DS = R"""(
+Type 3 non-uniform FFT (non-uniform to non-uniform)
+
+Computes out[k] = sum_j points[j]*exp(+-i*dot(coord_out[k], coord[j])).
+
+Parameters
+----------
+points : numpy.ndarray((npoints,), dtype=numpy.complex)
+    The input values at the specified non-uniform points
+coord : numpy.ndarray((npoints, ndim), dtype=numpy.float32 or numpy.float64)
+    the coordinates of the npoints non-uniform input points.
+    No periodicity is assumed.
+coord_out : numpy.ndarray((npoints_out, ndim), same dtype as coord)
+    the coordinates of the npoints_out non-uniform output points.
+    No periodicity is assumed.
+forward : bool
+    if True, perform the FFT with exponent -1, else +1.
+epsilon : float
+    desired accuracy
+    for single precision inputs, this must be >1e-6, for double precision it
+    must be >2e-13
+nthreads : int >= 0
+    the number of threads to use for the computation
+    if 0, use as many threads as there are hardware threads available on the system
+out : numpy.ndarray((npoints_out,), same dtype as points), optional
+    if provided, this will be used to store the result
+verbosity: int
+    0: no console output
+    1: some diagnostic console output
+sigma_min, sigma_max: float
+    minimum and maximum allowed oversampling factors
+    1.2 <= sigma_min < sigma_max <= 2.5
+
+Returns
+-------
+numpy.ndarray((npoints_out,), same dtype as points)
+    the computed values at the non-uniform output points.
+    Identical to `out` if it was provided
+)""";
+
 constexpr const char *plan_init_DS = R"""(
 Nufft plan constructor
 
@@ -356,6 +809,22 @@ periodicity: float
 fft_order: bool
     if False, grids start with the most negative Fourier node
     if True, grids start with the zero Fourier mode
+lockfree_spreading: bool
+    if True, nu2u transforms avoid locking the oversampled grid by processing
+    the tiles of the grid in several groups, whose members never overlap.
+    This can be faster for many threads and strongly clustered points.
+precompute_weights: bool
+    if True, the kernel weights of all points are computed once and stored
+    in the plan, so that they need not be recomputed in every transform.
+    This can be faster if the plan is applied many times, but needs
+    ndim*(supp*sizeof(float/double)+4) additional bytes per point, where supp
+    is the kernel support (reported for verbosity>0).
+convert_coords: bool
+    if True, the coordinates are converted once to grid indices and kernel
+    arguments, which are stored in the plan. This saves the range reduction
+    of the coordinates (carried out in long double precision for float64
+    coordinates) in every transform, but needs ndim*(sizeof(float/double)+4)
+    additional bytes per point. Has no effect if precompute_weights is True.
 )""";
 
 constexpr const char *plan_nu2u_DS = R"""(
@@ -368,15 +837,20 @@ forward : bool
 verbosity: int
     0: no console output
     1: some diagnostic console output
-points : numpy.ndarray((npoints,), dtype=numpy.complex)
-    The input values at the specified non-uniform grid points
-out : numpy.ndarray(1D/2D/3D, same dtype as points)
+points : numpy.ndarray((npoints,) or (ntrans, npoints), dtype=numpy.complex)
+    The input values at the specified non-uniform grid points.
+    If two-dimensional, `ntrans` transforms with the same coordinates are
+    carried out together; this is considerably cheaper than `ntrans`
+    separate calls, since the kernel weights are only computed once.
+out : numpy.ndarray(1D/2D/3D/4D, same dtype as points)
     if provided, this will be used to store he result.
+    For batched transforms, its shape must be `(ntrans,)+grid_shape`.
 
 Returns
 -------
-numpy.ndarray(1D/2D/3D, same dtype as points)
+numpy.ndarray(1D/2D/3D/4D, same dtype as points)
     the computed grid values.
+    For batched transforms, the shape is `(ntrans,)+grid_shape`.
     Identical to `out` if it was provided.
 )""";
 
@@ -390,24 +864,186 @@ forward : bool
 verbosity: int
     0: no console output
     1: some diagnostic console output
-grid : numpy.ndarray(1D/2D/3D, dtype=complex)
-    the grid of input data
-out : numpy.ndarray((npoints,), same data type as grid), optional
+grid : numpy.ndarray(1D/2D/3D/4D, dtype=complex)
+    the grid of input data.
+    If it has one more dimension than `grid_shape`, the first axis is
+    interpreted as enumerating `ntrans` independent transforms, which are
+    carried out together.
+out : numpy.ndarray((npoints,) or (ntrans, npoints), same data type as grid), optional
     if provided, this will be used to store the result
 
 Returns
 -------
-numpy.ndarray((npoints,), same data type as grid)
+numpy.ndarray((npoints,) or (ntrans, npoints), same data type as grid)
     the computed values at the specified non-uniform grid points.
     Identical to `out` if it was provided.
 )""";
 
+constexpr const char *plan_prep_normal_DS = R"""(
+Prepare the application of the normal operator A^H W A, where A is the u2nu
+transform of this plan in the given direction, A^H the corresponding nu2u
+transform in the opposite direction, and W a diagonal matrix of weights.
+
+This carries out a single nu2u transform onto a grid of about twice the size
+of the uniform grid per axis; afterwards `apply_normal` does not need any
+spreading or interpolation, but only two FFTs on a grid of this size.
+
+Parameters
+----------
+forward : bool
+    direction of the u2nu transform A
+weights : numpy.ndarray((npoints,), dtype=numpy.float32 or numpy.float64), optional
+    the weights of the non-uniform points (same data type as the
+    coordinates). If not provided, all weights are 1.
+)""";
+
+constexpr const char *plan_apply_normal_DS = R"""(
+Apply the normal operator prepared by `prep_normal`.
+
+The result agrees with `nu2u(points=w*u2nu(grid=grid, forward=forward),
+forward=not forward)` within the accuracy of the plan.
+
+Parameters
+----------
+grid : numpy.ndarray(1D/2D/3D/4D, dtype=complex)
+    the uniform input grid, or a batch of grids (with one additional leading
+    dimension)
+out : numpy.ndarray(same shape and data type as grid), optional
+    if provided, this will be used to store the result
+
+Returns
+-------
+numpy.ndarray(same shape and data type as grid)
+    the result of the normal operator.
+    Identical to `out` if it was provided.
+)""";
+
+constexpr const char *plan3_init_DS = R"""(
+Type 3 Nufft plan constructor
+
+The expensive preparation steps which only depend on the coordinates are
+carried out here, so that repeated transforms with the same input and output
+coordinates are cheap.
+
+Parameters
+----------
+coord : numpy.ndarray((npoints, ndim), dtype=numpy.float32 or numpy.float64)
+    the coordinates of the npoints non-uniform input points.
+    No periodicity is assumed.
+coord_out : numpy.ndarray((npoints_out, ndim), same dtype as coord)
+    the coordinates of the npoints_out non-uniform output points.
+    No periodicity is assumed.
+epsilon : float
+    desired accuracy
+    for single precision inputs, this must be >1e-6, for double precision it
+    must be >2e-13
+nthreads : int >= 0
+    the number of threads to use for the computation
+    if 0, use as many threads as there are hardware threads available on the system
+sigma_min, sigma_max: float
+    minimum and maximum allowed oversampling factors
+    1.2 <= sigma_min < sigma_max <= 2.5
+)""";
+
+constexpr const char *plan3_nu2nu_DS = R"""(
+Perform a pre-planned nu2nu transform.
+
+Parameters
+----------
+forward : bool
+    if True, perform the FFT with exponent -1, else +1.
+verbosity: int
+    0: no console output
+    1: some diagnostic console output
+points : numpy.ndarray((npoints,) or (ntrans, npoints), dtype=numpy.complex)
+    The input values at the non-uniform input points.
+    If two-dimensional, `ntrans` transforms with the same coordinates are
+    carried out together.
+out : numpy.ndarray((npoints_out,) or (ntrans, npoints_out), same dtype as points), optional
+    if provided, this will be used to store the result
+
+Returns
+-------
+numpy.ndarray((npoints_out,) or (ntrans, npoints_out), same dtype as points)
+    the computed values at the non-uniform output points.
+    Identical to `out` if it was provided.
+)""";
+
+constexpr const char *accumulator_init_DS = R"""(
+Accumulator for nu2u transforms of point sets which are too large to be
+held in memory at once.
+
+The non-uniform points are provided in chunks of arbitrary size via `add`,
+which spreads them onto an oversampled grid held by the object. `finish`
+then computes the result and resets the accumulator, so that it can be used
+for a new transform.
+
+Parameters
+----------
+grid_shape : tuple(int) of length ndim
+    the shape of the uniform grid
+npoints : int
+    estimated total number of non-uniform points.
+    This is only used for choosing the optimal transform parameters.
+epsilon : float
+    desired accuracy
+    for single precision inputs, this must be >1e-6, for double precision it
+    must be >2e-13
+singleprec : bool
+    if True, coordinates, points and result are single precision,
+    otherwise double precision
+nthreads : int >= 0
+    the number of threads to use for the computation
+    if 0, use as many threads as there are hardware threads available on the system
+sigma_min, sigma_max: float
+    minimum and maximum allowed oversampling factors
+    1.2 <= sigma_min < sigma_max <= 2.5
+periodicity: float
+    periodicity of the coordinates
+fft_order: bool
+    if False, grids start with the most negative Fourier node
+    if True, grids start with the zero Fourier mode
+)""";
+
+constexpr const char *accumulator_add_DS = R"""(
+Spreads a chunk of non-uniform points onto the internal oversampled grid.
+
+Parameters
+----------
+coord : numpy.ndarray((nchunk, ndim), dtype=numpy.float32 or numpy.float64)
+    the coordinates of the points in this chunk
+points : numpy.ndarray((nchunk,) or (ntrans, nchunk), dtype=numpy.complex)
+    The values at the points in this chunk.
+    The number of transforms must be the same for all chunks of a transform.
+)""";
+
+constexpr const char *accumulator_finish_DS = R"""(
+Computes the nu2u transform of all points added so far, and resets the
+accumulator.
+
+Parameters
+----------
+forward : bool
+    if True, perform the FFT with exponent -1, else +1.
+verbosity: int
+    0: no console output
+    1: some diagnostic console output
+out : numpy.ndarray(grid_shape or (ntrans,)+grid_shape, dtype=numpy.complex), optional
+    if provided, this will be used to store he result.
+
+Returns
+-------
+numpy.ndarray(grid_shape or (ntrans,)+grid_shape, dtype=numpy.complex)
+    the computed grid values.
+    Identical to `out` if it was provided.
+)""";
+
 constexpr const char *bestEpsilon_DS = R"""(
 Computes the smallest possible error for the given NUFFT parameters.
 
 Parameters
 ----------
-ndim : int (1-3)
+ndim : int (1-4)
     the dimensionality of the transform
 singleprec : bool
     True if np.float32/np.complex64 are used, otherwise False
@@ -421,6 +1057,66 @@ float
     the smallest possible error that can be achieved for the given parameters.
 )""";
 
+constexpr const char *get_cost_model_DS = R"""(
+Returns the machine-dependent cost model used for choosing kernels and
+oversampling factors in `ducc0.nufft` and `ducc0.wgridder`.
+
+Returns
+-------
+dict
+    with the entries
+      | fft_cost : time (in s) of a single-threaded 2048x2048 complex FFT
+      | gridding_cost : time (in s) per kernel evaluation and grid update
+        per SIMD lane
+      | max_fft_scaling : asymptotic speedup of FFTs for many threads
+      | fft_cost_single : like fft_cost, but for single precision
+      | gridding_cost_single : like gridding_cost, but for single precision
+)""";
+
+constexpr const char *set_cost_model_DS = R"""(
+Sets the machine-dependent cost model used for choosing kernels and
+oversampling factors in `ducc0.nufft` and `ducc0.wgridder`.
+
+Parameters
+----------
+model : dict or None
+    Entries in the format returned by `get_cost_model`. Missing entries keep
+    their current values.
+    If None, the built-in default model is restored.
+
+Notes
+-----
+The initial model can also be provided via the environment variable
+DUCC0_GRIDDING_COST_MODEL, containing the values of fft_cost, gridding_cost,
+max_fft_scaling, fft_cost_single and gridding_cost_single, separated by
+commas. If only the first three values are given, they are also used for
+single precision.
+)""";
+
+constexpr const char *calibrate_cost_model_DS = R"""(
+Measures FFT and spreading/interpolation throughput on the current machine
+in single and double precision and derives a cost model from the timings.
+
+Parameters
+----------
+nthreads : int
+    number of threads used for measuring FFT scalability
+    0: use as many threads as sensible
+npoints : int
+    number of nonuniform points used for measuring spreading throughput
+activate : bool
+    if True, the measured model is used for all subsequent operations
+
+Returns
+-------
+dict
+    the measured cost model, in the format returned by `get_cost_model`.
+
+Notes
+-----
+Calibration takes a few seconds. The result can be stored and restored
+later via `set_cost_model`.
+)""";
 
 void add_nufft(py::module_ &msup)
   {
@@ -435,19 +1131,54 @@ void add_nufft(py::module_ &msup)
         "forward"_a, "epsilon"_a, "nthreads"_a=1, "out"_a=None, "verbosity"_a=0,
         "sigma_min"_a=1.2, "sigma_max"_a=2.51, "periodicity"_a=2*pi,
         "fft_order"_a=false);
+  m.def("nu2nu", &Py_nu2nu, nu2nu_DS, py::kw_only(), "points"_a, "coord"_a,
+        "coord_out"_a, "forward"_a, "epsilon"_a, "nthreads"_a=1, "out"_a=None,
+        "verbosity"_a=0, "sigma_min"_a=1.2, "sigma_max"_a=2.51);
   m.def("bestEpsilon", &bestEpsilon, bestEpsilon_DS, py::kw_only(),
         "ndim"_a, "singleprec"_a, "sigma_min"_a=1.1, "sigma_max"_a=2.6);
+  m.def("get_cost_model", &Py_get_cost_model, get_cost_model_DS);
+  m.def("set_cost_model", &Py_set_cost_model, set_cost_model_DS,
+        "model"_a=None);
+  m.def("calibrate_cost_model", &Py_calibrate_cost_model,
+        calibrate_cost_model_DS, py::kw_only(), "nthreads"_a=1,
+        "npoints"_a=1000000, "activate"_a=true);
 
   py::class_<Py_Nufftplan> (m, "plan", py::module_local())
     .def(py::init<bool, const py::array &, const py::object &,
-                  double, size_t, double, double, double, bool>(),
+                  double, size_t, double, double, double, bool, bool, bool,
+                  bool>(),
       plan_init_DS, py::kw_only(), "nu2u"_a, "coord"_a, "grid_shape"_a,
         "epsilon"_a, "nthreads"_a=0, "sigma_min"_a=1.1, "sigma_max"_a=2.6,
-        "periodicity"_a=2*pi, "fft_order"_a=false)
+        "periodicity"_a=2*pi, "fft_order"_a=false,
+        "lockfree_spreading"_a=false, "precompute_weights"_a=false,
+        "convert_coords"_a=false)
     .def("nu2u", &Py_Nufftplan::nu2u, plan_nu2u_DS, py::kw_only(), "forward"_a,
       "verbosity"_a=0, "points"_a, "out"_a=None)
-    .def("u2nu", &Py_Nufftplan::u2nu, py::kw_only(), "forward"_a,
-      "verbosity"_a=0, "grid"_a, "out"_a=None);
+    .def("u2nu", &Py_Nufftplan::u2nu, plan_u2nu_DS, py::kw_only(), "forward"_a,
+      "verbosity"_a=0, "grid"_a, "out"_a=None)
+    .def("prep_normal", &Py_Nufftplan::prep_normal, plan_prep_normal_DS,
+      py::kw_only(), "forward"_a, "weights"_a=None)
+    .def("apply_normal", &Py_Nufftplan::apply_normal, plan_apply_normal_DS,
+      py::kw_only(), "grid"_a, "out"_a=None);
+
+  py::class_<Py_Nu2uAccumulator> (m, "nu2u_accumulator", py::module_local())
+    .def(py::init<const py::object &, size_t, double, bool, size_t, double,
+                  double, double, bool>(),
+      accumulator_init_DS, py::kw_only(), "grid_shape"_a, "npoints"_a,
+        "epsilon"_a, "singleprec"_a=false, "nthreads"_a=0, "sigma_min"_a=1.1,
+        "sigma_max"_a=2.6, "periodicity"_a=2*pi, "fft_order"_a=false)
+    .def("add", &Py_Nu2uAccumulator::add, accumulator_add_DS, py::kw_only(),
+      "coord"_a, "points"_a)
+    .def("finish", &Py_Nu2uAccumulator::finish, accumulator_finish_DS,
+      py::kw_only(), "forward"_a, "verbosity"_a=0, "out"_a=None);
+
+  py::class_<Py_Nufft3plan> (m, "plan3", py::module_local())
+    .def(py::init<const py::array &, const py::array &, double, size_t,
+                  double, double>(),
+      plan3_init_DS, py::kw_only(), "coord"_a, "coord_out"_a, "epsilon"_a,
+        "nthreads"_a=0, "sigma_min"_a=1.1, "sigma_max"_a=2.6)
+    .def("nu2nu", &Py_Nufft3plan::nu2nu, plan3_nu2nu_DS, py::kw_only(),
+      "forward"_a, "verbosity"_a=0, "points"_a, "out"_a=None);
   }
 
 }
@@ -0,0 +1,28 @@
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Copyright(C) 2023 Max-Planck-Society
+
+import ducc0.wgridder
+import pytest
+
+
+@pytest.fixture
+def gridder_overrides():
+    """Yields ducc0.wgridder.experimental._set_overrides; the overrides
+    active before the test are restored afterwards."""
+    set_overrides = ducc0.wgridder.experimental._set_overrides
+    old = set_overrides()
+    set_overrides(*old)
+    yield set_overrides
+    set_overrides(*old)
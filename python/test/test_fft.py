@@ -21,6 +21,9 @@ import numpy as np
 import pytest
 from numpy.testing import assert_, assert_allclose
 import platform
+import os
+import subprocess
+import sys
 
 pmp = pytest.mark.parametrize
 
@@ -394,3 +397,279 @@ def test_conv2(L1,L2,dtype):
     x2 = refconv(a,L2,1,k)
     eps = tol[x2.real.dtype.type]
     _assert_close(x, x2, eps)
+
+
+@pmp("shp", ((7,), (5, 12), (6, 5, 4), (3, 1, 8)))
+@pmp("correlate", (False, True))
+@pmp("dtype", (np.float32, np.float64, np.complex64, np.complex128))
+def test_convolve(shp, correlate, dtype):
+    rng = np.random.default_rng(42)
+    a = rng.random(shp)-0.5
+    if issubclass(dtype, np.complexfloating):
+        a = a + 1j*(rng.random(shp)-0.5)
+    a = a.astype(dtype)
+    axlist = [None, (0,)] + ([(len(shp)-1, 0)] if len(shp) > 1 else [])
+    for axes in axlist:
+        ax = tuple(range(len(shp))) if axes is None else axes
+        kshp = tuple(shp[i] for i in ax)
+        k = rng.random(kshp)-0.5
+        if issubclass(dtype, np.complexfloating):
+            k = k + 1j*(rng.random(kshp)-0.5)
+        k = k.astype(dtype)
+        fk = np.fft.fftn(k)
+        if correlate:
+            fk = np.conj(fk)
+        bshp = [1]*len(shp)
+        for i, a_ in enumerate(ax):
+            bshp[a_] = kshp[i]
+        fk = fk.transpose(np.argsort(ax)).reshape(bshp)
+        ref = np.fft.ifftn(np.fft.fftn(a.astype(np.complex128), axes=ax)*fk,
+                           axes=ax)
+        if not issubclass(dtype, np.complexfloating):
+            ref = ref.real
+        res = fft.convolve(a, k, axes=axes, correlate=correlate, nthreads=2)
+        _assert_close(res, ref, tol[a.real.dtype.type])
+
+
+@pmp("n", (1, 10, 1000))
+@pmp("m", (1, 3, 40))
+@pmp("dtype", (np.float32, np.float64, np.complex64, np.complex128))
+def test_convolve_axis_linear(n, m, dtype):
+    rng = np.random.default_rng(42)
+    a = rng.random((3, n))-0.5
+    k = rng.random(m)-0.5
+    if issubclass(dtype, np.complexfloating):
+        a = a + 1j*(rng.random((3, n))-0.5)
+        k = k + 1j*(rng.random(m)-0.5)
+    a, k = a.astype(dtype), k.astype(dtype)
+    ref = np.array([np.convolve(x, k) for x in a])
+    out = np.empty((3, n+m-1), dtype=dtype)
+    res = fft.convolve_axis_linear(a, out, 1, k)
+    _assert_close(res, ref, tol[a.real.dtype.type])
+    out = np.empty((n+m-1, 3), dtype=dtype)
+    res = fft.convolve_axis_linear(a.T, out, 0, k)
+    _assert_close(res, ref.T, tol[a.real.dtype.type])
+
+
+@pmp("shp", shapes)
+@pmp("nthreads", (1, 2))
+@pmp("inorm", [0, 2])
+def test_plan(shp, nthreads, inorm):
+    rng = np.random.default_rng(42)
+    a = rng.random(shp)-0.5 + 1j*rng.random(shp)-0.5j
+    out = np.empty_like(a)
+    plan = fft.plan("c2c", a, out, nthreads=nthreads)
+    for i in range(3):
+        a = rng.random(shp)-0.5 + 1j*rng.random(shp)-0.5j
+        assert_(plan.exec(a, out, forward=True, inorm=inorm) is out)
+        _assert_close(out, fftn(a, inorm=inorm), 1e-15)
+    tmp = a.copy()
+    plan = fft.plan("c2c", tmp, tmp, nthreads=nthreads)
+    plan.exec(tmp, tmp, forward=False, inorm=inorm)
+    _assert_close(tmp, ifftn(a, inorm=inorm), 1e-15)
+
+    r = a.real.copy()
+    c = rfftn(r)
+    plan = fft.plan("r2c", r, c, nthreads=nthreads)
+    _assert_close(plan.exec(r, np.empty_like(c), inorm=inorm),
+                  rfftn(r, inorm=inorm), 1e-15)
+    rout = np.empty_like(r)
+    plan = fft.plan("c2r", c, rout, nthreads=nthreads)
+    plan.exec(c, rout, forward=False, inorm=inorm)
+    _assert_close(rout, irfftn(c, lastsize=shp[-1], inorm=inorm), 1e-15)
+
+
+def test_plan_cache():
+    old = fft.plan_cache_info()
+    try:
+        fft.clear_plan_cache()
+        fft.set_plan_cache_limits(max_entries=4, max_bytes=1 << 30)
+        lengths = list(range(50, 56))
+        for n in lengths:
+            fft.c2c(np.ones(n, dtype=np.complex128))
+        info = fft.plan_cache_info()
+        assert_(info["misses"] == len(lengths))
+        assert_(info["entries"] == 4)
+        assert_(info["evictions"] == len(lengths)-4)
+        fft.c2c(np.ones(lengths[-1], dtype=np.complex128))
+        assert_(fft.plan_cache_info()["hits"] == 1)
+        fft.set_plan_cache_limits(max_entries=1, max_bytes=1 << 30)
+        assert_(fft.plan_cache_info()["entries"] == 1)
+    finally:
+        fft.set_plan_cache_limits(old["max_entries"], old["max_bytes"])
+
+
+@pmp("length", (97, 360, 1024))
+@pmp("real", (False, True))
+def test_wisdom(length, real):
+    rng = np.random.default_rng(42)
+    a = rng.random(length)-0.5
+    if not real:
+        a = a + 1j*(rng.random(length)-0.5)
+    ref = fftn(a)
+    try:
+        fft.tune_wisdom(length, real=real)
+        wisdom = fft.export_wisdom()
+        assert_(str(length) in wisdom)
+        _assert_close(fftn(a), ref, 1e-15)
+        fft.forget_wisdom()
+        fft.import_wisdom(wisdom)
+        assert_(fft.export_wisdom() == wisdom)
+        _assert_close(fftn(a), ref, 1e-15)
+    finally:
+        fft.forget_wisdom()
+
+
+def test_wisdom_malformed_file(tmp_path):
+    # a broken wisdom file must not make all subsequent transforms fail
+    fname = tmp_path / "wisdom.txt"
+    fname.write_text("c 8 12 1 m 0 5,2\n")
+    code = ("import numpy as np, ducc0\n"
+            "a = np.arange(12.)+0j\n"
+            "for _ in range(2):\n"
+            "    assert np.allclose(ducc0.fft.c2c(a), np.fft.fft(a))\n"
+            "assert ducc0.fft.export_wisdom().count('\\n') == 1\n")
+    res = subprocess.run([sys.executable, "-c", code], capture_output=True,
+                         text=True,
+                         env=dict(os.environ, DUCC0_FFT_WISDOM=str(fname)))
+    assert_(res.returncode == 0, res.stderr)
+    assert_("DUCC0_FFT_WISDOM" in res.stderr)
+
+
+@pmp("len", (100008, 3*2**17, 2**20))
+def test_long1D(len):
+    rng = np.random.default_rng(42)
+    a = rng.random(len)-0.5 + 1j*rng.random(len)-0.5j
+    ref = fftn(a)
+    # independent references: numpy's FFT, and a direct DFT for a few bins
+    # (with exactly reduced phases)
+    _assert_close(ref, np.fft.fft(a), 1e-14)
+    bins = rng.choice(len, 8, replace=False)
+    dft = np.array([np.sum(a*np.exp(-2j*np.pi*((k*np.arange(len)) % len)/len))
+                    for k in bins])
+    _assert_close(ref[bins], dft, 1e-13)
+    _assert_close(fftn(a.astype(np.complex64)), ref, 5e-7)
+    _assert_close(ifftn(ref, inorm=2), a, 1e-15)
+
+
+@pmp("len", (40000, 2**17, 3*2**17, 1000003))
+@pmp("dtype", (np.complex64, np.complex128))
+def test_long1D_threads(len, dtype):
+    rng = np.random.default_rng(42)
+    a = (rng.random(len)-0.5 + 1j*rng.random(len)-0.5j).astype(dtype)
+    eps = 5e-7 if dtype == np.complex64 else 1e-15
+    _assert_close(fftn(a, nthreads=4), fftn(a), eps)
+    _assert_close(ifftn(a, nthreads=4), ifftn(a), eps)
+    _assert_close(rfftn(a.real, nthreads=4), rfftn(a.real), eps)
+
+
+@pmp("n", (2, 4, 8, 16, 32, 64))
+@pmp("shp", ((3,), (257, 5), (9, 33)))
+@pmp("dtype", (np.complex64, np.complex128))
+def test_small_batched(n, shp, dtype):
+    rng = np.random.default_rng(42)
+    eps = 5e-7 if dtype == np.complex64 else 1e-15
+    for ax in range(len(shp)+1):
+        shape = list(shp)
+        shape.insert(ax, n)
+        a = (rng.random(shape)-0.5 + 1j*rng.random(shape)-0.5j).astype(dtype)
+        ref = np.fft.fft(a.astype(np.complex128), axis=ax)
+        _assert_close(fft.c2c(a, axes=(ax,)), ref, eps)
+        _assert_close(fft.c2c(a, axes=(ax,), forward=False, inorm=2),
+                      np.fft.ifft(a.astype(np.complex128), axis=ax), eps)
+
+
+@pmp("shp", ((16, 12, 10), (40, 7)))
+@pmp("axes", (None, (0,), (1,), (-1, 0)))
+@pmp("inorm", (0, 2))
+def test_c2c_slabs(tmp_path, shp, axes, inorm):
+    rng = np.random.default_rng(42)
+    a = rng.random(shp)-0.5 + 1j*rng.random(shp)-0.5j
+    ref = fftn(a, axes=axes, inorm=inorm)
+    b = a.copy()
+    res = fft.c2c_slabs(b, axes=axes, inorm=inorm, max_bytes=1000)
+    assert_(res is b)
+    _assert_close(b, ref, 1e-15)
+    m = np.memmap(tmp_path / "data.bin", dtype=a.dtype, mode="w+",
+                  shape=shp)
+    m[()] = a
+    fft.c2c_slabs(m, axes=axes, inorm=inorm, max_bytes=1000, nthreads=2)
+    _assert_close(np.asarray(m), ref, 1e-15)
+
+
+@pmp("shp", ((10,), (127,), (32, 17), (5, 7, 6)))
+@pmp("nthreads", (1, 2))
+def test_r2c_c2r_float16(shp, nthreads):
+    rng = np.random.default_rng(42)
+    a = (rng.random(shp)-0.5).astype(np.float16)
+    axes = tuple(range(len(shp)))
+    res = fft.r2c(a, nthreads=nthreads)
+    assert_(res.dtype == np.complex64)
+    ref = fft.r2c(a.astype(np.float32), nthreads=nthreads)
+    _assert_close(res, ref, 1e-7)
+    out = np.empty(shp, dtype=np.float16)
+    fft.c2r(ref, axes=axes, lastsize=shp[-1], inorm=2, out=out,
+            nthreads=nthreads)
+    ref2 = fft.c2r(ref, axes=axes, lastsize=shp[-1], inorm=2,
+                   nthreads=nthreads)
+    assert_allclose(out, ref2.astype(np.float16))
+
+
+def _range_mask(n, ranges):
+    mask = np.zeros(n, dtype=bool)
+    if len(ranges) == 0:
+        mask[:] = True
+    for lo, hi in ranges:
+        mask[lo:hi] = True
+    return mask
+
+
+@pmp("shp, axes, in_ranges, out_ranges", (
+    # single axis, contiguous input and output ranges
+    ((16, 7, 5), (0,), [[(3, 9)]], [[(0, 4)]]),
+    # wrap-around ranges as used by the gridders, last axis untouched
+    ((24, 20, 3), (0, 1), [[(0, 5), (19, None)], [(0, 4), (17, None)]],
+     [[(0, 7), (21, None)], [(2, 11)]]),
+    # all axes, one of them unrestricted on input, one on output
+    ((12, 15, 18), (2, 0, 1), [[(4, 10)], [], [(1, 3), (9, 12)]],
+     [[], [(5, 6)], [(0, 15)]]),
+    # a transformed axis of length 1 and one with only a single input row
+    ((1, 30, 9), (0, 1, 2), [[], [(29, 30)], [(0, 9)]],
+     [[(0, 1)], [(3, 20)], [(8, None)]]),
+    # pruning on a middle axis, outer axis not transformed
+    ((6, 32, 10), (1, 2), [[(10, 14)], [(0, 2), (8, 10)]],
+     [[(0, 32)], [(4, 6)]])))
+@pmp("dtype", (np.complex64, np.complex128))
+@pmp("forward", (True, False))
+@pmp("nthreads", (1, 3))
+def test_c2c_pruned(shp, axes, in_ranges, out_ranges, dtype, forward,
+                    nthreads):
+    rng = np.random.default_rng(42)
+    inmask = np.ones(shp, dtype=bool)
+    outmask = np.ones(shp, dtype=bool)
+    for ax, rin, rout in zip(axes, in_ranges, out_ranges):
+        bshape = [1]*len(shp)
+        bshape[ax] = shp[ax]
+        inmask &= _range_mask(shp[ax], rin).reshape(bshape)
+        outmask &= _range_mask(shp[ax], rout).reshape(bshape)
+    a = (rng.random(shp)-0.5 + 1j*(rng.random(shp)-0.5)).astype(dtype)
+    a[~inmask] = 0
+    ref = fft.c2c(a, axes=axes, forward=forward, inorm=2)
+    res = fft.c2c_pruned(a, axes, in_ranges, out_ranges, forward=forward,
+                         inorm=2, nthreads=nthreads)
+    assert_(res is a)
+    eps = 3e-6 if dtype == np.complex64 else 1e-13
+    _assert_close(a[outmask], ref[outmask], eps)
+
+
+# Overlapping or unsorted ranges and repeated axes must be rejected, since
+# they would lead to sub-arrays being transformed more than once.
+@pmp("axes, in_ranges, out_ranges", (
+    ((0,), [[(0, 4), (3, 6)]], [[]]),
+    ((0,), [[]], [[(5, None), (0, 2)]]),
+    ((1, 1), [[], []], [[], []]),
+    ((0, 2, 0), [[(0, 2)], [], []], [[], [], [(1, 3)]])))
+def test_c2c_pruned_bad_args(axes, in_ranges, out_ranges):
+    a = np.zeros((8, 8, 8), dtype=np.complex128)
+    with pytest.raises(RuntimeError):
+        fft.c2c_pruned(a, axes, in_ranges, out_ranges)
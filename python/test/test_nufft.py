@@ -13,6 +13,9 @@
 #
 # Copyright(C) 2020-2022 Max-Planck-Society
 
+import os
+import subprocess
+import sys
 from itertools import product
 
 import ducc0
@@ -224,3 +227,435 @@ def test_nufft_3d(nx, ny, nz, npoints, epsilon, forward, singleprec,
         if comp.ndim==0:
             comp=np.array([comp[()]])
         assert_allclose(ducc0.misc.l2error(ms2,comp), 0, atol=50*epsilon)
+
+
+@pmp("shape", ((1, 7, 8, 3), (10, 11, 6, 9)))
+@pmp("npoints", (1, 37))
+@pmp("epsilon", (1e-5, 1e-10))
+@pmp("forward", (True, False))
+@pmp("singleprec", (True, False))
+@pmp("fft_order", (False, True))
+@pmp("nthreads", (1, 2))
+def test_nufft_4d(shape, npoints, epsilon, forward, singleprec, fft_order,
+                  nthreads):
+    if singleprec and epsilon < 1e-6:
+        pytest.skip()
+    rng = np.random.default_rng(42)
+    periodicity = 2*np.pi
+    uvw = (rng.random((npoints, 4))-0.5)*periodicity
+    ms = rng.random(npoints)-0.5 + 1j*(rng.random(npoints)-0.5)
+    dirty = rng.random(shape)-0.5 + 1j*(rng.random(shape)-0.5)
+    if singleprec:
+        ms = ms.astype("c8")
+        dirty = dirty.astype("c8")
+
+    dirty2 = np.empty(shape, dtype=dirty.dtype)
+    dirty2 = ducc0.nufft.nu2u(points=ms, coord=uvw, forward=forward,
+                              epsilon=epsilon, nthreads=nthreads, out=dirty2,
+                              periodicity=periodicity, fft_order=fft_order).astype("c16")
+    dirty_ref = explicit_nufft(uvw, ms, shape, forward, periodicity, fft_order)
+    assert_allclose(ducc0.misc.l2error(dirty2, dirty_ref), 0, atol=epsilon)
+
+    plan = ducc0.nufft.plan(nu2u=False, coord=uvw, grid_shape=shape,
+                            epsilon=epsilon, nthreads=nthreads,
+                            periodicity=periodicity, fft_order=fft_order)
+    ms2 = plan.u2nu(grid=dirty, forward=not forward).astype("c16")
+    ref = max(ducc0.misc.vdot(ms, ms).real, ducc0.misc.vdot(ms2, ms2).real,
+              ducc0.misc.vdot(dirty, dirty).real, ducc0.misc.vdot(dirty2, dirty2).real)
+    tol = 3e-5*ref if singleprec else 2e-13*ref
+    assert_allclose(ducc0.misc.vdot(ms, ms2), ducc0.misc.vdot(dirty2, dirty), rtol=tol)
+
+
+@pmp("singleprec", (True, False))
+def test_nufft_4d_accuracy(singleprec):
+    # 4D kernels are extrapolated from the 3D entries of the kernel database
+    # (see kernelDBDims()), so check the accuracy over the full range.
+    rng = np.random.default_rng(42)
+    shape, npoints = (8, 9, 7, 6), 200
+    coord = (rng.random((npoints, 4))-0.5)*2*np.pi
+    points = rng.random(npoints)-0.5 + 1j*(rng.random(npoints)-0.5)
+    grid = rng.random(shape)-0.5 + 1j*(rng.random(shape)-0.5)
+    ref_grid = explicit_nufft(coord, points, shape, True, 2*np.pi, False)
+    xyz = np.meshgrid(*[(-(ss//2) + np.arange(ss)) for ss in shape],
+                      indexing='ij')
+    ref_points = np.array(
+        [np.sum(grid*np.exp(-1j*sum(a*b for a, b in zip(xyz, c))))
+         for c in coord])
+    if singleprec:
+        points = points.astype(np.complex64)
+        grid = grid.astype(np.complex64)
+    best = ducc0.nufft.bestEpsilon(ndim=4, singleprec=singleprec,
+                                   sigma_min=1.2, sigma_max=2.51)
+    epsilons = [1.0001*best] + [e for e in 10.**-np.arange(1, 14) if e > best]
+    for epsilon in epsilons:
+        res = ducc0.nufft.nu2u(points=points, coord=coord, forward=True,
+                               epsilon=epsilon, out=np.empty_like(grid))
+        assert ducc0.misc.l2error(res, ref_grid) < epsilon
+        res = ducc0.nufft.u2nu(grid=grid, coord=coord, forward=True,
+                               epsilon=epsilon)
+        assert ducc0.misc.l2error(res, ref_points) < epsilon
+
+
+@pmp("shape", ((50,), (20, 21), (10, 11, 12)))
+@pmp("ntrans", (1, 3))
+@pmp("singleprec", (True, False))
+@pmp("nthreads", (1, 2))
+def test_nufft_plan_batched(shape, ntrans, singleprec, nthreads):
+    rng = np.random.default_rng(42)
+    npoints = 100
+    ndim = len(shape)
+    epsilon = 1e-5 if singleprec else 1e-10
+    rdtype, cdtype = ("f4", "c8") if singleprec else ("f8", "c16")
+    coord = ((rng.random((npoints, ndim))-0.5)*2*np.pi).astype(rdtype)
+    points = (rng.random((ntrans, npoints))-0.5
+              + 1j*(rng.random((ntrans, npoints))-0.5)).astype(cdtype)
+    grid = (rng.random((ntrans,)+shape)-0.5
+            + 1j*(rng.random((ntrans,)+shape)-0.5)).astype(cdtype)
+    plan = ducc0.nufft.plan(nu2u=True, coord=coord, grid_shape=shape,
+                            epsilon=epsilon, nthreads=nthreads)
+    res = plan.nu2u(points=points, forward=True)
+    assert res.shape == (ntrans,)+shape
+    for t in range(ntrans):
+        ref = plan.nu2u(points=points[t], forward=True)
+        assert_allclose(res[t], ref)
+    plan = ducc0.nufft.plan(nu2u=False, coord=coord, grid_shape=shape,
+                            epsilon=epsilon, nthreads=nthreads)
+    res = plan.u2nu(grid=grid, forward=False)
+    assert res.shape == (ntrans, npoints)
+    for t in range(ntrans):
+        ref = plan.u2nu(grid=grid[t], forward=False)
+        assert_allclose(res[t], ref)
+
+
+def test_nufft_batch_weights(capfd):
+    # batches of transforms share one set of kernel weights, which is
+    # reported as a separate timer; single transforms need no shared weights
+    rng = np.random.default_rng(42)
+    shape, ntrans, npoints, epsilon = (24, 20, 22), 3, 2000, 1e-11
+    marker = "precomputing kernel"
+    coord = (rng.random((npoints, len(shape)))-0.5)*2*np.pi
+    points = (rng.random((ntrans, npoints))-0.5
+              + 1j*(rng.random((ntrans, npoints))-0.5))
+    # the timers of a plan accumulate over calls, so every check gets a
+    # fresh plan
+    def mkplan(nu2u):
+        return ducc0.nufft.plan(nu2u=nu2u, coord=coord, grid_shape=shape,
+                                epsilon=epsilon, nthreads=2)
+    capfd.readouterr()
+    grid = mkplan(True).nu2u(points=points, forward=True, verbosity=1)
+    assert marker in capfd.readouterr().out
+    plan = mkplan(True)
+    for t in range(ntrans):
+        ref = plan.nu2u(points=points[t], forward=True, verbosity=1)
+        assert marker not in capfd.readouterr().out
+        assert_allclose(ducc0.misc.l2error(grid[t], ref), 0, atol=1e-13)
+
+    res = mkplan(False).u2nu(grid=grid, forward=False, verbosity=1)
+    assert marker in capfd.readouterr().out
+    plan = mkplan(False)
+    for t in range(ntrans):
+        ref = plan.u2nu(grid=grid[t], forward=False, verbosity=1)
+        assert marker not in capfd.readouterr().out
+        assert_allclose(ducc0.misc.l2error(res[t], ref), 0, atol=1e-13)
+
+
+@pmp("shape", ((40,), (24, 19), (12, 10, 9)))
+@pmp("lockfree", (False, True))
+@pmp("precompute", (False, True))
+def test_nufft_index_blocks(shape, lockfree, precompute):
+    rng = np.random.default_rng(42)
+    # When built with -DDUCC0_NUFFT_LOG2_IDXBLOCK=4 (as in CI), these are
+    # several full sorting blocks plus a partial one.
+    npoints = 7*16+5
+    ndim = len(shape)
+    epsilon = 1e-10
+    coord = (rng.random((npoints, ndim))-0.5)*2*np.pi
+    points = rng.random(npoints)-0.5 + 1j*(rng.random(npoints)-0.5)
+    grid = rng.random(shape)-0.5 + 1j*(rng.random(shape)-0.5)
+
+    def mkplan(nu2u):
+        return ducc0.nufft.plan(nu2u=nu2u, coord=coord, grid_shape=shape,
+                                epsilon=epsilon, lockfree_spreading=lockfree,
+                                precompute_weights=precompute)
+    res = mkplan(True).nu2u(points=points, forward=True)
+    ref = explicit_nufft(coord, points, shape, True, 2*np.pi, False)
+    assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=10*epsilon)
+
+    res = mkplan(False).u2nu(grid=grid, forward=False)
+    xyz = np.meshgrid(*[(-(ss//2) + np.arange(ss)) for ss in shape],
+                      indexing='ij')
+    ref = np.array([np.sum(grid*np.exp(1j*sum(a*b for a, b in zip(xyz, c))))
+                    for c in coord])
+    assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=10*epsilon)
+
+
+def exact_phases(t, n):
+    """exp(2*pi*i*k*t) for all modes k of a grid with n points, with the
+    products k*t reduced modulo 1 exactly (for |k| < 2**20): t is split
+    into a part with 33 significant bits and a remainder, so that both
+    partial products with k are exact in double precision."""
+    assert n//2 < 2**20
+    k = np.arange(n, dtype=np.float64) - (n//2)
+    c = t*(2.**20+1)
+    thi = c-(c-t)
+    tlo = t-thi
+    a, b = k*thi, k*tlo
+    return np.exp(2j*np.pi*((a-np.round(a)) + (b-np.round(b))))
+
+
+@pmp("shape", ((1000001,), (1024, 1001), (128, 100, 97)))
+@pmp("convert", (False, True))
+def test_nufft_edges(shape, convert):
+    # coordinates at and next to the edges of the periodic interval on large
+    # grids, where the range reduction of the coordinates must not lose
+    # accuracy
+    rng = np.random.default_rng(42)
+    ndim = len(shape)
+    epsilon, periodicity = 1e-13, 2*np.pi
+    pi_lo = np.nextafter(np.pi, 0)
+    edges = np.array([np.pi, -np.pi, pi_lo, -pi_lo, np.nextafter(np.pi, 4),
+                      np.nextafter(-np.pi, -4), 0., 3*np.pi, -3*pi_lo])
+    npoints = 2*edges.size
+    coord = np.empty((npoints, ndim))
+    coord[:, 0] = np.tile(edges, 2)
+    coord[:, 1:] = rng.choice(edges, (npoints, ndim-1))
+    points = rng.random(npoints)-0.5 + 1j*(rng.random(npoints)-0.5)
+    grid = rng.random(shape)-0.5 + 1j*(rng.random(shape)-0.5)
+
+    # The plan maps the coordinates onto the unit interval by multiplying
+    # with 1/periodicity in double precision. The reference uses the same
+    # mapped values; otherwise it would be dominated by the conditioning of
+    # exp(i*k*x) for large k, not by the accuracy of the transform.
+    def term(i):
+        res = 1.
+        for d in range(ndim):
+            res = np.multiply.outer(
+                res, exact_phases(coord[i, d]*(1./periodicity), shape[d]))
+        return res
+
+    def mkplan(nu2u):
+        return ducc0.nufft.plan(nu2u=nu2u, coord=coord, grid_shape=shape,
+                                epsilon=epsilon, nthreads=1,
+                                periodicity=periodicity,
+                                convert_coords=convert)
+    res = mkplan(True).nu2u(points=points, forward=True)
+    ref = sum(points[i]*np.conj(term(i)) for i in range(npoints))
+    assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=4*epsilon)
+
+    res = mkplan(False).u2nu(grid=grid, forward=False)
+    ref = np.array([np.sum(grid*term(i)) for i in range(npoints)])
+    assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=4*epsilon)
+
+
+# The larger shapes have at least 8 tiles along the first axis, so that the
+# tiles are coloured periodically, including the extra colours of the tiles
+# which wrap around the grid; in 4D with double precision the kernel support
+# is wide enough for a colour period of 3.
+@pmp("shape", ((50,), (4096,), (20, 21), (256, 256), (10, 11, 12),
+               (64, 20, 12), (40, 6, 5, 4)))
+@pmp("ntrans", (1, 3))
+@pmp("singleprec", (True, False))
+@pmp("nthreads", (1, 4))
+@pmp("precompute", (False, True))
+def test_nufft_lockfree_spreading(shape, ntrans, singleprec, nthreads,
+                                  precompute):
+    rng = np.random.default_rng(42)
+    npoints = 1000
+    ndim = len(shape)
+    epsilon = 1e-5 if singleprec else 1e-10
+    rdtype, cdtype = ("f4", "c8") if singleprec else ("f8", "c16")
+    coord = ((rng.random((npoints, ndim))-0.5)*4*np.pi).astype(rdtype)
+    points = (rng.random((ntrans, npoints))-0.5
+              + 1j*(rng.random((ntrans, npoints))-0.5)).astype(cdtype)
+    res = []
+    for lockfree in (False, True):
+        plan = ducc0.nufft.plan(nu2u=True, coord=coord, grid_shape=shape,
+                                epsilon=epsilon, nthreads=nthreads,
+                                lockfree_spreading=lockfree,
+                                precompute_weights=precompute)
+        res.append(plan.nu2u(points=points, forward=True))
+    tol = 1e-5 if singleprec else 1e-12
+    assert_allclose(ducc0.misc.l2error(res[0], res[1]), 0, atol=tol)
+
+
+@pmp("shape", ((50,), (20, 21), (10, 11, 12), (6, 7, 5, 4)))
+@pmp("ntrans", (1, 3))
+@pmp("singleprec", (True, False))
+@pmp("nthreads", (1, 2))
+def test_nufft_precompute_weights(shape, ntrans, singleprec, nthreads):
+    rng = np.random.default_rng(42)
+    npoints = 1000
+    ndim = len(shape)
+    epsilon = 1e-5 if singleprec else 1e-10
+    rdtype, cdtype = ("f4", "c8") if singleprec else ("f8", "c16")
+    coord = ((rng.random((npoints, ndim))-0.5)*4*np.pi).astype(rdtype)
+    points = (rng.random((ntrans, npoints))-0.5
+              + 1j*(rng.random((ntrans, npoints))-0.5)).astype(cdtype)
+    grid = (rng.random((ntrans,)+shape)-0.5
+            + 1j*(rng.random((ntrans,)+shape)-0.5)).astype(cdtype)
+    res_nu2u, res_u2nu = [], []
+    # plain plan, precomputed kernel weights, converted coordinates
+    for precompute, convert in ((False, False), (True, False), (False, True)):
+        plan = ducc0.nufft.plan(nu2u=True, coord=coord, grid_shape=shape,
+                                epsilon=epsilon, nthreads=nthreads,
+                                precompute_weights=precompute,
+                                convert_coords=convert)
+        # applying the plan repeatedly must not change the result
+        for _ in range(2):
+            res_nu2u.append(plan.nu2u(points=points, forward=True))
+            res_u2nu.append(plan.u2nu(grid=grid, forward=False))
+    for res in (res_nu2u, res_u2nu):
+        for r in res[1:]:
+            assert_allclose(ducc0.misc.l2error(res[0], r), 0, atol=1e-15)
+
+
+@pmp("shape", ((50,), (1,), (20, 21), (10, 11, 12), (6, 7, 5, 4)))
+@pmp("ntrans", (0, 2))
+@pmp("weighted", (False, True))
+@pmp("forward", (True, False))
+@pmp("singleprec", (True, False))
+@pmp("fft_order", (False, True))
+def test_nufft_normal(shape, ntrans, weighted, forward, singleprec, fft_order):
+    rng = np.random.default_rng(42)
+    npoints = 300
+    ndim = len(shape)
+    epsilon = 1e-5 if singleprec else 1e-10
+    rdtype, cdtype = ("f4", "c8") if singleprec else ("f8", "c16")
+    coord = ((rng.random((npoints, ndim))-0.5)*2*np.pi).astype(rdtype)
+    weights = (rng.random(npoints)+0.5).astype(rdtype) if weighted else None
+    gshape = shape if ntrans == 0 else (ntrans,)+shape
+    grid = (rng.random(gshape)-0.5 + 1j*(rng.random(gshape)-0.5)).astype(cdtype)
+    plan = ducc0.nufft.plan(nu2u=False, coord=coord, grid_shape=shape,
+                            epsilon=epsilon, nthreads=2, fft_order=fft_order)
+    points = plan.u2nu(grid=grid, forward=forward)
+    if weighted:
+        points *= weights
+    ref = plan.nu2u(points=points, forward=not forward)
+    plan.prep_normal(forward=forward, weights=weights)
+    res = plan.apply_normal(grid=grid)
+    assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=epsilon)
+
+
+def test_nufft_cost_model():
+    default = ducc0.nufft.get_cost_model()
+    try:
+        model = ducc0.nufft.calibrate_cost_model(npoints=20000, activate=False)
+        assert ducc0.nufft.get_cost_model() == default
+        assert set(model) == set(default)
+        assert all(model[key] > 0 for key in default)
+        ducc0.nufft.set_cost_model(model)
+        assert ducc0.nufft.get_cost_model() == model
+        ducc0.nufft.set_cost_model({"max_fft_scaling": 3.})
+        assert ducc0.nufft.get_cost_model()["max_fft_scaling"] == 3.
+        assert ducc0.nufft.get_cost_model()["fft_cost"] == model["fft_cost"]
+        ducc0.nufft.set_cost_model({"gridding_cost_single": 1e-9})
+        assert ducc0.nufft.get_cost_model()["gridding_cost_single"] == 1e-9
+        assert (ducc0.nufft.get_cost_model()["gridding_cost"]
+                == model["gridding_cost"])
+        with pytest.raises(RuntimeError):
+            ducc0.nufft.set_cost_model({"gridding_cost": -1.})
+        # transforms stay accurate with a very different model
+        ducc0.nufft.set_cost_model({"fft_cost": 1e-5, "gridding_cost": 1e-5,
+                                    "fft_cost_single": 1e-5,
+                                    "gridding_cost_single": 1e-5})
+        rng = np.random.default_rng(42)
+        coord = (rng.random((100, 2))-0.5)*2*np.pi
+        points = rng.random(100)-0.5 + 1j*(rng.random(100)-0.5)
+        ref = explicit_nufft(coord, points, (8, 10), True, 2*np.pi, False)
+        for ftype, ctype, epsilon in ((np.float64, np.complex128, 1e-10),
+                                      (np.float32, np.complex64, 1e-5)):
+            res = ducc0.nufft.nu2u(points=points.astype(ctype),
+                                   coord=coord.astype(ftype), forward=True,
+                                   epsilon=epsilon,
+                                   out=np.empty((8, 10), ctype))
+            assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=epsilon)
+    finally:
+        ducc0.nufft.set_cost_model(None)
+    assert ducc0.nufft.get_cost_model() == default
+
+
+@pmp("value, valid", (("0.1,1e-9,4", True), ("0.1,1e-9,4,0.05,2e-9", True),
+                      ("0.1,1e-9", False), ("0.1,nan,4", False),
+                      ("0.1,1e-9,0.5", False), ("0.1,1e-9,4,x", False)))
+def test_nufft_cost_model_env(value, valid):
+    # a malformed DUCC0_GRIDDING_COST_MODEL is reported and ignored, and must
+    # not make all subsequent transforms fail
+    code = ("import numpy as np, ducc0\n"
+            "model = ducc0.nufft.get_cost_model()\n"
+            "for _ in range(2):\n"
+            "    ducc0.nufft.nu2u(points=np.ones(10, np.complex128),\n"
+            "                     coord=np.zeros((10, 2)), forward=True,\n"
+            "                     epsilon=1e-5, out=np.empty((8, 8), np.complex128))\n"
+            "ducc0.nufft.set_cost_model(None)\n"
+            "print(model == ducc0.nufft.get_cost_model(), model['fft_cost'])\n")
+    res = subprocess.run([sys.executable, "-c", code], capture_output=True,
+                         text=True,
+                         env=dict(os.environ, DUCC0_GRIDDING_COST_MODEL=value))
+    assert res.returncode == 0, res.stderr
+    is_default, fft_cost = res.stdout.split()
+    if valid:
+        assert fft_cost == "0.1"
+        assert "DUCC0_GRIDDING_COST_MODEL" not in res.stderr
+    else:
+        assert is_default == "True"
+        assert "DUCC0_GRIDDING_COST_MODEL" in res.stderr
+
+
+@pmp("ndim", (1, 2, 3))
+@pmp("npoints", (1, 37))
+@pmp("npoints_out", (1, 29))
+@pmp("epsilon", (1e-5, 1e-10))
+@pmp("forward", (True, False))
+@pmp("singleprec", (True, False))
+@pmp("nthreads", (1, 2))
+def test_nufft_type3(ndim, npoints, npoints_out, epsilon, forward, singleprec,
+                     nthreads):
+    if singleprec and epsilon < 1e-6:
+        pytest.skip()
+    rng = np.random.default_rng(42)
+    rdtype, cdtype = ("f4", "c8") if singleprec else ("f8", "c16")
+    coord = (3. + 10*(rng.random((npoints, ndim))-0.5)).astype(rdtype)
+    coord_out = (-2. + 20*(rng.random((npoints_out, ndim))-0.5)).astype(rdtype)
+    points = (rng.random((2, npoints))-0.5
+              + 1j*(rng.random((2, npoints))-0.5)).astype(cdtype)
+    isign = -1 if forward else 1
+    ref = points.astype("c16") @ np.exp(isign*1j*(coord.astype("f8")
+                                        @ coord_out.astype("f8").T))
+    res = ducc0.nufft.nu2nu(points=points[0], coord=coord,
+                            coord_out=coord_out, forward=forward,
+                            epsilon=epsilon, nthreads=nthreads)
+    assert_allclose(ducc0.misc.l2error(res, ref[0]), 0, atol=4*epsilon)
+    plan = ducc0.nufft.plan3(coord=coord, coord_out=coord_out,
+                             epsilon=epsilon, nthreads=nthreads)
+    res = plan.nu2nu(points=points, forward=forward)
+    assert res.shape == (2, npoints_out)
+    assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=4*epsilon)
+
+
+@pmp("shape", ((50,), (20, 21), (10, 11, 12)))
+@pmp("ntrans", (None, 2))
+@pmp("singleprec", (True, False))
+@pmp("nthreads", (1, 2))
+def test_nu2u_accumulator(shape, ntrans, singleprec, nthreads):
+    rng = np.random.default_rng(42)
+    npoints, nchunk = 1000, 170
+    ndim = len(shape)
+    epsilon = 1e-5 if singleprec else 1e-10
+    rdtype, cdtype = ("f4", "c8") if singleprec else ("f8", "c16")
+    pshape = (npoints,) if ntrans is None else (ntrans, npoints)
+    coord = ((rng.random((npoints, ndim))-0.5)*2*np.pi).astype(rdtype)
+    points = (rng.random(pshape)-0.5
+              + 1j*(rng.random(pshape)-0.5)).astype(cdtype)
+    acc = ducc0.nufft.nu2u_accumulator(grid_shape=shape, npoints=npoints,
+                                       epsilon=epsilon, singleprec=singleprec,
+                                       nthreads=nthreads)
+    plan = ducc0.nufft.plan(nu2u=True, coord=coord, grid_shape=shape,
+                            epsilon=epsilon, nthreads=nthreads)
+    ref = plan.nu2u(points=points, forward=True)
+    for _ in range(2):  # the accumulator must be reusable
+        for lo in range(0, npoints, nchunk):
+            acc.add(coord=coord[lo:lo+nchunk], points=points[..., lo:lo+nchunk])
+        res = acc.finish(forward=True)
+        assert res.shape == ref.shape
+        assert_allclose(ducc0.misc.l2error(res, ref), 0,
+                        atol=1e-6 if singleprec else 1e-13)
@@ -242,6 +242,94 @@ def test_adjointness_ms2dirty(nx, ny, nrow, nchan, epsilon,
     check(dirty2, ms2)
 
 
+@pmp("nblocks", (1, 5))
+def test_wgridder_row_blocks(nblocks):
+    rng = np.random.default_rng(42)
+    # When built with -DDUCC0_WGRIDDER_LOG2_ROWBLOCK=2 (as in CI), this is a
+    # single full row block, or several full ones plus a partial one.
+    nrow = nblocks*4 + (3 if nblocks > 1 else 0)
+    nchan, nxdirty, nydirty, epsilon = 3, 32, 24, 1e-10
+    pixsizex = np.pi/180/60/nxdirty*0.2398
+    pixsizey = np.pi/180/60/nxdirty
+    f0 = 1e9
+    freq = f0 + np.arange(nchan)*(f0/nchan)
+    uvw = (rng.random((nrow, 3))-0.5)/(pixsizey*f0/SPEEDOFLIGHT)
+    ms = rng.random((nrow, nchan))-0.5 + 1j*(rng.random((nrow, nchan))-0.5)
+    wgt = rng.uniform(0.9, 1.1, (nrow, nchan))
+    mask = (rng.uniform(0, 1, (nrow, nchan)) > 0.35).astype(np.uint8)
+    dirty = ng.ms2dirty(uvw, freq, ms, wgt, nxdirty, nydirty, pixsizex,
+                        pixsizey, 0, 0, epsilon, True, 1, 0, mask)
+    ref = explicit_gridder(uvw, freq, ms, wgt, nxdirty, nydirty, pixsizex,
+                           pixsizey, True, mask)
+    assert_allclose(ducc0.misc.l2error(dirty, ref), 0, atol=10*epsilon)
+
+    dirty = rng.random((nxdirty, nydirty))-0.5
+    ms = ng.dirty2ms(uvw, freq, dirty, wgt, pixsizex, pixsizey, 0, 0,
+                     epsilon, True, 1, 0, mask)
+    ref = explicit_degridder(uvw, freq, dirty, wgt, pixsizex, pixsizey, True,
+                             mask)
+    assert_allclose(ducc0.misc.l2error(ms, ref), 0, atol=10*epsilon)
+
+
+# 12 planes in flight are more than are w-screened by rotation in a row
+@pmp("planes", (3, 12))
+@pmp("singleprec", (False, True))
+def test_wgridder_planes_in_flight(gridder_overrides, planes, singleprec):
+    rng = np.random.default_rng(42)
+    nrow, nchan, nxdirty, nydirty = 200, 2, 64, 64
+    epsilon = 1e-5 if singleprec else 1e-12
+    ftype, ctype = ("f4", "c8") if singleprec else ("f8", "c16")
+    pixsizex = pixsizey = 40*np.pi/180/nxdirty
+    f0 = 1e9
+    freq = f0 + np.arange(nchan)*(0.1*f0)
+    uvw = (rng.random((nrow, 3))-0.5)/(pixsizey*f0/SPEEDOFLIGHT)
+    ms = (rng.random((nrow, nchan))-0.5
+          + 1j*(rng.random((nrow, nchan))-0.5)).astype(ctype)
+    dirty = (rng.random((nxdirty, nydirty))-0.5).astype(ftype)
+    res = []
+    for np_ in (1, planes):
+        gridder_overrides(planes_in_flight=np_)
+        res.append((ng.ms2dirty(uvw, freq, ms, None, nxdirty, nydirty,
+                                pixsizex, pixsizey, 0, 0, epsilon, True),
+                    ng.dirty2ms(uvw, freq, dirty, None, pixsizex, pixsizey,
+                                0, 0, epsilon, True)))
+    assert_allclose(ducc0.misc.l2error(res[1][0], res[0][0]), 0, atol=epsilon)
+    assert_allclose(ducc0.misc.l2error(res[1][1], res[0][1]), 0, atol=epsilon)
+
+
+# The tuning code subdivides this wide field with few visibilities into 7x7
+# facets. The number of concurrent facets is limited by the number of threads.
+@pmp("nthreads", (2, 4))
+def test_wgridder_facet_concurrency(gridder_overrides, nthreads):
+    rng = np.random.default_rng(42)
+    nrow, nchan, npix, epsilon = 100, 2, 512, 1e-5
+    pixsize = 30*np.pi/180/npix
+    f0 = 1e9
+    freq = f0 + np.arange(nchan)*(0.1*f0)
+    uvw = (rng.random((nrow, 3))-0.5)/(pixsize*f0/SPEEDOFLIGHT)
+    vis = rng.random((nrow, nchan))-0.5 + 1j*(rng.random((nrow, nchan))-0.5)
+    dirty = rng.random((npix, npix))-0.5
+    res = []
+    for nconc in (1, 3):
+        gridder_overrides(facet_concurrency=nconc)
+        res.append((ng.experimental.vis2dirty_tuning(
+                        uvw=uvw, freq=freq, vis=vis, npix_x=npix, npix_y=npix,
+                        pixsize_x=pixsize, pixsize_y=pixsize, epsilon=epsilon,
+                        do_wgridding=True, nthreads=nthreads),
+                    ng.experimental.dirty2vis_tuning(
+                        uvw=uvw, freq=freq, dirty=dirty, pixsize_x=pixsize,
+                        pixsize_y=pixsize, epsilon=epsilon, do_wgridding=True,
+                        nthreads=nthreads)))
+    # only the thread distribution and the summation order change
+    assert_allclose(ducc0.misc.l2error(res[1][0], res[0][0]), 0, atol=1e-13)
+    assert_allclose(ducc0.misc.l2error(res[1][1], res[0][1]), 0, atol=1e-13)
+    # the facets add their visibilities to the same arrays
+    ref = ng.experimental.dirty2vis(
+        uvw=uvw, freq=freq, dirty=dirty, pixsize_x=pixsize, pixsize_y=pixsize,
+        epsilon=epsilon, do_wgridding=True, nthreads=nthreads)
+    assert_allclose(ducc0.misc.l2error(res[0][1], ref), 0, atol=epsilon)
+
+
 @pmp('nx', [(2, 2), (6, 2), (18, 2), (66, 4)])
 @pmp('ny', [(2, 2), (64, 2)])
 @pmp("nrow", (1, 2, 27))
@@ -342,6 +430,157 @@ def test_ms2dirty_against_wdft3(nxdirty, nydirty, nrow, nchan, epsilon,
     assert_allclose(ducc0.misc.l2error(x1,x2), 0, atol=epsilon)
 
 
+@pmp("nxdirty", (16, 64))
+@pmp("nydirty", (32, 128))
+@pmp("nrow", (1, 27))
+@pmp("nchan", (1, 5))
+@pmp("singleprec", (True, False))
+@pmp("wstacking", (True, False))
+@pmp("use_wgt", (True, False))
+@pmp("use_mask", (False, True))
+@pmp("nthreads", (1, 2))
+def test_plan(nxdirty, nydirty, nrow, nchan, singleprec, wstacking, use_wgt,
+              use_mask, nthreads):
+    import ducc0.wgridder.experimental as wgridder
+    rng = np.random.default_rng(42)
+    epsilon = 1e-4 if singleprec else 1e-10
+    pixsizex = np.pi/180/60/nxdirty*0.2398
+    pixsizey = np.pi/180/60/nxdirty
+    f0 = 1e9
+    freq = f0 + np.arange(nchan)*(f0/nchan)
+    uvw = (rng.random((nrow, 3))-0.5)/(pixsizey*f0/SPEEDOFLIGHT)
+    ms = rng.random((nrow, nchan))-0.5 + 1j*(rng.random((nrow, nchan))-0.5)
+    wgt = rng.uniform(0.9, 1.1, (nrow, nchan)) if use_wgt else None
+    mask = (rng.uniform(0, 1, (nrow, nchan)) > 0.5).astype(np.uint8) \
+        if use_mask else None
+    dirty = rng.random((nxdirty, nydirty))-0.5
+    if singleprec:
+        ms = ms.astype("c8")
+        dirty = dirty.astype("f4")
+        if wgt is not None:
+            wgt = wgt.astype("f4")
+    tol = 1e-5 if singleprec else 1e-12
+    args = dict(uvw=uvw, freq=freq, wgt=wgt, mask=mask, pixsize_x=pixsizex,
+                pixsize_y=pixsizey, epsilon=epsilon, do_wgridding=wstacking,
+                nthreads=nthreads, center_x=0.1*pixsizex)
+    ref_dirty = wgridder.vis2dirty(vis=ms, npix_x=nxdirty, npix_y=nydirty,
+                                   **args)
+    ref_ms = wgridder.dirty2vis(dirty=dirty, **args)
+    plan = wgridder.plan(npix_x=nxdirty, npix_y=nydirty,
+                         singleprec=singleprec, **args)
+    for _ in range(2):  # plans are reusable
+        assert_allclose(ducc0.misc.l2error(plan.vis2dirty(vis=ms), ref_dirty),
+                        0, atol=tol)
+        vis = np.full_like(ms, 1.)  # also entries outside the mask are set
+        plan.dirty2vis(dirty=dirty, vis=vis)
+        assert_allclose(ducc0.misc.l2error(vis, ref_ms), 0, atol=tol)
+
+
+@pmp("nxdirty", (16, 64))
+@pmp("nydirty", (32, 128))
+@pmp("nrow", (1, 27))
+@pmp("nchan", (1, 5))
+@pmp("ncorr", (1, 4))
+@pmp("singleprec", (True, False))
+@pmp("wstacking", (True, False))
+@pmp("nthreads", (1, 2))
+def test_plan_ncorr(nxdirty, nydirty, nrow, nchan, ncorr, singleprec,
+                    wstacking, nthreads):
+    import ducc0.wgridder.experimental as wgridder
+    rng = np.random.default_rng(42)
+    epsilon = 1e-4 if singleprec else 1e-10
+    pixsizex = np.pi/180/60/nxdirty*0.2398
+    pixsizey = np.pi/180/60/nxdirty
+    f0 = 1e9
+    freq = f0 + np.arange(nchan)*(f0/nchan)
+    uvw = (rng.random((nrow, 3))-0.5)/(pixsizey*f0/SPEEDOFLIGHT)
+    ms = rng.random((ncorr, nrow, nchan))-0.5 \
+        + 1j*(rng.random((ncorr, nrow, nchan))-0.5)
+    wgt = rng.uniform(0.9, 1.1, (nrow, nchan))
+    mask = (rng.uniform(0, 1, (nrow, nchan)) > 0.5).astype(np.uint8)
+    dirty = rng.random((ncorr, nxdirty, nydirty))-0.5
+    if singleprec:
+        ms = ms.astype("c8")
+        dirty = dirty.astype("f4")
+        wgt = wgt.astype("f4")
+    args = dict(uvw=uvw, freq=freq, wgt=wgt, mask=mask, pixsize_x=pixsizex,
+                pixsize_y=pixsizey, epsilon=epsilon, do_wgridding=wstacking,
+                nthreads=nthreads)
+    plan = wgridder.plan(npix_x=nxdirty, npix_y=nydirty,
+                         singleprec=singleprec, ncorr=ncorr, **args)
+    dirty2 = plan.vis2dirty(vis=ms)
+    ms2 = plan.dirty2vis(dirty=dirty)
+    dirty3 = wgridder.vis2dirty(vis=ms, npix_x=nxdirty, npix_y=nydirty,
+                                **args)
+    ms3 = wgridder.dirty2vis(dirty=dirty, **args)
+    assert dirty2.shape == dirty3.shape == dirty.shape
+    assert ms2.shape == ms3.shape == ms.shape
+    # all correlations together give the same result as one at a time
+    for i in range(ncorr):
+        ref_dirty = wgridder.vis2dirty(vis=ms[i], npix_x=nxdirty,
+                                       npix_y=nydirty, **args)
+        ref_ms = wgridder.dirty2vis(dirty=dirty[i], **args)
+        assert_allclose(ducc0.misc.l2error(dirty2[i], ref_dirty), 0,
+                        atol=epsilon)
+        assert_allclose(ducc0.misc.l2error(ms2[i], ref_ms), 0, atol=epsilon)
+        assert_allclose(ducc0.misc.l2error(dirty3[i], ref_dirty), 0,
+                        atol=epsilon)
+        assert_allclose(ducc0.misc.l2error(ms3[i], ref_ms), 0, atol=epsilon)
+
+
+@pmp("nxdirty", (32, 64))
+@pmp("nydirty", (32, 48))
+@pmp("nrow", (10, 200))
+@pmp("nchan", (1, 7))
+@pmp("nimage", (1, 3))
+@pmp("singleprec", (True, False))
+@pmp("wstacking", (True, False))
+@pmp("nthreads", (1, 2))
+def test_plan_cube(nxdirty, nydirty, nrow, nchan, nimage, singleprec,
+                   wstacking, nthreads):
+    import ducc0.wgridder.experimental as wgridder
+    rng = np.random.default_rng(42)
+    epsilon = 1e-4 if singleprec else 1e-10
+    pixsizex = np.pi/180/60/nxdirty*0.2398
+    pixsizey = np.pi/180/60/nxdirty
+    f0 = 1e9
+    freq = f0 + np.arange(nchan)*(f0/nchan)
+    uvw = (rng.random((nrow, 3))-0.5)/(pixsizey*f0/SPEEDOFLIGHT)
+    ms = rng.random((nrow, nchan))-0.5 + 1j*(rng.random((nrow, nchan))-0.5)
+    wgt = rng.uniform(0.9, 1.1, (nrow, nchan))
+    mask = (rng.uniform(0, 1, (nrow, nchan)) > 0.5).astype(np.uint8)
+    # the last image may not receive any channels
+    chan2img = rng.integers(0, nimage, nchan)
+    nimg = np.max(chan2img)+1
+    dirty = rng.random((nimg, nxdirty, nydirty))-0.5
+    if singleprec:
+        ms = ms.astype("c8")
+        dirty = dirty.astype("f4")
+        wgt = wgt.astype("f4")
+    args = dict(uvw=uvw, freq=freq, wgt=wgt, pixsize_x=pixsizex,
+                pixsize_y=pixsizey, epsilon=epsilon, do_wgridding=wstacking,
+                nthreads=nthreads)
+    plan = wgridder.plan(npix_x=nxdirty, npix_y=nydirty, mask=mask,
+                         singleprec=singleprec, chan2img=chan2img, **args)
+    dirty2 = plan.vis2dirty(vis=ms)
+    ms2 = plan.dirty2vis(dirty=dirty)
+    assert dirty2.shape == dirty.shape
+    assert ms2.shape == ms.shape
+    # every image equals a separate transform restricted to its channels
+    ref_ms = np.zeros_like(ms)
+    for i in range(nimg):
+        mask_i = mask*(chan2img == i)[None, :].astype(np.uint8)
+        if not np.any(mask_i):
+            assert not np.any(dirty2[i])
+            continue
+        ref_dirty = wgridder.vis2dirty(vis=ms, npix_x=nxdirty,
+                                       npix_y=nydirty, mask=mask_i, **args)
+        ref_ms += wgridder.dirty2vis(dirty=dirty[i], mask=mask_i, **args)
+        assert_allclose(ducc0.misc.l2error(dirty2[i], ref_dirty), 0,
+                        atol=epsilon)
+    assert_allclose(ducc0.misc.l2error(ms2, ref_ms), 0, atol=epsilon)
+
+
 @pmp('nx', [(2, 2), (30, 3), (128, 2)])
 @pmp('ny', [(2, 2), (128, 2), (250, 5)])
 @pmp("nrow", (1, 2, 27))
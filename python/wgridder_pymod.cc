@@ -32,6 +32,7 @@ namespace detail_pymodule_wgridder {
 using namespace std;
 
 namespace py = pybind11;
+using shape_t = fmav_info::shape_t;
 
 auto None = py::none();
 
@@ -164,26 +165,36 @@ template<typename T> py::array Py2_vis2dirty(const py::array &uvw_,
   {
   auto uvw = to_cmav<double,2>(uvw_);
   auto freq = to_cmav<double,1>(freq_);
-  auto vis = to_cmav<complex<T>,2>(vis_);
-  auto wgt = get_optional_const_Pyarr<T>(wgt_, {vis.shape(0),vis.shape(1)});
+  // an optional leading axis of vis holds several correlations
+  bool batched = vis_.ndim()==3;
+  MR_assert(!(batched && gpu), "GPU gridding needs 2D visibilities");
+  auto vis = batched ? to_cmav<complex<T>,3>(vis_)
+                     : to_cmav<complex<T>,2>(vis_).prepend_1();
+  auto wgt = get_optional_const_Pyarr<T>(wgt_, {vis.shape(1),vis.shape(2)});
   auto wgt2 = to_cmav<T,2>(wgt);
   auto mask = get_optional_const_Pyarr<uint8_t>(mask_, {uvw.shape(0),freq.shape(0)});
   auto mask2 = to_cmav<uint8_t,2>(mask);
   // sizes must be either both zero or both nonzero
   MR_assert((npix_x==0)==(npix_y==0), "inconsistent dirty image dimensions");
-  auto dirty = (npix_x==0) ? get_Pyarr<T>(dirty_, 2)
-                           : get_optional_Pyarr<T>(dirty_, {npix_x, npix_y});
-  auto dirty2 = to_vmav<T,2>(dirty);
+  auto dirty = (npix_x==0) ? get_Pyarr<T>(dirty_, batched ? 3 : 2)
+                           : get_optional_Pyarr<T>(dirty_, batched ?
+                               shape_t{vis.shape(0), npix_x, npix_y} :
+                               shape_t{npix_x, npix_y});
+  auto dirty2 = batched ? to_vmav<T,3>(dirty) : to_vmav<T,2>(dirty).prepend_1();
   {
   py::gil_scoped_release release;
   if (gpu)
+    {
+    auto vis1 = to_cmav<complex<T>,2>(vis_);
+    auto dirty1 = to_vmav<T,2>(dirty);
     double_precision_accumulation ?
-      ms2dirty_sycl<T,double>(uvw,freq,vis,wgt2,mask2,pixsize_x,pixsize_y,epsilon,
-        do_wgridding,nthreads,dirty2,verbosity,flip_v,divide_by_n, sigma_min,
+      ms2dirty_sycl<T,double>(uvw,freq,vis1,wgt2,mask2,pixsize_x,pixsize_y,epsilon,
+        do_wgridding,nthreads,dirty1,verbosity,flip_v,divide_by_n, sigma_min,
         sigma_max, center_x, center_y, allow_nshift) :
-      ms2dirty_sycl<T,T>(uvw,freq,vis,wgt2,mask2,pixsize_x,pixsize_y,epsilon,
-        do_wgridding,nthreads,dirty2,verbosity,flip_v,divide_by_n, sigma_min,
+      ms2dirty_sycl<T,T>(uvw,freq,vis1,wgt2,mask2,pixsize_x,pixsize_y,epsilon,
+        do_wgridding,nthreads,dirty1,verbosity,flip_v,divide_by_n, sigma_min,
         sigma_max, center_x, center_y, allow_nshift);
+    }
   else
     double_precision_accumulation ?
       ms2dirty<T,double>(uvw,freq,vis,wgt2,mask2,pixsize_x,pixsize_y,epsilon,
@@ -225,12 +236,14 @@ uvw: numpy.ndarray((nrows, 3), dtype=numpy.float64)
     UVW coordinates from the measurement set
 freq: numpy.ndarray((nchan,), dtype=numpy.float64)
     channel frequencies
-vis: numpy.ndarray((nrows, nchan), dtype=numpy.complex64 or numpy.complex128)
+vis: numpy.ndarray(([ncorr,] nrows, nchan), dtype=numpy.complex64 or numpy.complex128)
     the input visibilities.
     Its data type determines the precision in which the calculation is carried
-    out.
+    out. If the leading axis is present, the ncorr correlations are gridded
+    in a single pass onto ncorr dirty images (not supported with `gpu`).
 wgt: numpy.ndarray((nrows, nchan), float with same precision as `vis`), optional
     If present, its values are multiplied to the input before gridding
+    (identically for all correlations)
 mask: numpy.ndarray((nrows, nchan), dtype=numpy.uint8), optional
     If present, only visibilities are processed for which mask!=0
 npix_x, npix_y: int
@@ -260,7 +273,7 @@ nthreads: int
 verbosity: int
     0: no output
     1: some diagnostic output and timings
-dirty: numpy.ndarray((npix_x, npix_y), dtype=float of same precision as `vis`),
+dirty: numpy.ndarray(([ncorr,] npix_x, npix_y), dtype=float of same precision as `vis`),
     optional
     If provided, the dirty image will be written to this array and a handle
     to it will be returned.
@@ -270,8 +283,8 @@ double_precision_accumulation: bool
 
 Returns
 -------
-numpy.ndarray((npix_x, npix_y), dtype=float of same precision as `vis`)
-    the dirty image
+numpy.ndarray(([ncorr,] npix_x, npix_y), dtype=float of same precision as `vis`)
+    the dirty image; the leading axis is present if it was present in `vis`
 
 Notes
 -----
@@ -386,19 +399,29 @@ template<typename T> py::array Py2_dirty2vis(const py::array &uvw_,
   {
   auto uvw = to_cmav<double,2>(uvw_);
   auto freq = to_cmav<double,1>(freq_);
-  auto dirty = to_cmav<T,2>(dirty_);
+  // an optional leading axis of dirty holds several correlations
+  bool batched = dirty_.ndim()==3;
+  MR_assert(!(batched && gpu), "GPU degridding needs a 2D dirty image");
+  auto dirty = batched ? to_cmav<T,3>(dirty_) : to_cmav<T,2>(dirty_).prepend_1();
   auto wgt = get_optional_const_Pyarr<T>(wgt_, {uvw.shape(0),freq.shape(0)});
   auto wgt2 = to_cmav<T,2>(wgt);
   auto mask = get_optional_const_Pyarr<uint8_t>(mask_, {uvw.shape(0),freq.shape(0)});
   auto mask2 = to_cmav<uint8_t,2>(mask);
-  auto vis = get_optional_Pyarr<complex<T>>(vis_, {uvw.shape(0),freq.shape(0)});
-  auto vis2 = to_vmav<complex<T>,2>(vis);
+  auto vis = get_optional_Pyarr<complex<T>>(vis_, batched ?
+    shape_t{dirty.shape(0), uvw.shape(0), freq.shape(0)} :
+    shape_t{uvw.shape(0), freq.shape(0)});
+  auto vis2 = batched ? to_vmav<complex<T>,3>(vis)
+                      : to_vmav<complex<T>,2>(vis).prepend_1();
   {
   py::gil_scoped_release release;
   if (gpu)
-    dirty2ms_sycl<T,T>(uvw,freq,dirty,wgt2,mask2,pixsize_x,pixsize_y,epsilon,
-      do_wgridding,nthreads,vis2,verbosity,flip_v,divide_by_n, sigma_min,
+    {
+    auto dirty1 = to_cmav<T,2>(dirty_);
+    auto vis1 = to_vmav<complex<T>,2>(vis);
+    dirty2ms_sycl<T,T>(uvw,freq,dirty1,wgt2,mask2,pixsize_x,pixsize_y,epsilon,
+      do_wgridding,nthreads,vis1,verbosity,flip_v,divide_by_n, sigma_min,
       sigma_max, center_x, center_y, allow_nshift);
+    }
   else
     dirty2ms<T,T>(uvw,freq,dirty,wgt2,mask2,pixsize_x,pixsize_y,epsilon,
       do_wgridding,nthreads,vis2,verbosity,flip_v,divide_by_n, sigma_min,
@@ -433,10 +456,11 @@ uvw: numpy.ndarray((nrows, 3), dtype=numpy.float64)
     UVW coordinates from the measurement set
 freq: numpy.ndarray((nchan,), dtype=numpy.float64)
     channel frequencies
-dirty: numpy.ndarray((npix_x, npix_y), dtype=numpy.float32 or numpy.float64)
+dirty: numpy.ndarray(([ncorr,] npix_x, npix_y), dtype=numpy.float32 or numpy.float64)
     dirty image
     Its data type determines the precision in which the calculation is carried
-    out.
+    out. If the leading axis is present, the ncorr images are degridded in a
+    single pass onto ncorr sets of visibilities (not supported with `gpu`).
     Both dimensions must be even and at least 32.
 wgt: numpy.ndarray((nrows, nchan), same dtype as `dirty`), optional
     If present, its values are multiplied to the output
@@ -464,15 +488,16 @@ nthreads: int
 verbosity: int
     0: no output
     1: some diagnostic output and timings
-vis: numpy.ndarray((nrows, nchan), dtype=complex of same precision as `dirty`),
+vis: numpy.ndarray(([ncorr,] nrows, nchan), dtype=complex of same precision as `dirty`),
     optional
     If provided, the computed visibilities will be stored in this array, and
     a handle to it will be returned.
 
 Returns
 -------
-numpy.ndarray((nrows, nchan), dtype=complex of same precision as `dirty`)
-    the computed visibilities.
+numpy.ndarray(([ncorr,] nrows, nchan), dtype=complex of same precision as `dirty`)
+    the computed visibilities; the leading axis is present if it was present
+    in `dirty`
 
 Notes
 -----
@@ -594,6 +619,305 @@ The input arrays should be contiguous and in C memory order.
 Other strides will work, but can degrade performance significantly.
 )""";
 
+class Py_Wgridderplan
+  {
+  private:
+    py::array wgt_ref;  // the plan refers to the weights, so keep them alive
+    size_t nrow, nchan, npix_x, npix_y, ncorr;
+    size_t nimage;  // 0 if the plan is not in cube mode
+    vmav<size_t,1> chan2img;
+
+    unique_ptr<Wgridder< float,  float,  float,  float>> pf;
+    unique_ptr<Wgridder< float, double,  float,  float>> pfd;
+    unique_ptr<Wgridder<double, double, double, double>> pd;
+
+    template<typename Tcalc, typename Tacc, typename T> void construct(
+      unique_ptr<Wgridder<Tcalc,Tacc,T,T>> &ptr, const py::array &uvw_,
+      const py::array &freq_, const py::object &wgt_, const py::object &mask_,
+      double pixsize_x, double pixsize_y, double epsilon, bool do_wgridding,
+      size_t nthreads, size_t verbosity, bool flip_v, bool divide_by_n,
+      double sigma_min, double sigma_max, double center_x, double center_y,
+      bool allow_nshift)
+      {
+      auto uvw = to_cmav<double,2>(uvw_);
+      auto freq = to_cmav<double,1>(freq_);
+      nrow = uvw.shape(0);
+      nchan = freq.shape(0);
+      wgt_ref = get_optional_const_Pyarr<T>(wgt_, {uvw.shape(0),freq.shape(0)});
+      auto wgt = to_cmav<T,2>(wgt_ref);
+      auto mask = get_optional_const_Pyarr<uint8_t>(mask_, {uvw.shape(0),freq.shape(0)});
+      auto mask2 = to_cmav<uint8_t,2>(mask);
+      {
+      py::gil_scoped_release release;
+      ptr = make_unique<Wgridder<Tcalc,Tacc,T,T>>(uvw, freq, wgt, mask2,
+        npix_x, npix_y, pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads,
+        verbosity, flip_v, divide_by_n, sigma_min, sigma_max, center_x,
+        center_y, allow_nshift, ncorr, chan2img);
+      }
+      }
+    template<typename Tcalc, typename Tacc, typename T> py::array do_vis2dirty(
+      const unique_ptr<Wgridder<Tcalc,Tacc,T,T>> &ptr, const py::array &vis_,
+      py::object &dirty_, size_t verbosity)
+      {
+      if (nimage>0)
+        {
+        auto vis = to_cmav<complex<T>,2>(vis_);
+        auto dirty = get_optional_Pyarr<T>(dirty_, {nimage, npix_x, npix_y});
+        auto dirty2 = to_vmav<T,3>(dirty);
+        {
+        py::gil_scoped_release release;
+        ptr->ms2dirty_cube(vis, dirty2, verbosity);
+        }
+        return dirty;
+        }
+      // arrays without correlation axis are only accepted if ncorr==1
+      bool batched = vis_.ndim()==3;
+      auto vis = batched ? to_cmav<complex<T>,3>(vis_)
+                         : to_cmav<complex<T>,2>(vis_).prepend_1();
+      auto dirty = get_optional_Pyarr<T>(dirty_, batched ?
+        shape_t{ncorr, npix_x, npix_y} : shape_t{npix_x, npix_y});
+      auto dirty2 = batched ? to_vmav<T,3>(dirty) : to_vmav<T,2>(dirty).prepend_1();
+      {
+      py::gil_scoped_release release;
+      ptr->ms2dirty(vis, dirty2, verbosity);
+      }
+      return dirty;
+      }
+    template<typename Tcalc, typename Tacc, typename T> py::array do_dirty2vis(
+      const unique_ptr<Wgridder<Tcalc,Tacc,T,T>> &ptr, const py::array &dirty_,
+      py::object &vis_, size_t verbosity)
+      {
+      if (nimage>0)
+        {
+        auto dirty = to_cmav<T,3>(dirty_);
+        auto vis = get_optional_Pyarr<complex<T>>(vis_, {nrow, nchan});
+        auto vis2 = to_vmav<complex<T>,2>(vis);
+        {
+        py::gil_scoped_release release;
+        ptr->dirty2ms_cube(dirty, vis2, verbosity);
+        }
+        return vis;
+        }
+      // arrays without correlation axis are only accepted if ncorr==1
+      bool batched = dirty_.ndim()==3;
+      auto dirty = batched ? to_cmav<T,3>(dirty_) : to_cmav<T,2>(dirty_).prepend_1();
+      auto vis = get_optional_Pyarr<complex<T>>(vis_, batched ?
+        shape_t{ncorr, nrow, nchan} : shape_t{nrow, nchan});
+      auto vis2 = batched ? to_vmav<complex<T>,3>(vis)
+                          : to_vmav<complex<T>,2>(vis).prepend_1();
+      {
+      py::gil_scoped_release release;
+      ptr->dirty2ms(dirty, vis2, verbosity);
+      }
+      return vis;
+      }
+
+  public:
+    Py_Wgridderplan(const py::array &uvw, const py::array &freq,
+      size_t npix_x_, size_t npix_y_, double pixsize_x, double pixsize_y,
+      double epsilon, bool do_wgridding, size_t nthreads, size_t verbosity,
+      const py::object &wgt, const py::object &mask, bool flip_v,
+      bool divide_by_n, double sigma_min, double sigma_max, double center_x,
+      double center_y, bool allow_nshift, bool singleprec,
+      bool double_precision_accumulation, size_t ncorr_,
+      const py::object &chan2img_)
+      : npix_x(npix_x_), npix_y(npix_y_), ncorr(ncorr_), nimage(0)
+      {
+      if (!chan2img_.is_none())
+        {
+        auto tc2i = to_cmav<int64_t,1>(chan2img_);
+        vmav<size_t,1> c2i({tc2i.shape(0)}, UNINITIALIZED);
+        for (size_t i=0; i<tc2i.shape(0); ++i)
+          {
+          MR_assert(tc2i(i)>=0, "negative image index in chan2img");
+          c2i(i) = size_t(tc2i(i));
+          nimage = max(nimage, c2i(i)+1);
+          }
+        chan2img.assign(c2i);
+        }
+      if (!singleprec)
+        construct(pd, uvw, freq, wgt, mask, pixsize_x, pixsize_y, epsilon,
+          do_wgridding, nthreads, verbosity, flip_v, divide_by_n, sigma_min,
+          sigma_max, center_x, center_y, allow_nshift);
+      else if (double_precision_accumulation)
+        construct(pfd, uvw, freq, wgt, mask, pixsize_x, pixsize_y, epsilon,
+          do_wgridding, nthreads, verbosity, flip_v, divide_by_n, sigma_min,
+          sigma_max, center_x, center_y, allow_nshift);
+      else
+        construct(pf, uvw, freq, wgt, mask, pixsize_x, pixsize_y, epsilon,
+          do_wgridding, nthreads, verbosity, flip_v, divide_by_n, sigma_min,
+          sigma_max, center_x, center_y, allow_nshift);
+      }
+
+    py::array vis2dirty(const py::array &vis, py::object &dirty,
+      size_t verbosity)
+      {
+      if (pd) return do_vis2dirty(pd, vis, dirty, verbosity);
+      if (pfd) return do_vis2dirty(pfd, vis, dirty, verbosity);
+      if (pf) return do_vis2dirty(pf, vis, dirty, verbosity);
+      MR_fail("unsupported");
+      }
+    py::array dirty2vis(const py::array &dirty, py::object &vis,
+      size_t verbosity)
+      {
+      if (pd) return do_dirty2vis(pd, dirty, vis, verbosity);
+      if (pfd) return do_dirty2vis(pfd, dirty, vis, verbosity);
+      if (pf) return do_dirty2vis(pf, dirty, vis, verbosity);
+      MR_fail("unsupported");
+      }
+  };
+
+constexpr const char *plan_init_DS = R"""(
+Prepares repeated gridding and degridding for fixed visibility coordinates.
+
+Everything that only depends on `uvw`, `freq`, `wgt`, `mask` and the image
+parameters (kernel and grid size selection, sorting of the visibilities) is
+done once here; the `vis2dirty` and `dirty2vis` methods then only need the
+visibility or image data. This is useful for iterative imaging, where many
+transforms are carried out for the same observation.
+
+Parameters
+----------
+uvw: numpy.ndarray((nrows, 3), dtype=numpy.float64)
+    UVW coordinates from the measurement set
+freq: numpy.ndarray((nchan,), dtype=numpy.float64)
+    channel frequencies
+npix_x, npix_y: int
+    dimensions of the dirty image (must both be even and at least 32)
+pixsize_x, pixsize_y: float
+    angular pixel size (in projected radians) of the dirty image
+epsilon: float
+    accuracy at which the computation should be done. Must be larger than 2e-13.
+    If `singleprec` is True, it must be larger than 1e-5.
+do_wgridding: bool
+    if True, the full w-gridding algorithm is carried out, otherwise
+    the w values are assumed to be zero.
+nthreads: int
+    number of threads to use for the calculation
+verbosity: int
+    0: no output
+    1: some diagnostic output and timings of the preparation step
+wgt: numpy.ndarray((nrows, nchan), float with the precision of the plan), optional
+    If present, its values are multiplied to the visibilities when gridding
+    and degridding.
+    The array is referenced by the plan and must not be modified while the
+    plan is in use.
+mask: numpy.ndarray((nrows, nchan), dtype=numpy.uint8), optional
+    If present, only visibilities are processed for which mask!=0
+flip_v: bool
+    if True, all v coordinates in uvw are multiplied by -1
+divide_by_n: bool
+    if True, the dirty image pixels are divided by n
+sigma_min, sigma_max: float
+    minimum and maximum allowed oversampling factors
+center_x, center_y: float
+    center of the dirty image relative to the phase center
+    (in projected radians)
+singleprec: bool
+    if True, the plan works on numpy.complex64 visibilities and numpy.float32
+    images, otherwise on numpy.complex128 and numpy.float64.
+double_precision_accumulation: bool
+    If True, always use double precision for accumulating operations onto the
+    uv grid. Only relevant if `singleprec` is True.
+ncorr: int
+    number of correlations (e.g. 4 for full-polarization data) which are
+    processed together. If larger than 1, visibilities and dirty images
+    passed to the plan need an additional leading axis of this length.
+    All correlations share `wgt` and `mask`; kernel evaluation and w-screens
+    are only computed once for all of them.
+chan2img: numpy.ndarray((nchan,), dtype=numpy.int64), optional
+    If present, the plan works in spectral cube mode: channel `i` contributes
+    to (and is predicted from) image `chan2img[i]` of a cube with
+    `max(chan2img)+1` images. `vis2dirty` then returns a cube of shape
+    (nimage, npix_x, npix_y), and `dirty2vis` expects one. Visibility sorting
+    and kernel selection are shared by all images, and every image only
+    processes the w planes touched by its own channels.
+    Requires ncorr==1.
+
+Notes
+-----
+The plan must not be used concurrently from several threads.
+)""";
+
+constexpr const char *plan_vis2dirty_DS = R"""(
+Converts visibilities to a dirty image.
+
+Parameters
+----------
+vis: numpy.ndarray(([ncorr,] nrows, nchan), dtype=complex with the precision of the plan)
+    the input visibilities.
+    In contrast to `vis2dirty`, visibilities which are zero are not skipped.
+    The leading axis may only be omitted if the plan has ncorr==1.
+    In cube mode, there is no correlation axis.
+dirty: numpy.ndarray(([ncorr,] npix_x, npix_y), dtype=float with the precision of the plan),
+    optional
+    If provided, the dirty image will be written to this array and a handle
+    to it will be returned.
+verbosity: int
+    0: no output
+    1: timings
+
+Returns
+-------
+numpy.ndarray(([ncorr,] npix_x, npix_y), dtype=float with the precision of the plan)
+    the dirty image(s); the leading axis is present if it was present in `vis`.
+    In cube mode, the shape is (nimage, npix_x, npix_y).
+)""";
+
+constexpr const char *plan_dirty2vis_DS = R"""(
+Converts a dirty image to visibilities.
+
+Parameters
+----------
+dirty: numpy.ndarray(([ncorr,] npix_x, npix_y), dtype=float with the precision of the plan)
+    dirty image(s)
+    The leading axis may only be omitted if the plan has ncorr==1.
+    In cube mode, the shape must be (nimage, npix_x, npix_y).
+vis: numpy.ndarray(([ncorr,] nrows, nchan), dtype=complex with the precision of the plan),
+    optional
+    If provided, the computed visibilities will be stored in this array, and
+    a handle to it will be returned.
+verbosity: int
+    0: no output
+    1: timings
+
+Returns
+-------
+numpy.ndarray(([ncorr,] nrows, nchan), dtype=complex with the precision of the plan)
+    the computed visibilities; the leading axis is present if it was present
+    in `dirty`. In cube mode, there is no correlation axis.
+)""";
+
+py::tuple Py_set_overrides(size_t planes_in_flight, size_t facet_concurrency)
+  {
+  auto old = getGridderOverrides();
+  GridderOverrides ovr;
+  ovr.planes_in_flight = planes_in_flight;
+  ovr.facet_concurrency = facet_concurrency;
+  setGridderOverrides(ovr);
+  return py::make_tuple(old.planes_in_flight, old.facet_concurrency);
+  }
+
+constexpr const char *set_overrides_DS = R"""(
+Fixes parameters of the gridding algorithm that are normally chosen
+automatically. This is only meant for testing; calling it without arguments
+restores the automatic choice.
+
+Parameters
+----------
+planes_in_flight : int
+    number of w planes that are gridded, transformed and w-screened together
+    0: choose automatically
+facet_concurrency : int
+    number of facets that `vis2dirty_tuning` and `dirty2vis_tuning` process
+    concurrently (at most `nthreads`), if they subdivide the image
+    0: choose automatically
+
+Returns
+-------
+tuple(int, int) : the previous values
+)""";
+
 constexpr const char *wgridder_experimental_DS = R"""(
 Experimental, more powerful interface to the gridding code
 
@@ -612,6 +936,8 @@ void add_wgridder(py::module_ &msup)
   auto m2 = m.def_submodule("experimental", wgridder_experimental_DS);
 
   m2.def("sycl_active", &ducc0::sycl_active);
+  m2.def("_set_overrides", &Py_set_overrides, set_overrides_DS,
+    "planes_in_flight"_a=0, "facet_concurrency"_a=0);
 
   m2.def("vis2dirty", &Py_vis2dirty, vis2dirty_DS, py::kw_only(), "uvw"_a, "freq"_a, "vis"_a,
     "wgt"_a=None, "npix_x"_a=0, "npix_y"_a=0, "pixsize_x"_a, "pixsize_y"_a,
@@ -636,6 +962,24 @@ void add_wgridder(py::module_ &msup)
     "flip_v"_a=false, "divide_by_n"_a=true, "vis"_a=None, "sigma_min"_a=1.1,
     "sigma_max"_a=2.6, "center_x"_a=0., "center_y"_a=0.);
 
+  py::class_<Py_Wgridderplan> (m2, "plan", py::module_local())
+    .def(py::init<const py::array &, const py::array &, size_t, size_t,
+                  double, double, double, bool, size_t, size_t,
+                  const py::object &, const py::object &, bool, bool, double,
+                  double, double, double, bool, bool, bool, size_t,
+                  const py::object &>(),
+      plan_init_DS, py::kw_only(), "uvw"_a, "freq"_a, "npix_x"_a, "npix_y"_a,
+      "pixsize_x"_a, "pixsize_y"_a, "epsilon"_a, "do_wgridding"_a=false,
+      "nthreads"_a=1, "verbosity"_a=0, "wgt"_a=None, "mask"_a=None,
+      "flip_v"_a=false, "divide_by_n"_a=true, "sigma_min"_a=1.1,
+      "sigma_max"_a=2.6, "center_x"_a=0., "center_y"_a=0.,
+      "allow_nshift"_a=true, "singleprec"_a=false,
+      "double_precision_accumulation"_a=false, "ncorr"_a=1, "chan2img"_a=None)
+    .def("vis2dirty", &Py_Wgridderplan::vis2dirty, plan_vis2dirty_DS,
+      py::kw_only(), "vis"_a, "dirty"_a=None, "verbosity"_a=0)
+    .def("dirty2vis", &Py_Wgridderplan::dirty2vis, plan_dirty2vis_DS,
+      py::kw_only(), "dirty"_a, "vis"_a=None, "verbosity"_a=0);
+
   m.def("ms2dirty", &Py_ms2dirty, ms2dirty_DS, "uvw"_a, "freq"_a, "ms"_a,
     "wgt"_a=None, "npix_x"_a, "npix_y"_a, "pixsize_x"_a, "pixsize_y"_a, "nu"_a=0, "nv"_a=0,
     "epsilon"_a, "do_wstacking"_a=false, "nthreads"_a=1, "verbosity"_a=0, "mask"_a=None,
@@ -52,6 +52,34 @@ void fft_c2c(const ducc0::ArrayDescriptor &in, ducc0::ArrayDescriptor &out,
   ducc0::c2c(in_mav, out_mav, axes1, forward, T(fct), nthreads);
 }
 
+// A plan is returned to Rust as an opaque pointer to this struct.
+struct FftPlanC2C {
+  size_t dtype;
+  void *plan;
+};
+
+template <typename T>
+void *fft_c2c_plan_new(const ducc0::ArrayDescriptor &in,
+                       const ducc0::ArrayDescriptor &out,
+                       const ducc0::ArrayDescriptor &axes,
+                       const size_t nthreads) {
+  auto in_mav = ducc0::to_cfmav<false, complex<T>>(in);
+  auto out_mav = ducc0::to_cfmav<false, complex<T>>(out);
+  auto axes1 = arraydesc2vec(axes);
+  return new ducc0::FftPlanND<T>(ducc0::FFT_C2C, in_mav, out_mav, axes1,
+                                 nthreads, in.data == out.data);
+}
+
+template <typename T>
+void fft_c2c_plan_exec(void *plan, const ducc0::ArrayDescriptor &in,
+                       ducc0::ArrayDescriptor &out, const bool forward,
+                       const double fct) {
+  auto in_mav = ducc0::to_cfmav<false, complex<T>>(in);
+  auto out_mav = ducc0::to_vfmav<false, complex<T>>(out);
+  reinterpret_cast<ducc0::FftPlanND<T> *>(plan)->exec(in_mav, out_mav, forward,
+                                                      T(fct));
+}
+
 extern "C" {
 
 void fft_c2c_(const ducc0::ArrayDescriptor &in, ducc0::ArrayDescriptor &out,
@@ -64,4 +92,38 @@ void fft_c2c_(const ducc0::ArrayDescriptor &in, ducc0::ArrayDescriptor &out,
   else
     MR_fail("Type not supported");
 }
+
+void *fft_c2c_plan_new_(const ducc0::ArrayDescriptor &in,
+                        const ducc0::ArrayDescriptor &out,
+                        const ducc0::ArrayDescriptor &axes,
+                        const size_t nthreads) {
+  if (in.dtype == C128)
+    return new FftPlanC2C{C128,
+                          fft_c2c_plan_new<double>(in, out, axes, nthreads)};
+  else if (in.dtype == C64)
+    return new FftPlanC2C{C64,
+                          fft_c2c_plan_new<float>(in, out, axes, nthreads)};
+  else
+    MR_fail("Type not supported");
+}
+
+void fft_c2c_plan_exec_(void *plan, const ducc0::ArrayDescriptor &in,
+                        ducc0::ArrayDescriptor &out, const bool forward,
+                        const double fct) {
+  auto p = reinterpret_cast<FftPlanC2C *>(plan);
+  MR_assert(in.dtype == p->dtype, "data type does not match the plan");
+  if (p->dtype == C128)
+    fft_c2c_plan_exec<double>(p->plan, in, out, forward, fct);
+  else
+    fft_c2c_plan_exec<float>(p->plan, in, out, forward, fct);
+}
+
+void fft_c2c_plan_delete_(void *plan) {
+  auto p = reinterpret_cast<FftPlanC2C *>(plan);
+  if (p->dtype == C128)
+    delete reinterpret_cast<ducc0::FftPlanND<double> *>(p->plan);
+  else
+    delete reinterpret_cast<ducc0::FftPlanND<float> *>(p->plan);
+  delete p;
+}
 }
@@ -4,6 +4,7 @@ use std::any::TypeId;
 use std::ffi::c_void;
 use std::mem::size_of;
 use std::cell::UnsafeCell;
+use std::marker::PhantomData;
 
 // Support -march=native
 // Support -ffast-math (only for building ducc)
@@ -98,6 +99,20 @@ extern "C" {
         fct: f64,
         nthreads: usize,
     );
+    fn fft_c2c_plan_new_(
+        inp: &RustArrayDescriptor,
+        out: &RustArrayDescriptor,
+        axes: &RustArrayDescriptor,
+        nthreads: usize,
+    ) -> *mut c_void;
+    fn fft_c2c_plan_exec_(
+        plan: *mut c_void,
+        inp: &RustArrayDescriptor,
+        out: &mut RustArrayDescriptor,
+        forward: bool,
+        fct: f64,
+    );
+    fn fft_c2c_plan_delete_(plan: *mut c_void);
 }
 
 /// Complex-to-complex Fast Fourier Transform
@@ -155,6 +170,97 @@ pub fn fft_c2c_inplace<A: 'static, D: ndarray::Dimension>(
         );
     }
 }
+/// Reusable plan for complex-to-complex Fast Fourier Transforms
+///
+/// The plan stores the one-dimensional plans, threading decisions and scratch buffers for a
+/// fixed array layout, so that repeated transforms of arrays with identical shape and strides
+/// do not have to redo this work. The arrays passed to [`FftPlanC2C::exec`] must have exactly
+/// the shapes and strides of the arrays used to create the plan.
+pub struct FftPlanC2C<A> {
+    plan: *mut c_void,
+    _marker: PhantomData<A>,
+}
+
+impl<A: 'static> FftPlanC2C<A> {
+    /// Creates a plan for out-of-place transforms from arrays laid out like `inp` to arrays laid
+    /// out like `out`. The array contents are not accessed.
+    ///
+    /// Arguments are analogous to [`fft_c2c`].
+    pub fn new<D: ndarray::Dimension>(
+        inp: ArrayView<Complex<A>, D>,
+        out: ArrayViewMut<Complex<A>, D>,
+        axes: &Vec<usize>,
+        nthreads: usize,
+    ) -> Self {
+        let inp2 = slice2arrdesc(inp);
+        let out2 = mutslice2arrdesc(out);
+        let axes2 = Array1::from_vec(axes.to_vec());
+        let axes3 = slice2arrdesc(axes2.view());
+        let plan = unsafe { fft_c2c_plan_new_(&inp2, &out2, &axes3, nthreads) };
+        FftPlanC2C {
+            plan,
+            _marker: PhantomData,
+        }
+    }
+
+    /// Creates a plan for in-place transforms of arrays laid out like `inpout`.
+    pub fn new_inplace<D: ndarray::Dimension>(
+        inpout: ArrayViewMut<Complex<A>, D>,
+        axes: &Vec<usize>,
+        nthreads: usize,
+    ) -> Self {
+        let inpout2 = mutslice2arrdesc(inpout);
+        let axes2 = Array1::from_vec(axes.to_vec());
+        let axes3 = slice2arrdesc(axes2.view());
+        let plan = unsafe { fft_c2c_plan_new_(&inpout2, &inpout2, &axes3, nthreads) };
+        FftPlanC2C {
+            plan,
+            _marker: PhantomData,
+        }
+    }
+
+    /// Executes the planned out-of-place transform.
+    pub fn exec<D: ndarray::Dimension>(
+        &mut self,
+        inp: ArrayView<Complex<A>, D>,
+        out: ArrayViewMut<Complex<A>, D>,
+        forward: bool,
+        fct: f64,
+    ) {
+        let inp2 = slice2arrdesc(inp);
+        let mut out2 = mutslice2arrdesc(out);
+        unsafe {
+            fft_c2c_plan_exec_(self.plan, &inp2, &mut out2, forward, fct);
+        }
+    }
+
+    /// Executes the planned in-place transform.
+    pub fn exec_inplace<D: ndarray::Dimension>(
+        &mut self,
+        inpout: ArrayViewMut<Complex<A>, D>,
+        forward: bool,
+        fct: f64,
+    ) {
+        let inpout2 = UnsafeCell::new(mutslice2arrdesc(inpout));
+        unsafe {
+            fft_c2c_plan_exec_(
+                self.plan,
+                &*inpout2.get(),
+                &mut *inpout2.get(),
+                forward,
+                fct,
+            );
+        }
+    }
+}
+
+impl<A> Drop for FftPlanC2C<A> {
+    fn drop(&mut self) {
+        unsafe {
+            fft_c2c_plan_delete_(self.plan);
+        }
+    }
+}
 // /Interface
 
 #[cfg(test)]
@@ -181,4 +287,20 @@ mod tests {
 
         fft_c2c_inplace(c.view_mut(), &axes, true, 1., 1);
     }
+
+    #[test]
+    fn fft_plan_test() {
+        let shape = (2, 3, 3);
+
+        let b = Array::from_elem(shape, Complex::<f64>::new(12., 0.));
+        let mut c = Array::from_elem(shape, Complex::<f64>::new(0., 0.));
+        let mut d = Array::from_elem(shape, Complex::<f64>::new(0., 0.));
+        let axes = vec![0, 2];
+        fft_c2c(b.view(), c.view_mut(), &axes, true, 1., 1);
+        let mut plan = FftPlanC2C::new(b.view(), d.view_mut(), &axes, 1);
+        for _ in 0..2 {
+            plan.exec(b.view(), d.view_mut(), true, 1.);
+            assert_eq!(c, d);
+        }
+    }
 }
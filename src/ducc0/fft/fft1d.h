@@ -62,8 +62,19 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <type_traits>
 #include <utility>
 #include <vector>
+#include <array>
 #include <typeinfo>
 #include <typeindex>
+#include <map>
+#include <tuple>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <cstdlib>
 #include "ducc0/infra/useful_macros.h"
 #include "ducc0/math/cmplx.h"
 #include "ducc0/infra/error_handling.h"
@@ -187,8 +198,232 @@ struct util1d // hack to avoid duplicate symbols
     }
   };
 
+/// Description of how a 1D transform of a given length is decomposed.
+struct FftRecipe
+  {
+  /* 'd': built-in heuristics
+     'm': multipass with the factors given in \a factors (in this order)
+     'v': vectorized pass (complex transforms only)
+     'x': complex transform of half length (real transforms only)
+     'g': generic O(n^2) pass (single factor only)
+     'b': Bluestein's algorithm (single factor only); for complex transforms
+          the convolution length is \a blue_len */
+  char method='d';
+  size_t blue_len=0;
+  vector<size_t> factors;
+  };
+
+/// Storage for measured 1D FFT recipes ("wisdom").
+/** If the environment variable DUCC0_FFT_WISDOM is set, wisdom is imported
+ *  from the file it points to when the store is first accessed. If the file
+ *  cannot be parsed, a warning is printed and the store starts out empty. */
+class FftWisdom
+  {
+  private:
+    // kind is 'c' or 'r', prec is the size of the floating point type
+    using Key = tuple<char, size_t, size_t, bool>;
+    map<Key, FftRecipe> data;
+    mutable Mutex mut;
+    atomic<bool> measure_{false};
+
+    FftWisdom()
+      {
+      auto fname = getenv("DUCC0_FFT_WISDOM");
+      if (!fname) return;
+      ifstream inp(fname);
+      if (!inp) return;
+      stringstream str;
+      str << inp.rdbuf();
+      // an exception here would make every subsequent plan creation fail
+      try
+        { import_wisdom(str.str()); }
+      catch (const exception &e)
+        {
+        cerr << "ducc0: ignoring DUCC0_FFT_WISDOM file '" << fname << "': "
+             << e.what() << endl;
+        }
+      }
+
+  public:
+    static FftWisdom &get()
+      {
+      static FftWisdom wisdom;
+      return wisdom;
+      }
+
+    bool lookup(char kind, size_t prec, size_t n, bool vectorize,
+      FftRecipe &res) const
+      {
+      LockGuard lock(mut);
+      auto it = data.find(Key(kind, prec, n, vectorize));
+      if (it==data.end()) return false;
+      res = it->second;
+      return true;
+      }
+    void set(char kind, size_t prec, size_t n, bool vectorize,
+      const FftRecipe &recipe)
+      {
+      LockGuard lock(mut);
+      data[Key(kind, prec, n, vectorize)] = recipe;
+      }
+    void clear()
+      {
+      LockGuard lock(mut);
+      data.clear();
+      }
+
+    /// If true, recipes for unknown lengths are measured when the first plan
+    /// for this length is created.
+    bool measure() const { return measure_; }
+    void set_measure(bool val) { measure_ = val; }
+
+    /// Returns all stored recipes in a line-based text format.
+    string export_wisdom() const
+      {
+      LockGuard lock(mut);
+      ostringstream res;
+      res << "# ducc0 FFT wisdom: kind prec length vectorize method blue_len factors\n";
+      for (const auto &[key, rec]: data)
+        {
+        res << std::get<0>(key) << ' ' << std::get<1>(key) << ' ' << std::get<2>(key) << ' '
+            << int(std::get<3>(key)) << ' ' << rec.method << ' ' << rec.blue_len << ' ';
+        if (rec.factors.empty()) res << '-';
+        for (size_t i=0; i<rec.factors.size(); ++i)
+          res << (i==0 ? "" : ",") << rec.factors[i];
+        res << '\n';
+        }
+      return res.str();
+      }
+    /// Adds the recipes contained in \a str (in the format produced by
+    /// export_wisdom()) to the store.
+    void import_wisdom(const string &str)
+      {
+      istringstream inp(str);
+      string line;
+      vector<pair<Key, FftRecipe>> newdata;
+      while (getline(inp, line))
+        {
+        if (line.empty() || (line[0]=='#')) continue;
+        istringstream ls(line);
+        char kind;
+        size_t prec, n;
+        int vectorize;
+        FftRecipe rec;
+        string factors;
+        ls >> kind >> prec >> n >> vectorize >> rec.method >> rec.blue_len >> factors;
+        MR_assert(ls && ((kind=='c')||(kind=='r')) && (n>0),
+          "malformed wisdom line: '", line, "'");
+        MR_assert(string("dmvxgb").find(rec.method)!=string::npos,
+          "unknown method in wisdom line: '", line, "'");
+        if (factors!="-")
+          {
+          istringstream fs(factors);
+          string tok;
+          size_t prod=1;
+          while (getline(fs, tok, ','))
+            {
+            rec.factors.push_back(size_t(stoull(tok)));
+            prod *= rec.factors.back();
+            }
+          MR_assert(prod==n, "factors do not match length in wisdom line: '",
+            line, "'");
+          }
+        newdata.emplace_back(Key(kind, prec, n, vectorize!=0), rec);
+        }
+      LockGuard lock(mut);
+      for (const auto &[key, rec]: newdata)
+        data[key] = rec;
+      }
+  };
+
+// Runs \a func repeatedly and returns the shortest average run time in seconds.
+template<typename Func> double time_fft_candidate(Func func)
+  {
+  using clock = chrono::steady_clock;
+  auto run = [&func](size_t nrep)
+    {
+    auto t0 = clock::now();
+    for (size_t i=0; i<nrep; ++i) func();
+    return chrono::duration<double>(clock::now()-t0).count();
+    };
+  size_t nrep=1;
+  double t;
+  while (((t=run(nrep))<1e-3) && (nrep<(size_t(1)<<20)))
+    nrep*=2;
+  double best = t/nrep;
+  for (size_t i=0; i<4; ++i)
+    best = min(best, run(nrep)/nrep);
+  return best;
+  }
+
+// Returns true if the passes of a real-valued multipass transform can be
+// executed in the order given by \a factors (even factors must come first).
+inline bool valid_real_factor_order(const vector<size_t> &factors)
+  {
+  for (size_t i=1; i<factors.size(); ++i)
+    if (((factors[i]&1)==0) && ((factors[i-1]&1)!=0))
+      return false;
+  return true;
+  }
+
+// Returns a list of distinct factor orderings worth measuring for a
+// multipass transform with the default factorization \a factors.
+inline vector<vector<size_t>> fft_factor_candidates(const vector<size_t> &factors,
+  size_t n, bool real)
+  {
+  vector<vector<size_t>> res;
+  auto add = [&res](const vector<size_t> &f)
+    {
+    if ((f.size()>1) && (find(res.begin(), res.end(), f)==res.end()))
+      res.push_back(f);
+    };
+  add(factors);
+  if (real)
+    {
+    // only the odd factors can be reordered
+    auto f2(factors);
+    auto it = find_if(f2.begin(), f2.end(), [](size_t f) { return f&1; });
+    reverse(it, f2.end());
+    add(f2);
+    return res;
+    }
+  add(vector<size_t>(factors.rbegin(), factors.rend()));
+  // radix-4 instead of radix-8 passes
+  vector<size_t> f4;
+  size_t log2n=0;
+  for (auto f: factors)
+    log2n += (f==8) ? 3 : ((f==4) ? 2 : ((f==2) ? 1 : 0));
+  if (log2n&1) f4.push_back(2);
+  for (size_t i=0; i<log2n/2; ++i) f4.push_back(4);
+  for (auto f: factors)
+    if ((f&1)!=0) f4.push_back(f);
+  add(f4);
+  // two roughly equal packets, as used for very long transforms
+  if (n>=1000)
+    {
+    vector<size_t> packets(2,1);
+    auto pf = util1d::prime_factors(n);
+    sort(pf.begin(), pf.end(), std::greater<size_t>());
+    for (auto f: pf)
+      (packets[0]>packets[1]) ? packets[1]*=f : packets[0]*=f;
+    if ((packets[0]>1) && (packets[1]>1)) add(packets);
+    }
+  return res;
+  }
+
 template<typename T> using Troots = shared_ptr<const UnityRoots<T,Cmplx<T>>>;
 
+// Returns scratch space for n values of type T which is private to the
+// calling thread. It is kept until the thread terminates, so repeated
+// multithreaded executions of long transforms do not allocate memory.
+// Every type must only be used at one nesting level of the algorithm.
+template<typename T> T *thread_scratch(size_t n)
+  {
+  static thread_local aligned_array<T> scratch;
+  if (scratch.size()<n) scratch.resize(n);
+  return scratch.data();
+  }
+
 // T: "type", f/c: "float/complex", s/v: "scalar/vector"
 template <typename Tfs> class cfftpass
   {
@@ -199,6 +434,9 @@ template <typename Tfs> class cfftpass
     // number of Tcd values required as scratch space during "exec"
     // will be provided in "buf"
     virtual size_t bufsize() const = 0;
+    // approximate number of Tcd values the pass may allocate on demand
+    // and keep afterwards (e.g. data needed for multithreaded execution)
+    virtual size_t lazy_size() const { return 0; }
     virtual bool needs_copy() const = 0;
     virtual void *exec(const type_index &ti, void *in, void *copy, void *buf,
       bool fwd, size_t nthreads=1) const = 0;
@@ -236,6 +474,15 @@ template <typename Tfs> class cfftpass
       return make_pass(1,1,ip,make_shared<UnityRoots<Tfs,Cmplx<Tfs>>>(ip),
         vectorize);
       }
+    // pass for a whole transform of length ip, built according to recipe
+    static shared_ptr<cfftpass> make_pass(size_t ip, const Troots<Tfs> &roots,
+      bool vectorize, const FftRecipe &recipe);
+    // measures the fastest recipe for a transform of length ip
+    static FftRecipe tune(size_t ip, bool vectorize);
+
+  private:
+    static shared_ptr<cfftpass> make_default_pass(size_t l1, size_t ido,
+      size_t ip, const Troots<Tfs> &roots, bool vectorize);
   };
 
 #define POCKETFFT_EXEC_DISPATCH \
@@ -1305,11 +1552,13 @@ template <typename Tfs> class cfftpblue: public cfftpass<Tfs>
 
   public:
     cfftpblue(size_t l1_, size_t ido_, size_t ip_, const Troots<Tfs> &roots,
-      bool vectorize=false)
-      : l1(l1_), ido(ido_), ip(ip_), ip2(util1d::good_size_cmplx(ip*2-1)),
+      bool vectorize=false, size_t ip2_=0)
+      : l1(l1_), ido(ido_), ip(ip_),
+        ip2((ip2_==0) ? util1d::good_size_cmplx(ip*2-1) : ip2_),
         subplan(cfftpass<Tfs>::make_pass(ip2, vectorize)), wa((ip-1)*(ido-1)),
         bk(ip), bkf(ip2/2+1)
       {
+      MR_assert(ip2>=2*ip-1, "Bluestein convolution length too small");
       size_t N=ip*l1*ido;
       auto rfct = roots->size()/N;
       MR_assert(roots->size()==N*rfct, "mismatch");
@@ -1350,6 +1599,7 @@ template <typename Tfs> class cfftpblue: public cfftpass<Tfs>
       }
 
     virtual size_t bufsize() const { return bufsz; }
+    virtual size_t lazy_size() const { return subplan->lazy_size(); }
     virtual bool needs_copy() const { return need_cpy; }
 
     POCKETFFT_EXEC_DISPATCH
@@ -1407,7 +1657,7 @@ template <typename Tfs> class cfft_multipass: public cfftpass<Tfs>
 
             execStatic(nvtrans, nthreads, 0, [&](auto &sched)
               {
-              aligned_array<Tcv> tbuf(2*ip+32+bufsize());
+              auto tbuf = thread_scratch<Tcv>(2*ip+32+bufsize());
               auto cc2 = &tbuf[0];
               auto ch2 = &tbuf[ip+16];
               auto buf2 = &tbuf[2*ip+32];
@@ -1449,7 +1699,7 @@ template <typename Tfs> class cfft_multipass: public cfftpass<Tfs>
 
             execStatic(nvtrans, nthreads, 0, [&](auto &sched)
               {
-              aligned_array<Tcv> tbuf(2*ip+32+bufsize());
+              auto tbuf = thread_scratch<Tcv>(2*ip+32+bufsize());
               auto cc2 = &tbuf[0];
               auto ch2 = &tbuf[ip+16];
               auto buf2 = &tbuf[2*ip+32];
@@ -1561,92 +1811,108 @@ MR_fail("must not get here");
         else
           {
           static const auto tic = tidx<Cmplx<T> *>();
+          // runs func(lo, hi, scratch) over [0; nwork[, using private
+          // scratch buffers if more than one thread is involved
+          auto run = [&](size_t nwork, auto &&func)
+            {
+            if (adjust_nthreads(nthreads)==1)
+              func(0, nwork, buf);
+            else
+              execParallel(nwork, nthreads, [&](size_t lo, size_t hi)
+                { func(lo, hi, thread_scratch<Cmplx<T>>(bufsize())); });
+            };
           if (ido==1)
             {
-// parallelize here!
-            for (size_t n=0; n<l1; ++n)
+            run(l1, [&](size_t lo, size_t hi, Cmplx<T> *buf2)
               {
-              Cmplx<T> *p1=&cc[n*ip], *p2=ch;
-              Cmplx<T> *res = nullptr;
-              for(const auto &pass: passes)
+              for (size_t n=lo; n<hi; ++n)
                 {
-                res = static_cast<Cmplx<T> *>(pass->exec(tic,
-                  p1, p2, buf, fwd));
-                if (res==p2) swap (p1,p2);
+                Cmplx<T> *p1=&cc[n*ip], *p2=buf2;
+                Cmplx<T> *res = nullptr;
+                for(const auto &pass: passes)
+                  {
+                  res = static_cast<Cmplx<T> *>(pass->exec(tic,
+                    p1, p2, buf2+ip, fwd));
+                  if (res==p2) swap (p1,p2);
+                  }
+                if (res != &cc[n*ip])
+                  copy(res, res+ip, cc+n*ip);
                 }
-              if (res != &cc[n*ip])
-                copy(res, res+ip, cc+n*ip);
-              }
+              });
             // transpose
             size_t nbunch = (l1*ido + bunchsize-1)/bunchsize;
-// parallelize here!
-            for (size_t ibunch=0; ibunch<nbunch; ++ibunch)
+            run(nbunch, [&](size_t lo, size_t hi, Cmplx<T> * /*buf2*/)
               {
-              size_t ntrans = min(bunchsize, l1-ibunch*bunchsize);
-              for (size_t m=0; m<ip; ++m)
-                for (size_t n=0; n<ntrans; ++n)
-                  {
-                  size_t itrans = ibunch*bunchsize + n;
-                  ch[itrans+m*l1] = cc[m+itrans*ip];
-                  }
-              }
+              for (size_t ibunch=lo; ibunch<hi; ++ibunch)
+                {
+                size_t ntrans = min(bunchsize, l1-ibunch*bunchsize);
+                for (size_t m=0; m<ip; ++m)
+                  for (size_t n=0; n<ntrans; ++n)
+                    {
+                    size_t itrans = ibunch*bunchsize + n;
+                    ch[itrans+m*l1] = cc[m+itrans*ip];
+                    }
+                }
+              });
             return ch;
             }
           if (l1==1)
             {
-            auto cc2 = &buf[0];
-            auto ch2 = &buf[bunchsize*ip];
-            auto buf2 = &buf[(bunchsize+1)*ip];
             size_t nbunch = (ido + bunchsize-1)/bunchsize;
 
             auto CC = [cc,this](size_t a, size_t b) -> Tc&
               { return cc[a+ido*b]; };
 
-// parallelize here!
-             for (size_t ibunch=0; ibunch<nbunch; ++ibunch)
+            run(nbunch, [&](size_t lo, size_t hi, Cmplx<T> *tbuf)
               {
-              size_t ntrans = min(bunchsize, ido-ibunch*bunchsize);
+              auto cc2 = &tbuf[0];
+              auto ch2 = &tbuf[bunchsize*ip];
+              auto buf2 = &tbuf[(bunchsize+1)*ip];
+              for (size_t ibunch=lo; ibunch<hi; ++ibunch)
+                {
+                size_t ntrans = min(bunchsize, ido-ibunch*bunchsize);
 
-              for (size_t m=0; m<ip; ++m)
-                for (size_t n=0; n<ntrans; ++n)
-                  cc2[m+n*ip] = CC(n+ibunch*bunchsize,m);
+                for (size_t m=0; m<ip; ++m)
+                  for (size_t n=0; n<ntrans; ++n)
+                    cc2[m+n*ip] = CC(n+ibunch*bunchsize,m);
 
-              for (size_t n=0; n<ntrans; ++n)
-                {
-                auto i = n+ibunch*bunchsize;
-                Cmplx<T> *p1=&cc2[n*ip], *p2=ch2;
-                Cmplx<T> *res = nullptr;
-                for(const auto &pass: passes)
-                  {
-                  res = static_cast<Cmplx<T> *>(pass->exec(tic,
-                    p1, p2, buf2, fwd));
-                  if (res==p2) swap (p1,p2);
-                  }
-                if (res==&cc2[n*ip]) // no copying necessary
+                for (size_t n=0; n<ntrans; ++n)
                   {
-                  if (i!=0)
+                  auto i = n+ibunch*bunchsize;
+                  Cmplx<T> *p1=&cc2[n*ip], *p2=ch2;
+                  Cmplx<T> *res = nullptr;
+                  for(const auto &pass: passes)
+                    {
+                    res = static_cast<Cmplx<T> *>(pass->exec(tic,
+                      p1, p2, buf2, fwd));
+                    if (res==p2) swap (p1,p2);
+                    }
+                  if (res==&cc2[n*ip]) // no copying necessary
                     {
-                    for (size_t m=1; m<ip; ++m)
-                      cc2[n*ip+m] = cc2[n*ip+m].template special_mul<fwd>((*myroots)[rfct*m*i]);
+                    if (i!=0)
+                      {
+                      for (size_t m=1; m<ip; ++m)
+                        cc2[n*ip+m] = cc2[n*ip+m].template special_mul<fwd>((*myroots)[rfct*m*i]);
+                      }
                     }
-                  }
-                else
-                  {
-                  if (i==0)
-                    for (size_t m=0; m<ip; ++m)
-                      cc2[n*ip+m] = res[m];
                   else
                     {
-                    cc2[n*ip] = res[0];
-                    for (size_t m=1; m<ip; ++m)
-                      cc2[n*ip+m] = res[m].template special_mul<fwd>((*myroots)[rfct*m*i]);
+                    if (i==0)
+                      for (size_t m=0; m<ip; ++m)
+                        cc2[n*ip+m] = res[m];
+                    else
+                      {
+                      cc2[n*ip] = res[0];
+                      for (size_t m=1; m<ip; ++m)
+                        cc2[n*ip+m] = res[m].template special_mul<fwd>((*myroots)[rfct*m*i]);
+                      }
                     }
                   }
+                for (size_t m=0; m<ip; ++m)
+                  for (size_t n=0; n<ntrans; ++n)
+                    CC(n+ibunch*bunchsize, m) = cc2[m+n*ip];
                 }
-              for (size_t m=0; m<ip; ++m)
-                for (size_t n=0; n<ntrans; ++n)
-                  CC(n+ibunch*bunchsize, m) = cc2[m+n*ip];
-              }
+              });
             return cc;
             }
 
@@ -1727,8 +1993,20 @@ MR_fail("must not get here");
       }
 
   public:
+    // the two factors into which long transforms are split
+    static array<size_t,2> packets(size_t ip)
+      {
+      array<size_t,2> res{1,1};
+      auto factors = util1d::prime_factors(ip);
+      sort(factors.begin(), factors.end(), std::greater<size_t>());
+      for (auto fct: factors)
+        (res[0]>res[1]) ? res[1]*=fct : res[0]*=fct;
+      return res;
+      }
+
     cfft_multipass(size_t l1_, size_t ido_, size_t ip_,
-      const Troots<Tfs> &roots, bool /*vectorize*/=false)
+      const Troots<Tfs> &roots, bool /*vectorize*/=false,
+      const vector<size_t> &factors={})
       : l1(l1_), ido(ido_), ip(ip_), bufsz(0), need_cpy(false),
         myroots(roots)
       {
@@ -1739,7 +2017,17 @@ MR_fail("must not get here");
       // FIXME TBD
 // do we need the vectorize flag at all?
       size_t lim = 10000; //vectorize ? 10000 : 10000;
-      if (ip<=lim)
+      if (!factors.empty()) // explicitly requested factorization
+        {
+        size_t l1l=1;
+        for (auto fct: factors)
+          {
+          passes.push_back(cfftpass<Tfs>::make_pass(l1l, ip/(fct*l1l), fct, roots, false));
+          l1l*=fct;
+          }
+        MR_assert(l1l==ip, "factors do not match length");
+        }
+      else if (ip<=lim)
         {
         auto factors = cfftpass<Tfs>::factorize(ip);
         size_t l1l=1;
@@ -1751,13 +2039,8 @@ MR_fail("must not get here");
         }
       else
         {
-        vector<size_t> packets(2,1);
-        auto factors = util1d::prime_factors(ip);
-        sort(factors.begin(), factors.end(), std::greater<size_t>());
-        for (auto fct: factors)
-          (packets[0]>packets[1]) ? packets[1]*=fct : packets[0]*=fct;
         size_t l1l=1;
-        for (auto pkt: packets)
+        for (auto pkt: packets(ip))
           {
           passes.push_back(cfftpass<Tfs>::make_pass(l1l, ip/(pkt*l1l), pkt, roots, false));
           l1l*=pkt;
@@ -1776,6 +2059,12 @@ MR_fail("must not get here");
       }
 
     virtual size_t bufsize() const { return bufsz; }
+    virtual size_t lazy_size() const
+      {
+      size_t res=0;
+      for (const auto &pass: passes) res+=pass->lazy_size();
+      return res;
+      }
     virtual bool needs_copy() const { return need_cpy; }
 
     POCKETFFT_EXEC_DISPATCH
@@ -1791,14 +2080,46 @@ template <size_t vlen, typename Tfs> class cfftp_vecpass: public cfftpass<Tfs>
     using Tfv=typename simd_select<Tfs, vlen>::type;
     using Tcv=Cmplx<Tfv>;
 
+    // Below this length, multithreading a single transform does not pay off.
+    static constexpr size_t par_min = 32768;
+
     size_t ip;
+    Troots<Tfs> roots;
     Tcpass<Tfs> spass;
     Tcpass<Tfs> vpass;
+    // packet lengths of the four-step decomposition for multithreaded
+    // execution, or {0,0} if that would not run in parallel
+    array<size_t,2> pkt;
+    // the four-step pass itself; only built when it is needed for the first
+    // time, and dropped if it does not fit into our scratch space
+    mutable Tcpass<Tfs> ppass;
+    mutable once_flag ppass_flag;
     size_t bufsz;
 
+    const cfftpass<Tfs> *get_ppass() const
+      {
+      call_once(ppass_flag, [this]()
+        {
+        ppass = make_shared<cfft_multipass<Tfs>>(1, 1, ip, roots);
+        if (ip+ppass->bufsize()>bufsz) ppass.reset();
+        });
+      return ppass.get();
+      }
+
     template<bool fwd> Tcs *exec_ (Tcs *cc,
       Tcs * /*ch*/, Tcs *sbuf, size_t nthreads) const
       {
+      static const auto tics = tidx<Tcs *>();
+      if ((pkt[0]!=0) && (adjust_nthreads(nthreads)>1))
+        if (auto pp=get_ppass())
+          {
+          auto res = static_cast<Tcs *>(pp->exec(tics, cc, sbuf, sbuf+ip,
+            fwd, nthreads));
+          if (res!=cc)
+            execParallel(ip, nthreads, [&](size_t lo, size_t hi)
+              { copy(res+lo, res+hi, cc+lo); });
+          return cc;
+          }
       char *xbuf = reinterpret_cast<char *>(sbuf);
       size_t misalign = reinterpret_cast<size_t>(xbuf)&(sizeof(Tfv)-1);
       if (misalign != 0)
@@ -1807,7 +2128,6 @@ template <size_t vlen, typename Tfs> class cfftp_vecpass: public cfftpass<Tfs>
       auto * cc2 = buf;
       auto * ch2 = buf+ip/vlen+7;
       auto * buf2 = buf+2*ip/vlen+7+7;
-      static const auto tics = tidx<Tcs *>();
 // run scalar pass
       auto res = static_cast<Tcs *>(spass->exec(tics, cc,
         reinterpret_cast<Tcs *>(ch2), reinterpret_cast<Tcs *>(buf2),
@@ -1839,17 +2159,36 @@ template <size_t vlen, typename Tfs> class cfftp_vecpass: public cfftpass<Tfs>
       }
 
   public:
-    cfftp_vecpass(size_t ip_, const Troots<Tfs> &roots)
-      : ip(ip_), spass(cfftpass<Tfs>::make_pass(1, ip/vlen, vlen, roots)),
-        vpass(cfftpass<Tfs>::make_pass(1, 1, ip/vlen, roots)), bufsz(0)
+    cfftp_vecpass(size_t ip_, const Troots<Tfs> &roots_)
+      : ip(ip_), roots(roots_),
+        spass(cfftpass<Tfs>::make_pass(1, ip/vlen, vlen, roots)),
+        vpass(cfftpass<Tfs>::make_pass(1, 1, ip/vlen, roots)),
+        pkt{0,0}, bufsz(0)
       {
       MR_assert((ip/vlen)*vlen==ip, "cannot vectorize this size");
+      if (ip>=par_min)
+        {
+        pkt = cfft_multipass<Tfs>::packets(ip);
+        // A prime packet is handled by a single, serial pass.
+        if ((util1d::prime_factors(pkt[0]).size()<2)
+          ||(util1d::prime_factors(pkt[1]).size()<2))
+          pkt = {0,0};
+        }
       bufsz = 2*(ip/vlen)+7+7;
       bufsz += max(vpass->bufsize(),(spass->bufsize()+vlen-1)/vlen); // buffers for subpasses
       bufsz *= vlen; // since we specify in terms of Tcs
       bufsz += vlen; // wiggle room for alignment shifts
       }
     virtual size_t bufsize() const { return bufsz; }
+    virtual size_t lazy_size() const
+      {
+      // The four-step plan shares the roots of unity. The twiddle factors of
+      // the k-th pass of a packet of length p have fewer than p/l1_k
+      // entries, and l1_k at least doubles from pass to pass, so they sum
+      // to less than 2p per packet. Bluestein passes for large prime
+      // factors of p add about as much again for their kernels.
+      return 4*(pkt[0]+pkt[1]) + spass->lazy_size() + vpass->lazy_size();
+      }
     virtual bool needs_copy() const { return false; }
     virtual void *exec(const type_index &ti, void *in, void *copy, void *buf,
       bool fwd, size_t nthreads=1) const
@@ -1864,21 +2203,129 @@ template <size_t vlen, typename Tfs> class cfftp_vecpass: public cfftpass<Tfs>
       }
   };
 
+// Returns a pass computing a complete transform of length ip with SIMD
+// arithmetic inside the transform, or nullptr if there is no suitable one.
+template<typename Tfs> Tcpass<Tfs> make_vecpass(size_t ip,
+  const Troots<Tfs> &roots)
+  {
+  // Very long transforms profit from the full native vector length
+  // (e.g. 8 floats with AVX/AVX-512 or wide SVE), shorter ones run faster
+  // with the 4-way pass. Beyond about 2^20 points, the 4-way pass is no
+  // faster than cfft_multipass, but needs more scratch space.
+  constexpr size_t vlen_long = fft1d_simdlen<Tfs>;
+  if constexpr ((vlen_long>4) && simd_exists<Tfs,vlen_long>)
+    if ((ip>100000) && ((ip%vlen_long)==0))
+      return make_shared<cfftp_vecpass<vlen_long,Tfs>>(ip, roots);
+  constexpr size_t vlen = 4;
+  if constexpr(simd_exists<Tfs,vlen>)
+    if (((ip&(vlen-1))==0) && (ip<=(size_t(1)<<20)))
+      return make_shared<cfftp_vecpass<vlen,Tfs>>(ip, roots);
+  return nullptr;
+  }
+
 template<typename Tfs> Tcpass<Tfs> cfftpass<Tfs>::make_pass(size_t l1,
   size_t ido, size_t ip, const Troots<Tfs> &roots, bool vectorize)
   {
   MR_assert(ip>=1, "no zero-sized FFTs");
-  // do we have an 1D vectorizable FFT?
-  if (vectorize && (ip>300)&& (ip<=100000) && (l1==1) && (ido==1))
+  if ((l1==1) && (ido==1) && (ip>1)) // complete transform, check for wisdom
+    {
+    auto &wisdom(FftWisdom::get());
+    FftRecipe recipe;
+    if (!wisdom.lookup('c', sizeof(Tfs), ip, vectorize, recipe)
+        && wisdom.measure())
+      {
+      recipe = tune(ip, vectorize);
+      wisdom.set('c', sizeof(Tfs), ip, vectorize, recipe);
+      }
+    return make_pass(ip, roots, vectorize, recipe);
+    }
+  return make_default_pass(l1, ido, ip, roots, vectorize);
+  }
+
+template<typename Tfs> Tcpass<Tfs> cfftpass<Tfs>::make_pass(size_t ip,
+  const Troots<Tfs> &roots, bool vectorize, const FftRecipe &recipe)
+  {
+  switch (recipe.method)
+    {
+    case 'm':
+      if (recipe.factors.size()>1)
+        return make_shared<cfft_multipass<Tfs>>(1, 1, ip, roots, vectorize,
+          recipe.factors);
+      break;
+    case 'v':
+      if (auto res = make_vecpass(ip, roots))
+        return res;
+      break;
+    case 'g':
+      if ((ip&1) && (ip>=5))
+        return make_shared<cfftpg<Tfs>>(1, 1, ip, roots);
+      break;
+    case 'b':
+      if ((recipe.blue_len==0) || (recipe.blue_len>=2*ip-1))
+        return make_shared<cfftpblue<Tfs>>(1, 1, ip, roots, vectorize,
+          recipe.blue_len);
+      break;
+    default:
+      break;
+    }
+  return make_default_pass(1, 1, ip, roots, vectorize);
+  }
+
+template<typename Tfs> FftRecipe cfftpass<Tfs>::tune(size_t ip,
+  bool vectorize)
+  {
+  using Tcs = Cmplx<Tfs>;
+  vector<FftRecipe> candidates(1); // start with the default
+  auto factors = factorize(ip);
+  for (const auto &f: fft_factor_candidates(factors, ip, false))
+    candidates.push_back({'m', 0, f});
+  if (vectorize && (ip>=64) && ((ip&3)==0))
+    candidates.push_back({'v', 0, {}});
+  if ((factors.size()==1) && (ip>11))
     {
-//    constexpr auto vlen = native_simd<Tfs>::size();
-//    if constexpr(vlen>=4)
-    constexpr auto vlen = 4;
-    if constexpr(simd_exists<Tfs,vlen>)
-      if ((ip&(vlen-1))==0)
-        return make_shared<cfftp_vecpass<vlen,Tfs>>(ip, roots);
+    if ((ip<=2000) && (ip&1))
+      candidates.push_back({'g', 0, {}});
+    vector<size_t> lens { util1d::good_size_cmplx(2*ip-1),
+                          util1d::good_size_real(2*ip-1) };
+    size_t len2=1;
+    while (len2<2*ip-1) len2*=2;
+    lens.push_back(len2);
+    sort(lens.begin(), lens.end());
+    lens.erase(unique(lens.begin(), lens.end()), lens.end());
+    for (auto len: lens)
+      candidates.push_back({'b', len, {}});
     }
 
+  auto roots = make_shared<UnityRoots<Tfs,Tcs>>(ip);
+  aligned_array<Tcs> src(ip), data(ip), copy(ip);
+  for (size_t i=0; i<ip; ++i)
+    src[i] = Tcs(Tfs(1)/Tfs(i+1), Tfs(0.5)-Tfs(i&1));
+  static const auto tic = tidx<Tcs *>();
+  double tbest=0;
+  FftRecipe best;
+  for (const auto &cand: candidates)
+    {
+    auto pass = make_pass(ip, roots, vectorize, cand);
+    aligned_array<Tcs> buf(pass->bufsize());
+    auto t = time_fft_candidate([&]()
+      {
+      copy_n(src.data(), ip, data.data());
+      pass->exec(tic, data.data(), copy.data(), buf.data(), true, 1);
+      });
+    if ((cand.method=='d') || (t<tbest))
+      { tbest=t; best=cand; }
+    }
+  return best;
+  }
+
+template<typename Tfs> Tcpass<Tfs> cfftpass<Tfs>::make_default_pass(size_t l1,
+  size_t ido, size_t ip, const Troots<Tfs> &roots, bool vectorize)
+  {
+  // do we have an 1D vectorizable FFT?
+  if (vectorize && (ip>300) && (l1==1) && (ido==1))
+    if (auto res = make_vecpass(ip, roots))
+      return res;
+
   if (ip==1) return make_shared<cfftp1<Tfs>>();
   auto factors=cfftpass<Tfs>::factorize(ip);
   if (factors.size()==1)
@@ -1923,6 +2370,7 @@ template<typename Tfs> class pocketfft_c
         plan(cfftpass<Tfs>::make_pass(n,vectorize)) {}
     size_t length() const { return N; }
     size_t bufsize() const { return N*plan->needs_copy()+2*critbuf+plan->bufsize(); }
+    size_t lazy_size() const { return plan->lazy_size(); }
     template<typename Tfd> DUCC0_NOINLINE Cmplx<Tfd> *exec(Cmplx<Tfd> *in, Cmplx<Tfd> *buf,
       Tfs fct, bool fwd, size_t nthreads=1) const
       {
@@ -1967,6 +2415,9 @@ template <typename Tfs> class rfftpass
     // number of Tfd values required as scratch space during "exec"
     // will be provided in "buf"
     virtual size_t bufsize() const = 0;
+    // approximate number of Tfd values the pass may allocate on demand
+    // and keep afterwards (e.g. data needed for multithreaded execution)
+    virtual size_t lazy_size() const { return 0; }
     virtual bool needs_copy() const = 0;
     virtual void *exec(const type_index &ti, void *in, void *copy, void *buf,
       bool fwd, size_t nthreads=1) const = 0;
@@ -2001,6 +2452,15 @@ template <typename Tfs> class rfftpass
       return make_pass(1,1,ip,make_shared<UnityRoots<Tfs,Cmplx<Tfs>>>(ip),
         vectorize);
       }
+    // pass for a whole transform of length ip, built according to recipe
+    static shared_ptr<rfftpass> make_pass(size_t ip, const Troots<Tfs> &roots,
+      bool vectorize, const FftRecipe &recipe);
+    // measures the fastest recipe for a transform of length ip
+    static FftRecipe tune(size_t ip, bool vectorize);
+
+  private:
+    static shared_ptr<rfftpass> make_default_pass(size_t l1, size_t ido,
+      size_t ip, const Troots<Tfs> &roots, bool vectorize);
   };
 
 #define POCKETFFT_EXEC_DISPATCH \
@@ -3013,6 +3473,7 @@ template <typename Tfs> class rfftpblue: public rfftpass<Tfs>
       }
 
     virtual size_t bufsize() const { return 4*ip + 2*cplan->bufsize(); }
+    virtual size_t lazy_size() const { return 2*cplan->lazy_size(); }
     virtual bool needs_copy() const { return true; }
 
     POCKETFFT_EXEC_DISPATCH
@@ -3060,7 +3521,8 @@ template <typename Tfs> class rfft_multipass: public rfftpass<Tfs>
 
   public:
     rfft_multipass(size_t l1_, size_t ido_, size_t ip_,
-      const Troots<Tfs> &roots, bool /*vectorize*/=false)
+      const Troots<Tfs> &roots, bool /*vectorize*/=false,
+      const vector<size_t> &factors_={})
       : l1(l1_), ido(ido_), ip(ip_), bufsz(0), need_cpy(false),
         wa((ip-1)*(ido-1))
       {
@@ -3075,7 +3537,7 @@ template <typename Tfs> class rfft_multipass: public rfftpass<Tfs>
           wa[(j-1)*(ido-1)+2*i-1] = val.i;
           }
 
-      auto factors = rfftpass<Tfs>::factorize(ip);
+      auto factors = factors_.empty() ? rfftpass<Tfs>::factorize(ip) : factors_;
 
       size_t l1l=1;
       for (auto fct: factors)
@@ -3083,6 +3545,7 @@ template <typename Tfs> class rfft_multipass: public rfftpass<Tfs>
         passes.push_back(rfftpass<Tfs>::make_pass(l1l, ip/(fct*l1l), fct, roots));
         l1l*=fct;
         }
+      MR_assert(l1l==ip, "factors do not match length");
       for (const auto &pass: passes)
         {
         bufsz = max(bufsz, pass->bufsize());
@@ -3096,6 +3559,12 @@ template <typename Tfs> class rfft_multipass: public rfftpass<Tfs>
       }
 
     virtual size_t bufsize() const { return bufsz; }
+    virtual size_t lazy_size() const
+      {
+      size_t res=0;
+      for (const auto &pass: passes) res+=pass->lazy_size();
+      return res;
+      }
     virtual bool needs_copy() const { return need_cpy; }
 
     POCKETFFT_EXEC_DISPATCH
@@ -3168,6 +3637,7 @@ template <typename Tfs> class rfftp_complexify: public rfftpass<Tfs>
       }
 
     virtual size_t bufsize() const { return 2*pass->bufsize(); }
+    virtual size_t lazy_size() const { return 2*pass->lazy_size(); }
     virtual bool needs_copy() const { return true; }
 
     POCKETFFT_EXEC_DISPATCH
@@ -3178,6 +3648,90 @@ template<typename Tfs> Trpass<Tfs> rfftpass<Tfs>::make_pass(size_t l1,
   size_t ido, size_t ip, const Troots<Tfs> &roots, bool vectorize)
   {
   MR_assert(ip>=1, "no zero-sized FFTs");
+  if ((l1==1) && (ido==1) && (ip>1)) // complete transform, check for wisdom
+    {
+    auto &wisdom(FftWisdom::get());
+    FftRecipe recipe;
+    if (!wisdom.lookup('r', sizeof(Tfs), ip, vectorize, recipe)
+        && wisdom.measure())
+      {
+      recipe = tune(ip, vectorize);
+      wisdom.set('r', sizeof(Tfs), ip, vectorize, recipe);
+      }
+    return make_pass(ip, roots, vectorize, recipe);
+    }
+  return make_default_pass(l1, ido, ip, roots, vectorize);
+  }
+
+template<typename Tfs> Trpass<Tfs> rfftpass<Tfs>::make_pass(size_t ip,
+  const Troots<Tfs> &roots, bool vectorize, const FftRecipe &recipe)
+  {
+  switch (recipe.method)
+    {
+    case 'm':
+      if ((recipe.factors.size()>1) && valid_real_factor_order(recipe.factors))
+        return make_shared<rfft_multipass<Tfs>>(1, 1, ip, roots, vectorize,
+          recipe.factors);
+      break;
+    case 'x':
+      if ((ip&1)==0)
+        return make_shared<rfftp_complexify<Tfs>>(ip, roots, vectorize);
+      break;
+    case 'g':
+      if ((ip&1) && (ip>=5))
+        return make_shared<rfftpg<Tfs>>(1, 1, ip, roots);
+      break;
+    case 'b':
+      if (ip&1)
+        return make_shared<rfftpblue<Tfs>>(1, 1, ip, roots, vectorize);
+      break;
+    default:
+      break;
+    }
+  return make_default_pass(1, 1, ip, roots, vectorize);
+  }
+
+template<typename Tfs> FftRecipe rfftpass<Tfs>::tune(size_t ip,
+  bool vectorize)
+  {
+  vector<FftRecipe> candidates(1); // start with the default
+  auto factors = factorize(ip);
+  for (const auto &f: fft_factor_candidates(factors, ip, true))
+    candidates.push_back({'m', 0, f});
+  if (((ip&1)==0) && (ip>=64))
+    candidates.push_back({'x', 0, {}});
+  if ((factors.size()==1) && (ip>5))
+    {
+    if (ip<=2000)
+      candidates.push_back({'g', 0, {}});
+    candidates.push_back({'b', 0, {}});
+    }
+
+  auto roots = make_shared<UnityRoots<Tfs,Cmplx<Tfs>>>(ip);
+  aligned_array<Tfs> src(ip), data(ip), copy(ip);
+  for (size_t i=0; i<ip; ++i)
+    src[i] = Tfs(1)/Tfs(i+1);
+  static const auto tif = tidx<Tfs *>();
+  double tbest=0;
+  FftRecipe best;
+  for (const auto &cand: candidates)
+    {
+    auto pass = make_pass(ip, roots, vectorize, cand);
+    aligned_array<Tfs> buf(pass->bufsize());
+    auto t = time_fft_candidate([&]()
+      {
+      copy_n(src.data(), ip, data.data());
+      pass->exec(tif, data.data(), copy.data(), buf.data(), true, 1);
+      });
+    if ((cand.method=='d') || (t<tbest))
+      { tbest=t; best=cand; }
+    }
+  return best;
+  }
+
+template<typename Tfs> Trpass<Tfs> rfftpass<Tfs>::make_default_pass(size_t l1,
+  size_t ido, size_t ip, const Troots<Tfs> &roots, bool vectorize)
+  {
   if (ip==1) return make_shared<rfftp1<Tfs>>();
   if ((ip>1000) && ((ip&1)==0))  // use complex transform
     {
@@ -3228,6 +3782,7 @@ template<typename Tfs> class pocketfft_r
       : N(n), plan(rfftpass<Tfs>::make_pass(n,vectorize)) {}
     size_t length() const { return N; }
     size_t bufsize() const { return N*plan->needs_copy()+plan->bufsize(); }
+    size_t lazy_size() const { return plan->lazy_size(); }
     template<typename Tfd> DUCC0_NOINLINE Tfd *exec(Tfd *in, Tfd *buf, Tfs fct,
       bool fwd, size_t nthreads=1) const
       {
@@ -3276,6 +3831,7 @@ template<typename Tfs> class pocketfft_hartley
       : N(n), plan(rfftpass<Tfs>::make_pass(n,vectorize)) {}
     size_t length() const { return N; }
     size_t bufsize() const { return N+plan->bufsize(); }
+    size_t lazy_size() const { return plan->lazy_size(); }
     template<typename Tfd> DUCC0_NOINLINE Tfd *exec(Tfd *in, Tfd *buf, Tfs fct,
       size_t nthreads=1) const
       {
@@ -3321,6 +3877,7 @@ template<typename Tfs> class pocketfft_fht
       : N(n), plan(rfftpass<Tfs>::make_pass(n,vectorize)) {}
     size_t length() const { return N; }
     size_t bufsize() const { return N+plan->bufsize(); }
+    size_t lazy_size() const { return plan->lazy_size(); }
     template<typename Tfd> DUCC0_NOINLINE Tfd *exec(Tfd *in, Tfd *buf, Tfs fct,
       size_t nthreads=1) const
       {
@@ -3367,6 +3924,7 @@ template<typename Tfs> class pocketfft_fftw
       : N(n), plan(rfftpass<Tfs>::make_pass(n,vectorize)) {}
     size_t length() const { return N; }
     size_t bufsize() const { return N+plan->bufsize(); }
+    size_t lazy_size() const { return plan->lazy_size(); }
     template<typename Tfd> DUCC0_NOINLINE Tfd *exec(Tfd *in, Tfd *buf, Tfs fct,
       bool fwd, size_t nthreads=1) const
       {
@@ -70,7 +70,8 @@ size_t usable_memory()
   string text = fileToString("/proc/meminfo");
   size_t MemTotal = find<size_t>(text, R"(MemTotal:\s+(\d+) kB)");
   size_t Committed = find<size_t>(text, R"(Committed_AS:\s+(\d+) kB)");
-  return MemTotal-Committed;
+  // on overcommitted systems Committed_AS exceeds MemTotal
+  return (Committed<MemTotal) ? MemTotal-Committed : 0;
   }
 
 }}
@@ -155,6 +155,7 @@ class TimerHierarchy
 
           int logtime=max(1,int(log10(total)+1));
           report("",logtime+5,slen, os);
+          os << flush;
           }
 
         void addTime(double dt)
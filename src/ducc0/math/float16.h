@@ -0,0 +1,87 @@
+/*
+ *  This code is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This code is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this code; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/** \file ducc0/math/float16.h
+ *  16-bit floating point storage types
+ *
+ *  \copyright Copyright (C) 2025 Max-Planck-Society
+ *  \author Martin Reinecke
+ */
+
+#ifndef DUCC0_FLOAT16_H
+#define DUCC0_FLOAT16_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace ducc0 {
+
+namespace detail_float16 {
+
+#if defined(__FLT16_MANT_DIG__)
+/// IEEE half precision type, if supported by the compiler
+#define DUCC0_HAVE_FLOAT16
+using float16 = _Float16;
+#endif
+
+/// Minimalistic bfloat16 type
+/** Meant exclusively for storage: it holds the upper 16 bits of an IEEE
+ *  single precision number, and all arithmetic has to be done after
+ *  conversion to float. Conversion from float rounds to nearest even,
+ *  using the same bias trick as the bfloat16 types of Eigen and
+ *  TensorFlow (re-implemented here, no code was copied). */
+struct bfloat16
+  {
+  uint16_t bits;
+
+  bfloat16() = default;
+  bfloat16(float v)
+    {
+    uint32_t u;
+    std::memcpy(&u, &v, 4);
+    if ((u&0x7fffffffu)>0x7f800000u) // NaN: keep it quiet and nonzero
+      bits = uint16_t((u>>16)|0x40);
+    else
+      bits = uint16_t((u+0x7fffu+((u>>16)&1))>>16);
+    }
+  operator float() const
+    {
+    uint32_t u = uint32_t(bits)<<16;
+    float v;
+    std::memcpy(&v, &u, 4);
+    return v;
+    }
+  };
+
+/// True for the 16-bit types that are only used for storing data
+template<typename T> constexpr bool is_storage16 =
+#ifdef DUCC0_HAVE_FLOAT16
+  std::is_same_v<T, float16> ||
+#endif
+  std::is_same_v<T, bfloat16>;
+
+}
+
+#ifdef DUCC0_HAVE_FLOAT16
+using detail_float16::float16;
+#endif
+using detail_float16::bfloat16;
+using detail_float16::is_storage16;
+
+}
+
+#endif
@@ -17,6 +17,8 @@
 /* Copyright (C) 2020-2022 Max-Planck-Society
    Author: Martin Reinecke */
 
+#include <cstdlib>
+#include <iostream>
 #include "ducc0/math/gridding_kernel.h"
 
 namespace ducc0 {
@@ -1561,15 +1563,102 @@ shared_ptr<PolynomialKernel> selectKernel(size_t idx)
 double bestEpsilon(size_t ndim, bool singleprec,
   double ofactor_min, double ofactor_max)
   {
-  MR_assert((ndim>=1) && (ndim<=3), "bad dimensionality");
+  auto [dbndim, epsfct] = kernelDBDims(ndim);
   double res = 1000.;
   for (const auto &krn:KernelDB)
-    if ((krn.ndim==ndim) && (krn.singleprec==singleprec)
+    if ((krn.ndim==dbndim) && (krn.singleprec==singleprec)
       && (krn.epsilon<=res)
       && (krn.ofactor<=ofactor_max) && (krn.ofactor>=ofactor_min))
       res = krn.epsilon;
   MR_assert(res<1000., "no appropriate kernel found");
+  return res*epsfct;
+  }
+
+namespace {
+
+void checkCostModel(const GriddingCostModel &model)
+  {
+  auto positive = [](double v) { return (v>0) && isfinite(v); };
+  MR_assert(positive(model.fft_cost), "fft_cost must be positive and finite");
+  MR_assert(positive(model.gridding_cost),
+    "gridding_cost must be positive and finite");
+  MR_assert((model.max_fft_scaling>1) && isfinite(model.max_fft_scaling),
+    "max_fft_scaling must be finite and larger than 1");
+  MR_assert(positive(model.fft_cost_single),
+    "fft_cost_single must be positive and finite");
+  MR_assert(positive(model.gridding_cost_single),
+    "gridding_cost_single must be positive and finite");
+  }
+
+GriddingCostModel parseCostModel(const char *str)
+  {
+  GriddingCostModel res;
+  const char *pos = str;
+  auto read_value = [&pos](double &val)
+    {
+    char *end;
+    val = strtod(pos, &end);
+    MR_assert(end!=pos, "invalid number");
+    pos = end;
+    };
+  auto read_values = [&pos,&read_value](const vector<double *> &vals)
+    {
+    for (auto *val: vals)
+      {
+      MR_assert(*pos==',', "expected ','");
+      ++pos;
+      read_value(*val);
+      }
+    };
+  read_value(res.fft_cost);
+  read_values({&res.gridding_cost, &res.max_fft_scaling});
+  res.fft_cost_single = res.fft_cost;
+  res.gridding_cost_single = res.gridding_cost;
+  if (*pos!=0)
+    read_values({&res.fft_cost_single, &res.gridding_cost_single});
+  MR_assert(*pos==0, "unexpected trailing characters");
+  checkCostModel(res);
   return res;
   }
 
+// Reads the cost model from DUCC0_GRIDDING_COST_MODEL, if set. A malformed
+// value is reported once and the defaults are used instead, so that it
+// does not make every later NUFFT or gridding operation fail.
+GriddingCostModel initialCostModel()
+  {
+  auto evar=getenv("DUCC0_GRIDDING_COST_MODEL");
+  if (!evar) return GriddingCostModel();
+  try
+    { return parseCostModel(evar); }
+  catch (const exception &e)
+    {
+    cerr << "ducc0: ignoring DUCC0_GRIDDING_COST_MODEL='" << evar << "': "
+         << e.what() << endl;
+    return GriddingCostModel();
+    }
+  }
+
+Mutex costModelMutex;
+
+GriddingCostModel &activeCostModel()
+  {
+  static GriddingCostModel model = initialCostModel();
+  return model;
+  }
+
+}
+
+GriddingCostModel getGriddingCostModel()
+  {
+  LockGuard lock(costModelMutex);
+  return activeCostModel();
+  }
+
+void setGriddingCostModel(const GriddingCostModel &model)
+  {
+  checkCostModel(model);
+  LockGuard lock(costModelMutex);
+  activeCostModel() = model;
+  }
+
 }}
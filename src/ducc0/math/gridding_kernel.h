@@ -29,6 +29,7 @@
 #include <cmath>
 #include <type_traits>
 #include <limits>
+#include <utility>
 #include "ducc0/infra/useful_macros.h"
 #include "ducc0/infra/error_handling.h"
 #include "ducc0/infra/threading.h"
@@ -403,17 +404,35 @@ template<typename T> constexpr inline size_t Wmax()
 
 extern const vector<KernelParams> KernelDB;
 
+/*! The kernel database only covers up to three dimensions. For more
+ *  dimensions, the 3D entries are used with their error scaled by ndim/3.
+ *  This is an extrapolation, not a derived bound: for most entries of the
+ *  database, the error for the same kernel grows exactly linearly from 1D to
+ *  3D (the median ratios of the 2D/1D and 3D/2D errors are 2 and 1.5), but
+ *  some entries grow faster. test_nufft_4d_accuracy checks the achieved 4D
+ *  accuracy over the whole supported epsilon range; the measured errors are
+ *  below a third of the requested ones.
+ *  Returns the dimensionality of the entries to use and the error scaling
+ *  factor. */
+inline pair<size_t, double> kernelDBDims(size_t ndim)
+  {
+  MR_assert(ndim>=1, "bad dimensionality");
+  size_t dbndim = min<size_t>(ndim, 3);
+  return make_pair(dbndim, double(ndim)/dbndim);
+  }
+
 /*! Returns the 2-parameter ES kernel for the given oversampling factor,
  *  dimensionality, and error that has the smallest support. */
 template<typename T> auto selectKernel(double ofactor, size_t ndim, double epsilon)
   {
   constexpr bool singleprec = is_same<T, float>::value;
+  auto [dbndim, epsfct] = kernelDBDims(ndim);
   size_t Wmin = Wmax<T>();
   size_t idx = KernelDB.size();
   for (size_t i=0; i<KernelDB.size(); ++i)
     {
-    if  ((KernelDB[i].ndim==ndim) && (KernelDB[i].singleprec==singleprec)
-      && (KernelDB[i].ofactor<=ofactor) && (KernelDB[i].epsilon<=epsilon)
+    if  ((KernelDB[i].ndim==dbndim) && (KernelDB[i].singleprec==singleprec)
+      && (KernelDB[i].ofactor<=ofactor) && (KernelDB[i].epsilon*epsfct<=epsilon)
       && (KernelDB[i].W<=Wmin))
       {
       idx = i;
@@ -427,6 +446,7 @@ template<typename T> auto getAvailableKernels(double epsilon,
   size_t ndim, double ofactor_min=1.1, double ofactor_max=2.6)
   {
   constexpr bool singleprec = is_same<T, float>::value;
+  auto [dbndim, epsfct] = kernelDBDims(ndim);
   vector<double> ofc(20, ofactor_max);
   vector<size_t> idx(20, KernelDB.size());
   size_t Wlim = Wmax<T>();
@@ -434,8 +454,8 @@ template<typename T> auto getAvailableKernels(double epsilon,
     {
     auto ofactor = KernelDB[i].ofactor;
     size_t W = KernelDB[i].W;
-    if ((KernelDB[i].ndim==ndim) && (KernelDB[i].singleprec==singleprec)
-      && (W<=Wlim) && (KernelDB[i].epsilon<=epsilon)
+    if ((KernelDB[i].ndim==dbndim) && (KernelDB[i].singleprec==singleprec)
+      && (W<=Wlim) && (KernelDB[i].epsilon*epsfct<=epsilon)
       && (ofactor<=ofc[W]) && (ofactor>=ofactor_min))
       {
       ofc[W] = ofactor;
@@ -452,6 +472,54 @@ template<typename T> auto getAvailableKernels(double epsilon,
 double bestEpsilon(size_t ndim, bool singleprec,
   double ofactor_min=1.1, double ofactor_max=2.6);
 
+/*! Machine-dependent constants of the cost model used for choosing the
+ *  kernel and oversampling factor of NUFFT and gridding operations.
+ *  The defaults describe a typical workstation; they can be replaced by
+ *  values measured on the actual host (see calibrateGriddingCostModel()). */
+struct GriddingCostModel
+  {
+  /// time (in s) of a single-threaded 2048x2048 complex FFT
+  double fft_cost=0.0693;
+  /// time (in s) per kernel evaluation and grid update per SIMD lane
+  double gridding_cost=2.2e-10;
+  /// asymptotic speedup of FFTs for large thread counts
+  double max_fft_scaling=6;
+  /// like fft_cost, but for single precision
+  double fft_cost_single=0.0693;
+  /// like gridding_cost, but for single precision
+  double gridding_cost_single=2.2e-10;
+
+  /// Returns the estimated time for a single-threaded complex FFT over
+  /// \a gridsize points in the requested precision.
+  double fftTime(double gridsize, bool singleprec) const
+    {
+    constexpr double nref=2048;
+    double logterm = log(gridsize)/log(nref*nref);
+    return gridsize/(nref*nref)*logterm
+      *(singleprec ? fft_cost_single : fft_cost);
+    }
+  /// Returns the time per kernel evaluation and grid update per SIMD lane
+  /// in the requested precision.
+  double griddingCost(bool singleprec) const
+    { return singleprec ? gridding_cost_single : gridding_cost; }
+  /// Returns the expected FFT speedup when using \a nthreads threads.
+  double fftSpeedup(size_t nthreads) const
+    {
+    double x2 = double(nthreads)-1, m2 = max_fft_scaling-1;
+    return 1.+x2/sqrt(1.+(x2/m2)*(x2/m2));
+    }
+  };
+
+/*! Returns the currently active cost model. Initially this contains the
+ *  default values, unless the environment variable
+ *  DUCC0_GRIDDING_COST_MODEL holds the numbers fft_cost, gridding_cost,
+ *  max_fft_scaling, fft_cost_single and gridding_cost_single, separated by
+ *  commas. If only the first three are given, they are also used for
+ *  single precision. */
+GriddingCostModel getGriddingCostModel();
+/// Replaces the currently active cost model.
+void setGriddingCostModel(const GriddingCostModel &model);
+
 }
 
 using detail_gridding_kernel::GriddingKernel;
@@ -462,6 +530,9 @@ using detail_gridding_kernel::bestEpsilon;
 using detail_gridding_kernel::PolynomialKernel;
 using detail_gridding_kernel::TemplateKernel;
 using detail_gridding_kernel::KernelParams;
+using detail_gridding_kernel::GriddingCostModel;
+using detail_gridding_kernel::getGriddingCostModel;
+using detail_gridding_kernel::setGriddingCostModel;
 
 }
 
@@ -52,6 +52,12 @@
 #include "ducc0/infra/bucket_sort.h"
 #include "ducc0/math/gridding_kernel.h"
 
+// base-2 logarithm of the number of points per sorting block (see
+// Nufft_ancestor::coord_idx); only meant to be reduced for testing purposes.
+#ifndef DUCC0_NUFFT_LOG2_IDXBLOCK
+#define DUCC0_NUFFT_LOG2_IDXBLOCK 31
+#endif
+
 namespace ducc0 {
 
 namespace detail_nufft {
@@ -156,8 +162,8 @@ template<typename Tcalc, typename Tacc> auto findNufftParameters(double epsilon,
   auto ndim = dims.size();
   auto idx = getAvailableKernels<Tcalc>(epsilon, ndim, sigma_min, sigma_max);
   double mincost = 1e300;
-  constexpr double nref_fft=2048;
-  constexpr double costref_fft=0.0693;
+  const auto model = getGriddingCostModel();
+  constexpr bool singleprec = is_same<Tcalc, float>::value;
   vector<size_t> bigdims(ndim, 0);
   size_t minidx=~(size_t(0));
   for (size_t i=0; i<idx.size(); ++i)
@@ -174,24 +180,15 @@ template<typename Tcalc, typename Tacc> auto findNufftParameters(double epsilon,
       lbigdims[idim] = max<size_t>(lbigdims[idim], 16);
       gridsize *= lbigdims[idim];
       }
-    double logterm = log(gridsize)/log(nref_fft*nref_fft);
-    double fftcost = gridsize/(nref_fft*nref_fft)*logterm*costref_fft;
+    double fftcost = model.fftTime(gridsize, singleprec);
     size_t kernelpoints = nvec*vlen;
     for (size_t idim=0; idim+1<ndim; ++idim)
       kernelpoints*=supp;
-    double gridcost = 2.2e-10*npoints*(kernelpoints + (ndim*nvec*(supp+3)*vlen));
+    double gridcost = model.griddingCost(singleprec)*npoints*(kernelpoints + (ndim*nvec*(supp+3)*vlen));
     if (gridding) gridcost *= sizeof(Tacc)/sizeof(Tcalc);
     // FIXME: heuristics could be improved
     gridcost /= nthreads;  // assume perfect scaling for now
-    constexpr double max_fft_scaling = 6;
-    constexpr double scaling_power=2;
-    auto sigmoid = [](double x, double m, double s)
-      {
-      auto x2 = x-1;
-      auto m2 = m-1;
-      return 1.+x2/pow((1.+pow(x2/m2,s)),1./s);
-      };
-    fftcost /= sigmoid(nthreads, max_fft_scaling, scaling_power);
+    fftcost /= model.fftSpeedup(nthreads);
     double cost = fftcost+gridcost;
     if (cost<mincost)
       {
@@ -202,57 +199,55 @@ template<typename Tcalc, typename Tacc> auto findNufftParameters(double epsilon,
     }
   return make_tuple(minidx, bigdims);
   }
-template<typename Tcalc, typename Tacc> auto findNufftKernel(double epsilon,
+/*! Selects the most efficient gridding kernel for the provided problem
+    parameters (see findNufftParameters()). */
+template<typename Tcalc, typename Tacc> size_t findNufftKernel(double epsilon,
   double sigma_min, double sigma_max, const vector<size_t> &dims,
   size_t npoints, bool gridding, size_t nthreads)
   {
-  auto vlen = gridding ? mysimd<Tacc>::size() : mysimd<Tcalc>::size();
-  auto ndim = dims.size();
-  auto idx = getAvailableKernels<Tcalc>(epsilon, ndim, sigma_min, sigma_max);
-  double mincost = 1e300;
-  constexpr double nref_fft=2048;
-  constexpr double costref_fft=0.0693;
-  size_t minidx=~(size_t(0));
-  for (size_t i=0; i<idx.size(); ++i)
-    {
-    const auto &krn(getKernel(idx[i]));
-    auto supp = krn.W;
-    auto nvec = (supp+vlen-1)/vlen;
-    auto ofactor = krn.ofactor;
-    double gridsize=1;
-    for (size_t idim=0; idim<ndim; ++idim)
-      {
-      size_t bigdim = 2*good_size_complex(size_t(dims[idim]*ofactor*0.5)+1);
-      bigdim = max<size_t>(bigdim, 16);
-      gridsize *= bigdim;
-      }
-    double logterm = log(gridsize)/log(nref_fft*nref_fft);
-    double fftcost = gridsize/(nref_fft*nref_fft)*logterm*costref_fft;
-    size_t kernelpoints = nvec*vlen;
-    for (size_t idim=0; idim+1<ndim; ++idim)
-      kernelpoints*=supp;
-    double gridcost = 2.2e-10*npoints*(kernelpoints + (ndim*nvec*(supp+3)*vlen));
-    if (gridding) gridcost *= sizeof(Tacc)/sizeof(Tcalc);
-    // FIXME: heuristics could be improved
-    gridcost /= nthreads;  // assume perfect scaling for now
-    constexpr double max_fft_scaling = 6;
-    constexpr double scaling_power=2;
-    auto sigmoid = [](double x, double m, double s)
-      {
-      auto x2 = x-1;
-      auto m2 = m-1;
-      return 1.+x2/pow((1.+pow(x2/m2,s)),1./s);
-      };
-    fftcost /= sigmoid(nthreads, max_fft_scaling, scaling_power);
-    double cost = fftcost+gridcost;
-    if (cost<mincost)
-      {
-      mincost=cost;
-      minidx = idx[i];
-      }
-    }
-  return minidx;
+  return get<0>(findNufftParameters<Tcalc,Tacc>(epsilon, sigma_min, sigma_max,
+    dims, npoints, gridding, nthreads));
   }
+/// Like LockGuard, but does nothing if constructed with a null pointer.
+class OptionalLockGuard
+  {
+  private:
+    Mutex *mtx;
+
+  public:
+    OptionalLockGuard(Mutex *mtx_) : mtx(mtx_) { if (mtx) mtx->lock(); }
+    ~OptionalLockGuard() { if (mtx) mtx->unlock(); }
+  };
+
+/// Sets a variable to a new value and restores the old one when going out
+/// of scope, also if an exception is thrown.
+template<typename T> class ValueGuard
+  {
+  private:
+    T &var;
+    T oldval;
+
+  public:
+    ValueGuard(T &var_, const T &newval) : var(var_), oldval(var_)
+      { var = newval; }
+    ~ValueGuard() { var = oldval; }
+    ValueGuard(const ValueGuard &) = delete;
+    ValueGuard &operator=(const ValueGuard &) = delete;
+  };
+
+/// Calls a function when going out of scope, also if an exception is thrown.
+template<typename Tfunc> class ScopeExit
+  {
+  private:
+    Tfunc func;
+
+  public:
+    explicit ScopeExit(Tfunc &&func_) : func(std::forward<Tfunc>(func_)) {}
+    ~ScopeExit() { func(); }
+    ScopeExit(const ScopeExit &) = delete;
+    ScopeExit &operator=(const ScopeExit &) = delete;
+  };
+
 //#define NEW_DUMP
 template<typename Tacc, size_t ndim> constexpr inline int log2tile_=-1;
 template<> constexpr inline int log2tile_<long double, 1> = 9;
@@ -269,11 +264,15 @@ template<> constexpr inline int log2tile_<double, 3> = 4;
 template<> constexpr inline int log2tile_<float , 3> = 4;
 #endif
 template<> constexpr inline int log2tile_<long double, 3> = 4;
+template<> constexpr inline int log2tile_<long double, 4> = 3;
+template<> constexpr inline int log2tile_<double, 4> = 3;
+template<> constexpr inline int log2tile_<float , 4> = 3;
 
 template<size_t ndim> constexpr inline size_t max_ntile=-1;
 template<> constexpr inline size_t max_ntile<1> = (~uint32_t(0))-10;
 template<> constexpr inline size_t max_ntile<2> = (uint32_t(1<<16))-10;
 template<> constexpr inline size_t max_ntile<3> = (uint32_t(1<<10))-10;
+template<> constexpr inline size_t max_ntile<4> = (uint32_t(1<<8))-10;
 
 template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
   {
@@ -283,6 +282,8 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
     double epsilon;
     // number of threads to use for this transform.
     size_t nthreads;
+    // limits for the oversampling factor this plan was built with
+    double sigma_min, sigma_max;
 
     // 1./<periodicity of coordinates>
     double coordfct;
@@ -301,8 +302,14 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
     array<size_t, ndim> nover;
 
     // holds the indices of the nonuniform points in the order in which they
-    // should be processed
+    // should be processed.
+    // The points are sorted in blocks of 2^log2_idxblock, and the indices are
+    // stored relative to the start of their block, so that 32 bits per point
+    // suffice for any number of points (see point_index()).
     quick_array<uint32_t> coord_idx;
+    static constexpr size_t log2_idxblock = DUCC0_NUFFT_LOG2_IDXBLOCK;
+    static_assert((log2_idxblock>0) && (log2_idxblock<=32),
+      "bad index block size");
 
     shared_ptr<PolynomialKernel> krn;
 
@@ -316,8 +323,34 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
     // the base-2 logarithm of the linear dimension of a computational tile.
     constexpr static int log2tile = log2tile_<Tacc,ndim>;
 
+    // if true, nu2u spreading does not lock any part of the oversampled grid,
+    // but processes the tiles in groups ("colours") whose local buffers do
+    // not overlap (see build_tile_schedule()).
+    bool lockfree_spreading;
+    // ranges of processed point indices for every tile, ordered by colour
+    vector<detail_threading::Range> tile_runs;
+    // start of every tile in tile_runs, plus end marker
+    vector<size_t> tile_ofs;
+    // start of every colour in tile_ofs, plus end marker
+    vector<size_t> colour_ofs;
+
+    // if not empty: kernel weights (ndim*supp values per point) and start
+    // indices in the oversampled grid of all nonuniform points, in
+    // processing order (see precompute_kernel())
+    quick_array<Tacc> kweights;
+    quick_array<array<int,ndim>> kindex;
+    // if not empty: kernel arguments of all nonuniform points, which
+    // together with kindex form a fixed-point representation of the
+    // coordinates (see convert_coords())
+    quick_array<array<Tacc,ndim>> kx;
+
+    // Fourier transform of the kernel of the normal operator, if prepared
+    // (see set_normal_kernel())
+    vmav<complex<Tcalc>,ndim> normal_krn;
+
     static_assert(sizeof(Tcalc)<=sizeof(Tacc),
       "Tacc must be at least as accurate as Tcalc");
+    static_assert(log2tile>=0, "unsupported dimensionality");
 
     /*! Compute minimum index in the oversampled grid touched by the kernel
         around coordinate \a in. */
@@ -326,11 +359,13 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
       {
       // do range reduction in long double when Tcoord is double,
       // to avoid inaccuracies with very large grids
+      // (the subtraction must already be done in long double; for negative
+      // coordinates it would lose low-order bits in double precision)
       using Tbig = typename conditional<is_same<Tcoord,double>::value, long double, double>::type;
       for (size_t i=0; i<ndim; ++i)
         {
-        auto tmp = in[i]*coordfct;
-        auto tmp2 = Tbig(tmp-floor(tmp))*nover[i];
+        Tbig tmp = in[i]*coordfct;
+        auto tmp2 = (tmp-floor(tmp))*nover[i];
         out0[i] = min(int(tmp2+shift[i])-int(nover[i]), maxi0[i]);
         out[i] = double(tmp2-out0[i]);
         }
@@ -358,6 +393,214 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
       return res;
       }
 
+    /*! Compute index of the tile (of size 2^\a lsq2) into which point \a i
+        of \a coords falls, using the converted coordinates if available. */
+    template<typename Tcoord> [[gnu::always_inline]] array<uint32_t,ndim> point_tile
+      (const cmav<Tcoord,2> &coords, size_t i, size_t lsq2=log2tile) const
+      {
+      array<uint32_t,ndim> res;
+      if (kx.size()!=0)
+        {
+        for (size_t d=0; d<ndim; ++d)
+          res[d] = uint32_t((kindex[i][d]+nsafe)>>lsq2);
+        return res;
+        }
+      array<double,ndim> in;
+      for (size_t d=0; d<ndim; ++d) in[d] = coords(i,d);
+      return get_tile<Tcoord>(in, lsq2);
+      }
+
+    /*! Prefetches the coordinates of point \a i of \a coords (or their
+        converted form, if available). */
+    template<typename Tcoord> [[gnu::always_inline]] void prefetch_coords
+      (const cmav<Tcoord,2> &coords, size_t i) const
+      {
+      if (kx.size()!=0)
+        {
+        DUCC0_PREFETCH_R(&kx[i]);
+        DUCC0_PREFETCH_R(&kindex[i]);
+        }
+      else
+        for (size_t d=0; d<ndim; ++d) DUCC0_PREFETCH_R(&coords(i,d));
+      }
+
+    /*! Kernel weights of a single nonuniform point, as used by the spreading
+        and interpolation helpers: the weights along axis d are stored in
+        buf.simd[d*nvec] to buf.simd[(d+1)*nvec-1], padded with zeros. */
+    template<size_t SUPP, typename T> class PointKernel
+      {
+      public:
+        static constexpr size_t vlen = mysimd<T>::size();
+        static constexpr size_t nvec = (SUPP+vlen-1)/vlen;
+
+      private:
+        TemplateKernel<SUPP, mysimd<T>> tkrn;
+
+      public:
+        union kbuf {
+          T scalar[ndim*nvec*vlen];
+          mysimd<T> simd[ndim*nvec];
+#if defined(_MSC_VER)
+          kbuf() {}
+#endif
+          };
+        kbuf buf;
+
+        PointKernel(const PolynomialKernel &krn) : tkrn(krn) {}
+
+        /*! Evaluates the kernel at the (scaled) arguments \a x. */
+        template<typename Tx> [[gnu::always_inline]] [[gnu::hot]] void eval
+          (const array<Tx,ndim> &x)
+          {
+          if constexpr (ndim==1)
+            tkrn.eval1(T(x[0]), &buf.simd[0]);
+          else if constexpr (ndim==2)
+            tkrn.eval2(T(x[0]), T(x[1]), &buf.simd[0]);
+          else if constexpr (ndim==3)
+            tkrn.eval3(T(x[0]), T(x[1]), T(x[2]), &buf.simd[0]);
+          else
+            for (size_t d=0; d<ndim; ++d)
+              tkrn.eval1(T(x[d]), &buf.simd[d*nvec]);
+          }
+        /*! Copies the kernel weights \a wgt precomputed by the plan. */
+        [[gnu::always_inline]] [[gnu::hot]] void load
+          (const Tacc * DUCC0_RESTRICT wgt)
+          {
+          for (size_t d=0; d<ndim; ++d)
+            for (size_t i=0; i<nvec*vlen; ++i)
+              buf.scalar[d*nvec*vlen+i] = (i<SUPP) ? T(wgt[d*SUPP+i]) : T(0);
+          }
+      };
+
+    /*! Computes the kernel weights of the point at position \a ix of the
+        processing order (with index \a row in \a coords, unless the
+        coordinates are \a sorted) in \a kbuf and returns its start index in
+        the oversampled grid. Kernel weights precomputed by the plan and
+        converted coordinates are used if available. */
+    template<size_t SUPP, typename T, typename Tcoord> [[gnu::always_inline]]
+      [[gnu::hot]] array<int,ndim> prep_point(PointKernel<SUPP,T> &kbuf,
+      const cmav<Tcoord,2> &coords, bool sorted, size_t ix, size_t row) const
+      {
+      if (sorted && (kweights.size()!=0))
+        {
+        kbuf.load(&kweights[ix*ndim*SUPP]);
+        return kindex[ix];
+        }
+      size_t i = sorted ? ix : row;
+      if (kx.size()!=0)
+        {
+        kbuf.eval(kx[i]);
+        return kindex[i];
+        }
+      array<double,ndim> in, frac;
+      array<int,ndim> i0;
+      for (size_t d=0; d<ndim; ++d) in[d] = coords(i,d);
+      getpix<Tcoord>(in, frac, i0);
+      for (size_t d=0; d<ndim; ++d) frac[d] = -frac[d]*2+(SUPP-1);
+      kbuf.eval(frac);
+      return i0;
+      }
+
+    /*! Converts the coordinates \a coords into start indices in the
+        oversampled grid and (scaled) kernel arguments, stored in kindex and
+        kx in the same order. Plans storing their coordinates thereby carry
+        out the range reduction of getpix(), which needs long double
+        arithmetic for double coordinates, only once per point instead of
+        once per point and transform. */
+    template<typename Tcoord> void convert_coords(const cmav<Tcoord,2> &coords)
+      {
+      timers.push("converting coords");
+      size_t n = coords.shape(0);
+      kindex.resize(n);
+      kx.resize(n);
+      execParallel(n, nthreads, [&](size_t lo, size_t hi)
+        {
+        array<double,ndim> in, frac;
+        for (size_t i=lo; i<hi; ++i)
+          {
+          for (size_t d=0; d<ndim; ++d) in[d] = coords(i,d);
+          getpix<Tcoord>(in, frac, kindex[i]);
+          for (size_t d=0; d<ndim; ++d)
+            kx[i][d] = Tacc(-frac[d]*2+(supp-1));
+          }
+        });
+      timers.pop();
+      }
+
+    /*! Returns the index of the nonuniform point which should be processed
+        at position \a i. */
+    [[gnu::always_inline]] size_t point_index(size_t i) const
+      { return ((i>>log2_idxblock)<<log2_idxblock) + coord_idx[i]; }
+
+    /*! Fills coord_idx with the point indices ordered by the keys (smaller
+        than \a max_key) returned by \a getkey for every point index. */
+    template<typename Tgetkey> void sort_points(size_t max_key,
+      Tgetkey &&getkey)
+      {
+      coord_idx.resize(npoints);
+      constexpr size_t blksz = size_t(1)<<log2_idxblock;
+      for (size_t ofs=0; ofs<npoints; ofs+=blksz)
+        {
+        size_t nblk = min(blksz, npoints-ofs);
+        quick_array<uint32_t> key(nblk);
+        execParallel(nblk, nthreads, [&](size_t lo, size_t hi)
+          {
+          for (size_t i=lo; i<hi; ++i)
+            key[i] = getkey(ofs+i);
+          });
+        if (nblk==npoints)
+          bucket_sort2(key, coord_idx, max_key, nthreads);
+        else
+          {
+          quick_array<uint32_t> idx;
+          bucket_sort2(key, idx, max_key, nthreads);
+          execParallel(nblk, nthreads, [&](size_t lo, size_t hi)
+            {
+            for (size_t i=lo; i<hi; ++i)
+              coord_idx[ofs+i] = idx[i];
+            });
+          }
+        }
+      }
+
+    /*! Fills coord_idx with the point indices of \a coords ordered by tile.
+        In 3D, the points within a tile are additionally ordered by smaller
+        sub-tiles, as long as the total number of keys stays moderate. */
+    template<typename Tcoord> void build_index(const cmav<Tcoord,2> &coords)
+      {
+      timers.push("building index");
+      MR_assert(coords.shape(0)==npoints, "number of coords mismatch");
+      MR_assert(coords.shape(1)==ndim, "ndim mismatch");
+      array<size_t,ndim> ntiles;
+      size_t nkeys = 1;
+      for (size_t d=0; d<ndim; ++d)
+        {
+        ntiles[d] = (nover[d]>>log2tile) + 3;
+        nkeys *= ntiles[d];
+        }
+      size_t lsq2 = log2tile;
+      if constexpr (ndim==3)
+        while ((lsq2>=1) && ((nkeys<<(ndim*(log2tile-lsq2)))<(size_t(1)<<28)))
+          --lsq2;
+      auto ssmall = log2tile-lsq2;
+      auto msmall = (size_t(1)<<ssmall) - 1;
+      nkeys <<= ndim*ssmall;
+      MR_assert(nkeys<=(size_t(1)<<32), "too many tiles");
+
+      sort_points(nkeys, [&](size_t i)
+        {
+        auto tile = point_tile(coords, i, lsq2);
+        size_t hikey=0, lowkey=0;
+        for (size_t d=0; d<ndim; ++d)
+          {
+          hikey = hikey*ntiles[d] + (tile[d]>>ssmall);
+          lowkey = (lowkey<<ssmall) | (tile[d]&msmall);
+          }
+        return uint32_t((hikey<<(ndim*ssmall)) | lowkey);
+        });
+      timers.pop();
+      }
+
     template<typename Tcoord> void sort_coords(const cmav<Tcoord,2> &coords,
       vmav<Tcoord,2> &coords_sorted)
       {
@@ -366,20 +609,47 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
         {
         for (size_t i=lo; i<hi; ++i)
           for (size_t d=0; d<ndim; ++d)
-            coords_sorted(i,d) = coords(coord_idx[i],d);
+            coords_sorted(i,d) = coords(point_index(i),d);
         });
+      if (kx.size()!=0)  // bring the converted coordinates into the same order
+        {
+        quick_array<array<int,ndim>> kindex2(npoints);
+        quick_array<array<Tacc,ndim>> kx2(npoints);
+        execParallel(npoints, nthreads, [&](size_t lo, size_t hi)
+          {
+          for (size_t i=lo; i<hi; ++i)
+            {
+            kindex2[i] = kindex[point_index(i)];
+            kx2[i] = kx[point_index(i)];
+            }
+          });
+        kindex = move(kindex2);
+        kx = move(kx2);
+        }
       timers.pop();
       }
 
-    template<typename Tpoints, typename Tgrid> bool prep_nu2u
-      (const cmav<complex<Tpoints>,1> &points, vmav<complex<Tgrid>,ndim> &uniform)
+    // The points arrays have the shape (ntrans, npoints), the uniform
+    // arrays the shape (ntrans, nuni...).
+    template<typename Tpoints, typename Tgrid> void check_batch
+      (const fmav_info &points, const fmav_info &uniform) const
       {
       static_assert(sizeof(Tpoints)<=sizeof(Tcalc),
         "Tcalc must be at least as accurate as Tpoints");
       static_assert(sizeof(Tgrid)<=sizeof(Tcalc),
         "Tcalc must be at least as accurate as Tgrid");
-      MR_assert(points.shape(0)==npoints, "number of points mismatch");
-      MR_assert(uniform.shape()==nuni, "uniform grid dimensions mismatch");
+      MR_assert(points.shape(1)==npoints, "number of points mismatch");
+      MR_assert(uniform.shape(0)==points.shape(0),
+        "number of transforms mismatch");
+      for (size_t i=0; i<ndim; ++i)
+        MR_assert(uniform.shape(i+1)==nuni[i],
+          "uniform grid dimensions mismatch");
+      }
+    template<typename Tpoints, typename Tgrid> bool prep_nu2u
+      (const cmav<complex<Tpoints>,2> &points, vmav<complex<Tgrid>,ndim+1> &uniform)
+      {
+      check_batch<Tpoints, Tgrid>(points, uniform);
+      if (points.shape(0)==0) return true;
       if (npoints==0)
         {
         mav_apply([](complex<Tgrid> &v){v=complex<Tgrid>(0);}, nthreads, uniform);
@@ -388,148 +658,828 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
       return false;
       }
     template<typename Tpoints, typename Tgrid> bool prep_u2nu
-      (const cmav<complex<Tpoints>,1> &points, const cmav<complex<Tgrid>,ndim> &uniform)
+      (const cmav<complex<Tpoints>,2> &points, const cmav<complex<Tgrid>,ndim+1> &uniform)
       {
-      static_assert(sizeof(Tpoints)<=sizeof(Tcalc),
-        "Tcalc must be at least as accurate as Tpoints");
-      static_assert(sizeof(Tgrid)<=sizeof(Tcalc),
-        "Tcalc must be at least as accurate as Tgrid");
-      MR_assert(points.shape(0)==npoints, "number of points mismatch");
-      MR_assert(uniform.shape()==nuni, "uniform grid dimensions mismatch");
-      return npoints==0;
+      check_batch<Tpoints, Tgrid>(points, uniform);
+      return (npoints==0) || (points.shape(0)==0);
       }
 
-   static string dim2string(const array<size_t, ndim> &arr)
+    // Number of transforms of a batch which are spread or interpolated
+    // together. Every transform needs its own tile buffer in each thread,
+    // and all of these should fit into the cache.
+    size_t trans_block(size_t ntrans, size_t elsize) const
       {
-      ostringstream str;
-      str << arr[0];
-      for (size_t i=1; i<ndim; ++i) str << "x" << arr[i];
-      return str.str();
+      size_t bufsize = elsize;
+      for (size_t i=0; i<ndim; ++i) bufsize *= supp+(size_t(1)<<log2tile);
+      return max<size_t>(1, min(ntrans, (size_t(1)<<18)/bufsize));
       }
 
-    void report(bool gridding)
+    // Views of the individual transforms in a batch of grids.
+    template<typename T> static vector<cmav<T,ndim>> split_grid
+      (const cmav<T,ndim+1> &grid)
       {
-      cout << (gridding ? "Nu2u:" : "U2nu:") << endl
-           << "  nthreads=" << nthreads << ", grid=(" << dim2string(nuni)
-           << "), oversampled grid=(" << dim2string(nover) << "), supp="
-           << supp << ", eps=" << epsilon << endl << "  npoints=" << npoints
-           << endl << "  memory overhead: "
-           << npoints*sizeof(uint32_t)/double(1<<30) << "GB (index) + "
-           << accumulate(nover.begin(), nover.end(), 1, multiplies<>())*sizeof(complex<Tcalc>)/double(1<<30) << "GB (oversampled grid)" << endl;
+      vector<cmav<T,ndim>> res;
+      vector<slice> slc(ndim+1);
+      for (size_t t=0; t<grid.shape(0); ++t)
+        {
+        slc[0] = slice(t);
+        res.push_back(subarray<ndim>(grid, slc));
+        }
+      return res;
+      }
+    template<typename T> static vector<vmav<T,ndim>> split_grid
+      (vmav<T,ndim+1> &grid)
+      {
+      vector<vmav<T,ndim>> res;
+      vector<slice> slc(ndim+1);
+      for (size_t t=0; t<grid.shape(0); ++t)
+        {
+        slc[0] = slice(t);
+        res.push_back(subarray<ndim>(grid, slc));
+        }
+      return res;
       }
 
-  public:
-    Nufft_ancestor(bool gridding, size_t npoints_,
-      const array<size_t,ndim> &uniform_shape, double epsilon_,
-      size_t nthreads_, double sigma_min, double sigma_max,
-      double periodicity, bool fft_order_)
-      : timers(gridding ? "nu2u" : "u2nu"), epsilon(epsilon_),
-        nthreads(adjust_nthreads(nthreads_)), coordfct(1./periodicity),
-        fft_order(fft_order_), npoints(npoints_), nuni(uniform_shape)
+    /* The local buffer of a tile extends by at most nsafe cells beyond the
+       tile on either side. If 2*nsafe does not exceed the tile size, two
+       tiles whose indices differ by at least 2 along some axis never touch
+       the same grid cells, otherwise (only possible for small tiles) this
+       holds for a difference of at least 3. Along every axis, the tiles are
+       therefore coloured periodically with this period, except for the last
+       period+1 ones, which may wrap around the periodic grid and overlap the
+       first ones; these get colours of their own. */
+    static size_t tile_colour(size_t itile, size_t ntiles, size_t period)
       {
-      MR_assert(npoints<=(~uint32_t(0)), "too many nonuniform points");
+      if (ntiles<=2*period+1) return itile;
+      return (itile+period+1<ntiles) ? (itile%period)
+                                     : (itile+2*period+1-ntiles);
+      }
 
-      timers.push("parameter calculation");
-      vector<size_t> tdims{nuni.begin(), nuni.end()};
-      auto [kidx, dims] = findNufftParameters<Tcalc,Tacc>
-        (epsilon, sigma_min, sigma_max, tdims, npoints, gridding, nthreads);
+    /*! Computes the tile colouring schedule for lock-free spreading of the
+        points in \a coords (which are already in processing order if
+        \a sorted is true). Must be called after the index has been built. */
+    template<typename Tcoord> void build_tile_schedule
+      (const cmav<Tcoord,2> &coords, bool sorted)
+      {
+      timers.push("tile colouring");
+      constexpr size_t tilesize = size_t(1)<<log2tile;
+      MR_assert(nsafe<=tilesize, "tiles too small for colouring");
+      size_t period = (2*nsafe<=tilesize) ? 2 : 3;
+      array<size_t,ndim> ntiles, ncol;
+      size_t ncolours=1;
       for (size_t i=0; i<ndim; ++i)
         {
-        nover[i] = dims[i];
-        MR_assert((nover[i]>>log2tile)<=max_ntile<ndim>, "oversampled grid too large");
+        ntiles[i] = ((maxi0[i]+nsafe)>>log2tile) + 1;
+        ncol[i] = min<size_t>(ntiles[i], 2*period+1);
+        ncolours *= ncol[i];
+        }
+      quick_array<uint32_t> key(npoints);
+      execParallel(npoints, nthreads, [&](size_t lo, size_t hi)
+        {
+        for (size_t ix=lo; ix<hi; ++ix)
+          {
+          size_t row = sorted ? ix : point_index(ix);
+          auto tile = point_tile(coords, row);
+          size_t k = 0;
+          for (size_t d=0; d<ndim; ++d) k = k*ntiles[d] + tile[d];
+          key[ix] = uint32_t(k);
+          }
+        });
+      // runs of consecutive points in the same tile; there may be several
+      // runs per tile if the points are sorted in more than one block
+      struct Run { size_t colour, tile, lo, hi; };
+      vector<Run> runs;
+      for (size_t lo=0, hi=0; lo<npoints; lo=hi)
+        {
+        while ((hi<npoints) && (key[hi]==key[lo])) ++hi;
+        size_t colour=0, fct=1;
+        for (size_t d=ndim, k=key[lo]; d>0; --d)
+          {
+          colour += fct*tile_colour(k%ntiles[d-1], ntiles[d-1], period);
+          fct *= ncol[d-1];
+          k /= ntiles[d-1];
+          }
+        runs.push_back({colour, key[lo], lo, hi});
+        }
+      sort(runs.begin(), runs.end(), [](const Run &a, const Run &b)
+        { return (a.colour!=b.colour) ? (a.colour<b.colour)
+               : ((a.tile!=b.tile) ? (a.tile<b.tile) : (a.lo<b.lo)); });
+      tile_runs.clear();
+      tile_ofs.clear();
+      colour_ofs.assign(ncolours+1, 0);
+      for (size_t i=0; i<runs.size(); ++i)
+        {
+        if ((i==0) || (runs[i].tile!=runs[i-1].tile))
+          {
+          tile_ofs.push_back(i);
+          ++colour_ofs[runs[i].colour+1];
+          }
+        tile_runs.emplace_back(runs[i].lo, runs[i].hi);
         }
+      tile_ofs.push_back(runs.size());
+      partial_sum(colour_ofs.begin(), colour_ofs.end(), colour_ofs.begin());
       timers.pop();
+      }
 
-      krn = selectKernel(kidx);
-      supp = krn->support();
-      nsafe = (supp+1)/2;
+    template<size_t SUPP, typename Tcoord> void precompute_kernel_helper
+      (size_t supp, const cmav<Tcoord,2> &coords)
+      {
+      if constexpr (SUPP>=8)
+        if (supp<=SUPP/2) return precompute_kernel_helper<SUPP/2>(supp, coords);
+      if constexpr (SUPP>4)
+        if (supp<SUPP) return precompute_kernel_helper<SUPP-1>(supp, coords);
+      MR_assert(supp==SUPP, "requested support out of range");
+      using Tsimd = mysimd<Tacc>;
+      constexpr size_t vlen = Tsimd::size();
+      constexpr size_t nvec = (SUPP+vlen-1)/vlen;
+      kweights.resize(npoints*ndim*SUPP);
+      kindex.resize(npoints);
+      execParallel(npoints, nthreads, [&](size_t lo, size_t hi)
+        {
+        TemplateKernel<SUPP, Tsimd> tkrn(*krn);
+        array<Tsimd,nvec> buf;
+        array<double,ndim> in, frac;
+        for (size_t i=lo; i<hi; ++i)
+          {
+          for (size_t d=0; d<ndim; ++d) in[d] = coords(i,d);
+          getpix<Tcoord>(in, frac, kindex[i]);
+          for (size_t d=0; d<ndim; ++d)
+            {
+            tkrn.eval1(Tacc(-frac[d]*2+(SUPP-1)), buf.data());
+            for (size_t j=0; j<SUPP; ++j)
+              kweights[(i*ndim+d)*SUPP+j] = buf[j/vlen][j%vlen];
+            }
+          }
+        });
+      }
 
-      for (size_t i=0; i<ndim; ++i)
+    /*! Evaluates the kernel weights and start indices of all nonuniform
+        points in \a coords (which must be in processing order) and stores
+        them, so that repeated transforms with the same coordinates can skip
+        this step. This needs ndim*supp*sizeof(Tacc)+ndim*sizeof(int) bytes
+        per point. */
+    template<typename Tcoord> void precompute_kernel(const cmav<Tcoord,2> &coords)
+      {
+      timers.push("precomputing kernel");
+      constexpr size_t maxsupp = is_same<Tacc, float>::value ? 8 : 16;
+      precompute_kernel_helper<maxsupp>(supp, coords);
+      timers.pop();
+      }
+
+    /*! Calls \a func(next) on all threads for spreading the points, where
+        next() returns the next range of point indices to be processed by the
+        calling thread, and an empty range when the work is done.
+        With lock-free spreading, the colours are processed one after the
+        other, and \a func is called anew for every colour, so that the local
+        buffers of all helpers created within \a func are written to the grid
+        before the tiles of the next colour are processed. */
+    template<typename Tfunc> void spread_parallel(Tfunc &&func) const
+      {
+      if (!lockfree_spreading)
         {
-        shift[i] = supp*(-0.5)+1+nover[i];
-        maxi0[i] = (nover[i]+nsafe)-supp;
-        MR_assert(nover[i]>=2*nsafe, "oversampled length too small");
-        MR_assert((nover[i]&1)==0, "oversampled dimensions must be even");
+        size_t chunksz = max<size_t>(1000, npoints/(10*nthreads));
+        execDynamic(npoints, nthreads, chunksz, [&](Scheduler &sched)
+          { func([&sched]() { return sched.getNext(); }); });
+        return;
         }
-      MR_assert(epsilon>0, "epsilon must be positive");
+      MR_assert(!colour_ofs.empty(), "tile schedule missing");
+      for (size_t c=0; c+1<colour_ofs.size(); ++c)
+        {
+        size_t t0=colour_ofs[c], nt=colour_ofs[c+1]-t0;
+        if (nt==0) continue;
+        execDynamic(nt, nthreads, 1, [&](Scheduler &sched)
+          {
+          size_t irun=0, irun_end=0;
+          func([&]()
+            {
+            while (irun==irun_end)
+              {
+              auto rng = sched.getNext();
+              if (!rng) return detail_threading::Range();
+              irun = tile_ofs[t0+rng.lo];
+              irun_end = tile_ofs[t0+rng.hi];
+              }
+            return tile_runs[irun++];
+            });
+          });
+        }
+      }
 
-      timers.push("correction factors");
-      for (size_t i=0; i<ndim; ++i)
-        if ((i<1) || (nuni[i]!=nuni[i-1]) || (nover[i]!=nover[i-1]))
-          corfac.push_back(krn->corfunc(nuni[i]/2+1, 1./nover[i], nthreads));
-        else
-          corfac.push_back(corfac.back());
-      timers.pop();
+   static string dim2string(const array<size_t, ndim> &arr)
+      {
+      ostringstream str;
+      str << arr[0];
+      for (size_t i=1; i<ndim; ++i) str << "x" << arr[i];
+      return str.str();
       }
-  };
 
+    // FFT of the oversampled grid. When gridding, only the parts of the
+    // result corresponding to the uniform grid are needed; when degridding,
+    // only these parts are nonzero on input.
+    // The first axis of the grid enumerates the transforms of a batch.
+    void grid_fft(vmav<complex<Tcalc>,ndim+1> &grid, bool forward,
+      bool gridding) const
+      {
+      vector<vector<slice>> full(ndim), uni(ndim);
+      for (size_t i=0; i<ndim; ++i)
+        uni[i] = {{0,(nuni[i]+1)/2}, {nover[i]-nuni[i]/2,nover[i]}};
+      vector<size_t> axes(ndim);
+      iota(axes.begin(), axes.end(), 1);
+      vfmav<complex<Tcalc>> fgrid(grid);
+      c2c_pruned(fgrid, axes, gridding ? full : uni, gridding ? uni : full,
+        forward, Tcalc(1), nthreads);
+      }
 
-template<typename Tcalc, typename Tacc, typename Tcoord, size_t ndim> class Nufft;
+    // grid shape (including the transform axis) of the oversampled grid
+    array<size_t,ndim+1> oversampled_shape(size_t ntrans) const
+      {
+      array<size_t,ndim+1> res;
+      res[0] = ntrans;
+      for (size_t d=0; d<ndim; ++d) res[d+1] = nover[d];
+      return res;
+      }
 
-#define DUCC0_NUFFT_BOILERPLATE \
-  private: \
-    using parent=Nufft_ancestor<Tcalc, Tacc, ndim>; \
-    using parent::coord_idx, parent::nthreads, parent::npoints, parent::supp, \
-          parent::timers, parent::krn, parent::fft_order, parent::nuni, \
+    template<size_t d, typename Tfunc> [[gnu::always_inline]] void
+      loop_uniform_rec(size_t i, double fct, ptrdiff_t ofs_uni,
+      ptrdiff_t ofs_over, const fmav_info &uniform, const fmav_info &grid,
+      Tfunc &func) const
+      {
+      auto [icf, iuni, iover] = comp_indices(i, nuni[d], nover[d], fft_order);
+      fct *= corfac[d][icf];
+      ofs_uni += ptrdiff_t(iuni)*uniform.stride(d+1);
+      ofs_over += ptrdiff_t(iover)*grid.stride(d+1);
+      if constexpr (d+1==ndim)
+        func(fct, ofs_uni, ofs_over);
+      else
+        for (size_t j=0; j<nuni[d+1]; ++j)
+          loop_uniform_rec<d+1>(j, fct, ofs_uni, ofs_over, uniform, grid, func);
+      }
+    /* Calls func(fct, iuni, iover) for every pixel of the uniform grid, where
+       iuni and iover are the offsets of the pixel in the uniform and
+       oversampled grid (without the transform axis), and fct is the product
+       of its grid correction factors. */
+    template<typename Tfunc> void loop_uniform(const fmav_info &uniform,
+      const fmav_info &grid, Tfunc &&func) const
+      {
+      execParallel(nuni[0], nthreads, [&](size_t lo, size_t hi)
+        {
+        for (auto i=lo; i<hi; ++i)
+          loop_uniform_rec<0>(i, 1., 0, 0, uniform, grid, func);
+        });
+      }
+
+    // FFT and grid correction of the spread oversampled grid
+    template<typename Tgrid> void grid2uniform(bool forward,
+      vmav<complex<Tcalc>,ndim+1> &grid, vmav<complex<Tgrid>,ndim+1> &uniform)
+      {
+      size_t ntrans = grid.shape(0);
+      timers.push("FFT");
+      grid_fft(grid, forward, true);
+      timers.poppush("grid correction");
+      loop_uniform(uniform, grid, [&](double fct, ptrdiff_t iuni, ptrdiff_t iover)
+        {
+        for (size_t t=0; t<ntrans; ++t)
+          uniform.data()[iuni+ptrdiff_t(t)*uniform.stride(0)]
+            = complex<Tgrid>(grid.data()[iover+ptrdiff_t(t)*grid.stride(0)]*Tcalc(fct));
+        });
+      timers.pop();
+      }
+
+    // grid correction and FFT of the uniform grid onto the oversampled grid
+    template<typename Tgrid> void uniform2grid(bool forward,
+      const cmav<complex<Tgrid>,ndim+1> &uniform, vmav<complex<Tcalc>,ndim+1> &grid)
+      {
+      size_t ntrans = grid.shape(0);
+      timers.push("zeroing grid");
+      // only zero the parts of the grid that are not filled afterwards anyway,
+      // i.e. the gap between the positive and negative modes along axis d
+      // for all combinations of mode blocks along the preceding axes
+      vector<slice> slc(ndim+1);
+      for (size_t d=0; d<ndim; ++d)
+        for (size_t blk=0; blk<(size_t(1)<<d); ++blk)
+          {
+          bool empty = (nuni[d]+1)/2 >= nover[d]-nuni[d]/2;
+          for (size_t d2=0; d2<d; ++d2)
+            if ((blk>>d2)&1)  // negative modes
+              {
+              empty |= (nuni[d2]/2==0);
+              slc[d2+1] = slice(nover[d2]-nuni[d2]/2, nover[d2]);
+              }
+            else
+              slc[d2+1] = slice(0, (nuni[d2]+1)/2);
+          slc[d+1] = slice((nuni[d]+1)/2, nover[d]-nuni[d]/2);
+          for (size_t d2=d+1; d2<ndim; ++d2) slc[d2+1] = slice();
+          if (empty) continue;
+          auto sub = subarray<ndim+1>(grid, slc);
+          mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);}, nthreads, sub);
+          }
+      timers.poppush("grid correction");
+      loop_uniform(uniform, grid, [&](double fct, ptrdiff_t iuni, ptrdiff_t iover)
+        {
+        for (size_t t=0; t<ntrans; ++t)
+          grid.data()[iover+ptrdiff_t(t)*grid.stride(0)]
+            = complex<Tcalc>(uniform.data()[iuni+ptrdiff_t(t)*uniform.stride(0)])*Tcalc(fct);
+        });
+      timers.poppush("FFT");
+      grid_fft(grid, forward, false);
+      timers.pop();
+      }
+
+    /* The normal operator A^H W A of a u2nu transform A (W being a diagonal
+       matrix of weights) is a convolution of the uniform grid with the
+       kernel T(m) = sum_j w_j exp(-+i m.x_j), which is a nu2u transform onto
+       the mode differences m between -(nuni-1) and nuni-1. If the uniform
+       grid is embedded into a periodic grid of at least 2*nuni-1 points per
+       axis, storing mode k at index k mod L, this becomes a cyclic
+       convolution, which is carried out via FFTs. */
+    static size_t normal_length(size_t n)
+      { return good_size_complex(2*n-1); }
+
+    /*! Calls \a func(suni, sbig) for all blocks of the uniform grid in which
+        the modes along every axis have the same sign; \a suni are the
+        slices of the block in the uniform grid, \a sbig those in the
+        embedding grid. */
+    template<typename Tfunc> void normal_blocks(Tfunc &&func) const
+      {
+      for (size_t blk=0; blk<(size_t(1)<<ndim); ++blk)
+        {
+        vector<slice> suni(ndim), sbig(ndim);
+        bool empty = false;
+        for (size_t d=0; d<ndim; ++d)
+          {
+          size_t n=nuni[d], len=normal_krn.shape(d), npos=(n+1)/2, nneg=n/2;
+          if ((blk>>d)&1)  // negative modes
+            {
+            empty |= (nneg==0);
+            suni[d] = fft_order ? slice(npos, n) : slice(0, nneg);
+            sbig[d] = slice(len-nneg, len);
+            }
+          else
+            {
+            suni[d] = fft_order ? slice(0, npos) : slice(nneg, n);
+            sbig[d] = slice(0, npos);
+            }
+          }
+        if (!empty) func(suni, sbig);
+        }
+      }
+
+    /*! Stores the Fourier transform of the normal operator kernel \a krn,
+        which must be given on the embedding grid (in FFT order). \a krn is
+        overwritten. */
+    void set_normal_kernel(vmav<complex<Tcalc>,ndim> &krn)
+      {
+      for (size_t i=0; i<ndim; ++i)
+        MR_assert(krn.shape(i)==normal_length(nuni[i]), "bad kernel shape");
+      vector<size_t> axes(ndim);
+      iota(axes.begin(), axes.end(), 0);
+      vfmav<complex<Tcalc>> fkrn(krn);
+      c2c(fkrn, fkrn, axes, true, Tcalc(1./krn.size()), nthreads);
+      normal_krn.assign(krn);
+      }
+
+    void report(bool gridding, size_t ntrans=1)
+      {
+      cout << (gridding ? "Nu2u:" : "U2nu:") << endl
+           << "  nthreads=" << nthreads << ", grid=(" << dim2string(nuni)
+           << "), oversampled grid=(" << dim2string(nover) << "), supp="
+           << supp << ", eps=" << epsilon << endl << "  npoints=" << npoints
+           << ", ntrans=" << ntrans << endl << "  memory overhead: "
+           << npoints*sizeof(uint32_t)/double(1<<30) << "GB (index) + "
+           << ntrans*accumulate(nover.begin(), nover.end(), 1, multiplies<>())*sizeof(complex<Tcalc>)/double(1<<30) << "GB (oversampled grid)";
+      if (kweights.size()!=0)
+        cout << " + " << (kweights.size()*sizeof(Tacc)
+                          + kindex.size()*sizeof(kindex[0]))/double(1<<30)
+             << "GB (kernel weights)";
+      else if (kx.size()!=0)
+        cout << " + " << kx.size()*(sizeof(kx[0])+sizeof(kindex[0]))/double(1<<30)
+             << "GB (converted coords)";
+      cout << endl;
+      }
+
+  public:
+    /*! Applies the normal operator prepared by prep_normal() to the batch of
+        uniform grids \a in and stores the result in \a out (which may be
+        identical to \a in). */
+    template<typename Tgrid> void apply_normal(
+      const cmav<complex<Tgrid>,ndim+1> &in, vmav<complex<Tgrid>,ndim+1> &out)
+      {
+      static_assert(sizeof(Tgrid)<=sizeof(Tcalc),
+        "Tcalc must be at least as accurate as Tgrid");
+      MR_assert(normal_krn.size()!=0, "normal operator has not been prepared");
+      check_batch<Tgrid, Tgrid>(fmav_info({in.shape(0), npoints}), in);
+      MR_assert(in.shape()==out.shape(), "shape mismatch");
+      timers.push("normal operator");
+      auto buf = vmav<complex<Tcalc>,ndim>::build_noncritical(normal_krn.shape(),
+        UNINITIALIZED);
+      vfmav<complex<Tcalc>> fbuf(buf);
+      vector<size_t> axes(ndim);
+      iota(axes.begin(), axes.end(), 0);
+      vector<vector<slice>> full(ndim), uni(ndim);
+      for (size_t i=0; i<ndim; ++i)
+        uni[i] = {{0,(nuni[i]+1)/2}, {buf.shape(i)-nuni[i]/2,buf.shape(i)}};
+      vector<slice> slc(ndim+1);
+      for (size_t t=0; t<in.shape(0); ++t)
+        {
+        slc[0] = slice(t);
+        mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);}, nthreads, buf);
+        normal_blocks([&](const vector<slice> &suni, const vector<slice> &sbig)
+          {
+          copy(suni.begin(), suni.end(), slc.begin()+1);
+          auto sub = subarray<ndim>(buf, sbig);
+          mav_apply([](complex<Tcalc> &b, const complex<Tgrid> &v)
+            { b = complex<Tcalc>(v); }, nthreads, sub, subarray<ndim>(in, slc));
+          });
+        c2c_pruned(fbuf, axes, uni, full, true, Tcalc(1), nthreads);
+        mav_apply([](complex<Tcalc> &b, const complex<Tcalc> &k) { b*=k; },
+          nthreads, buf, normal_krn);
+        c2c_pruned(fbuf, axes, full, uni, false, Tcalc(1), nthreads);
+        normal_blocks([&](const vector<slice> &suni, const vector<slice> &sbig)
+          {
+          copy(suni.begin(), suni.end(), slc.begin()+1);
+          auto sub = subarray<ndim>(out, slc);
+          mav_apply([](complex<Tgrid> &o, const complex<Tcalc> &b)
+            { o = complex<Tgrid>(b); }, nthreads, sub, subarray<ndim>(buf, sbig));
+          });
+        }
+      timers.pop();
+      }
+    template<typename Tgrid> void apply_normal(
+      const cmav<complex<Tgrid>,ndim> &in, vmav<complex<Tgrid>,ndim> &out)
+      {
+      auto out2 = out.prepend_1();
+      apply_normal(in.prepend_1(), out2);
+      }
+
+    Nufft_ancestor(bool gridding, size_t npoints_,
+      const array<size_t,ndim> &uniform_shape, double epsilon_,
+      size_t nthreads_, double sigma_min_, double sigma_max_,
+      double periodicity, bool fft_order_, bool lockfree_spreading_=false)
+      : timers(gridding ? "nu2u" : "u2nu"), epsilon(epsilon_),
+        nthreads(adjust_nthreads(nthreads_)), sigma_min(sigma_min_),
+        sigma_max(sigma_max_), coordfct(1./periodicity),
+        fft_order(fft_order_), npoints(npoints_), nuni(uniform_shape),
+        lockfree_spreading(lockfree_spreading_)
+      {
+      timers.push("parameter calculation");
+      vector<size_t> tdims{nuni.begin(), nuni.end()};
+      auto [kidx, dims] = findNufftParameters<Tcalc,Tacc>
+        (epsilon, sigma_min, sigma_max, tdims, npoints, gridding, nthreads);
+      for (size_t i=0; i<ndim; ++i)
+        {
+        nover[i] = dims[i];
+        MR_assert((nover[i]>>log2tile)<=max_ntile<ndim>, "oversampled grid too large");
+        }
+      timers.pop();
+
+      krn = selectKernel(kidx);
+      supp = krn->support();
+      nsafe = (supp+1)/2;
+
+      for (size_t i=0; i<ndim; ++i)
+        {
+        shift[i] = supp*(-0.5)+1+nover[i];
+        maxi0[i] = (nover[i]+nsafe)-supp;
+        MR_assert(nover[i]>=2*nsafe, "oversampled length too small");
+        MR_assert((nover[i]&1)==0, "oversampled dimensions must be even");
+        }
+      MR_assert(epsilon>0, "epsilon must be positive");
+
+      timers.push("correction factors");
+      for (size_t i=0; i<ndim; ++i)
+        if ((i<1) || (nuni[i]!=nuni[i-1]) || (nover[i]!=nover[i-1]))
+          corfac.push_back(krn->corfunc(nuni[i]/2+1, 1./nover[i], nthreads));
+        else
+          corfac.push_back(corfac.back());
+      timers.pop();
+      }
+
+    /// Returns the support of the gridding kernel used by this plan.
+    size_t kernel_support() const { return supp; }
+    /*! Returns the accumulated times (in s) of the steps of all transforms
+        carried out with this plan so far, keyed by their path in the timer
+        hierarchy, e.g. "nu2u:nu2u proper:spreading". */
+    map<string, double> get_timings()
+      { return timers.get_timings(); }
+  };
+
+
+template<typename Tcalc, typename Tacc, typename Tcoord, size_t ndim> class Nufft;
+template<typename Tcalc, typename Tacc, typename Tcoord, size_t ndim> class Nufft3;
+
+#define DUCC0_NUFFT_BOILERPLATE \
+  private: \
+    using parent=Nufft_ancestor<Tcalc, Tacc, ndim>; \
+    using parent::coord_idx, parent::nthreads, parent::npoints, parent::supp, \
+          parent::timers, parent::krn, parent::fft_order, parent::nuni, \
+          parent::point_index, parent::sort_points, \
           parent::nover, parent::shift, parent::maxi0, parent::report, \
           parent::log2tile, parent::corfac, parent::sort_coords, \
-          parent::prep_nu2u, parent::prep_u2nu; \
+          parent::prep_nu2u, parent::prep_u2nu, \
+          parent::split_grid, parent::trans_block, \
+          parent::lockfree_spreading, parent::colour_ofs, \
+          parent::build_tile_schedule, parent::spread_parallel, \
+          parent::kweights, parent::kindex, parent::precompute_kernel, \
+          parent::epsilon, parent::sigma_min, parent::sigma_max, \
+          parent::coordfct, parent::normal_length, \
+          parent::set_normal_kernel, parent::kx, parent::convert_coords, \
+          parent::prefetch_coords, parent::prep_point, parent::build_index, \
+          parent::oversampled_shape, parent::grid2uniform, \
+          parent::uniform2grid; \
+    /* type-3 transforms use the spreading and interpolation steps directly */ \
+    template<typename, typename, typename, size_t> friend class Nufft3; \
  \
     vmav<Tcoord,2> coords_sorted; \
+    /* oversampled grid accumulated by nu2u_add() */ \
+    vmav<complex<Tcalc>,ndim+1> accgrid; \
  \
   public: \
     using parent::parent; /* inherit constructor */ \
+    /* If convert_coordinates is true, the coordinates are additionally \
+       stored in fixed-point form (see convert_coords()), which saves the \
+       range reduction in every transform (done in long double for double \
+       coordinates) at the cost of ndim*(sizeof(Tacc)+sizeof(int)) bytes \
+       per point. This is not needed if the kernel weights are precomputed. */ \
     Nufft(bool gridding, const cmav<Tcoord,2> &coords, \
           const array<size_t, ndim> &uniform_shape_, double epsilon_,  \
           size_t nthreads_, double sigma_min, double sigma_max, \
-          double periodicity, bool fft_order_) \
+          double periodicity, bool fft_order_, \
+          bool lockfree_spreading_=false, bool precompute_weights=false, \
+          bool convert_coordinates=false) \
       : parent(gridding, coords.shape(0), uniform_shape_, epsilon_, nthreads_, \
-               sigma_min, sigma_max, periodicity, fft_order_), \
+               sigma_min, sigma_max, periodicity, fft_order_, \
+               lockfree_spreading_), \
         coords_sorted({npoints,ndim},UNINITIALIZED) \
       { \
+      if (convert_coordinates && (!precompute_weights)) convert_coords(coords); \
       build_index(coords); \
       sort_coords(coords, coords_sorted); \
+      if (precompute_weights) precompute_kernel(coords_sorted); \
       } \
  \
     template<typename Tpoints, typename Tgrid> void nu2u(bool forward, size_t verbosity, \
-      const cmav<complex<Tpoints>,1> &points, vmav<complex<Tgrid>,ndim> &uniform) \
+      const cmav<complex<Tpoints>,2> &points, vmav<complex<Tgrid>,ndim+1> &uniform) \
       { \
       if (prep_nu2u(points, uniform)) return; \
       MR_assert(coords_sorted.size()!=0, "bad call"); \
-      if (verbosity>0) report(true); \
+      if (verbosity>0) report(true, points.shape(0)); \
       nonuni2uni(forward, coords_sorted, points, uniform); \
       if (verbosity>0) timers.report(cout); \
       } \
     template<typename Tpoints, typename Tgrid> void u2nu(bool forward, size_t verbosity, \
-      const cmav<complex<Tgrid>,ndim> &uniform, vmav<complex<Tpoints>,1> &points) \
+      const cmav<complex<Tgrid>,ndim+1> &uniform, vmav<complex<Tpoints>,2> &points) \
       { \
       if (prep_u2nu(points, uniform)) return; \
       MR_assert(coords_sorted.size()!=0, "bad call"); \
-      if (verbosity>0) report(false); \
+      if (verbosity>0) report(false, points.shape(0)); \
       uni2nonuni(forward, uniform, coords_sorted, points); \
       if (verbosity>0) timers.report(cout); \
       } \
     template<typename Tpoints, typename Tgrid> void nu2u(bool forward, size_t verbosity, \
-      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,1> &points, \
-      vmav<complex<Tgrid>,ndim> &uniform) \
+      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,2> &points, \
+      vmav<complex<Tgrid>,ndim+1> &uniform) \
       { \
       if (prep_nu2u(points, uniform)) return; \
       MR_assert(coords_sorted.size()==0, "bad call"); \
-      if (verbosity>0) report(true); \
+      if (verbosity>0) report(true, points.shape(0)); \
       build_index(coords); \
       nonuni2uni(forward, coords, points, uniform); \
       if (verbosity>0) timers.report(cout); \
       } \
     template<typename Tpoints, typename Tgrid> void u2nu(bool forward, size_t verbosity, \
-      const cmav<complex<Tgrid>,ndim> &uniform, const cmav<Tcoord,2> &coords, \
-      vmav<complex<Tpoints>,1> &points) \
+      const cmav<complex<Tgrid>,ndim+1> &uniform, const cmav<Tcoord,2> &coords, \
+      vmav<complex<Tpoints>,2> &points) \
       { \
       if (prep_u2nu(points, uniform)) return; \
       MR_assert(coords_sorted.size()==0, "bad call"); \
-      if (verbosity>0) report(false); \
+      if (verbosity>0) report(false, points.shape(0)); \
       build_index(coords); \
       uni2nonuni(forward, uniform, coords, points); \
       if (verbosity>0) timers.report(cout); \
+      } \
+    /* single-transform variants of the above */ \
+    template<typename Tpoints, typename Tgrid> void nu2u(bool forward, size_t verbosity, \
+      const cmav<complex<Tpoints>,1> &points, vmav<complex<Tgrid>,ndim> &uniform) \
+      { \
+      auto uniform2 = uniform.prepend_1(); \
+      nu2u(forward, verbosity, points.prepend_1(), uniform2); \
+      } \
+    template<typename Tpoints, typename Tgrid> void u2nu(bool forward, size_t verbosity, \
+      const cmav<complex<Tgrid>,ndim> &uniform, vmav<complex<Tpoints>,1> &points) \
+      { \
+      auto points2 = points.prepend_1(); \
+      u2nu(forward, verbosity, uniform.prepend_1(), points2); \
+      } \
+    template<typename Tpoints, typename Tgrid> void nu2u(bool forward, size_t verbosity, \
+      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,1> &points, \
+      vmav<complex<Tgrid>,ndim> &uniform) \
+      { \
+      auto uniform2 = uniform.prepend_1(); \
+      nu2u(forward, verbosity, coords, points.prepend_1(), uniform2); \
+      } \
+    template<typename Tpoints, typename Tgrid> void u2nu(bool forward, size_t verbosity, \
+      const cmav<complex<Tgrid>,ndim> &uniform, const cmav<Tcoord,2> &coords, \
+      vmav<complex<Tpoints>,1> &points) \
+      { \
+      auto points2 = points.prepend_1(); \
+      u2nu(forward, verbosity, uniform.prepend_1(), coords, points2); \
+      } \
+ \
+    /* Prepares apply_normal() for the normal operator A^H W A, where A is \
+       the u2nu transform in direction forward with the coordinates of this \
+       plan, and W the diagonal matrix of the given weights (the identity if \
+       weights is empty). The weights refer to the original point order. \
+       Afterwards, no spreading or interpolation is needed for applying the \
+       operator, only two FFTs on grids of about twice the uniform size. */ \
+    template<typename Tw> void prep_normal(bool forward, const cmav<Tw,1> &weights) \
+      { \
+      MR_assert(coords_sorted.size()!=0, "bad call"); \
+      bool weighted = weights.shape(0)!=0; \
+      MR_assert((!weighted) || (weights.shape(0)==npoints), \
+        "number of weights mismatch"); \
+      timers.push("normal operator kernel"); \
+      array<size_t,ndim> shp; \
+      for (size_t i=0; i<ndim; ++i) shp[i] = normal_length(nuni[i]); \
+      vmav<complex<Tcalc>,1> wgt({npoints}, UNINITIALIZED); \
+      execParallel(npoints, nthreads, [&](size_t lo, size_t hi) \
+        { \
+        for (size_t i=lo; i<hi; ++i) \
+          wgt(i) = weighted ? Tcalc(weights(point_index(i))) : Tcalc(1); \
+        }); \
+      auto krn2 = vmav<complex<Tcalc>,ndim>::build_noncritical(shp, UNINITIALIZED); \
+      { \
+      Nufft plan(true, coords_sorted, shp, epsilon, nthreads, sigma_min, \
+        sigma_max, 1./coordfct, true, lockfree_spreading); \
+      plan.nu2u(!forward, 0, wgt, krn2); \
+      } \
+      set_normal_kernel(krn2); \
+      timers.pop(); \
+      } \
+ \
+    /* Streaming interface for nu2u transforms of point sets which do not \
+       fit into memory at once: nu2u_add() spreads a chunk of nonuniform \
+       points onto an oversampled grid kept by the plan, nu2u_finish() \
+       carries out FFT and grid correction and releases the grid again. \
+       Only for plans constructed without coordinates; the number of points \
+       passed to the constructor is only used for choosing the parameters. */ \
+    template<typename Tpoints> void nu2u_add(const cmav<Tcoord,2> &coords, \
+      const cmav<complex<Tpoints>,2> &points) \
+      { \
+      static_assert(sizeof(Tpoints)<=sizeof(Tcalc), \
+        "Tcalc must be at least as accurate as Tpoints"); \
+      MR_assert(coords_sorted.size()==0, "bad call"); \
+      MR_assert(coords.shape(1)==ndim, "ndim mismatch"); \
+      MR_assert(points.shape(1)==coords.shape(0), "number of points mismatch"); \
+      size_t ntrans = points.shape(0); \
+      timers.push("nu2u accumulation"); \
+      if (accgrid.size()==0) \
+        { \
+        timers.push("allocating grid"); \
+        auto grid = vmav<complex<Tcalc>,ndim+1>::build_noncritical(oversampled_shape(ntrans), UNINITIALIZED); \
+        timers.poppush("zeroing grid"); \
+        mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid); \
+        accgrid.assign(grid); \
+        timers.pop(); \
+        } \
+      MR_assert(accgrid.shape(0)==ntrans, "number of transforms mismatch"); \
+      if (coords.shape(0)>0) \
+        { \
+        /* the index and spreading helpers work on the current chunk */ \
+        ValueGuard<size_t> chunk_npoints(npoints, coords.shape(0)); \
+        build_index(coords); \
+        timers.push("spreading"); \
+        spread_batch(coords, points, accgrid); \
+        timers.pop(); \
+        } \
+      timers.pop(); \
+      } \
+    template<typename Tgrid> void nu2u_finish(bool forward, size_t verbosity, \
+      vmav<complex<Tgrid>,ndim+1> &uniform) \
+      { \
+      static_assert(sizeof(Tgrid)<=sizeof(Tcalc), \
+        "Tcalc must be at least as accurate as Tgrid"); \
+      for (size_t i=0; i<ndim; ++i) \
+        MR_assert(uniform.shape(i+1)==nuni[i], "uniform grid dimensions mismatch"); \
+      if (accgrid.size()==0) /* no points were added */ \
+        { \
+        mav_apply([](complex<Tgrid> &v){v=complex<Tgrid>(0);}, nthreads, uniform); \
+        return; \
+        } \
+      MR_assert(uniform.shape(0)==accgrid.shape(0), \
+        "number of transforms mismatch"); \
+      if (verbosity>0) report(true, uniform.shape(0)); \
+      timers.push("nu2u proper"); \
+      grid2uniform(forward, accgrid, uniform); \
+      timers.pop(); \
+      accgrid.dealloc(); \
+      if (verbosity>0) timers.report(cout); \
+      } \
+    /* single-transform variants of the above */ \
+    template<typename Tpoints> void nu2u_add(const cmav<Tcoord,2> &coords, \
+      const cmav<complex<Tpoints>,1> &points) \
+      { nu2u_add(coords, points.prepend_1()); } \
+    template<typename Tgrid> void nu2u_finish(bool forward, size_t verbosity, \
+      vmav<complex<Tgrid>,ndim> &uniform) \
+      { \
+      auto uniform2 = uniform.prepend_1(); \
+      nu2u_finish(forward, verbosity, uniform2); \
+      } \
+ \
+  private: \
+    template<typename Tpoints, typename Tgrid> void nonuni2uni(bool forward, \
+      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,2> &points, \
+      vmav<complex<Tgrid>,ndim+1> &uniform) \
+      { \
+      size_t ntrans = points.shape(0); \
+      timers.push("nu2u proper"); \
+      timers.push("allocating grid"); \
+      auto grid = vmav<complex<Tcalc>,ndim+1>::build_noncritical(oversampled_shape(ntrans), UNINITIALIZED); \
+      timers.poppush("zeroing grid"); \
+      mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid); \
+      timers.poppush("spreading"); \
+      spread_batch(coords, points, grid); \
+      timers.pop(); \
+      grid2uniform(forward, grid, uniform); \
+      timers.pop(); \
+      } \
+    template<typename Tpoints, typename Tgrid> void uni2nonuni(bool forward, \
+      const cmav<complex<Tgrid>,ndim+1> &uniform, const cmav<Tcoord,2> &coords, \
+      vmav<complex<Tpoints>,2> &points) \
+      { \
+      size_t ntrans = points.shape(0); \
+      timers.push("u2nu proper"); \
+      timers.push("allocating grid"); \
+      auto grid = vmav<complex<Tcalc>,ndim+1>::build_noncritical(oversampled_shape(ntrans), UNINITIALIZED); \
+      timers.pop(); \
+      uniform2grid(forward, uniform, grid); \
+      timers.push("interpolation"); \
+      interpolate_batch(grid, coords, points); \
+      timers.pop(); \
+      timers.pop(); \
+      } \
+ \
+    /* A batch which is spread or interpolated in several blocks of \
+       transforms (see trans_block()) would evaluate the kernel once per \
+       point and block. If the plan does not store the kernel weights, they \
+       are therefore computed once and kept for the duration of the batch, \
+       unless they would need more memory than the oversampled grids of the \
+       batch. Returns true if this was done; the caller must then call \
+       release_batch_weights() afterwards. */ \
+    bool prep_batch_weights(size_t ntrans, size_t tblock) \
+      { \
+      if ((tblock>=ntrans) || (coords_sorted.size()==0) || (kweights.size()!=0)) \
+        return false; \
+      size_t wsize = npoints*(ndim*supp*sizeof(Tacc)+sizeof(array<int,ndim>)); \
+      size_t gsize = ntrans*sizeof(complex<Tcalc>); \
+      for (auto n: nover) gsize *= n; \
+      if (wsize>gsize) return false; \
+      precompute_kernel(coords_sorted); \
+      return true; \
+      } \
+    void release_batch_weights() \
+      { \
+      kweights.resize(0); \
+      /* start indices are still needed for converted coordinates */ \
+      if (kx.size()==0) kindex.resize(0); \
+      } \
+    template<typename Tpoints> void spread_batch(const cmav<Tcoord,2> &coords, \
+      const cmav<complex<Tpoints>,2> &points, vmav<complex<Tcalc>,ndim+1> &grid) \
+      { \
+      constexpr size_t maxsupp = is_same<Tacc, float>::value ? 8 : 16; \
+      size_t ntrans = points.shape(0); \
+      bool sorted = coords_sorted.size()!=0; \
+      /* the schedule only needs to be computed once for sorted coordinates */ \
+      if (lockfree_spreading && ((!sorted) || colour_ofs.empty())) \
+        build_tile_schedule(coords, sorted); \
+      size_t tblock = trans_block(ntrans, sizeof(complex<Tacc>)); \
+      bool tmpweights = prep_batch_weights(ntrans, tblock); \
+      ScopeExit release([&]{ if (tmpweights) release_batch_weights(); }); \
+      vector<slice> slc(ndim+1); \
+      for (size_t t0=0; t0<ntrans; t0+=tblock) \
+        { \
+        slc[0] = slice(t0, min(ntrans, t0+tblock)); \
+        auto points2 = subarray<2>(points, {slc[0], {}}); \
+        auto grid2 = subarray<ndim+1>(grid, slc); \
+        spreading_helper<maxsupp>(supp, coords, points2, grid2); \
+        } \
+      } \
+    template<typename Tpoints> void interpolate_batch( \
+      const cmav<complex<Tcalc>,ndim+1> &grid, const cmav<Tcoord,2> &coords, \
+      vmav<complex<Tpoints>,2> &points) \
+      { \
+      constexpr size_t maxsupp = is_same<Tcalc, float>::value ? 8 : 16; \
+      size_t ntrans = points.shape(0); \
+      size_t tblock = trans_block(ntrans, sizeof(complex<Tcalc>)); \
+      bool tmpweights = prep_batch_weights(ntrans, tblock); \
+      ScopeExit release([&]{ if (tmpweights) release_batch_weights(); }); \
+      vector<slice> slc(ndim+1); \
+      for (size_t t0=0; t0<ntrans; t0+=tblock) \
+        { \
+        slc[0] = slice(t0, min(ntrans, t0+tblock)); \
+        auto points2 = subarray<2>(points, {slc[0], {}}); \
+        auto grid2 = subarray<ndim+1>(grid, slc); \
+        interpolation_helper<maxsupp>(supp, grid2, coords, points2); \
+        } \
       }
 
 /*! Helper class for carrying out 1D nonuniform FFTs of types 1 and 2.
@@ -553,11 +1503,11 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
   DUCC0_NUFFT_BOILERPLATE
 
   private:
-    template<size_t supp> class HelperNu2u
+    template<size_t supp> class HelperNu2u: public Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tacc>
       {
       public:
-        static constexpr size_t vlen = mysimd<Tacc>::size();
-        static constexpr size_t nvec = (supp+vlen-1)/vlen;
+        using Tkbuf = typename Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tacc>;
+        using Tkbuf::vlen, Tkbuf::nvec;
 
       private:
         static constexpr int nsafe = (supp+1)/2;
@@ -565,14 +1515,13 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         static constexpr int suvec = su+vlen-1;
         static constexpr double xsupp=2./supp;
         const Nufft *parent;
-        TemplateKernel<supp, mysimd<Tacc>> tkrn;
         vmav<complex<Tcalc>,ndim> &grid;
         array<int,ndim> i0; // start index of the current nonuniform point
         array<int,ndim> b0; // start index of the current buffer
 
         vmav<Tacc,ndim> bufr, bufi;
         Tacc *px0r, *px0i;
-        Mutex &mylock;
+        Mutex *mylock; // null for lock-free spreading
 
         // add the acumulated local tile to the global oversampled grid
         DUCC0_NOINLINE void dump()
@@ -580,7 +1529,7 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           if (b0[0]<-nsafe) return; // nothing written into buffer yet
           int inu = int(parent->nover[0]);
           {
-          LockGuard lock(mylock);
+          OptionalLockGuard lock(mylock);
           for (int iu=0, idxu=(b0[0]+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
             {
             grid(idxu) += complex<Tcalc>(Tcalc(bufr(iu)), Tcalc(bufi(iu)));
@@ -591,31 +1540,21 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
       public:
         Tacc * DUCC0_RESTRICT p0r, * DUCC0_RESTRICT p0i;
-        union kbuf {
-          Tacc scalar[nvec*vlen];
-          mysimd<Tacc> simd[nvec];
-#if defined(_MSC_VER)
-          kbuf() {}
-#endif
-          };
-        kbuf buf;
 
         HelperNu2u(const Nufft *parent_, vmav<complex<Tcalc>,ndim> &grid_,
-          Mutex &mylock_)
-          : parent(parent_), tkrn(*parent->krn), grid(grid_),
+          Mutex *mylock_)
+          : Tkbuf(*parent_->krn), parent(parent_), grid(grid_),
             i0{-1000000}, b0{-1000000},
             bufr({size_t(suvec)}), bufi({size_t(suvec)}),
             px0r(bufr.data()), px0i(bufi.data()), mylock(mylock_) {}
         ~HelperNu2u() { dump(); }
 
-        [[gnu::always_inline]] [[gnu::hot]] void prep(array<double,ndim> in)
+        /*! Move to the point with start index \a i0new, whose kernel weights
+            have been computed by prep_point(). */
+        [[gnu::always_inline]] [[gnu::hot]] void update(const array<int,ndim> &i0new)
           {
-          array<double,ndim> frac;
-          auto i0old = i0;
-          parent->template getpix<Tcoord>(in, frac, i0);
-          auto x0 = -frac[0]*2+(supp-1);
-          tkrn.eval1(Tacc(x0), &buf.simd[0]);
-          if (i0==i0old) return;
+          if (i0new==i0) return;
+          i0 = i0new;
           if ((i0[0]<b0[0]) || (i0[0]+int(supp)>b0[0]+su))
             {
             dump();
@@ -625,13 +1564,14 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           p0r = px0r+ofs;
           p0i = px0i+ofs;
           }
+        const array<int,ndim> &index() const { return i0; }
       };
 
-    template<size_t supp> class HelperU2nu
+    template<size_t supp> class HelperU2nu: public Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tcalc>
       {
       public:
-        static constexpr size_t vlen = mysimd<Tcalc>::size();
-        static constexpr size_t nvec = (supp+vlen-1)/vlen;
+        using Tkbuf = typename Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tcalc>;
+        using Tkbuf::vlen, Tkbuf::nvec;
 
       private:
         static constexpr int nsafe = (supp+1)/2;
@@ -640,7 +1580,6 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         static constexpr double xsupp=2./supp;
         const Nufft *parent;
 
-        TemplateKernel<supp, mysimd<Tcalc>> tkrn;
         const cmav<complex<Tcalc>,ndim> &grid;
         array<int,ndim> i0; // start index of the current nonuniform point
         array<int,ndim> b0; // start index of the current buffer
@@ -658,29 +1597,19 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
       public:
         const Tcalc * DUCC0_RESTRICT p0r, * DUCC0_RESTRICT p0i;
-        union kbuf {
-          Tcalc scalar[nvec*vlen];
-          mysimd<Tcalc> simd[nvec];
-#if defined(_MSC_VER)
-          kbuf() {}
-#endif
-          };
-        kbuf buf;
 
         HelperU2nu(const Nufft *parent_, const cmav<complex<Tcalc>,ndim> &grid_)
-          : parent(parent_), tkrn(*parent->krn), grid(grid_),
+          : Tkbuf(*parent_->krn), parent(parent_), grid(grid_),
             i0{-1000000}, b0{-1000000},
             bufr({size_t(suvec)}), bufi({size_t(suvec)}),
             px0r(bufr.data()), px0i(bufi.data()) {}
 
-        [[gnu::always_inline]] [[gnu::hot]] void prep(array<double,ndim> in)
+        /*! Move to the point with start index \a i0new, whose kernel weights
+            have been computed by prep_point(). */
+        [[gnu::always_inline]] [[gnu::hot]] void update(const array<int,ndim> &i0new)
           {
-          array<double,ndim> frac;
-          auto i0old = i0;
-          parent->template getpix<Tcoord>(in, frac, i0);
-          auto x0 = -frac[0]*2+(supp-1);
-          tkrn.eval1(Tcalc(x0), &buf.simd[0]);
-          if (i0==i0old) return;
+          if (i0new==i0) return;
+          i0 = i0new;
           if ((i0[0]<b0[0]) || (i0[0]+int(supp)>b0[0]+su))
             {
             b0[0]=((((i0[0]+nsafe)>>log2tile)<<log2tile))-nsafe;
@@ -690,12 +1619,13 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           p0r = px0r+ofs;
           p0i = px0i+ofs;
           }
+        const array<int,ndim> &index() const { return i0; }
       };
 
     template<size_t SUPP, typename Tpoints> [[gnu::hot]] void spreading_helper
       (size_t supp, const cmav<Tcoord,2> &coords,
-      const cmav<complex<Tpoints>,1> &points,
-      vmav<complex<Tcalc>,ndim> &grid) const
+      const cmav<complex<Tpoints>,2> &points,
+      vmav<complex<Tcalc>,ndim+1> &grid) const
       {
       if constexpr (SUPP>=8)
         if (supp<=SUPP/2) return spreading_helper<SUPP/2>(supp, coords, points, grid);
@@ -703,48 +1633,60 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         if (supp<SUPP) return spreading_helper<SUPP-1>(supp, coords, points, grid);
       MR_assert(supp==SUPP, "requested support out of range");
       bool sorted = coords_sorted.size()!=0;
+      using Thlp = HelperNu2u<SUPP>;
+      size_t ntrans = points.shape(0);
+      auto grids = split_grid(grid);
 
-      Mutex mylock;
+      vector<Mutex> mylocks(lockfree_spreading ? 0 : ntrans);
 
-      size_t chunksz = max<size_t>(1000, npoints/(10*nthreads));
-      execDynamic(npoints, nthreads, chunksz, [&](Scheduler &sched)
+      spread_parallel([&](auto &&next)
         {
-        HelperNu2u<SUPP> hlp(this, grid, mylock);
-        const auto * DUCC0_RESTRICT ku = hlp.buf.simd;
+        // one helper per transform; kernel weights are only computed by the
+        // first one and shared with the others
+        vector<unique_ptr<Thlp>> hlp;
+        for (size_t t=0; t<ntrans; ++t)
+          hlp.push_back(make_unique<Thlp>(this, grids[t], lockfree_spreading ? nullptr : &mylocks[t]));
+        auto &lead(*hlp[0]);
+        const auto * DUCC0_RESTRICT ku = lead.buf.simd;
 
         constexpr size_t lookahead=10;
-        while (auto rng=sched.getNext()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
+        while (auto rng=next()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
           {
           if (ix+lookahead<npoints)
             {
-            auto nextidx = coord_idx[ix+lookahead];
-            DUCC0_PREFETCH_R(&points(nextidx));
-            if (!sorted)
-              DUCC0_PREFETCH_R(&coords(nextidx,0));
+            auto nextidx = point_index(ix+lookahead);
+            for (size_t t=0; t<ntrans; ++t)
+              DUCC0_PREFETCH_R(&points(t,nextidx));
+            if (!sorted) prefetch_coords(coords, nextidx);
             }
-          size_t row = coord_idx[ix];
-          sorted ? hlp.prep({coords(ix,0)}) : hlp.prep({coords(row,0)});
-          auto v(points(row));
-
-          Tacc vr(v.real()), vi(v.imag());
-          for (size_t cu=0; cu<hlp.nvec; ++cu)
+          size_t row = point_index(ix);
+          lead.update(prep_point(lead, coords, sorted, ix, row));
+          for (size_t t=0; t<ntrans; ++t)
             {
-            auto * DUCC0_RESTRICT pxr = hlp.p0r+cu*hlp.vlen;
-            auto * DUCC0_RESTRICT pxi = hlp.p0i+cu*hlp.vlen;
-            auto tr = mysimd<Tacc>(pxr,element_aligned_tag());
-            tr += vr*ku[cu];
-            tr.copy_to(pxr,element_aligned_tag());
-            auto ti = mysimd<Tacc>(pxi, element_aligned_tag());
-            ti += vi*ku[cu];
-            ti.copy_to(pxi,element_aligned_tag());
+            auto &h(*hlp[t]);
+            if (t>0) h.update(lead.index());
+            auto v(points(t,row));
+
+            Tacc vr(v.real()), vi(v.imag());
+            for (size_t cu=0; cu<Thlp::nvec; ++cu)
+              {
+              auto * DUCC0_RESTRICT pxr = h.p0r+cu*Thlp::vlen;
+              auto * DUCC0_RESTRICT pxi = h.p0i+cu*Thlp::vlen;
+              auto tr = mysimd<Tacc>(pxr,element_aligned_tag());
+              tr += vr*ku[cu];
+              tr.copy_to(pxr,element_aligned_tag());
+              auto ti = mysimd<Tacc>(pxi, element_aligned_tag());
+              ti += vi*ku[cu];
+              ti.copy_to(pxi,element_aligned_tag());
+              }
             }
           }
         });
       }
 
     template<size_t SUPP, typename Tpoints> [[gnu::hot]] void interpolation_helper
-      (size_t supp, const cmav<complex<Tcalc>,ndim> &grid,
-      const cmav<Tcoord,2> &coords, vmav<complex<Tpoints>,1> &points) const
+      (size_t supp, const cmav<complex<Tcalc>,ndim+1> &grid,
+      const cmav<Tcoord,2> &coords, vmav<complex<Tpoints>,2> &points) const
       {
       if constexpr (SUPP>=8)
         if (supp<=SUPP/2) return interpolation_helper<SUPP/2>(supp, grid, coords, points);
@@ -752,109 +1694,47 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         if (supp<SUPP) return interpolation_helper<SUPP-1>(supp, grid, coords, points);
       MR_assert(supp==SUPP, "requested support out of range");
       bool sorted = coords_sorted.size()!=0;
+      using Thlp = HelperU2nu<SUPP>;
+      size_t ntrans = points.shape(0);
+      auto grids = split_grid(grid);
 
       size_t chunksz = max<size_t>(1000, npoints/(10*nthreads));
       execDynamic(npoints, nthreads, chunksz, [&](Scheduler &sched)
         {
-        HelperU2nu<SUPP> hlp(this, grid);
-        const auto * DUCC0_RESTRICT ku = hlp.buf.simd;
+        vector<unique_ptr<Thlp>> hlp;
+        for (size_t t=0; t<ntrans; ++t)
+          hlp.push_back(make_unique<Thlp>(this, grids[t]));
+        auto &lead(*hlp[0]);
+        const auto * DUCC0_RESTRICT ku = lead.buf.simd;
 
         constexpr size_t lookahead=10;
         while (auto rng=sched.getNext()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
           {
           if (ix+lookahead<npoints)
             {
-            auto nextidx = coord_idx[ix+lookahead];
-            DUCC0_PREFETCH_W(&points(nextidx));
-            if (!sorted) DUCC0_PREFETCH_R(&coords(nextidx,0));
+            auto nextidx = point_index(ix+lookahead);
+            for (size_t t=0; t<ntrans; ++t)
+              DUCC0_PREFETCH_W(&points(t,nextidx));
+            if (!sorted) prefetch_coords(coords, nextidx);
             }
-          size_t row = coord_idx[ix];
-          sorted ? hlp.prep({coords(ix,0)})
-                 : hlp.prep({coords(row,0)});
-          mysimd<Tcalc> rr=0, ri=0;
-          for (size_t cu=0; cu<hlp.nvec; ++cu)
+          size_t row = point_index(ix);
+          lead.update(prep_point(lead, coords, sorted, ix, row));
+          for (size_t t=0; t<ntrans; ++t)
             {
-            const auto * DUCC0_RESTRICT pxr = hlp.p0r + cu*hlp.vlen;
-            const auto * DUCC0_RESTRICT pxi = hlp.p0i + cu*hlp.vlen;
-            rr += ku[cu]*mysimd<Tcalc>(pxr,element_aligned_tag());
-            ri += ku[cu]*mysimd<Tcalc>(pxi,element_aligned_tag());
+            auto &h(*hlp[t]);
+            if (t>0) h.update(lead.index());
+            mysimd<Tcalc> rr=0, ri=0;
+            for (size_t cu=0; cu<Thlp::nvec; ++cu)
+              {
+              const auto * DUCC0_RESTRICT pxr = h.p0r + cu*Thlp::vlen;
+              const auto * DUCC0_RESTRICT pxi = h.p0i + cu*Thlp::vlen;
+              rr += ku[cu]*mysimd<Tcalc>(pxr,element_aligned_tag());
+              ri += ku[cu]*mysimd<Tcalc>(pxi,element_aligned_tag());
+              }
+            points(t,row) = hsum_cmplx<Tcalc>(rr,ri);
             }
-          points(row) = hsum_cmplx<Tcalc>(rr,ri);
-          }
-        });
-      }
-
-    template<typename Tpoints, typename Tgrid> void nonuni2uni(bool forward,
-      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,1> &points,
-      vmav<complex<Tgrid>,ndim> &uniform)
-      {
-      timers.push("nu2u proper");
-      timers.push("allocating grid");
-      auto grid = vmav<complex<Tcalc>,ndim>::build_noncritical(nover, UNINITIALIZED);
-      timers.poppush("zeroing grid");
-      mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid);
-      timers.poppush("spreading");
-      constexpr size_t maxsupp = is_same<Tacc, float>::value ? 8 : 16;
-      spreading_helper<maxsupp>(supp, coords, points, grid);
-      timers.poppush("FFT");
-      vfmav<complex<Tcalc>> fgrid(grid);
-      c2c(fgrid, fgrid, {0}, forward, Tcalc(1), nthreads);
-      timers.poppush("grid correction");
-      execParallel(nuni[0], nthreads, [&](size_t lo, size_t hi)
-        {
-        for (auto i=lo; i<hi; ++i)
-          {
-          auto [icfu, iout, iin] = comp_indices(i, nuni[0], nover[0], fft_order);
-          uniform(iout) = complex<Tgrid>(grid(iin)*Tcalc(corfac[0][icfu]));
-          }
-        });
-      timers.pop();
-      timers.pop();
-      }
-
-    template<typename Tpoints, typename Tgrid> void uni2nonuni(bool forward,
-      const cmav<complex<Tgrid>,ndim> &uniform, const cmav<Tcoord,2> &coords,
-      vmav<complex<Tpoints>,1> &points)
-      {
-      timers.push("u2nu proper");
-      timers.push("allocating grid");
-      auto grid = vmav<complex<Tcalc>,ndim>::build_noncritical(nover, UNINITIALIZED);
-      timers.poppush("zeroing grid");
-      mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid);
-      timers.poppush("grid correction");
-      execParallel(nuni[0], nthreads, [&](size_t lo, size_t hi)
-        {
-        for (auto i=lo; i<hi; ++i)
-          {
-          auto [icfu, iin, iout] = comp_indices(i, nuni[0], nover[0], fft_order);
-          grid(iout) = complex<Tcalc>(uniform(iin))*Tcalc(corfac[0][icfu]);
           }
         });
-      timers.poppush("FFT");
-      vfmav<complex<Tcalc>> fgrid(grid);
-      c2c(fgrid, fgrid, {0}, forward, Tcalc(1), nthreads);
-      timers.poppush("interpolation");
-      constexpr size_t maxsupp = is_same<Tcalc, float>::value ? 8 : 16;
-      interpolation_helper<maxsupp>(supp, grid, coords, points);
-      timers.pop();
-      timers.pop();
-      }
-
-    void build_index(const cmav<Tcoord,2> &coords)
-      {
-      timers.push("building index");
-      MR_assert(coords.shape(0)==npoints, "number of coords mismatch");
-      MR_assert(coords.shape(1)==ndim, "ndim mismatch");
-      size_t ntiles_u = (nover[0]>>log2tile) + 3;
-      coord_idx.resize(npoints);
-      quick_array<uint32_t> key(npoints);
-      execParallel(npoints, nthreads, [&](size_t lo, size_t hi)
-        {
-        for (size_t i=lo; i<hi; ++i)
-          key[i] = parent::template get_tile<Tcoord>({coords(i,0)})[0];
-        });
-      bucket_sort2(key, coord_idx, ntiles_u, nthreads);
-      timers.pop();
       }
   };
 
@@ -865,25 +1745,24 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
   DUCC0_NUFFT_BOILERPLATE
 
-    template<size_t supp> class HelperNu2u
+    template<size_t supp> class HelperNu2u: public Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tacc>
       {
       public:
-        static constexpr size_t vlen = mysimd<Tacc>::size();
-        static constexpr size_t nvec = (supp+vlen-1)/vlen;
+        using Tkbuf = typename Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tacc>;
+        using Tkbuf::vlen, Tkbuf::nvec;
 
       private:
         static constexpr int nsafe = (supp+1)/2;
         static constexpr int su = supp+(1<<log2tile), sv = su;
         static constexpr double xsupp=2./supp;
         const Nufft *parent;
-        TemplateKernel<supp, mysimd<Tacc>> tkrn;
         vmav<complex<Tcalc>,ndim> &grid;
         array<int,ndim> i0; // start index of the current nonuniform point
         array<int,ndim> b0; // start index of the current buffer
 
         vmav<complex<Tacc>,ndim> gbuf;
         complex<Tacc> *px0;
-        vector<Mutex> &locks;
+        vector<Mutex> *locks; // null for lock-free spreading
 
         DUCC0_NOINLINE void dump()
           {
@@ -894,7 +1773,7 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           int idxv0 = (b0[1]+inv)%inv;
           for (int iu=0, idxu=(b0[0]+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
             {
-            LockGuard lock(locks[idxu]);
+            OptionalLockGuard lock(locks ? &(*locks)[idxu] : nullptr);
             for (int iv=0, idxv=idxv0; iv<sv; ++iv, idxv=(idxv+1<inv)?(idxv+1):0)
               {
               grid(idxu,idxv) += complex<Tcalc>(gbuf(iu,iv));
@@ -905,34 +1784,23 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
       public:
         complex<Tacc> * DUCC0_RESTRICT p0;
-        union kbuf {
-          Tacc scalar[2*nvec*vlen];
-          mysimd<Tacc> simd[2*nvec];
-#if defined(_MSC_VER)
-          kbuf() {}
-#endif
-          };
-        kbuf buf;
 
         HelperNu2u(const Nufft *parent_, vmav<complex<Tcalc>,ndim> &grid_,
-          vector<Mutex> &locks_)
-          : parent(parent_), tkrn(*parent->krn), grid(grid_),
+          vector<Mutex> *locks_)
+          : Tkbuf(*parent_->krn), parent(parent_), grid(grid_),
             i0{-1000000, -1000000}, b0{-1000000, -1000000},
             gbuf({size_t(su+1),size_t(sv)}),
             px0(gbuf.data()), locks(locks_) {}
         ~HelperNu2u() { dump(); }
 
-        constexpr int lineJump() const { return sv; }
+        static constexpr int lineJump() { return sv; }
 
-        [[gnu::always_inline]] [[gnu::hot]] void prep(array<double,ndim> in)
+        /*! Move to the point with start index \a i0new, whose kernel weights
+            have been computed by prep_point(). */
+        [[gnu::always_inline]] [[gnu::hot]] void update(const array<int,ndim> &i0new)
           {
-          array<double,ndim> frac;
-          auto i0old = i0;
-          parent->template getpix<Tcoord>(in, frac, i0);
-          auto x0 = -frac[0]*2+(supp-1);
-          auto y0 = -frac[1]*2+(supp-1);
-          tkrn.eval2(Tacc(x0), Tacc(y0), &buf.simd[0]);
-          if (i0==i0old) return;
+          if (i0new==i0) return;
+          i0 = i0new;
           if ((i0[0]<b0[0]) || (i0[1]<b0[1]) || (i0[0]+int(supp)>b0[0]+su) || (i0[1]+int(supp)>b0[1]+sv))
             {
             dump();
@@ -941,13 +1809,14 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
             }
           p0 = px0 + (i0[0]-b0[0])*sv + i0[1]-b0[1];
           }
+        const array<int,ndim> &index() const { return i0; }
       };
 
-    template<size_t supp> class HelperU2nu
+    template<size_t supp> class HelperU2nu: public Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tcalc>
       {
       public:
-        static constexpr size_t vlen = mysimd<Tcalc>::size();
-        static constexpr size_t nvec = (supp+vlen-1)/vlen;
+        using Tkbuf = typename Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tcalc>;
+        using Tkbuf::vlen, Tkbuf::nvec;
 
       private:
         static constexpr int nsafe = (supp+1)/2;
@@ -956,7 +1825,6 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         static constexpr double xsupp=2./supp;
         const Nufft *parent;
 
-        TemplateKernel<supp, mysimd<Tcalc>> tkrn;
         const cmav<complex<Tcalc>,ndim> &grid;
         array<int,ndim> i0; // start index of the current nonuniform point
         array<int,ndim> b0; // start index of the current buffer
@@ -979,32 +1847,21 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
       public:
         const Tcalc * DUCC0_RESTRICT p0r, * DUCC0_RESTRICT p0i;
-        union kbuf {
-          Tcalc scalar[2*nvec*vlen];
-          mysimd<Tcalc> simd[2*nvec];
-#if defined(_MSC_VER)
-          kbuf() {}
-#endif
-          };
-        kbuf buf;
 
         HelperU2nu(const Nufft *parent_, const cmav<complex<Tcalc>,ndim> &grid_)
-          : parent(parent_), tkrn(*parent->krn), grid(grid_),
+          : Tkbuf(*parent_->krn), parent(parent_), grid(grid_),
             i0{-1000000, -1000000}, b0{-1000000, -1000000},
             bufri({size_t(2*su+1),size_t(svvec)}),
             px0r(bufri.data()), px0i(bufri.data()+svvec) {}
 
-        constexpr int lineJump() const { return 2*svvec; }
+        static constexpr int lineJump() { return 2*svvec; }
 
-        [[gnu::always_inline]] [[gnu::hot]] void prep(array<double,ndim> in)
+        /*! Move to the point with start index \a i0new, whose kernel weights
+            have been computed by prep_point(). */
+        [[gnu::always_inline]] [[gnu::hot]] void update(const array<int,ndim> &i0new)
           {
-          array<double,ndim> frac;
-          auto i0old = i0;
-          parent->template getpix<Tcoord>(in, frac, i0);
-          auto x0 = -frac[0]*2+(supp-1);
-          auto y0 = -frac[1]*2+(supp-1);
-          tkrn.eval2(Tcalc(x0), Tcalc(y0), &buf.simd[0]);
-          if (i0==i0old) return;
+          if (i0new==i0) return;
+          i0 = i0new;
           if ((i0[0]<b0[0]) || (i0[1]<b0[1]) || (i0[0]+int(supp)>b0[0]+su) || (i0[1]+int(supp)>b0[1]+sv))
             {
             b0[0]=((((i0[0]+nsafe)>>log2tile)<<log2tile))-nsafe;
@@ -1015,6 +1872,7 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           p0r = px0r+ofs;
           p0i = px0i+ofs;
           }
+        const array<int,ndim> &index() const { return i0; }
       };
 
 #if 0
@@ -1058,12 +1916,12 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           {
           if (ix+lookahead<coord_idx.size())
             {
-            auto nextidx = coord_idx[ix+lookahead];
+            auto nextidx = point_index(ix+lookahead);
             DUCC0_PREFETCH_R(&points(nextidx));
             if (!sorted)
               for (size_t d=0; d<ndim; ++d) DUCC0_PREFETCH_R(&coords(nextidx,d));
             }
-          size_t row = coord_idx[ix];
+          size_t row = point_index(ix);
           sorted ? hlp.prep({coords(ix,0), coords(ix,1)})
                  : hlp.prep({coords(row,0), coords(row,1)});
           complex<Tacc> v(points(row));
@@ -1091,8 +1949,8 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
     template<size_t SUPP, typename Tpoints> [[gnu::hot]] void spreading_helper
       (size_t supp, const cmav<Tcoord,2> &coords,
-      const cmav<complex<Tpoints>,1> &points,
-      vmav<complex<Tcalc>,ndim> &grid) const
+      const cmav<complex<Tpoints>,2> &points,
+      vmav<complex<Tcalc>,ndim+1> &grid) const
       {
       if constexpr (SUPP>=8)
         if (supp<=SUPP/2) return spreading_helper<SUPP/2>(supp, coords, points, grid);
@@ -1100,54 +1958,66 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         if (supp<SUPP) return spreading_helper<SUPP-1>(supp, coords, points, grid);
       MR_assert(supp==SUPP, "requested support out of range");
       bool sorted = coords_sorted.size()!=0;
+      using Thlp = HelperNu2u<SUPP>;
+      size_t ntrans = points.shape(0);
+      auto grids = split_grid(grid);
 
-      vector<mutex> locks(nover[0]);
+      vector<vector<Mutex>> locks(lockfree_spreading ? 0 : ntrans);
+      for (auto &l: locks) l = vector<Mutex>(nover[0]);
 
-      size_t chunksz = max<size_t>(1000, coord_idx.size()/(10*nthreads));
-      execDynamic(coord_idx.size(), nthreads, chunksz, [&](Scheduler &sched)
+      spread_parallel([&](auto &&next)
         {
-        HelperNu2u<SUPP> hlp(this, grid, locks);
-        constexpr auto jump = hlp.lineJump();
-        const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
-        const auto * DUCC0_RESTRICT kv = hlp.buf.scalar+hlp.nvec*hlp.vlen;
-        constexpr size_t NVEC2 = (2*SUPP+hlp.vlen-1)/hlp.vlen;
+        // one helper per transform; kernel weights are only computed by the
+        // first one and shared with the others
+        vector<unique_ptr<Thlp>> hlp;
+        for (size_t t=0; t<ntrans; ++t)
+          hlp.push_back(make_unique<Thlp>(this, grids[t], lockfree_spreading ? nullptr : &locks[t]));
+        auto &lead(*hlp[0]);
+        constexpr auto jump = Thlp::lineJump();
+        const auto * DUCC0_RESTRICT ku = lead.buf.scalar;
+        const auto * DUCC0_RESTRICT kv = lead.buf.scalar+Thlp::nvec*Thlp::vlen;
+        constexpr size_t NVEC2 = (2*SUPP+Thlp::vlen-1)/Thlp::vlen;
         array<complex<Tacc>,SUPP> cdata;
         array<mysimd<Tacc>,NVEC2> vdata;
         for (size_t i=0; i<vdata.size(); ++i) vdata[i]=0;
 
         constexpr size_t lookahead=3;
-        while (auto rng=sched.getNext()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
+        while (auto rng=next()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
           {
           if (ix+lookahead<coord_idx.size())
             {
-            auto nextidx = coord_idx[ix+lookahead];
-            DUCC0_PREFETCH_R(&points(nextidx));
-            if (!sorted)
-              for (size_t d=0; d<ndim; ++d) DUCC0_PREFETCH_R(&coords(nextidx,d));
+            auto nextidx = point_index(ix+lookahead);
+            for (size_t t=0; t<ntrans; ++t)
+              DUCC0_PREFETCH_R(&points(t,nextidx));
+            if (!sorted) prefetch_coords(coords, nextidx);
             }
-          size_t row = coord_idx[ix];
-          sorted ? hlp.prep({coords(ix,0), coords(ix,1)})
-                 : hlp.prep({coords(row,0), coords(row,1)});
-          complex<Tacc> v(points(row));
+          size_t row = point_index(ix);
+          lead.update(prep_point(lead, coords, sorted, ix, row));
+          for (size_t t=0; t<ntrans; ++t)
+            {
+            auto &h(*hlp[t]);
+            if (t>0) h.update(lead.index());
+            complex<Tacc> v(points(t,row));
 
-          for (size_t cv=0; cv<SUPP; ++cv)
-            cdata[cv] = kv[cv]*v;
+            for (size_t cv=0; cv<SUPP; ++cv)
+              cdata[cv] = kv[cv]*v;
 
-          // really ugly, but attemps with type-punning via union fail on some platforms
-          memcpy(reinterpret_cast<void *>(vdata.data()),
-                 reinterpret_cast<const void *>(cdata.data()),
-                 SUPP*sizeof(complex<Tacc>));
+            // really ugly, but attemps with type-punning via union fail on some platforms
+            memcpy(reinterpret_cast<void *>(vdata.data()),
+                   reinterpret_cast<const void *>(cdata.data()),
+                   SUPP*sizeof(complex<Tacc>));
 
-          Tacc * DUCC0_RESTRICT xpx = reinterpret_cast<Tacc *>(hlp.p0);
-          for (size_t cu=0; cu<SUPP; ++cu)
-            {
-            Tacc tmpx=ku[cu];
-            for (size_t cv=0; cv<NVEC2; ++cv)
+            Tacc * DUCC0_RESTRICT xpx = reinterpret_cast<Tacc *>(h.p0);
+            for (size_t cu=0; cu<SUPP; ++cu)
               {
-              auto * DUCC0_RESTRICT px = xpx+cu*2*jump+cv*hlp.vlen;
-              auto tval = mysimd<Tacc>(px,element_aligned_tag());
-              tval += tmpx*vdata[cv];
-              tval.copy_to(px,element_aligned_tag());
+              Tacc tmpx=ku[cu];
+              for (size_t cv=0; cv<NVEC2; ++cv)
+                {
+                auto * DUCC0_RESTRICT px = xpx+cu*2*jump+cv*Thlp::vlen;
+                auto tval = mysimd<Tacc>(px,element_aligned_tag());
+                tval += tmpx*vdata[cv];
+                tval.copy_to(px,element_aligned_tag());
+                }
               }
             }
           }
@@ -1157,8 +2027,8 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 #endif
 
     template<size_t SUPP, typename Tpoints> [[gnu::hot]] void interpolation_helper
-      (size_t supp, const cmav<complex<Tcalc>,ndim> &grid,
-      const cmav<Tcoord,2> &coords, vmav<complex<Tpoints>,1> &points) const
+      (size_t supp, const cmav<complex<Tcalc>,ndim+1> &grid,
+      const cmav<Tcoord,2> &coords, vmav<complex<Tpoints>,2> &points) const
       {
       if constexpr (SUPP>=8)
         if (supp<=SUPP/2) return interpolation_helper<SUPP/2>(supp, grid, coords, points);
@@ -1166,170 +2036,71 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         if (supp<SUPP) return interpolation_helper<SUPP-1>(supp, grid, coords, points);
       MR_assert(supp==SUPP, "requested support out of range");
       bool sorted = coords_sorted.size()!=0;
+      using Thlp = HelperU2nu<SUPP>;
+      size_t ntrans = points.shape(0);
+      auto grids = split_grid(grid);
 
       size_t chunksz = max<size_t>(1000, coord_idx.size()/(10*nthreads));
       execDynamic(npoints, nthreads, chunksz, [&](Scheduler &sched)
         {
-        HelperU2nu<SUPP> hlp(this, grid);
-        constexpr int jump = hlp.lineJump();
-        const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
-        const auto * DUCC0_RESTRICT kv = hlp.buf.simd+hlp.nvec;
+        vector<unique_ptr<Thlp>> hlp;
+        for (size_t t=0; t<ntrans; ++t)
+          hlp.push_back(make_unique<Thlp>(this, grids[t]));
+        auto &lead(*hlp[0]);
+        constexpr int jump = Thlp::lineJump();
+        const auto * DUCC0_RESTRICT ku = lead.buf.scalar;
+        const auto * DUCC0_RESTRICT kv = lead.buf.simd+Thlp::nvec;
 
         constexpr size_t lookahead=3;
         while (auto rng=sched.getNext()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
           {
           if (ix+lookahead<npoints)
             {
-            auto nextidx = coord_idx[ix+lookahead];
-            DUCC0_PREFETCH_W(&points(nextidx));
-            if (!sorted)
-              for (size_t d=0; d<ndim; ++d) DUCC0_PREFETCH_R(&coords(nextidx,d));
+            auto nextidx = point_index(ix+lookahead);
+            for (size_t t=0; t<ntrans; ++t)
+              DUCC0_PREFETCH_W(&points(t,nextidx));
+            if (!sorted) prefetch_coords(coords, nextidx);
             }
-          size_t row = coord_idx[ix];
-          sorted ? hlp.prep({coords(ix,0), coords(ix,1)})
-                 : hlp.prep({coords(row,0), coords(row,1)});
-          mysimd<Tcalc> rr=0, ri=0;
-          if constexpr (hlp.nvec==1)
+          size_t row = point_index(ix);
+          lead.update(prep_point(lead, coords, sorted, ix, row));
+          for (size_t t=0; t<ntrans; ++t)
             {
-            for (size_t cu=0; cu<SUPP; ++cu)
+            auto &h(*hlp[t]);
+            if (t>0) h.update(lead.index());
+            mysimd<Tcalc> rr=0, ri=0;
+            if constexpr (Thlp::nvec==1)
               {
-              const auto * DUCC0_RESTRICT pxr = hlp.p0r + cu*jump;
-              const auto * DUCC0_RESTRICT pxi = hlp.p0i + cu*jump;
-              rr += mysimd<Tcalc>(pxr,element_aligned_tag())*ku[cu];
-              ri += mysimd<Tcalc>(pxi,element_aligned_tag())*ku[cu];
+              for (size_t cu=0; cu<SUPP; ++cu)
+                {
+                const auto * DUCC0_RESTRICT pxr = h.p0r + cu*jump;
+                const auto * DUCC0_RESTRICT pxi = h.p0i + cu*jump;
+                rr += mysimd<Tcalc>(pxr,element_aligned_tag())*ku[cu];
+                ri += mysimd<Tcalc>(pxi,element_aligned_tag())*ku[cu];
+                }
+              rr *= kv[0];
+              ri *= kv[0];
               }
-            rr *= kv[0];
-            ri *= kv[0];
-            }
-          else
-            {
-            for (size_t cu=0; cu<SUPP; ++cu)
+            else
               {
-              mysimd<Tcalc> tmpr(0), tmpi(0);
-              for (size_t cv=0; cv<hlp.nvec; ++cv)
+              for (size_t cu=0; cu<SUPP; ++cu)
                 {
-                const auto * DUCC0_RESTRICT pxr = hlp.p0r + cu*jump + hlp.vlen*cv;
-                const auto * DUCC0_RESTRICT pxi = hlp.p0i + cu*jump + hlp.vlen*cv;
-                tmpr += kv[cv]*mysimd<Tcalc>(pxr,element_aligned_tag());
-                tmpi += kv[cv]*mysimd<Tcalc>(pxi,element_aligned_tag());
+                mysimd<Tcalc> tmpr(0), tmpi(0);
+                for (size_t cv=0; cv<Thlp::nvec; ++cv)
+                  {
+                  const auto * DUCC0_RESTRICT pxr = h.p0r + cu*jump + Thlp::vlen*cv;
+                  const auto * DUCC0_RESTRICT pxi = h.p0i + cu*jump + Thlp::vlen*cv;
+                  tmpr += kv[cv]*mysimd<Tcalc>(pxr,element_aligned_tag());
+                  tmpi += kv[cv]*mysimd<Tcalc>(pxi,element_aligned_tag());
+                  }
+                rr += ku[cu]*tmpr;
+                ri += ku[cu]*tmpi;
                 }
-              rr += ku[cu]*tmpr;
-              ri += ku[cu]*tmpi;
               }
+            points(t,row) = hsum_cmplx<Tcalc>(rr,ri);
             }
-          points(row) = hsum_cmplx<Tcalc>(rr,ri);
           }
         });
       }
-
-    template<typename Tpoints, typename Tgrid> void nonuni2uni(bool forward,
-      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,1> &points,
-      vmav<complex<Tgrid>,ndim> &uniform)
-      {
-      timers.push("nu2u proper");
-      timers.push("allocating grid");
-      auto grid = vmav<complex<Tcalc>,ndim>::build_noncritical(nover, UNINITIALIZED);
-      timers.poppush("zeroing grid");
-      mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid);
-      timers.poppush("spreading");
-      constexpr size_t maxsupp = is_same<Tacc, float>::value ? 8 : 16;
-      spreading_helper<maxsupp>(supp, coords, points, grid);
-
-      timers.poppush("FFT");
-      {
-      vfmav<complex<Tcalc>> fgrid(grid);
-      c2c(fgrid, fgrid, {1}, forward, Tcalc(1), nthreads);
-      auto fgridl=fgrid.subarray({{},{0,(nuni[1]+1)/2}});
-      c2c(fgridl, fgridl, {0}, forward, Tcalc(1), nthreads);
-      if (nuni[1]>1)
-        {
-        auto fgridh=fgrid.subarray({{},{fgrid.shape(1)-nuni[1]/2,MAXIDX}});
-        c2c(fgridh, fgridh, {0}, forward, Tcalc(1), nthreads);
-        }
-      }
-      timers.poppush("grid correction");
-      execParallel(nuni[0], nthreads, [&](size_t lo, size_t hi)
-        {
-        for (auto i=lo; i<hi; ++i)
-          {
-          auto [icfu, iout, iin] = comp_indices(i, nuni[0], nover[0], fft_order);
-          for (size_t j=0; j<nuni[1]; ++j)
-            {
-            auto [icfv, jout, jin] = comp_indices(j, nuni[1], nover[1], fft_order);
-            uniform(iout,jout) = complex<Tgrid>(grid(iin,jin)
-              *Tcalc(corfac[0][icfu]*corfac[1][icfv]));
-            }
-          }
-        });
-      timers.pop();
-      timers.pop();
-      }
-
-    template<typename Tpoints, typename Tgrid> void uni2nonuni(bool forward,
-      const cmav<complex<Tgrid>,ndim> &uniform, const cmav<Tcoord,2> &coords,
-      vmav<complex<Tpoints>,1> &points)
-      {
-      timers.push("u2nu proper");
-      timers.push("allocating grid");
-      auto grid = vmav<complex<Tcalc>,ndim>::build_noncritical(nover, UNINITIALIZED);
-      timers.poppush("zeroing grid");
-
-      // only zero the parts of the grid that are not filled afterwards anyway
-      { auto a0 = subarray<2>(grid, {{0,(nuni[0]+1)/2}, {nuni[1]/2,nover[1]-nuni[1]/2}}); quickzero(a0, nthreads); }
-      { auto a0 = subarray<2>(grid, {{(nuni[0]+1)/2, nover[0]-nuni[0]/2}, {}}); quickzero(a0, nthreads); }
-      if (nuni[0]>1)
-        { auto a0 = subarray<2>(grid, {{nover[0]-nuni[0]/2,MAXIDX}, {nuni[1]/2, nover[1]-nuni[1]/2+1}}); quickzero(a0, nthreads); }
-      timers.poppush("grid correction");
-      execParallel(nuni[0], nthreads, [&](size_t lo, size_t hi)
-        {
-        for (auto i=lo; i<hi; ++i)
-          {
-          auto [icfu, iin, iout] = comp_indices(i, nuni[0], nover[0], fft_order);
-          for (size_t j=0; j<nuni[1]; ++j)
-            {
-            auto [icfv, jin, jout] = comp_indices(j, nuni[1], nover[1], fft_order);
-            grid(iout,jout) = complex<Tcalc>(uniform(iin,jin))
-              *Tcalc(corfac[0][icfu]*corfac[1][icfv]);
-            }
-          }
-        });
-      timers.poppush("FFT");
-      {
-      vfmav<complex<Tcalc>> fgrid(grid);
-      auto fgridl=fgrid.subarray({{},{0,(nuni[1]+1)/2}});
-      c2c(fgridl, fgridl, {0}, forward, Tcalc(1), nthreads);
-      if (nuni[1]>1)
-        {
-        auto fgridh=fgrid.subarray({{},{fgrid.shape(1)-nuni[1]/2,MAXIDX}});
-        c2c(fgridh, fgridh, {0}, forward, Tcalc(1), nthreads);
-        }
-      c2c(fgrid, fgrid, {1}, forward, Tcalc(1), nthreads);
-      }
-      timers.poppush("interpolation");
-      constexpr size_t maxsupp = is_same<Tcalc, float>::value ? 8 : 16;
-      interpolation_helper<maxsupp>(supp, grid, coords, points);
-      timers.pop();
-      timers.pop();
-      }
-
-    void build_index(const cmav<Tcoord,2> &coords)
-      {
-      timers.push("building index");
-      size_t ntiles_u = (nover[0]>>log2tile) + 3;
-      size_t ntiles_v = (nover[1]>>log2tile) + 3;
-      coord_idx.resize(npoints);
-      quick_array<uint32_t> key(npoints);
-      execParallel(npoints, nthreads, [&](size_t lo, size_t hi)
-        {
-        for (size_t i=lo; i<hi; ++i)
-          {
-          auto tile = parent::template get_tile<Tcoord>({coords(i,0), coords(i,1)});
-          key[i] = tile[0]*ntiles_v + tile[1];
-          }
-        });
-      bucket_sort2(key, coord_idx, ntiles_u*ntiles_v, nthreads);
-      timers.pop();
-      }
   };
 
 template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc, Tcoord, 3>: public Nufft_ancestor<Tcalc, Tacc, 3>
@@ -1339,18 +2110,17 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
   DUCC0_NUFFT_BOILERPLATE
 
-    template<size_t supp> class HelperNu2u
+    template<size_t supp> class HelperNu2u: public Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tacc>
       {
       public:
-        static constexpr size_t vlen = mysimd<Tacc>::size();
-        static constexpr size_t nvec = (supp+vlen-1)/vlen;
+        using Tkbuf = typename Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tacc>;
+        using Tkbuf::vlen, Tkbuf::nvec;
 
       private:
         static constexpr int nsafe = (supp+1)/2;
         static constexpr int su = supp+(1<<log2tile), sv = su, sw = su;
         static constexpr double xsupp=2./supp;
         const Nufft *parent;
-        TemplateKernel<supp, mysimd<Tacc>> tkrn;
         vmav<complex<Tcalc>,ndim> &grid;
         array<int,ndim> i0; // start index of the current nonuniform point
         array<int,ndim> b0; // start index of the current buffer
@@ -1360,7 +2130,7 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
         vmav<complex<Tacc>,ndim> gbuf;
         complex<Tacc> *px0;
-        vector<Mutex> &locks;
+        vector<Mutex> *locks; // null for lock-free spreading
 
         DUCC0_NOINLINE void dump()
           {
@@ -1374,7 +2144,7 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           int idxw0 = (imin[2]+b0[2]+inw)%inw;
           for (int iu=imin[0], idxu=(imin[0]+b0[0]+inu)%inu; iu<imax[0]; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
             {
-            LockGuard lock(locks[idxu]);
+            OptionalLockGuard lock(locks ? &(*locks)[idxu] : nullptr);
             for (int iv=imin[1], idxv=idxv0; iv<imax[1]; ++iv, idxv=(idxv+1<inv)?(idxv+1):0)
               for (int iw=imin[2], idxw=idxw0; iw<imax[2]; ++iw, idxw=(idxw+1<inw)?(idxw+1):0)
                 {
@@ -1389,7 +2159,7 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           int idxw0 = (b0[2]+inw)%inw;
           for (int iu=0, idxu=(b0[0]+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
             {
-            LockGuard lock(locks[idxu]);
+            OptionalLockGuard lock(locks ? &(*locks)[idxu] : nullptr);
             for (int iv=0, idxv=idxv0; iv<sv; ++iv, idxv=(idxv+1<inv)?(idxv+1):0)
               for (int iw=0, idxw=idxw0; iw<sw; ++iw, idxw=(idxw+1<inw)?(idxw+1):0)
                 {
@@ -1403,18 +2173,10 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
       public:
         complex<Tacc> * DUCC0_RESTRICT p0;
-        union kbuf {
-          Tacc scalar[3*nvec*vlen];
-          mysimd<Tacc> simd[3*nvec];
-#if defined(_MSC_VER)
-          kbuf() {}
-#endif
-          };
-        kbuf buf;
 
         HelperNu2u(const Nufft *parent_, vmav<complex<Tcalc>,ndim> &grid_,
-          vector<Mutex> &locks_)
-          : parent(parent_), tkrn(*parent->krn), grid(grid_),
+          vector<Mutex> *locks_)
+          : Tkbuf(*parent_->krn), parent(parent_), grid(grid_),
             i0{-1000000, -1000000, -1000000}, b0{-1000000, -1000000, -1000000},
 #ifdef NEW_DUMP
             imin{1000,1000,1000},imax{-1000,-1000,-1000},
@@ -1423,20 +2185,15 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
             px0(gbuf.data()), locks(locks_) {}
         ~HelperNu2u() { dump(); }
 
-        constexpr int lineJump() const { return sw; }
-        constexpr int planeJump() const { return sv*sw; }
+        static constexpr int lineJump() { return sw; }
+        static constexpr int planeJump() { return sv*sw; }
 
-        [[gnu::always_inline]] [[gnu::hot]] void prep(array<double,ndim> in)
+        /*! Move to the point with start index \a i0new, whose kernel weights
+            have been computed by prep_point(). */
+        [[gnu::always_inline]] [[gnu::hot]] void update(const array<int,ndim> &i0new)
           {
-          array<double,ndim> frac;
-          
-          auto i0old = i0;
-          parent->template getpix<Tcoord>(in, frac, i0);
-          auto x0 = -frac[0]*2+(supp-1);
-          auto y0 = -frac[1]*2+(supp-1);
-          auto z0 = -frac[2]*2+(supp-1);
-          tkrn.eval3(Tacc(x0), Tacc(y0), Tacc(z0), &buf.simd[0]);
-          if (i0==i0old) return;
+          if (i0new==i0) return;
+          i0 = i0new;
           if ((i0[0]<b0[0]) || (i0[1]<b0[1]) || (i0[2]<b0[2])
            || (i0[0]+int(supp)>b0[0]+su) || (i0[1]+int(supp)>b0[1]+sv) || (i0[2]+int(supp)>b0[2]+sw))
             {
@@ -1454,13 +2211,14 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 #endif
           p0 = px0 + (i0[0]-b0[0])*sv*sw + (i0[1]-b0[1])*sw + (i0[2]-b0[2]);
           }
+        const array<int,ndim> &index() const { return i0; }
       };
 
-    template<size_t supp> class HelperU2nu
+    template<size_t supp> class HelperU2nu: public Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tcalc>
       {
       public:
-        static constexpr size_t vlen = mysimd<Tcalc>::size();
-        static constexpr size_t nvec = (supp+vlen-1)/vlen;
+        using Tkbuf = typename Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tcalc>;
+        using Tkbuf::vlen, Tkbuf::nvec;
 
       private:
         static constexpr int nsafe = (supp+1)/2;
@@ -1469,7 +2227,6 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         static constexpr double xsupp=2./supp;
         const Nufft *parent;
 
-        TemplateKernel<supp, mysimd<Tcalc>> tkrn;
         const cmav<complex<Tcalc>,ndim> &grid;
         array<int,ndim> i0; // start index of the nonuniform point
         array<int,ndim> b0; // start index of the current buffer
@@ -1495,34 +2252,22 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
       public:
         const Tcalc * DUCC0_RESTRICT p0r, * DUCC0_RESTRICT p0i;
-        union kbuf {
-          Tcalc scalar[3*nvec*vlen];
-          mysimd<Tcalc> simd[3*nvec];
-#if defined(_MSC_VER)
-          kbuf() {}
-#endif
-          };
-        kbuf buf;
 
         HelperU2nu(const Nufft *parent_, const cmav<complex<Tcalc>,ndim> &grid_)
-          : parent(parent_), tkrn(*parent->krn), grid(grid_),
+          : Tkbuf(*parent_->krn), parent(parent_), grid(grid_),
             i0{-1000000, -1000000, -1000000}, b0{-1000000, -1000000, -1000000},
             bufri({size_t(su+1),size_t(2*sv),size_t(swvec)}),
             px0r(bufri.data()), px0i(bufri.data()+swvec) {}
 
-        constexpr int lineJump() const { return 2*swvec; }
-        constexpr int planeJump() const { return 2*sv*swvec; }
+        static constexpr int lineJump() { return 2*swvec; }
+        static constexpr int planeJump() { return 2*sv*swvec; }
 
-        [[gnu::always_inline]] [[gnu::hot]] void prep(array<double,ndim> in)
+        /*! Move to the point with start index \a i0new, whose kernel weights
+            have been computed by prep_point(). */
+        [[gnu::always_inline]] [[gnu::hot]] void update(const array<int,ndim> &i0new)
           {
-          array<double,ndim> frac;
-          auto i0old = i0;
-          parent->template getpix<Tcoord>(in, frac, i0);
-          auto x0 = -frac[0]*2+(supp-1);
-          auto y0 = -frac[1]*2+(supp-1);
-          auto z0 = -frac[2]*2+(supp-1);
-          tkrn.eval3(Tcalc(x0), Tcalc(y0), Tcalc(z0), &buf.simd[0]);
-          if (i0==i0old) return;
+          if (i0new==i0) return;
+          i0 = i0new;
           if ((i0[0]<b0[0]) || (i0[1]<b0[1]) || (i0[2]<b0[2])
            || (i0[0]+int(supp)>b0[0]+su) || (i0[1]+int(supp)>b0[1]+sv) || (i0[2]+int(supp)>b0[2]+sw))
             {
@@ -1535,12 +2280,13 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           p0r = px0r+ofs;
           p0i = px0i+ofs;
           }
+        const array<int,ndim> &index() const { return i0; }
       };
 
     template<size_t SUPP, typename Tpoints> [[gnu::hot]] void spreading_helper
       (size_t supp, const cmav<Tcoord,2> &coords,
-      const cmav<complex<Tpoints>,1> &points,
-      vmav<complex<Tcalc>,ndim> &grid) const
+      const cmav<complex<Tpoints>,2> &points,
+      vmav<complex<Tcalc>,ndim+1> &grid) const
       {
       if constexpr (SUPP>=8)
         if (supp<=SUPP/2) return spreading_helper<SUPP/2>(supp, coords, points, grid);
@@ -1548,18 +2294,26 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         if (supp<SUPP) return spreading_helper<SUPP-1>(supp, coords, points, grid);
       MR_assert(supp==SUPP, "requested support out of range");
       bool sorted = coords_sorted.size()!=0;
+      using Thlp = HelperNu2u<SUPP>;
+      size_t ntrans = points.shape(0);
+      auto grids = split_grid(grid);
 
-      vector<Mutex> locks(nover[0]);
+      vector<vector<Mutex>> locks(lockfree_spreading ? 0 : ntrans);
+      for (auto &l: locks) l = vector<Mutex>(nover[0]);
 
-      size_t chunksz = max<size_t>(1000, npoints/(10*nthreads));
-      execDynamic(npoints, nthreads, chunksz, [&](Scheduler &sched)
+      spread_parallel([&](auto &&next)
         {
-        HelperNu2u<SUPP> hlp(this, grid, locks);
-        constexpr auto ljump = hlp.lineJump();
-        constexpr auto pjump = hlp.planeJump();
-        const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
-        const auto * DUCC0_RESTRICT kv = hlp.buf.scalar+hlp.vlen*hlp.nvec;
-        const auto * DUCC0_RESTRICT kw = hlp.buf.scalar+2*hlp.vlen*hlp.nvec;
+        // one helper per transform; kernel weights are only computed by the
+        // first one and shared with the others
+        vector<unique_ptr<Thlp>> hlp;
+        for (size_t t=0; t<ntrans; ++t)
+          hlp.push_back(make_unique<Thlp>(this, grids[t], lockfree_spreading ? nullptr : &locks[t]));
+        auto &lead(*hlp[0]);
+        constexpr auto ljump = Thlp::lineJump();
+        constexpr auto pjump = Thlp::planeJump();
+        const auto * DUCC0_RESTRICT ku = lead.buf.scalar;
+        const auto * DUCC0_RESTRICT kv = lead.buf.scalar+Thlp::vlen*Thlp::nvec;
+        const auto * DUCC0_RESTRICT kw = lead.buf.scalar+2*Thlp::vlen*Thlp::nvec;
         union Txdata{
           array<complex<Tacc>,SUPP> c;
           array<Tacc,2*SUPP> f;
@@ -1567,41 +2321,45 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           };
         Txdata xdata;
 
-        while (auto rng=sched.getNext()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
+        while (auto rng=next()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
           {
           constexpr size_t lookahead=3;
           if (ix+lookahead<npoints)
             {
-            auto nextidx = coord_idx[ix+lookahead];
-            DUCC0_PREFETCH_R(&points(nextidx));
-            if (!sorted)
-              for (size_t d=0; d<ndim; ++d) DUCC0_PREFETCH_R(&coords(nextidx,d));
+            auto nextidx = point_index(ix+lookahead);
+            for (size_t t=0; t<ntrans; ++t)
+              DUCC0_PREFETCH_R(&points(t,nextidx));
+            if (!sorted) prefetch_coords(coords, nextidx);
+            }
+          size_t row = point_index(ix);
+          lead.update(prep_point(lead, coords, sorted, ix, row));
+          for (size_t t=0; t<ntrans; ++t)
+            {
+            auto &h(*hlp[t]);
+            if (t>0) h.update(lead.index());
+            complex<Tacc> v(points(t,row));
+
+            for (size_t cw=0; cw<SUPP; ++cw)
+              xdata.c[cw]=kw[cw]*v;
+            const Tacc * DUCC0_RESTRICT fptr1=xdata.f.data();
+            Tacc * DUCC0_RESTRICT fptr2=reinterpret_cast<Tacc *>(h.p0);
+            const auto j1 = 2*ljump;
+            const auto j2 = 2*(pjump-SUPP*ljump);
+            for (size_t cu=0; cu<SUPP; ++cu, fptr2+=j2)
+              for (size_t cv=0; cv<SUPP; ++cv, fptr2+=j1)
+                {
+                Tacc tmp2x=ku[cu]*kv[cv];
+                for (size_t cw=0; cw<2*SUPP; ++cw)
+                  fptr2[cw] += tmp2x*fptr1[cw];
+                }
             }
-          size_t row = coord_idx[ix];
-          sorted ? hlp.prep({coords(ix,0), coords(ix,1), coords(ix,2)})
-                 : hlp.prep({coords(row,0), coords(row,1), coords(row,2)});
-          complex<Tacc> v(points(row));
-
-          for (size_t cw=0; cw<SUPP; ++cw)
-            xdata.c[cw]=kw[cw]*v;
-          const Tacc * DUCC0_RESTRICT fptr1=xdata.f.data();
-          Tacc * DUCC0_RESTRICT fptr2=reinterpret_cast<Tacc *>(hlp.p0);
-          const auto j1 = 2*ljump;
-          const auto j2 = 2*(pjump-SUPP*ljump);
-          for (size_t cu=0; cu<SUPP; ++cu, fptr2+=j2)
-            for (size_t cv=0; cv<SUPP; ++cv, fptr2+=j1)
-              {
-              Tacc tmp2x=ku[cu]*kv[cv];
-              for (size_t cw=0; cw<2*SUPP; ++cw)
-                fptr2[cw] += tmp2x*fptr1[cw];
-              }
           }
         });
       }
 
     template<size_t SUPP, typename Tpoints> [[gnu::hot]] void interpolation_helper
-      (size_t supp, const cmav<complex<Tcalc>,ndim> &grid,
-      const cmav<Tcoord,2> &coords, vmav<complex<Tpoints>,1> &points) const
+      (size_t supp, const cmav<complex<Tcalc>,ndim+1> &grid,
+      const cmav<Tcoord,2> &coords, vmav<complex<Tpoints>,2> &points) const
       {
       if constexpr (SUPP>=8)
         if (supp<=SUPP/2) return interpolation_helper<SUPP/2>(supp, grid, coords, points);
@@ -1609,242 +2367,684 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         if (supp<SUPP) return interpolation_helper<SUPP-1>(supp, grid, coords, points);
       MR_assert(supp==SUPP, "requested support out of range");
       bool sorted = coords_sorted.size()!=0;
+      using Thlp = HelperU2nu<SUPP>;
+      size_t ntrans = points.shape(0);
+      auto grids = split_grid(grid);
 
       size_t chunksz = max<size_t>(1000, npoints/(10*nthreads));
       execDynamic(npoints, nthreads, chunksz, [&](Scheduler &sched)
         {
-        HelperU2nu<SUPP> hlp(this, grid);
-        constexpr auto ljump = hlp.lineJump();
-        constexpr auto pjump = hlp.planeJump();
-        const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
-        const auto * DUCC0_RESTRICT kv = hlp.buf.scalar+hlp.vlen*hlp.nvec;
-        const auto * DUCC0_RESTRICT kw = hlp.buf.simd+2*hlp.nvec;
+        vector<unique_ptr<Thlp>> hlp;
+        for (size_t t=0; t<ntrans; ++t)
+          hlp.push_back(make_unique<Thlp>(this, grids[t]));
+        auto &lead(*hlp[0]);
+        constexpr auto ljump = Thlp::lineJump();
+        constexpr auto pjump = Thlp::planeJump();
+        const auto * DUCC0_RESTRICT ku = lead.buf.scalar;
+        const auto * DUCC0_RESTRICT kv = lead.buf.scalar+Thlp::vlen*Thlp::nvec;
+        const auto * DUCC0_RESTRICT kw = lead.buf.simd+2*Thlp::nvec;
 
         while (auto rng=sched.getNext()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
           {
           constexpr size_t lookahead=3;
           if (ix+lookahead<npoints)
             {
-            auto nextidx = coord_idx[ix+lookahead];
-            DUCC0_PREFETCH_W(&points(nextidx));
-            if (!sorted)
-              for (size_t d=0; d<ndim; ++d) DUCC0_PREFETCH_R(&coords(nextidx,d));
+            auto nextidx = point_index(ix+lookahead);
+            for (size_t t=0; t<ntrans; ++t)
+              DUCC0_PREFETCH_W(&points(t,nextidx));
+            if (!sorted) prefetch_coords(coords, nextidx);
             }
-          size_t row = coord_idx[ix];
-          sorted ? hlp.prep({coords(ix,0), coords(ix,1), coords(ix,2)})
-                 : hlp.prep({coords(row,0), coords(row,1), coords(row,2)});
-          mysimd<Tcalc> rr=0, ri=0;
-          if constexpr (hlp.nvec==1)
+          size_t row = point_index(ix);
+          lead.update(prep_point(lead, coords, sorted, ix, row));
+          for (size_t t=0; t<ntrans; ++t)
             {
-            for (size_t cu=0; cu<SUPP; ++cu)
+            auto &h(*hlp[t]);
+            if (t>0) h.update(lead.index());
+            mysimd<Tcalc> rr=0, ri=0;
+            if constexpr (Thlp::nvec==1)
               {
-              mysimd<Tcalc> r2r=0, r2i=0;
-              for (size_t cv=0; cv<SUPP; ++cv)
+              for (size_t cu=0; cu<SUPP; ++cu)
                 {
-                const auto * DUCC0_RESTRICT pxr = hlp.p0r + cu*pjump + cv*ljump;
-                const auto * DUCC0_RESTRICT pxi = hlp.p0i + cu*pjump + cv*ljump;
-                r2r += mysimd<Tcalc>(pxr,element_aligned_tag())*kv[cv];
-                r2i += mysimd<Tcalc>(pxi,element_aligned_tag())*kv[cv];
+                mysimd<Tcalc> r2r=0, r2i=0;
+                for (size_t cv=0; cv<SUPP; ++cv)
+                  {
+                  const auto * DUCC0_RESTRICT pxr = h.p0r + cu*pjump + cv*ljump;
+                  const auto * DUCC0_RESTRICT pxi = h.p0i + cu*pjump + cv*ljump;
+                  r2r += mysimd<Tcalc>(pxr,element_aligned_tag())*kv[cv];
+                  r2i += mysimd<Tcalc>(pxi,element_aligned_tag())*kv[cv];
+                  }
+                rr += r2r*ku[cu];
+                ri += r2i*ku[cu];
                 }
-              rr += r2r*ku[cu];
-              ri += r2i*ku[cu];
+              rr *= kw[0];
+              ri *= kw[0];
               }
-            rr *= kw[0];
-            ri *= kw[0];
-            }
-          else
-            {
-            for (size_t cu=0; cu<SUPP; ++cu)
+            else
               {
-              mysimd<Tcalc> tmpr(0), tmpi(0);
-              for (size_t cv=0; cv<SUPP; ++cv)
+              for (size_t cu=0; cu<SUPP; ++cu)
                 {
-                mysimd<Tcalc> tmp2r(0), tmp2i(0);
-                for (size_t cw=0; cw<hlp.nvec; ++cw)
+                mysimd<Tcalc> tmpr(0), tmpi(0);
+                for (size_t cv=0; cv<SUPP; ++cv)
                   {
-                  const auto * DUCC0_RESTRICT pxr = hlp.p0r + cu*pjump + cv*ljump + hlp.vlen*cw;
-                  const auto * DUCC0_RESTRICT pxi = hlp.p0i + cu*pjump + cv*ljump + hlp.vlen*cw;
-                  tmp2r += kw[cw]*mysimd<Tcalc>(pxr,element_aligned_tag());
-                  tmp2i += kw[cw]*mysimd<Tcalc>(pxi,element_aligned_tag());
+                  mysimd<Tcalc> tmp2r(0), tmp2i(0);
+                  for (size_t cw=0; cw<Thlp::nvec; ++cw)
+                    {
+                    const auto * DUCC0_RESTRICT pxr = h.p0r + cu*pjump + cv*ljump + Thlp::vlen*cw;
+                    const auto * DUCC0_RESTRICT pxi = h.p0i + cu*pjump + cv*ljump + Thlp::vlen*cw;
+                    tmp2r += kw[cw]*mysimd<Tcalc>(pxr,element_aligned_tag());
+                    tmp2i += kw[cw]*mysimd<Tcalc>(pxi,element_aligned_tag());
+                    }
+                  tmpr += kv[cv]*tmp2r;
+                  tmpi += kv[cv]*tmp2i;
                   }
-                tmpr += kv[cv]*tmp2r;
-                tmpi += kv[cv]*tmp2i;
+                rr += ku[cu]*tmpr;
+                ri += ku[cu]*tmpi;
                 }
-              rr += ku[cu]*tmpr;
-              ri += ku[cu]*tmpi;
               }
+            points(t,row) = hsum_cmplx<Tcalc>(rr,ri);
             }
-          points(row) = hsum_cmplx<Tcalc>(rr,ri);
           }
         });
       }
+  };
 
-    template<typename Tpoints, typename Tgrid> void nonuni2uni(bool forward,
-      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,1> &points,
-      vmav<complex<Tgrid>,ndim> &uniform)
-      {
-      timers.push("nu2u proper");
-      timers.push("allocating grid");
-      auto grid = vmav<complex<Tcalc>,ndim>::build_noncritical(nover, UNINITIALIZED);
-      timers.poppush("zeroing grid");
-      mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid);
-      timers.poppush("spreading");
-      constexpr size_t maxsupp = is_same<Tacc, float>::value ? 8 : 16;
-      spreading_helper<maxsupp>(supp, coords, points, grid);
-      timers.poppush("FFT");
+/*! Generic implementation of Nufft for more than three dimensions.
+    The oversampled grid is processed in tiles of size 2^log2tile along every
+    axis, as in the lower-dimensional specializations; kernel weights are
+    evaluated separately for every axis, and the innermost axis of a tile is
+    processed in contiguous loops, which the compiler is expected to
+    vectorize. Like the specializations, it only provides the spreading and
+    interpolation helpers; everything else is shared via Nufft_ancestor and
+    DUCC0_NUFFT_BOILERPLATE. */
+template<typename Tcalc, typename Tacc, typename Tcoord, size_t ndim> class Nufft: public Nufft_ancestor<Tcalc, Tacc, ndim>
+  {
+  static_assert(ndim>=2, "unsupported dimensionality");
+
+  DUCC0_NUFFT_BOILERPLATE
+
+    /*! Advances \a idx to the start of the next line along the last axis of
+        a box with edge length \a len starting at \a idx0 on a periodic grid
+        of shape \a inu (\a ib holds the position within the box). The first
+        axis is not touched. Returns false after the last line. */
+    static bool next_line(int len, array<int,ndim> &ib, array<int,ndim> &idx,
+      const array<int,ndim> &idx0, const array<int,ndim> &inu)
       {
-      vfmav<complex<Tcalc>> fgrid(grid);
-      slice slz{0,(nuni[2]+1)/2}, shz{fgrid.shape(2)-nuni[2]/2,MAXIDX};
-      slice sly{0,(nuni[1]+1)/2}, shy{fgrid.shape(1)-nuni[1]/2,MAXIDX};
-      c2c(fgrid, fgrid, {2}, forward, Tcalc(1), nthreads);
-      auto fgridl=fgrid.subarray({{},{},slz});
-      c2c(fgridl, fgridl, {1}, forward, Tcalc(1), nthreads);
-      if (nuni[2]>1)
+      for (size_t d=ndim-2; d>0; --d)
         {
-        auto fgridh=fgrid.subarray({{},{},shz});
-        c2c(fgridh, fgridh, {1}, forward, Tcalc(1), nthreads);
+        idx[d] = (idx[d]+1<inu[d]) ? (idx[d]+1) : 0;
+        if (++ib[d]<len) return true;
+        ib[d] = 0;
+        idx[d] = idx0[d];
         }
-      auto fgridll=fgrid.subarray({{},sly,slz});
-      c2c(fgridll, fgridll, {0}, forward, Tcalc(1), nthreads);
-      if (nuni[2]>1)
-        {
-        auto fgridlh=fgrid.subarray({{},sly,shz});
-        c2c(fgridlh, fgridlh, {0}, forward, Tcalc(1), nthreads);
-        }
-      if (nuni[1]>1)
-        {
-        auto fgridhl=fgrid.subarray({{},shy,slz});
-        c2c(fgridhl, fgridhl, {0}, forward, Tcalc(1), nthreads);
-        if (nuni[2]>1)
+      return false;
+      }
+
+    template<size_t supp> class HelperNu2u: public Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tacc>
+      {
+      public:
+        using Tkbuf = typename Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tacc>;
+        using Tkbuf::vlen, Tkbuf::nvec;
+        static constexpr int su = supp+(1<<log2tile);
+
+      private:
+        static constexpr int nsafe = (supp+1)/2;
+        const Nufft *parent;
+        vmav<complex<Tcalc>,ndim> &grid;
+        array<int,ndim> i0; // start index of the current nonuniform point
+        array<int,ndim> b0; // start index of the current buffer
+
+        vmav<complex<Tacc>,ndim> gbuf;
+        complex<Tacc> *px0;
+        vector<Mutex> *locks; // null for lock-free spreading
+
+        static array<size_t,ndim> bufshape()
           {
-          auto fgridhh=fgrid.subarray({{},shy,shz});
-          c2c(fgridhh, fgridhh, {0}, forward, Tcalc(1), nthreads);
+          array<size_t,ndim> res;
+          res.fill(su);
+          return res;
           }
-        }
-      }
-      timers.poppush("grid correction");
-      execParallel(nuni[0], nthreads, [&](size_t lo, size_t hi)
-        {
-        for (auto i=lo; i<hi; ++i)
+
+        DUCC0_NOINLINE void dump()
           {
-          auto [icfu, iout, iin] = comp_indices(i, nuni[0], nover[0], fft_order);
-          for (size_t j=0; j<nuni[1]; ++j)
+          if (b0[0]<-nsafe) return; // nothing written into buffer yet
+          array<int,ndim> inu, idx0;
+          for (size_t d=0; d<ndim; ++d)
             {
-            auto [icfv, jout, jin] = comp_indices(j, nuni[1], nover[1], fft_order);
-            for (size_t k=0; k<nuni[2]; ++k)
+            inu[d] = int(parent->nover[d]);
+            idx0[d] = (b0[d]+inu[d])%inu[d];
+            }
+          auto *pbuf = px0;
+          const auto sl = grid.stride(ndim-1);
+          for (int iu=0, idxu=idx0[0]; iu<su; ++iu, idxu=(idxu+1<inu[0])?(idxu+1):0)
+            {
+            OptionalLockGuard lock(locks ? &(*locks)[idxu] : nullptr);
+            array<int,ndim> ib{}, idx(idx0);
+            idx[0] = idxu;
+            do
               {
-              auto [icfw, kout, kin] = comp_indices(k, nuni[2], nover[2], fft_order);
-              uniform(iout,jout,kout) = complex<Tgrid>(grid(iin,jin,kin)
-                *Tcalc(corfac[0][icfu]*corfac[1][icfv]*corfac[2][icfw]));
+              ptrdiff_t ofs = 0;
+              for (size_t d=0; d+1<ndim; ++d) ofs += idx[d]*grid.stride(d);
+              auto *pgrid = grid.data()+ofs;
+              for (int il=0, idxl=idx0[ndim-1]; il<su; ++il, idxl=(idxl+1<inu[ndim-1])?(idxl+1):0)
+                {
+                pgrid[idxl*sl] += complex<Tcalc>(pbuf[il]);
+                pbuf[il] = 0;
+                }
+              pbuf += su;
               }
+            while (next_line(su, ib, idx, idx0, inu));
+            }
+          }
+
+      public:
+        complex<Tacc> * DUCC0_RESTRICT p0;
+
+        HelperNu2u(const Nufft *parent_, vmav<complex<Tcalc>,ndim> &grid_,
+          vector<Mutex> *locks_)
+          : Tkbuf(*parent_->krn), parent(parent_), grid(grid_),
+            gbuf(bufshape()), px0(gbuf.data()), locks(locks_)
+          {
+          i0.fill(-1000000);
+          b0.fill(-1000000);
+          }
+        ~HelperNu2u() { dump(); }
+
+        /*! Move to the point with start index \a i0new, whose kernel weights
+            have been computed by prep_point(). */
+        [[gnu::always_inline]] [[gnu::hot]] void update(const array<int,ndim> &i0new)
+          {
+          if (i0new==i0) return;
+          i0 = i0new;
+          bool outside = false;
+          for (size_t d=0; d<ndim; ++d)
+            outside |= (i0[d]<b0[d]) || (i0[d]+int(supp)>b0[d]+su);
+          if (outside)
+            {
+            dump();
+            for (size_t d=0; d<ndim; ++d)
+              b0[d]=((((i0[d]+nsafe)>>log2tile)<<log2tile))-nsafe;
+            }
+          ptrdiff_t ofs = 0;
+          for (size_t d=0; d<ndim; ++d)
+            ofs = ofs*su + (i0[d]-b0[d]);
+          p0 = px0+ofs;
+          }
+        const array<int,ndim> &index() const { return i0; }
+      };
+
+    template<size_t supp> class HelperU2nu: public Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tcalc>
+      {
+      public:
+        using Tkbuf = typename Nufft_ancestor<Tcalc, Tacc, ndim>::template PointKernel<supp, Tcalc>;
+        using Tkbuf::vlen, Tkbuf::nvec;
+        static constexpr int su = supp+(1<<log2tile);
+
+      private:
+        static constexpr int nsafe = (supp+1)/2;
+        const Nufft *parent;
+        const cmav<complex<Tcalc>,ndim> &grid;
+        array<int,ndim> i0; // start index of the current nonuniform point
+        array<int,ndim> b0; // start index of the current buffer
+
+        vmav<complex<Tcalc>,ndim> gbuf;
+        const complex<Tcalc> *px0;
+
+        static array<size_t,ndim> bufshape()
+          {
+          array<size_t,ndim> res;
+          res.fill(su);
+          return res;
+          }
+
+        // load a tile from the global oversampled grid into local buffer
+        DUCC0_NOINLINE void load()
+          {
+          array<int,ndim> inu, idx0;
+          for (size_t d=0; d<ndim; ++d)
+            {
+            inu[d] = int(parent->nover[d]);
+            idx0[d] = (b0[d]+inu[d])%inu[d];
+            }
+          auto *pbuf = gbuf.data();
+          const auto sl = grid.stride(ndim-1);
+          for (int iu=0, idxu=idx0[0]; iu<su; ++iu, idxu=(idxu+1<inu[0])?(idxu+1):0)
+            {
+            array<int,ndim> ib{}, idx(idx0);
+            idx[0] = idxu;
+            do
+              {
+              ptrdiff_t ofs = 0;
+              for (size_t d=0; d+1<ndim; ++d) ofs += idx[d]*grid.stride(d);
+              const auto *pgrid = grid.data()+ofs;
+              for (int il=0, idxl=idx0[ndim-1]; il<su; ++il, idxl=(idxl+1<inu[ndim-1])?(idxl+1):0)
+                pbuf[il] = pgrid[idxl*sl];
+              pbuf += su;
+              }
+            while (next_line(su, ib, idx, idx0, inu));
+            }
+          }
+
+      public:
+        const complex<Tcalc> * DUCC0_RESTRICT p0;
+
+        HelperU2nu(const Nufft *parent_, const cmav<complex<Tcalc>,ndim> &grid_)
+          : Tkbuf(*parent_->krn), parent(parent_), grid(grid_),
+            gbuf(bufshape()), px0(gbuf.data())
+          {
+          i0.fill(-1000000);
+          b0.fill(-1000000);
+          }
+
+        /*! Move to the point with start index \a i0new, whose kernel weights
+            have been computed by prep_point(). */
+        [[gnu::always_inline]] [[gnu::hot]] void update(const array<int,ndim> &i0new)
+          {
+          if (i0new==i0) return;
+          i0 = i0new;
+          bool outside = false;
+          for (size_t d=0; d<ndim; ++d)
+            outside |= (i0[d]<b0[d]) || (i0[d]+int(supp)>b0[d]+su);
+          if (outside)
+            {
+            for (size_t d=0; d<ndim; ++d)
+              b0[d]=((((i0[d]+nsafe)>>log2tile)<<log2tile))-nsafe;
+            load();
+            }
+          ptrdiff_t ofs = 0;
+          for (size_t d=0; d<ndim; ++d)
+            ofs = ofs*su + (i0[d]-b0[d]);
+          p0 = px0+ofs;
+          }
+        const array<int,ndim> &index() const { return i0; }
+      };
+
+    // distance (in real numbers) between neighbouring buffer entries along
+    // axis \a d
+    template<int su> static constexpr size_t bufstride(size_t d)
+      {
+      size_t res = 2;
+      for (size_t i=d+1; i<ndim; ++i) res *= su;
+      return res;
+      }
+
+    /* Adds wgt*<kernel weights of axes d..ndim-2>*xdata to the buffer section
+       starting at ptr; xdata holds the point value multiplied by the kernel
+       weights of the last axis. */
+    template<size_t d, size_t SUPP, int su> [[gnu::always_inline]] static void
+      spread_rec(Tacc * DUCC0_RESTRICT ptr, const Tacc * DUCC0_RESTRICT ker,
+      size_t kstride, Tacc wgt, const Tacc * DUCC0_RESTRICT xdata)
+      {
+      if constexpr (d+1==ndim)
+        for (size_t c=0; c<2*SUPP; ++c)
+          ptr[c] += wgt*xdata[c];
+      else
+        for (size_t c=0; c<SUPP; ++c)
+          spread_rec<d+1, SUPP, su>(ptr+c*bufstride<su>(d), ker, kstride,
+            wgt*ker[d*kstride+c], xdata);
+      }
+    /* Adds wgt*<kernel weights of axes d..ndim-2>*<buffer section starting at
+       ptr> to acc, without applying the kernel weights of the last axis. */
+    template<size_t d, size_t SUPP, int su> [[gnu::always_inline]] static void
+      interp_rec(const Tcalc * DUCC0_RESTRICT ptr,
+      const Tcalc * DUCC0_RESTRICT ker, size_t kstride, Tcalc wgt,
+      Tcalc * DUCC0_RESTRICT acc)
+      {
+      if constexpr (d+1==ndim)
+        for (size_t c=0; c<2*SUPP; ++c)
+          acc[c] += wgt*ptr[c];
+      else
+        for (size_t c=0; c<SUPP; ++c)
+          interp_rec<d+1, SUPP, su>(ptr+c*bufstride<su>(d), ker, kstride,
+            wgt*ker[d*kstride+c], acc);
+      }
+
+    template<size_t SUPP, typename Tpoints> [[gnu::hot]] void spreading_helper
+      (size_t supp, const cmav<Tcoord,2> &coords,
+      const cmav<complex<Tpoints>,2> &points,
+      vmav<complex<Tcalc>,ndim+1> &grid) const
+      {
+      if constexpr (SUPP>=8)
+        if (supp<=SUPP/2) return spreading_helper<SUPP/2>(supp, coords, points, grid);
+      if constexpr (SUPP>4)
+        if (supp<SUPP) return spreading_helper<SUPP-1>(supp, coords, points, grid);
+      MR_assert(supp==SUPP, "requested support out of range");
+      bool sorted = coords_sorted.size()!=0;
+      using Thlp = HelperNu2u<SUPP>;
+      size_t ntrans = points.shape(0);
+      auto grids = split_grid(grid);
+
+      vector<vector<Mutex>> locks(lockfree_spreading ? 0 : ntrans);
+      for (auto &l: locks) l = vector<Mutex>(nover[0]);
+
+      spread_parallel([&](auto &&next)
+        {
+        // one helper per transform; kernel weights are only computed by the
+        // first one and shared with the others
+        vector<unique_ptr<Thlp>> hlp;
+        for (size_t t=0; t<ntrans; ++t)
+          hlp.push_back(make_unique<Thlp>(this, grids[t], lockfree_spreading ? nullptr : &locks[t]));
+        auto &lead(*hlp[0]);
+        constexpr size_t kstride = Thlp::vlen*Thlp::nvec;
+        const auto * DUCC0_RESTRICT ker = lead.buf.scalar;
+        const auto * DUCC0_RESTRICT klast = lead.buf.scalar+(ndim-1)*kstride;
+        union Txdata{
+          array<complex<Tacc>,SUPP> c;
+          array<Tacc,2*SUPP> f;
+          Txdata(){for (size_t i=0; i<f.size(); ++i) f[i]=0;}
+          };
+        Txdata xdata;
+
+        while (auto rng=next()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
+          {
+          constexpr size_t lookahead=3;
+          if (ix+lookahead<npoints)
+            {
+            auto nextidx = point_index(ix+lookahead);
+            for (size_t t=0; t<ntrans; ++t)
+              DUCC0_PREFETCH_R(&points(t,nextidx));
+            if (!sorted) prefetch_coords(coords, nextidx);
+            }
+          size_t row = point_index(ix);
+          lead.update(prep_point(lead, coords, sorted, ix, row));
+          for (size_t t=0; t<ntrans; ++t)
+            {
+            auto &h(*hlp[t]);
+            if (t>0) h.update(lead.index());
+            complex<Tacc> v(points(t,row));
+            for (size_t c=0; c<SUPP; ++c)
+              xdata.c[c] = klast[c]*v;
+            spread_rec<0, SUPP, Thlp::su>(reinterpret_cast<Tacc *>(h.p0), ker,
+              kstride, Tacc(1), xdata.f.data());
             }
           }
         });
-      timers.pop();
-      timers.pop();
       }
 
-    template<typename Tpoints, typename Tgrid> void uni2nonuni(bool forward,
-      const cmav<complex<Tgrid>,ndim> &uniform, const cmav<Tcoord,2> &coords,
-      vmav<complex<Tpoints>,1> &points)
+    template<size_t SUPP, typename Tpoints> [[gnu::hot]] void interpolation_helper
+      (size_t supp, const cmav<complex<Tcalc>,ndim+1> &grid,
+      const cmav<Tcoord,2> &coords, vmav<complex<Tpoints>,2> &points) const
       {
-      timers.push("u2nu proper");
-      timers.push("allocating grid");
-      auto grid = vmav<complex<Tcalc>,ndim>::build_noncritical(nover, UNINITIALIZED);
-      timers.poppush("zeroing grid");
-      // TODO: not all entries need to be zeroed, perhaps some time can be saved here
-      mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid);
-      timers.poppush("grid correction");
-      execParallel(nuni[0], nthreads, [&](size_t lo, size_t hi)
+      if constexpr (SUPP>=8)
+        if (supp<=SUPP/2) return interpolation_helper<SUPP/2>(supp, grid, coords, points);
+      if constexpr (SUPP>4)
+        if (supp<SUPP) return interpolation_helper<SUPP-1>(supp, grid, coords, points);
+      MR_assert(supp==SUPP, "requested support out of range");
+      bool sorted = coords_sorted.size()!=0;
+      using Thlp = HelperU2nu<SUPP>;
+      size_t ntrans = points.shape(0);
+      auto grids = split_grid(grid);
+
+      size_t chunksz = max<size_t>(1000, npoints/(10*nthreads));
+      execDynamic(npoints, nthreads, chunksz, [&](Scheduler &sched)
         {
-        for (auto i=lo; i<hi; ++i)
+        vector<unique_ptr<Thlp>> hlp;
+        for (size_t t=0; t<ntrans; ++t)
+          hlp.push_back(make_unique<Thlp>(this, grids[t]));
+        auto &lead(*hlp[0]);
+        constexpr size_t kstride = Thlp::vlen*Thlp::nvec;
+        const auto * DUCC0_RESTRICT ker = lead.buf.scalar;
+        const auto * DUCC0_RESTRICT klast = lead.buf.scalar+(ndim-1)*kstride;
+        array<Tcalc,2*SUPP> acc;
+
+        while (auto rng=sched.getNext()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
           {
-          auto [icfu, iin, iout] = comp_indices(i, nuni[0], nover[0], fft_order);
-          for (size_t j=0; j<nuni[1]; ++j)
+          constexpr size_t lookahead=3;
+          if (ix+lookahead<npoints)
             {
-            auto [icfv, jin, jout] = comp_indices(j, nuni[1], nover[1], fft_order);
-            for (size_t k=0; k<nuni[2]; ++k)
+            auto nextidx = point_index(ix+lookahead);
+            for (size_t t=0; t<ntrans; ++t)
+              DUCC0_PREFETCH_W(&points(t,nextidx));
+            if (!sorted) prefetch_coords(coords, nextidx);
+            }
+          size_t row = point_index(ix);
+          lead.update(prep_point(lead, coords, sorted, ix, row));
+          for (size_t t=0; t<ntrans; ++t)
+            {
+            auto &h(*hlp[t]);
+            if (t>0) h.update(lead.index());
+            for (size_t c=0; c<2*SUPP; ++c) acc[c] = 0;
+            interp_rec<0, SUPP, Thlp::su>(reinterpret_cast<const Tcalc *>(h.p0),
+              ker, kstride, Tcalc(1), acc.data());
+            Tcalc rr=0, ri=0;
+            for (size_t c=0; c<SUPP; ++c)
               {
-              auto [icfw, kin, kout] = comp_indices(k, nuni[2], nover[2], fft_order);
-              grid(iout,jout,kout) = complex<Tcalc>(uniform(iin,jin,kin))
-                *Tcalc(corfac[0][icfu]*corfac[1][icfv]*corfac[2][icfw]);
+              rr += klast[c]*acc[2*c];
+              ri += klast[c]*acc[2*c+1];
               }
+            points(t,row) = complex<Tpoints>(complex<Tcalc>(rr, ri));
             }
           }
         });
-      timers.poppush("FFT");
+      }
+  };
+
+#undef DUCC0_NUFFT_BOILERPLATE
+
+/*! Helper class for carrying out nonuniform-to-nonuniform (type 3) FFTs
+    in 1D/2D/3D, i.e.
+      points_out[k] = sum_j points_in[j]*exp(+-i*<coord_out[k],coord_in[j]>).
+    No periodicity is assumed for either set of coordinates.
+
+    The input points are shifted to their center and rescaled, spread onto an
+    oversampled grid (without FFT), and this grid is evaluated at the
+    correspondingly rescaled output coordinates by a type-2 transform.
+    Finally, the output values are divided by the Fourier transform of the
+    spreading kernel.
+    Everything depending only on the coordinates is computed in the
+    constructor, so that repeated transforms with the same coordinates are
+    cheap.
+ */
+template<typename Tcalc, typename Tacc, typename Tcoord, size_t ndim> class Nufft3
+  {
+  private:
+    TimerHierarchy timers;
+    double epsilon;
+    size_t nthreads;
+    size_t npoints_in, npoints_out;
+
+    // type-1 plan, only used for spreading the rescaled input points
+    unique_ptr<Nufft<Tcalc, Tacc, Tcoord, ndim>> spreader;
+    // type-2 plan evaluating the spread grid at the rescaled output points
+    unique_ptr<Nufft<Tcalc, Tcalc, Tcoord, ndim>> interpolator;
+
+    // phase factors for the input points (empty if all of them are 1)
+    quick_array<complex<Tcalc>> prephase;
+    // phase factors combined with the kernel correction for the output points
+    // (both arrays hold the values for forward transforms; backward transforms
+    // use the complex conjugates)
+    quick_array<complex<Tcalc>> postfac;
+
+    // center and half width of the coordinate range along axis \a idim
+    static pair<double, double> get_range(const cmav<Tcoord,2> &coord,
+      size_t idim)
       {
-      vfmav<complex<Tcalc>> fgrid(grid);
-      slice slz{0,(nuni[2]+1)/2}, shz{fgrid.shape(2)-nuni[2]/2,MAXIDX};
-      slice sly{0,(nuni[1]+1)/2}, shy{fgrid.shape(1)-nuni[1]/2,MAXIDX};
-      auto fgridll=fgrid.subarray({{},sly,slz});
-      c2c(fgridll, fgridll, {0}, forward, Tcalc(1), nthreads);
-      if (nuni[2]>1)
+      if (coord.shape(0)==0) return make_pair(0., 0.);
+      double lo=coord(0,idim), hi=lo;
+      for (size_t i=1; i<coord.shape(0); ++i)
         {
-        auto fgridlh=fgrid.subarray({{},sly,shz});
-        c2c(fgridlh, fgridlh, {0}, forward, Tcalc(1), nthreads);
+        lo = min<double>(lo, coord(i,idim));
+        hi = max<double>(hi, coord(i,idim));
         }
-      if (nuni[1]>1)
+      return make_pair(0.5*(lo+hi), 0.5*(hi-lo));
+      }
+
+    void report(size_t ntrans) const
+      {
+      cout << "Nu2nu:" << endl
+           << "  nthreads=" << nthreads << ", oversampled grid=("
+           << spreader->nover[0];
+      for (size_t i=1; i<ndim; ++i) cout << "x" << spreader->nover[i];
+      cout << "), supp=" << spreader->supp << "/" << interpolator->supp
+           << ", eps=" << epsilon << endl
+           << "  npoints_in=" << npoints_in << ", npoints_out=" << npoints_out
+           << ", ntrans=" << ntrans << endl;
+      }
+
+  public:
+    Nufft3(const cmav<Tcoord,2> &coord_in, const cmav<Tcoord,2> &coord_out,
+      double epsilon_, size_t nthreads_, double sigma_min, double sigma_max)
+      : timers("nu2nu"), epsilon(epsilon_), nthreads(adjust_nthreads(nthreads_)),
+        npoints_in(coord_in.shape(0)), npoints_out(coord_out.shape(0))
+      {
+      MR_assert((coord_in.shape(1)==ndim) && (coord_out.shape(1)==ndim),
+        "ndim mismatch");
+      MR_assert(epsilon>0, "epsilon must be positive");
+
+      timers.push("parameter calculation");
+      array<double,ndim> xctr, xhw, sctr, shw;
+      for (size_t d=0; d<ndim; ++d)
+        {
+        tie(xctr[d], xhw[d]) = get_range(coord_in, d);
+        tie(sctr[d], shw[d]) = get_range(coord_out, d);
+        if (xhw[d]==0) xhw[d] = (shw[d]==0) ? 1. : 1./shw[d];
+        if (shw[d]==0) shw[d] = 1./xhw[d];
+        }
+      // Input coordinates are mapped to x' = (x-xctr)/gamma and output
+      // coordinates to s' = (s-sctr)*gamma. The rescaled input points must
+      // stay away from the grid edges by more than half a kernel support,
+      // and the s' must lie in the range where the kernel correction is
+      // accurate, i.e. |s'|<=nuni/2 for the type-1 plan.
+      vector<size_t> nuni(ndim);
+      for (size_t d=0; d<ndim; ++d)
+        nuni[d] = max<size_t>(1, size_t(ceil(2*shw[d]*xhw[d]/pi)));
+      array<double,ndim> gamma;
+      while (true)
         {
-        auto fgridhl=fgrid.subarray({{},shy,slz});
-        c2c(fgridhl, fgridhl, {0}, forward, Tcalc(1), nthreads);
-        if (nuni[2]>1)
+        auto [kidx, dims] = findNufftParameters<Tcalc,Tacc>
+          (epsilon, sigma_min, sigma_max, nuni, npoints_in, true, nthreads);
+        size_t supp = getKernel(kidx).W;
+        bool ok = true;
+        for (size_t d=0; d<ndim; ++d)
           {
-          auto fgridhh=fgrid.subarray({{},shy,shz});
-          c2c(fgridhh, fgridhh, {0}, forward, Tcalc(1), nthreads);
+          if (dims[d]<2*(supp+2))
+            { nuni[d]*=2; ok=false; continue; }
+          gamma[d] = xhw[d]*dims[d]/(pi*(dims[d]-supp-2));
+          auto nmin = size_t(ceil(2*shw[d]*gamma[d]));
+          if (nmin>nuni[d])
+            { nuni[d]=nmin; ok=false; }
           }
+        if (ok) break;
         }
-      auto fgridl=fgrid.subarray({{},{},slz});
-      c2c(fgridl, fgridl, {1}, forward, Tcalc(1), nthreads);
-      if (nuni[2]>1)
+
+      timers.poppush("spreading plan");
+      vmav<Tcoord,2> coord2({npoints_in, ndim}, UNINITIALIZED);
+      bool need_prephase = false;
+      for (size_t d=0; d<ndim; ++d)
+        need_prephase |= (sctr[d]!=0);
+      if (need_prephase) prephase.resize(npoints_in);
+      execParallel(npoints_in, nthreads, [&](size_t lo, size_t hi)
         {
-        auto fgridh=fgrid.subarray({{},{},shz});
-        c2c(fgridh, fgridh, {1}, forward, Tcalc(1), nthreads);
-        }
-      c2c(fgrid, fgrid, {2}, forward, Tcalc(1), nthreads);
-      }
-      timers.poppush("interpolation");
-      constexpr size_t maxsupp = is_same<Tcalc, float>::value ? 8 : 16;
-      interpolation_helper<maxsupp>(supp, grid, coords, points);
-      timers.pop();
+        for (size_t i=lo; i<hi; ++i)
+          {
+          double phase=0;
+          for (size_t d=0; d<ndim; ++d)
+            {
+            coord2(i,d) = Tcoord((coord_in(i,d)-xctr[d])/gamma[d]);
+            phase += sctr[d]*coord_in(i,d);
+            }
+          if (need_prephase)
+            prephase[i] = complex<Tcalc>(polar(1., -phase));
+          }
+        });
+      array<size_t,ndim> nuni2;
+      for (size_t d=0; d<ndim; ++d) nuni2[d] = nuni[d];
+      spreader = make_unique<Nufft<Tcalc, Tacc, Tcoord, ndim>>(true, coord2,
+        nuni2, epsilon, nthreads, sigma_min, sigma_max, 2*pi, false);
+      auto nover = spreader->nover;
+
+      timers.poppush("interpolation plan");
+      vmav<Tcoord,2> coord3({npoints_out, ndim}, UNINITIALIZED);
+      postfac.resize(npoints_out);
+      execParallel(npoints_out, nthreads, [&](size_t lo, size_t hi)
+        {
+        for (size_t i=lo; i<hi; ++i)
+          {
+          double phase=0, corr=1;
+          for (size_t d=0; d<ndim; ++d)
+            {
+            double s2 = (coord_out(i,d)-sctr[d])*gamma[d];
+            coord3(i,d) = Tcoord(s2*2*pi/nover[d]);
+            corr *= spreader->krn->corfunc(s2/nover[d]);
+            phase += xctr[d]*(coord_out(i,d)-sctr[d]);
+            }
+          postfac[i] = complex<Tcalc>(polar(corr, -phase));
+          }
+        });
+      interpolator = make_unique<Nufft<Tcalc, Tcalc, Tcoord, ndim>>(false,
+        coord3, nover, epsilon, nthreads, sigma_min, sigma_max, 2*pi, true);
       timers.pop();
       }
 
-    void build_index(const cmav<Tcoord,2> &coords)
+    template<typename Tpoints> void nu2nu(bool forward, size_t verbosity,
+      const cmav<complex<Tpoints>,2> &points_in,
+      vmav<complex<Tpoints>,2> &points_out)
       {
-      timers.push("building index");
-      size_t ntiles_u = (nover[0]>>log2tile) + 3;
-      size_t ntiles_v = (nover[1]>>log2tile) + 3;
-      size_t ntiles_w = (nover[2]>>log2tile) + 3;
-      size_t lsq2 = log2tile;
-      while ((lsq2>=1) && (((ntiles_u*ntiles_v*ntiles_w)<<(3*(log2tile-lsq2)))<(size_t(1)<<28)))
-        --lsq2;
-      auto ssmall = log2tile-lsq2;
-      auto msmall = (size_t(1)<<ssmall) - 1;
-
-      coord_idx.resize(npoints);
-      quick_array<uint32_t> key(npoints);
-      execParallel(npoints, nthreads, [&](size_t lo, size_t hi)
+      static_assert(sizeof(Tpoints)<=sizeof(Tcalc),
+        "Tcalc must be at least as accurate as Tpoints");
+      MR_assert(points_in.shape(1)==npoints_in, "number of input points mismatch");
+      MR_assert(points_out.shape(1)==npoints_out,
+        "number of output points mismatch");
+      size_t ntrans = points_in.shape(0);
+      MR_assert(points_out.shape(0)==ntrans, "number of transforms mismatch");
+      if ((ntrans==0) || (npoints_out==0)) return;
+      if (npoints_in==0)
         {
-        for (size_t i=lo; i<hi; ++i)
+        mav_apply([](complex<Tpoints> &v){v=complex<Tpoints>(0);}, nthreads,
+          points_out);
+        return;
+        }
+      if (verbosity>0) report(ntrans);
+      timers.push("nu2nu proper");
+      timers.push("allocating grid");
+      array<size_t,ndim+1> gshape;
+      gshape[0] = ntrans;
+      for (size_t d=0; d<ndim; ++d) gshape[d+1] = spreader->nover[d];
+      auto grid = vmav<complex<Tcalc>,ndim+1>::build_noncritical(gshape, UNINITIALIZED);
+      timers.poppush("zeroing grid");
+      mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid);
+      if (prephase.size()!=0)
+        {
+        timers.poppush("phase shift");
+        vmav<complex<Tcalc>,2> points2({ntrans, npoints_in}, UNINITIALIZED);
+        execParallel(npoints_in, nthreads, [&](size_t lo, size_t hi)
           {
-          auto tile = parent::template get_tile<Tcoord>({coords(i,0),coords(i,1),coords(i,2)},lsq2);
-          auto lowkey = ((tile[0]&msmall)<<(2*ssmall))
-                      | ((tile[1]&msmall)<<   ssmall)
-                      |  (tile[2]&msmall);
-          auto hikey = ((tile[0]>>ssmall)*ntiles_v*ntiles_w)
-                     + ((tile[1]>>ssmall)*ntiles_w)
-                     +  (tile[2]>>ssmall);
-          key[i] = (hikey<<(3*ssmall)) | lowkey;
-          }
+          for (size_t t=0; t<ntrans; ++t)
+            for (size_t i=lo; i<hi; ++i)
+              points2(t,i) = complex<Tcalc>(points_in(t,i))
+                           * (forward ? prephase[i] : conj(prephase[i]));
+          });
+        timers.poppush("spreading");
+        spreader->spread_batch(spreader->coords_sorted, points2, grid);
+        }
+      else
+        {
+        timers.poppush("spreading");
+        spreader->spread_batch(spreader->coords_sorted, points_in, grid);
+        }
+      timers.poppush("interpolation");
+      interpolator->u2nu(forward, 0, grid, points_out);
+      timers.poppush("correction");
+      execParallel(npoints_out, nthreads, [&](size_t lo, size_t hi)
+        {
+        for (size_t t=0; t<ntrans; ++t)
+          for (size_t i=lo; i<hi; ++i)
+            points_out(t,i) = complex<Tpoints>(complex<Tcalc>(points_out(t,i))
+              * (forward ? postfac[i] : conj(postfac[i])));
         });
-      bucket_sort2(key, coord_idx, (ntiles_u*ntiles_v*ntiles_w)<<(3*ssmall), nthreads);
       timers.pop();
+      timers.pop();
+      if (verbosity>0) timers.report(cout);
+      }
+    /* single-transform variant of the above */
+    template<typename Tpoints> void nu2nu(bool forward, size_t verbosity,
+      const cmav<complex<Tpoints>,1> &points_in,
+      vmav<complex<Tpoints>,1> &points_out)
+      {
+      auto points_out2 = points_out.prepend_1();
+      nu2nu(forward, verbosity, points_in.prepend_1(), points_out2);
       }
   };
 
-#undef DUCC0_NUFFT_BOILERPLATE
-
 template<typename Tcalc, typename Tacc, typename Tpoints, typename Tgrid, typename Tcoord>
   void nu2u(const cmav<Tcoord,2> &coord, const cmav<complex<Tpoints>,1> &points,
     bool forward, double epsilon, size_t nthreads,
@@ -1852,7 +3052,7 @@ template<typename Tcalc, typename Tacc, typename Tpoints, typename Tgrid, typena
     double sigma_min, double sigma_max, double periodicity, bool fft_order)
   {
   auto ndim = uniform.ndim();
-  MR_assert((ndim>=1) && (ndim<=3), "transform must be 1D/2D/3D");
+  MR_assert((ndim>=1) && (ndim<=4), "transform must be 1D/2D/3D/4D");
   MR_assert(ndim==coord.shape(1), "dimensionality mismatch");
   if (ndim==1)
     {
@@ -1875,6 +3075,13 @@ template<typename Tcalc, typename Tacc, typename Tpoints, typename Tgrid, typena
       epsilon, nthreads, sigma_min, sigma_max, periodicity, fft_order);
     nufft.nu2u(forward, verbosity, coord, points, uniform2); 
     }
+  else if (ndim==4)
+    {
+    vmav<complex<Tgrid>,4> uniform2(uniform);
+    Nufft<Tcalc, Tacc, Tcoord, 4> nufft(true, points.shape(0), uniform2.shape(),
+      epsilon, nthreads, sigma_min, sigma_max, periodicity, fft_order);
+    nufft.nu2u(forward, verbosity, coord, points, uniform2);
+    }
   }
 template<typename Tcalc, typename Tacc, typename Tpoints, typename Tgrid, typename Tcoord>
   void u2nu(const cmav<Tcoord,2> &coord, const cfmav<complex<Tgrid>> &uniform,
@@ -1883,7 +3090,7 @@ template<typename Tcalc, typename Tacc, typename Tpoints, typename Tgrid, typena
     double sigma_min, double sigma_max, double periodicity, bool fft_order)
   {
   auto ndim = uniform.ndim();
-  MR_assert((ndim>=1) && (ndim<=3), "transform must be 1D/2D/3D");
+  MR_assert((ndim>=1) && (ndim<=4), "transform must be 1D/2D/3D/4D");
   MR_assert(ndim==coord.shape(1), "dimensionality mismatch");
   if (ndim==1)
     {
@@ -1906,14 +3113,148 @@ template<typename Tcalc, typename Tacc, typename Tpoints, typename Tgrid, typena
       epsilon, nthreads, sigma_min, sigma_max, periodicity, fft_order);
     nufft.u2nu(forward, verbosity, uniform2, coord, points); 
     }
+  else if (ndim==4)
+    {
+    cmav<complex<Tgrid>,4> uniform2(uniform);
+    Nufft<Tcalc, Tacc, Tcoord, 4> nufft(false, points.shape(0), uniform2.shape(),
+      epsilon, nthreads, sigma_min, sigma_max, periodicity, fft_order);
+    nufft.u2nu(forward, verbosity, uniform2, coord, points);
+    }
   }
+template<typename Tcalc, typename Tacc, typename Tpoints, typename Tcoord>
+  void nu2nu(const cmav<Tcoord,2> &coord_in,
+    const cmav<complex<Tpoints>,1> &points_in, const cmav<Tcoord,2> &coord_out,
+    bool forward, double epsilon, size_t nthreads,
+    vmav<complex<Tpoints>,1> &points_out, size_t verbosity,
+    double sigma_min, double sigma_max)
+  {
+  auto ndim = coord_in.shape(1);
+  MR_assert((ndim>=1) && (ndim<=3), "transform must be 1D/2D/3D");
+  MR_assert(ndim==coord_out.shape(1), "dimensionality mismatch");
+  if (ndim==1)
+    {
+    Nufft3<Tcalc, Tacc, Tcoord, 1> nufft(coord_in, coord_out, epsilon,
+      nthreads, sigma_min, sigma_max);
+    nufft.nu2nu(forward, verbosity, points_in, points_out);
+    }
+  else if (ndim==2)
+    {
+    Nufft3<Tcalc, Tacc, Tcoord, 2> nufft(coord_in, coord_out, epsilon,
+      nthreads, sigma_min, sigma_max);
+    nufft.nu2nu(forward, verbosity, points_in, points_out);
+    }
+  else if (ndim==3)
+    {
+    Nufft3<Tcalc, Tacc, Tcoord, 3> nufft(coord_in, coord_out, epsilon,
+      nthreads, sigma_min, sigma_max);
+    nufft.nu2nu(forward, verbosity, points_in, points_out);
+    }
+  }
+/*! Returns the time (in s) per kernel evaluation and grid update per SIMD
+    lane, measured with \a npoints points on a prebuilt 2D plan with Tcalc
+    and Tacc equal to \a T. Only the spreading and interpolation steps are
+    timed; the grid is small enough that the results hardly depend on cache
+    effects. */
+template<typename T> double measureGriddingCost(size_t npoints)
+  {
+  constexpr size_t nuni=64;
+  constexpr double epsilon=1e-5, sigma_min=1.9, sigma_max=2.1;
+  MR_assert(npoints>0, "need at least one point");
+  vmav<T,2> coords({npoints,2}, UNINITIALIZED);
+  for (size_t i=0; i<npoints; ++i)
+    {
+    // R2 low-discrepancy sequence, which jumps around the whole domain
+    coords(i,0) = T(2*pi*fmod(0.5+(i+1)*0.7548776662466927, 1.)-pi);
+    coords(i,1) = T(2*pi*fmod(0.5+(i+1)*0.5698402909980532, 1.)-pi);
+    }
+  vmav<complex<T>,1> points({npoints});
+  vmav<complex<T>,2> grid({nuni,nuni});
+  auto best_time = [](auto &plan, auto &&func, const string &step)
+    {
+    double tmin = 1e300;
+    for (size_t i=0; i<3; ++i)
+      {
+      double t0 = plan.get_timings()[step];
+      func();
+      tmin = min(tmin, plan.get_timings()[step]-t0);
+      }
+    return tmin;
+    };
+  Nufft<T,T,T,2> gplan(true, coords, {nuni,nuni}, epsilon, 1, sigma_min,
+    sigma_max, 2*pi, false);
+  auto tg = best_time(gplan, [&]{ gplan.nu2u(true, 0, points, grid); },
+    "nu2u:nu2u proper:spreading");
+  Nufft<T,T,T,2> iplan(false, coords, {nuni,nuni}, epsilon, 1, sigma_min,
+    sigma_max, 2*pi, false);
+  auto ti = best_time(iplan, [&]{ iplan.u2nu(true, 0, grid, points); },
+    "u2nu:u2nu proper:interpolation");
+  size_t supp = gplan.kernel_support();
+  size_t vlen = mysimd<T>::size();
+  size_t nvec = (supp+vlen-1)/vlen;
+  double nops = double(npoints)*(nvec*vlen*supp + 2*nvec*(supp+3)*vlen);
+  return 0.5*(tg+ti)/nops;
+  }
+
+/*! Measures FFT and spreading/interpolation throughput on the host in single
+    and double precision and derives a GriddingCostModel from the timings.
+    The spreading benchmark uses \a npoints points; FFT scaling is measured
+    with \a nthreads threads. If \a activate is true, the result becomes the
+    active cost model used by subsequent NUFFT and gridding operations. */
+inline GriddingCostModel calibrateGriddingCostModel(size_t nthreads,
+  size_t npoints=1000000, bool activate=true)
+  {
+  auto res = getGriddingCostModel();
+  nthreads = adjust_nthreads(nthreads);
+  auto best_time = [](auto &&func)
+    {
+    double tmin = 1e300;
+    for (size_t i=0; i<3; ++i)
+      {
+      SimpleTimer timer;
+      func();
+      tmin = min(tmin, timer());
+      }
+    return tmin;
+    };
+
+  // FFT throughput
+  constexpr size_t nfft=1024;
+  vmav<complex<double>,2> arr({nfft,nfft});
+  vfmav<complex<double>> farr(arr);
+  auto t1 = best_time([&]{ c2c(farr, farr, {0,1}, true, 1., 1); });
+  res.fft_cost *= t1/res.fftTime(double(nfft)*nfft, false);
+  {
+  vmav<complex<float>,2> arrf({nfft,nfft});
+  vfmav<complex<float>> farrf(arrf);
+  auto t1f = best_time([&]{ c2c(farrf, farrf, {0,1}, true, 1.f, 1); });
+  res.fft_cost_single *= t1f/res.fftTime(double(nfft)*nfft, true);
+  }
+  if (nthreads>1)
+    {
+    auto tn = best_time([&]{ c2c(farr, farr, {0,1}, true, 1., nthreads); });
+    // invert GriddingCostModel::fftSpeedup() for the measured speedup
+    double x2 = double(nthreads)-1, y2 = max(t1/tn-1., 1e-3*x2);
+    res.max_fft_scaling = 1.+x2/sqrt(max((x2/y2)*(x2/y2)-1., 0.01));
+    }
+
+  // spreading and interpolation throughput
+  res.gridding_cost = measureGriddingCost<double>(npoints);
+  res.gridding_cost_single = measureGriddingCost<float>(npoints);
+
+  if (activate) setGriddingCostModel(res);
+  return res;
+  }
+
 } // namespace detail_nufft
 
 // public names
+using detail_nufft::calibrateGriddingCostModel;
 using detail_nufft::findNufftKernel;
 using detail_nufft::u2nu;
 using detail_nufft::nu2u;
+using detail_nufft::nu2nu;
 using detail_nufft::Nufft;
+using detail_nufft::Nufft3;
 
 } // namespace ducc0
 
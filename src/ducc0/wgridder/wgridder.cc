@@ -277,4 +277,56 @@ tuple<vmav<uint8_t,2>,size_t,size_t,size_t> get_tuning_parameters(
     return make_tuple(wbin, miniwcut, minminnfx, minminnfy);
   }
 
+namespace {
+
+Mutex overridesMutex;
+GridderOverrides activeOverrides;
+
+}
+
+GridderOverrides getGridderOverrides()
+  {
+  LockGuard lock(overridesMutex);
+  return activeOverrides;
+  }
+
+void setGridderOverrides(const GridderOverrides &ovr)
+  {
+  LockGuard lock(overridesMutex);
+  activeOverrides = ovr;
+  }
+
+size_t gridder_memory_budget()
+  {
+  try
+    { return usable_memory()*size_t(1024)/2; } // use at most half of it
+  catch (...) // memory information is not available on all systems
+    { return 0; }
+  }
+
+size_t get_facet_concurrency(size_t nfacets, size_t nthreads,
+  size_t bytes_per_facet, size_t verbosity)
+  {
+  nthreads = adjust_nthreads(nthreads);
+  // Small facets do not keep many threads busy, so it is better to process
+  // several of them at the same time, as many as there are facets, threads
+  // and memory for their buffers.
+  size_t nconc = max<size_t>(1, min(nfacets, nthreads));
+  auto fixed = getGridderOverrides().facet_concurrency;
+  if (fixed>0)
+    nconc = max<size_t>(1, min({fixed, nfacets, nthreads}));
+  else if ((nconc>1) && (bytes_per_facet>0))
+    nconc = max<size_t>(1, min(nconc, gridder_memory_budget()/bytes_per_facet));
+  if (verbosity>0)
+    {
+    if (nconc>1)
+      cout << "  processing " << nconc << " facets concurrently with "
+           << nthreads/nconc << " thread(s) each ("
+           << bytes_per_facet/double(1<<30) << "GB per facet)" << endl;
+    else
+      cout << "  processing facets one after the other" << endl;
+    }
+  return nconc;
+  }
+
 }}
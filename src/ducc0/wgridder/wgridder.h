@@ -35,6 +35,7 @@
 #include <array>
 #include <atomic>
 #include <memory>
+#include <optional>
 #if ((!defined(DUCC0_NO_SIMD)) && (defined(__AVX__)||defined(__SSE3__)))
 #include <x86intrin.h>
 #endif
@@ -48,9 +49,16 @@
 #include "ducc0/infra/mav.h"
 #include "ducc0/infra/simd.h"
 #include "ducc0/infra/timers.h"
+#include "ducc0/infra/system.h"
 #include "ducc0/math/gridding_kernel.h"
 #include "ducc0/math/rangeset.h"
 
+// base-2 logarithm of the number of rows per row block (see RowchanRange);
+// only meant to be reduced for testing purposes.
+#ifndef DUCC0_WGRIDDER_LOG2_ROWBLOCK
+#define DUCC0_WGRIDDER_LOG2_ROWBLOCK 32
+#endif
+
 namespace ducc0 {
 
 namespace detail_gridder {
@@ -152,6 +160,30 @@ template<size_t ndim> void checkShape
   (const array<size_t, ndim> &shp1, const array<size_t, ndim> &shp2)
   { MR_assert(shp1==shp2, "shape mismatch"); }
 
+// converts a rangeset into a list of index ranges for c2c_pruned()
+inline vector<slice> ranges2slices(const rangeset<int> &rs)
+  {
+  vector<slice> res;
+  for (size_t i=0; i<rs.nranges(); ++i)
+    res.emplace_back(size_t(rs.ivbegin(i)), size_t(rs.ivend(i)));
+  return res;
+  }
+// converts the union of the rangesets \a rs[lo] ... \a rs[hi-1] into a list
+// of index ranges for c2c_pruned()
+inline vector<slice> ranges2slices(const vector<rangeset<int>> &rs,
+  size_t lo, size_t hi)
+  {
+  rangeset<int> res;
+  for (size_t i=lo; i<hi; ++i)
+    res = res.op_or(rs[i]);
+  return ranges2slices(res);
+  }
+
+// index ranges of a grid axis of length n that correspond to an image axis
+// of length ndirty
+inline vector<slice> dirty_slices(size_t n, size_t ndirty)
+  { return {{0, ndirty/2}, {n-ndirty/2, n}}; }
+
 //
 // Start of real gridder functionality
 //
@@ -223,14 +255,41 @@ template<typename T> void hartley2_2D(vmav<T,2> &arr, size_t vlim,
      });
   }
 
+/*! Parameters of the w-gridder that are normally chosen automatically.
+ *  They can be fixed for testing code paths which are otherwise only taken
+ *  on large machines; a value of 0 means automatic choice. */
+struct GridderOverrides
+  {
+  /// number of w planes that are gridded, transformed and w-screened
+  /// together (see Wgridder::planes_in_flight())
+  size_t planes_in_flight=0;
+  /// number of facets processed concurrently by the tuned gridding routines,
+  /// at most the number of threads (see get_facet_concurrency())
+  size_t facet_concurrency=0;
+  };
+
+/// Returns the overrides used by gridding operations started from now on.
+GridderOverrides getGridderOverrides();
+/// Replaces the overrides used by gridding operations started from now on.
+void setGridderOverrides(const GridderOverrides &ovr);
+
+/// Returns the number of bytes which the gridder may use for optional
+/// buffers (half of the memory not yet committed), or 0 if unknown.
+size_t gridder_memory_budget();
+
 class Uvwidx
   {
   public:
     uint16_t tile_u, tile_v, minplane;
+    // rows are stored as 32-bit offsets relative to rowblock<<log2_rowblock
+    // (see RowchanRange); not part of the comparisons below
+    uint16_t rowblock;
 
     Uvwidx() {}
-    Uvwidx(uint16_t tile_u_, uint16_t tile_v_, uint16_t minplane_)
-      : tile_u(tile_u_), tile_v(tile_v_), minplane(minplane_) {}
+    Uvwidx(uint16_t tile_u_, uint16_t tile_v_, uint16_t minplane_,
+      uint16_t rowblock_=0)
+      : tile_u(tile_u_), tile_v(tile_v_), minplane(minplane_),
+        rowblock(rowblock_) {}
 
     uint64_t idx() const
       { return (uint64_t(tile_u)<<32) + (uint64_t(tile_v)<<16) + minplane; }
@@ -243,6 +302,8 @@ class Uvwidx
 class RowchanRange
   {
   public:
+    // lower log2_rowblock bits of the row index; the upper ones are stored
+    // in the rowblock field of the corresponding Uvwidx
     uint32_t row;
     uint16_t ch_begin, ch_end;
 
@@ -334,23 +395,25 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
     constexpr static int log2tile=is_same<Tacc,float>::value ? 5 : 4;
     bool gridding;
     TimerHierarchy timers;
-    const cmav<complex<Tms>,2> &ms_in;
-    vmav<complex<Tms>,2> &ms_out;
-    const cmav<Timg,2> &dirty_in;
-    vmav<Timg,2> &dirty_out;
-    const cmav<Tms,2> &wgt;
-    const cmav<uint8_t,2> &mask;
+    cmav<Tms,2> wgt;
     vmav<uint8_t,2> lmask;
     double pixsize_x, pixsize_y;
     size_t nxdirty, nydirty;
+    size_t ncorr;
     double epsilon;
     bool do_wgridding;
     size_t nthreads;
     size_t verbosity;
     bool negate_v, divide_by_n;
     double sigma_min, sigma_max;
+    // degridding adds to the visibilities instead of overwriting them
+    bool add_ms=false;
 
     Baselines bl;
+    // base-2 logarithm of the number of rows per row block (see RowchanRange)
+    static constexpr size_t log2_rowblock = DUCC0_WGRIDDER_LOG2_ROWBLOCK;
+    static_assert((log2_rowblock>0) && (log2_rowblock<=32),
+      "bad row block size");
     vector<RowchanRange> ranges;
     vector<pair<Uvwidx, size_t>> blockstart;
 
@@ -358,6 +421,14 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
     size_t nvis;
     double wmin, dw, xdw, wshift;
     size_t nplanes;
+
+    // cube mode: image index of every channel; the blocks of image i are
+    // blockstart[img_bs[i]] to blockstart[img_bs[i+1]-1], and they touch
+    // the w planes [planes_img[i].first; planes_img[i].second[
+    size_t nimg;
+    vector<size_t> chan2img;
+    vector<size_t> img_bs;
+    vector<pair<size_t, size_t>> planes_img;
     double nm1min, nm1max;
 
     double lshift, mshift, nshift;
@@ -373,7 +444,7 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
     int maxiu0, maxiv0;
     size_t vlim;
     bool uv_side_fast;
-    vector<rangeset<int>> uranges, vranges;
+    vector<rangeset<int>> uranges, vranges;  // indexed by img*nplanes+plane
 
     static_assert(sizeof(Tcalc)<=sizeof(Tacc), "bad type combination");
     static_assert(sizeof(Tms)<=sizeof(Tcalc), "bad type combination");
@@ -414,61 +485,90 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
           }
         });
       }
-    void grid2dirty_post2(vmav<complex<Tcalc>,2> &tmav, vmav<Timg,2> &dirty, double w)
+    // maximum number of consecutive w-screens obtained by rotating the
+    // previous one (each rotation adds a rounding error of order epsilon(Tcalc))
+    static constexpr size_t phase_resync = 8;
+
+    // accumulates the w-screened planes w, w+dw, ... stored in \a tmav onto
+    // \a dirty, and zeroes \a tmav
+    void grid2dirty_post2(vmav<complex<Tcalc>,3> &tmav, vmav<Timg,3> &dirty, double w)
       {
       timers.push("wscreen+grid correction");
-      checkShape(dirty.shape(), {nxdirty,nydirty});
+      checkShape(dirty.shape(), {ncorr,nxdirty,nydirty});
+      size_t np = tmav.shape(0)/ncorr;
       double x0 = lshift-0.5*nxdirty*pixsize_x,
              y0 = mshift-0.5*nydirty*pixsize_y;
       size_t nxd = lmshift ? nxdirty : (nxdirty/2+1);
       execParallel(nxd, nthreads, [&](size_t lo, size_t hi)
         {
         vector<complex<Tcalc>> phases(lmshift ? nydirty : (nydirty/2+1));
+        vector<complex<Tcalc>> step(np>1 ? phases.size() : 0);
         vector<Tcalc> buf(lmshift ? nydirty : (nydirty/2+1));
         for (auto i=lo; i<hi; ++i)
           {
           double fx = sqr(x0+i*pixsize_x);
           size_t ix = nu-nxdirty/2+i;
           if (ix>=nu) ix-=nu;
-          expi(phases, buf, [&](size_t i)
-            { return Tcalc(phase(fx, sqr(y0+i*pixsize_y), w, true, nshift)); });
-          if (lmshift)
-            for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
-              {
-              dirty(i,j) += Timg(tmav(ix,jx).real()*phases[j].real()
-                               - tmav(ix,jx).imag()*phases[j].imag());
-              tmav(ix,jx) = complex<Tcalc>(0);
-              }
-          else
+          // the phase is linear in w, so the screens of the following planes
+          // are obtained by rotation; they are recomputed directly every
+          // phase_resync planes to keep rounding errors from accumulating
+          if (np>1)
+            expi(step, buf, [&](size_t i)
+              { return Tcalc(phase(fx, sqr(y0+i*pixsize_y), dw, true, nshift)); });
+          for (size_t q=0; q<np; ++q)
             {
-            size_t i2 = nxdirty-i;
-            size_t ix2 = nu-nxdirty/2+i2;
-            if (ix2>=nu) ix2-=nu;
-            if ((i>0)&&(i<i2))
-              for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
-                {
-                size_t j2 = min(j, nydirty-j);
-                Tcalc re = phases[j2].real(), im = phases[j2].imag();
-                dirty(i ,j) += Timg(tmav(ix ,jx).real()*re - tmav(ix ,jx).imag()*im);
-                dirty(i2,j) += Timg(tmav(ix2,jx).real()*re - tmav(ix2,jx).imag()*im);
-                tmav(ix,jx) = tmav(ix2,jx) = complex<Tcalc>(0);
-                }
+            if (q%phase_resync==0)
+              expi(phases, buf, [&](size_t i)
+                { return Tcalc(phase(fx, sqr(y0+i*pixsize_y), w+q*dw, true, nshift)); });
             else
-              for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
+              for (size_t j=0; j<phases.size(); ++j)
+                phases[j] *= step[j];
+            // the w-screen is shared by all correlations
+            for (size_t c0=0; c0<ncorr; ++c0)
+              {
+              size_t c = q*ncorr+c0;
+              if (lmshift)
+                for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
+                  {
+                  dirty(c0,i,j) += Timg(tmav(c,ix,jx).real()*phases[j].real()
+                                     - tmav(c,ix,jx).imag()*phases[j].imag());
+                  tmav(c,ix,jx) = complex<Tcalc>(0);
+                  }
+              else
                 {
-                size_t j2 = min(j, nydirty-j);
-                Tcalc re = phases[j2].real(), im = phases[j2].imag();
-                dirty(i,j) += Timg(tmav(ix,jx).real()*re - tmav(ix,jx).imag()*im); // lower left
-                tmav(ix,jx) = complex<Tcalc>(0);
+                size_t i2 = nxdirty-i;
+                size_t ix2 = nu-nxdirty/2+i2;
+                if (ix2>=nu) ix2-=nu;
+                if ((i>0)&&(i<i2))
+                  for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
+                    {
+                    size_t j2 = min(j, nydirty-j);
+                    Tcalc re = phases[j2].real(), im = phases[j2].imag();
+                    dirty(c0,i ,j) += Timg(tmav(c,ix ,jx).real()*re - tmav(c,ix ,jx).imag()*im);
+                    dirty(c0,i2,j) += Timg(tmav(c,ix2,jx).real()*re - tmav(c,ix2,jx).imag()*im);
+                    tmav(c,ix,jx) = tmav(c,ix2,jx) = complex<Tcalc>(0);
+                    }
+                else
+                  for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
+                    {
+                    size_t j2 = min(j, nydirty-j);
+                    Tcalc re = phases[j2].real(), im = phases[j2].imag();
+                    dirty(c0,i,j) += Timg(tmav(c,ix,jx).real()*re - tmav(c,ix,jx).imag()*im); // lower left
+                    tmav(c,ix,jx) = complex<Tcalc>(0);
+                    }
                 }
+              }
             }
           }
         });
       timers.poppush("zeroing grid");
       // only zero the parts of the grid that have not been zeroed before
-      { auto a0 = subarray<2>(tmav, {{0,nxdirty/2}, {nydirty/2,nv-nydirty/2}}); quickzero(a0, nthreads); }
-      { auto a0 = subarray<2>(tmav, {{nxdirty/2, nu-nxdirty/2}, {}}); quickzero(a0, nthreads); }
-      { auto a0 = subarray<2>(tmav, {{nu-nxdirty/2,MAXIDX}, {nydirty/2, nv-nydirty/2}}); quickzero(a0, nthreads); }
+      for (size_t c=0; c<tmav.shape(0); ++c)
+        {
+        { auto a0 = subarray<2>(tmav, {{c}, {0,nxdirty/2}, {nydirty/2,nv-nydirty/2}}); quickzero(a0, nthreads); }
+        { auto a0 = subarray<2>(tmav, {{c}, {nxdirty/2, nu-nxdirty/2}, {}}); quickzero(a0, nthreads); }
+        { auto a0 = subarray<2>(tmav, {{c}, {nu-nxdirty/2,MAXIDX}, {nydirty/2, nv-nydirty/2}}); quickzero(a0, nthreads); }
+        }
       timers.pop();
       }
 
@@ -482,42 +582,22 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
       timers.pop();
       }
 
+    // \a grid holds consecutive planes starting at w; \a iplane is the
+    // uranges/vranges index of the first one
     void grid2dirty_c_overwrite_wscreen_add
-      (vmav<complex<Tcalc>,2> &grid, vmav<Timg,2> &dirty, double w, size_t iplane)
+      (vmav<complex<Tcalc>,3> &grid, vmav<Timg,3> &dirty, double w, size_t iplane)
       {
       timers.push("FFT");
-      checkShape(grid.shape(), {nu,nv});
+      checkShape(grid.shape(), {grid.shape(0),nu,nv});
+      size_t iplane_end = iplane + grid.shape(0)/ncorr;
       vfmav<complex<Tcalc>> inout(grid);
-
-      const auto &rsu(uranges[iplane]);
-      const auto &rsv(vranges[iplane]);
-      auto cost_ufirst = nxdirty*log(nv)*nv + rsv.nval()*log(nu)*nu;
-      auto cost_vfirst = nydirty*log(nu)*nu + rsu.nval()*log(nv)*nv;
-      if (cost_ufirst<cost_vfirst)
-        {
-        for (size_t i=0; i<rsv.nranges(); ++i)
-          {
-          auto inout_tmp = inout.subarray({{},{size_t(rsv.ivbegin(i)), size_t(rsv.ivend(i))}});
-          c2c(inout_tmp, inout_tmp, {0}, BACKWARD, Tcalc(1), nthreads);
-          }
-        auto inout_lo = inout.subarray({{0,nxdirty/2},{}});
-        c2c(inout_lo, inout_lo, {1}, BACKWARD, Tcalc(1), nthreads);
-        auto inout_hi = inout.subarray({{inout.shape(0)-nxdirty/2, MAXIDX},{}});
-        c2c(inout_hi, inout_hi, {1}, BACKWARD, Tcalc(1), nthreads);
-        }
-      else
-        {
-        for (size_t i=0; i<rsu.nranges(); ++i)
-          {
-          auto inout_tmp = inout.subarray({{size_t(rsu.ivbegin(i)), size_t(rsu.ivend(i))}, {}});
-          c2c(inout_tmp, inout_tmp, {1}, BACKWARD, Tcalc(1), nthreads);
-          }
-        auto inout_lo = inout.subarray({{}, {0,nydirty/2}});
-        c2c(inout_lo, inout_lo, {0}, BACKWARD, Tcalc(1), nthreads);
-        auto inout_hi = inout.subarray({{},{inout.shape(1)-nydirty/2, MAXIDX}});
-        c2c(inout_hi, inout_hi, {0}, BACKWARD, Tcalc(1), nthreads);
-        }
-
+      // all planes are transformed together; each of them is only nonzero in
+      // the union of the occupied u and v ranges (the grid is zeroed between
+      // passes), and only the parts corresponding to the dirty image are
+      // needed
+      c2c_pruned(inout, {1,2}, {ranges2slices(uranges, iplane, iplane_end),
+        ranges2slices(vranges, iplane, iplane_end)}, {dirty_slices(nu, nxdirty),
+        dirty_slices(nv, nydirty)}, BACKWARD, Tcalc(1), nthreads);
       timers.pop();
       grid2dirty_post2(grid, dirty, w);
       }
@@ -552,15 +632,20 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
         });
       timers.pop();
       }
-    void dirty2grid_pre2(const cmav<Timg,2> &dirty, vmav<complex<Tcalc>,2> &grid, double w)
+    // fills \a grid with the w-screened images for the planes w, w+dw, ...
+    void dirty2grid_pre2(const cmav<Timg,3> &dirty, vmav<complex<Tcalc>,3> &grid, double w)
       {
       timers.push("zeroing grid");
-      checkShape(dirty.shape(), {nxdirty, nydirty});
-      checkShape(grid.shape(), {nu, nv});
+      checkShape(dirty.shape(), {ncorr, nxdirty, nydirty});
+      checkShape(grid.shape(), {grid.shape(0), nu, nv});
+      size_t np = grid.shape(0)/ncorr;
       // only zero the parts of the grid that are not filled afterwards anyway
-      { auto a0 = subarray<2>(grid, {{0,nxdirty/2}, {nydirty/2, nv-nydirty/2}}); quickzero(a0, nthreads); }
-      { auto a0 = subarray<2>(grid, {{nxdirty/2,nu-nxdirty/2}, {}}); quickzero(a0, nthreads); }
-      { auto a0 = subarray<2>(grid, {{nu-nxdirty/2,MAXIDX}, {nydirty/2,nv-nydirty/2}}); quickzero(a0, nthreads); }
+      for (size_t c=0; c<grid.shape(0); ++c)
+        {
+        { auto a0 = subarray<2>(grid, {{c}, {0,nxdirty/2}, {nydirty/2, nv-nydirty/2}}); quickzero(a0, nthreads); }
+        { auto a0 = subarray<2>(grid, {{c}, {nxdirty/2,nu-nxdirty/2}, {}}); quickzero(a0, nthreads); }
+        { auto a0 = subarray<2>(grid, {{c}, {nu-nxdirty/2,MAXIDX}, {nydirty/2,nv-nydirty/2}}); quickzero(a0, nthreads); }
+        }
       timers.poppush("wscreen+grid correction");
       double x0 = lshift-0.5*nxdirty*pixsize_x,
              y0 = mshift-0.5*nydirty*pixsize_y;
@@ -568,32 +653,48 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
       execParallel(nxd, nthreads, [&](size_t lo, size_t hi)
         {
         vector<complex<Tcalc>> phases(lmshift ? nydirty : (nydirty/2+1));
+        vector<complex<Tcalc>> step(np>1 ? phases.size() : 0);
         vector<Tcalc> buf(lmshift ? nydirty : (nydirty/2+1));
         for(auto i=lo; i<hi; ++i)
           {
           double fx = sqr(x0+i*pixsize_x);
           size_t ix = nu-nxdirty/2+i;
           if (ix>=nu) ix-=nu;
-          expi(phases, buf, [&](size_t i)
-            { return Tcalc(phase(fx, sqr(y0+i*pixsize_y), w, false, nshift)); });
-          if (lmshift)
-            for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
-              grid(ix,jx) = Tcalc(dirty(i,j))*phases[j];
-          else
+          if (np>1)
+            expi(step, buf, [&](size_t i)
+              { return Tcalc(phase(fx, sqr(y0+i*pixsize_y), dw, false, nshift)); });
+          for (size_t q=0; q<np; ++q)
             {
-            size_t i2 = nxdirty-i;
-            size_t ix2 = nu-nxdirty/2+i2;
-            if (ix2>=nu) ix2-=nu;
-            if ((i>0)&&(i<i2))
-              for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
+            if (q%phase_resync==0)
+              expi(phases, buf, [&](size_t i)
+                { return Tcalc(phase(fx, sqr(y0+i*pixsize_y), w+q*dw, false, nshift)); });
+            else
+              for (size_t j=0; j<phases.size(); ++j)
+                phases[j] *= step[j];
+            // the w-screen is shared by all correlations
+            for (size_t c0=0; c0<ncorr; ++c0)
+              {
+              size_t c = q*ncorr+c0;
+              if (lmshift)
+                for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
+                  grid(c,ix,jx) = Tcalc(dirty(c0,i,j))*phases[j];
+              else
                 {
-                size_t j2 = min(j, nydirty-j);
-                grid(ix ,jx) = Tcalc(dirty(i ,j))*phases[j2]; // lower left
-                grid(ix2,jx) = Tcalc(dirty(i2,j))*phases[j2]; // lower right
+                size_t i2 = nxdirty-i;
+                size_t ix2 = nu-nxdirty/2+i2;
+                if (ix2>=nu) ix2-=nu;
+                if ((i>0)&&(i<i2))
+                  for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
+                    {
+                    size_t j2 = min(j, nydirty-j);
+                    grid(c,ix ,jx) = Tcalc(dirty(c0,i ,j))*phases[j2]; // lower left
+                    grid(c,ix2,jx) = Tcalc(dirty(c0,i2,j))*phases[j2]; // lower right
+                    }
+                else
+                  for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
+                    grid(c,ix,jx) = Tcalc(dirty(c0,i,j))*phases[min(j, nydirty-j)]; // lower left
                 }
-            else
-              for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
-                grid(ix,jx) = Tcalc(dirty(i,j))*phases[min(j, nydirty-j)]; // lower left
+              }
             }
           }
         });
@@ -608,41 +709,21 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
       timers.pop();
       }
 
-    void dirty2grid_c_wscreen(const cmav<Timg,2> &dirty,
-      vmav<complex<Tcalc>,2> &grid, double w, size_t iplane)
+    // \a grid receives consecutive planes starting at w; \a iplane is the
+    // uranges/vranges index of the first one
+    void dirty2grid_c_wscreen(const cmav<Timg,3> &dirty,
+      vmav<complex<Tcalc>,3> &grid, double w, size_t iplane)
       {
       dirty2grid_pre2(dirty, grid, w);
       timers.push("FFT");
+      size_t iplane_end = iplane + grid.shape(0)/ncorr;
       vfmav<complex<Tcalc>> inout(grid);
-
-      const auto &rsu(uranges[iplane]);
-      const auto &rsv(vranges[iplane]);
-      auto cost_ufirst = nydirty*log(nu)*nu + rsu.nval()*log(nv)*nv;
-      auto cost_vfirst = nxdirty*log(nv)*nv + rsv.nval()*log(nu)*nu;
-      if (cost_ufirst<cost_vfirst)
-        {
-        auto inout_lo = inout.subarray({{}, {0,nydirty/2}});
-        c2c(inout_lo, inout_lo, {0}, FORWARD, Tcalc(1), nthreads);
-        auto inout_hi = inout.subarray({{},{inout.shape(1)-nydirty/2, MAXIDX}});
-        c2c(inout_hi, inout_hi, {0}, FORWARD, Tcalc(1), nthreads);
-        for (size_t i=0; i<rsu.nranges(); ++i)
-          {
-          auto inout_tmp = inout.subarray({{size_t(rsu.ivbegin(i)), size_t(rsu.ivend(i))}, {}});
-          c2c(inout_tmp, inout_tmp, {1}, FORWARD, Tcalc(1), nthreads);
-          }
-        }
-      else
-        {
-        auto inout_lo = inout.subarray({{0,nxdirty/2},{}});
-        c2c(inout_lo, inout_lo, {1}, FORWARD, Tcalc(1), nthreads);
-        auto inout_hi = inout.subarray({{inout.shape(0)-nxdirty/2, MAXIDX},{}});
-        c2c(inout_hi, inout_hi, {1}, FORWARD, Tcalc(1), nthreads);
-        for (size_t i=0; i<rsv.nranges(); ++i)
-          {
-          auto inout_tmp = inout.subarray({{},{size_t(rsv.ivbegin(i)), size_t(rsv.ivend(i))}});
-          c2c(inout_tmp, inout_tmp, {0}, FORWARD, Tcalc(1), nthreads);
-          }
-        }
+      // all planes are transformed together; the grid is only nonzero in the
+      // parts corresponding to the dirty image, and only the union of the
+      // occupied u and v ranges is needed
+      c2c_pruned(inout, {1,2}, {dirty_slices(nu, nxdirty),
+        dirty_slices(nv, nydirty)}, {ranges2slices(uranges, iplane, iplane_end),
+        ranges2slices(vranges, iplane, iplane_end)}, FORWARD, Tcalc(1), nthreads);
       timers.pop();
       }
 
@@ -693,16 +774,18 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
       size_t max_allowed = size_t(nvis/double(nbunch*nthreads)*max_asymm);
 
       checkShape(wgt.shape(),{nrow,nchan});
-      checkShape(ms_in.shape(), {nrow,nchan});
-      checkShape(mask.shape(), {nrow,nchan});
 
       size_t ntiles_u = (nu>>log2tile) + 3;
       size_t ntiles_v = (nv>>log2tile) + 3;
       size_t nwmin = do_wgridding ? nplanes-supp+3 : 1;
+      // ranges are additionally sorted by blocks of 2^log2_rowblock rows, so
+      // that 32 bits suffice for storing the row index
+      size_t nrowblocks = (nrow>>log2_rowblock) + 1;
+      MR_assert(nrowblocks<=(size_t(1)<<16), "too many rows");
 timers.push("counting");
       // align members with cache lines
       struct alignas(64) spaced_size_t { atomic<size_t> v; }; 
-      vector<spaced_size_t> buf(ntiles_u*ntiles_v*nwmin+1);
+      vector<spaced_size_t> buf(ntiles_u*ntiles_v*nwmin*nrowblocks+1);
       auto chunk = max<size_t>(1, nrow/(20*nthreads));
       execDynamic(nrow, nthreads, chunk, [&](Scheduler &sched)
         {
@@ -717,11 +800,14 @@ timers.push("counting");
             {
             while((ch0<nchan) && (!lmask(irow,ch0))) ++ch0;
             uint32_t ch1=min<uint32_t>(nchan,ch0+1);
-            while( (ch1<nchan) && (lmask(irow,ch1))) ++ch1;
+            // active ranges never extend over more than one image
+            while( (ch1<nchan) && (lmask(irow,ch1))
+                && (chan2img[ch1]==chan2img[ch0])) ++ch1;
             // now [ch0;ch1[ contains an active range or we are at end
             auto inc0 = [&](Uvwidx idx)
               {
-              ++buf[idx.tile_u*ntiles_v*nwmin + idx.tile_v*nwmin + idx.minplane].v;
+              ++buf[(idx.tile_u*ntiles_v*nwmin + idx.tile_v*nwmin + idx.minplane)
+                    *nrowblocks + (irow>>log2_rowblock)].v;
               };
             auto inc = [&](Uvwidx idx, uint32_t ch)
               {
@@ -766,17 +852,19 @@ timers.poppush("allocation");
       for (size_t tu=0; tu<ntiles_u; ++tu)
         for (size_t tv=0; tv<ntiles_v; ++tv)
           for (size_t mp=0; mp<nwmin; ++mp)
-            {
-            size_t i = tu*ntiles_v*nwmin + tv*nwmin + mp;
-            size_t tmp = buf[i].v;
-            if (tmp>0) blockstart.push_back({Uvwidx(tu,tv,mp),acc});
-            buf[i].v = acc;
-            acc += tmp;
-            }
+            for (size_t rb=0; rb<nrowblocks; ++rb)
+              {
+              size_t i = (tu*ntiles_v*nwmin + tv*nwmin + mp)*nrowblocks + rb;
+              size_t tmp = buf[i].v;
+              if (tmp>0) blockstart.push_back({Uvwidx(tu,tv,mp,rb),acc});
+              buf[i].v = acc;
+              acc += tmp;
+              }
       buf.back().v=acc;
       }
 timers.poppush("filling");
       ranges.resize(buf.back().v);
+      const size_t rowmask = (size_t(1)<<log2_rowblock)-1;
       execDynamic(nrow, nthreads, chunk, [&](Scheduler &sched)
         {
         vector<pair<uint16_t, uint16_t>> interbuf;
@@ -790,10 +878,11 @@ timers.poppush("filling");
           auto flush=[&]()
             {
             if (interbuf.empty()) return;
-            auto bufidx = uvwlast.tile_u*ntiles_v*nwmin + uvwlast.tile_v*nwmin + uvwlast.minplane;
+            auto bufidx = (uvwlast.tile_u*ntiles_v*nwmin + uvwlast.tile_v*nwmin
+                          + uvwlast.minplane)*nrowblocks + (irow>>log2_rowblock);
             auto bufpos = (buf[bufidx].v+=interbuf.size()) - interbuf.size();
             for (size_t i=0; i<interbuf.size(); ++i)
-              ranges[bufpos+i] = RowchanRange(irow,interbuf[i].first,interbuf[i].second);
+              ranges[bufpos+i] = RowchanRange(uint32_t(irow&rowmask),interbuf[i].first,interbuf[i].second);
             interbuf.clear();
             };
           auto add=[&](uint16_t cb, uint16_t ce)
@@ -806,6 +895,11 @@ timers.poppush("filling");
             auto xmask = lmask(irow,ichan);
             if (xmask)
               {
+              if (on && (chan2img[ichan]!=chan2img[chan0])) // image boundary
+                {
+                add(chan0, ichan);
+                on=false;
+                }
               if ((!on)||(xmask==2))
                 {
                 auto uvwcur = get_uvwidx(uvwbase, ichan);
@@ -834,6 +928,39 @@ timers.poppush("filling");
           flush();
           }
         });
+      // group the ranges by image, keeping the block order within each image
+      img_bs.assign(nimg+1, 0);
+      if (nimg>1)
+        {
+timers.poppush("grouping by image");
+        vector<size_t> ofs(nimg+1, 0);
+        for (const auto &rcr: ranges)
+          ++ofs[chan2img[rcr.ch_begin]+1];
+        for (size_t i=0; i<nimg; ++i)
+          ofs[i+1] += ofs[i];
+        vector<RowchanRange> ranges2(ranges.size());
+        vector<vector<pair<Uvwidx, size_t>>> bsimg(nimg);
+        for (size_t ib=0; ib<blockstart.size(); ++ib)
+          {
+          size_t lo = blockstart[ib].second;
+          size_t hi = (ib+1<blockstart.size()) ? blockstart[ib+1].second : ranges.size();
+          for (size_t j=lo; j<hi; ++j)
+            {
+            auto img = chan2img[ranges[j].ch_begin];
+            if (bsimg[img].empty() || (bsimg[img].back().first!=blockstart[ib].first))
+              bsimg[img].emplace_back(blockstart[ib].first, ofs[img]);
+            ranges2[ofs[img]++] = ranges[j];
+            }
+          }
+        ranges.swap(ranges2);
+        blockstart.clear();
+        for (size_t i=0; i<nimg; ++i)
+          {
+          img_bs[i] = blockstart.size();
+          blockstart.insert(blockstart.end(), bsimg[i].begin(), bsimg[i].end());
+          }
+        }
+      img_bs[nimg] = blockstart.size();
 timers.poppush("building blockstart");
       vector<size_t> vissum;
       vissum.reserve(ranges.size()+1);
@@ -846,8 +973,11 @@ timers.poppush("building blockstart");
       vissum.push_back(visacc);
       vector<pair<Uvwidx, size_t>> bs2;
       swap(blockstart, bs2);
+      size_t img=0;
       for (size_t i=0; i<bs2.size(); ++i)
         {
+        while ((img<nimg) && (img_bs[img]==i))
+          img_bs[img++] = blockstart.size();
         blockstart.push_back(bs2[i]);
         size_t i1 = bs2[i].second;
         size_t i2 = vissum.size();
@@ -863,25 +993,45 @@ timers.poppush("building blockstart");
             }
           }
         }
+      while (img<=nimg)
+        img_bs[img++] = blockstart.size();
       lmask.dealloc();
 timers.pop();
 
+      // images only need the w planes touched by their own blocks
+      planes_img.assign(nimg, {0, 0});
+      for (size_t img=0; img<nimg; ++img)
+        if (img_bs[img]<img_bs[img+1])
+          {
+          size_t lo=~size_t(0), hi=0;
+          for (size_t ib=img_bs[img]; ib<img_bs[img+1]; ++ib)
+            {
+            lo = min<size_t>(lo, blockstart[ib].first.minplane);
+            hi = max<size_t>(hi, blockstart[ib].first.minplane);
+            }
+          planes_img[img] = {lo, do_wgridding ? hi+supp : 1};
+          }
+
       // compute which grid regions are required
       if (do_wgridding)
         {
         timers.poppush("grid regions");
-        vmav<unsigned char, 2> tmpu({nplanes,(nu>>log2tile)+1}),
-                               tmpv({nplanes,(nv>>log2tile)+1});
-        for (const auto &rng: blockstart)
-          for (size_t i=0; i<supp; ++i)
+        vmav<unsigned char, 2> tmpu({nimg*nplanes,(nu>>log2tile)+1}),
+                               tmpv({nimg*nplanes,(nv>>log2tile)+1});
+        for (size_t img=0; img<nimg; ++img)
+          for (size_t ib=img_bs[img]; ib<img_bs[img+1]; ++ib)
             {
-            tmpu(rng.first.minplane+i, rng.first.tile_u) = 1;
-            tmpv(rng.first.minplane+i, rng.first.tile_v) = 1;
+            const auto &idx(blockstart[ib].first);
+            for (size_t i=0; i<supp; ++i)
+              {
+              tmpu(img*nplanes+idx.minplane+i, idx.tile_u) = 1;
+              tmpv(img*nplanes+idx.minplane+i, idx.tile_v) = 1;
+              }
             }
-        uranges.resize(nplanes);
-        vranges.resize(nplanes);
+        uranges.resize(nimg*nplanes);
+        vranges.resize(nimg*nplanes);
         constexpr int tilesize = 1<<log2tile;
-        for (size_t i=0; i<nplanes; ++i)
+        for (size_t i=0; i<nimg*nplanes; ++i)
           {
           auto &rsu(uranges[i]);
           auto &rsv(vranges[i]);
@@ -936,11 +1086,11 @@ timers.pop();
         static constexpr double xsupp=2./supp;
         const Wgridder *parent;
         TemplateKernel<supp, mysimd<Tacc>> tkrn;
-        vmav<complex<Tcalc>,2> &grid;
+        vmav<complex<Tcalc>,3> &grid;
         int iu0, iv0; // start index of the current visibility
         int bu0, bv0; // start index of the current buffer
 
-        vmav<Tacc,2> bufr, bufi;
+        vmav<Tacc,3> bufr, bufi;
         Tacc *px0r, *px0i;
         double w0, xdw;
         vector<Mutex> &locks;
@@ -955,14 +1105,17 @@ timers.pop();
           int idxv0 = (bv0+inv)%inv;
           for (int iu=0; iu<su; ++iu)
             {
-            int idxv = idxv0;
             {
             LockGuard lock(locks[idxu]);
-            for (int iv=0; iv<sv; ++iv)
+            for (size_t c=0; c<grid.shape(0); ++c)
               {
-              grid(idxu,idxv) += complex<Tcalc>(Tcalc(bufr(iu,iv)), Tcalc(bufi(iu,iv)));
-              bufr(iu,iv) = bufi(iu,iv) = 0;
-              if (++idxv>=inv) idxv=0;
+              int idxv = idxv0;
+              for (int iv=0; iv<sv; ++iv)
+                {
+                grid(c,idxu,idxv) += complex<Tcalc>(Tcalc(bufr(c,iu,iv)), Tcalc(bufi(c,iu,iv)));
+                bufr(c,iu,iv) = bufi(c,iu,iv) = 0;
+                if (++idxv>=inv) idxv=0;
+                }
               }
             }
             if (++idxu>=inu) idxu=0;
@@ -970,6 +1123,8 @@ timers.pop();
           }
 
       public:
+        // distance between the buffers of consecutive correlations
+        static constexpr size_t cstride = su*svvec;
         Tacc * DUCC0_RESTRICT p0r, * DUCC0_RESTRICT p0i;
         union kbuf {
           Tacc scalar[2*nvec*vlen];
@@ -980,21 +1135,21 @@ timers.pop();
           };
         kbuf buf;
 
-        HelperX2g2(const Wgridder *parent_, vmav<complex<Tcalc>,2> &grid_,
+        HelperX2g2(const Wgridder *parent_, vmav<complex<Tcalc>,3> &grid_,
           vector<Mutex> &locks_, double w0_=-1, double dw_=-1)
           : parent(parent_), tkrn(*parent->krn), grid(grid_),
             iu0(-1000000), iv0(-1000000),
             bu0(-1000000), bv0(-1000000),
-            bufr({size_t(su),size_t(svvec)}),
-            bufi({size_t(su),size_t(svvec)}),
+            bufr({parent->ncorr,size_t(su),size_t(svvec)}),
+            bufi({parent->ncorr,size_t(su),size_t(svvec)}),
             px0r(bufr.data()), px0i(bufi.data()),
             w0(w0_),
             xdw(1./dw_),
             locks(locks_)
-          { checkShape(grid.shape(), {parent->nu,parent->nv}); }
+          { checkShape(grid.shape(), {parent->ncorr,parent->nu,parent->nv}); }
         ~HelperX2g2() { dump(); }
 
-        constexpr int lineJump() const { return svvec; }
+        static constexpr int lineJump() { return svvec; }
 
         [[gnu::always_inline]] [[gnu::hot]] void prep(const UVW &in,
           [[maybe_unused]] size_t nth=0)
@@ -1038,11 +1193,11 @@ timers.pop();
         const Wgridder *parent;
 
         TemplateKernel<supp, mysimd<Tcalc>> tkrn;
-        const cmav<complex<Tcalc>,2> &grid;
+        const cmav<complex<Tcalc>,3> &grid;
         int iu0, iv0; // start index of the current visibility
         int bu0, bv0; // start index of the current buffer
 
-        vmav<Tcalc,2> bufr, bufi;
+        vmav<Tcalc,3> bufr, bufi;
         const Tcalc *px0r, *px0i;
         double w0, xdw;
 
@@ -1052,20 +1207,26 @@ timers.pop();
           int inv = int(parent->nv);
           int idxu = (bu0+inu)%inu;
           int idxv0 = (bv0+inv)%inv;
-          for (int iu=0; iu<su; ++iu)
+          for (size_t c=0; c<grid.shape(0); ++c)
             {
-            int idxv = idxv0;
-            for (int iv=0; iv<sv; ++iv)
+            int idxu2 = idxu;
+            for (int iu=0; iu<su; ++iu)
               {
-              bufr(iu,iv) = grid(idxu, idxv).real();
-              bufi(iu,iv) = grid(idxu, idxv).imag();
-              if (++idxv>=inv) idxv=0;
+              int idxv = idxv0;
+              for (int iv=0; iv<sv; ++iv)
+                {
+                bufr(c,iu,iv) = grid(c, idxu2, idxv).real();
+                bufi(c,iu,iv) = grid(c, idxu2, idxv).imag();
+                if (++idxv>=inv) idxv=0;
+                }
+              if (++idxu2>=inu) idxu2=0;
               }
-            if (++idxu>=inu) idxu=0;
             }
           }
 
       public:
+        // distance between the buffers of consecutive correlations
+        static constexpr size_t cstride = su*svvec;
         const Tcalc * DUCC0_RESTRICT p0r, * DUCC0_RESTRICT p0i;
         union kbuf {
           Tcalc scalar[2*nvec*vlen];
@@ -1076,19 +1237,19 @@ timers.pop();
           };
         kbuf buf;
 
-        HelperG2x2(const Wgridder *parent_, const cmav<complex<Tcalc>,2> &grid_,
+        HelperG2x2(const Wgridder *parent_, const cmav<complex<Tcalc>,3> &grid_,
           double w0_=-1, double dw_=-1)
           : parent(parent_), tkrn(*parent->krn), grid(grid_),
             iu0(-1000000), iv0(-1000000),
             bu0(-1000000), bv0(-1000000),
-            bufr({size_t(su),size_t(svvec)}),
-            bufi({size_t(su),size_t(svvec)}),
+            bufr({parent->ncorr,size_t(su),size_t(svvec)}),
+            bufi({parent->ncorr,size_t(su),size_t(svvec)}),
             px0r(bufr.data()), px0i(bufi.data()),
             w0(w0_),
             xdw(1./dw_)
-          { checkShape(grid.shape(), {parent->nu,parent->nv}); }
+          { checkShape(grid.shape(), {parent->ncorr,parent->nu,parent->nv}); }
 
-        constexpr int lineJump() const { return svvec; }
+        static constexpr int lineJump() { return svvec; }
 
         [[gnu::always_inline]] [[gnu::hot]] void prep(const UVW &in,
           [[maybe_unused]] size_t nth=0)
@@ -1132,36 +1293,63 @@ timers.pop();
                       });
       }
 
+    // Returns the range [qlo; qhi[ of planes p0+q (0<=q<np) which receive
+    // contributions from the block with index \a idx.
+    template<size_t SUPP, bool wgrid> static pair<size_t, size_t> touched_planes
+      (const Uvwidx &idx, size_t p0, size_t np)
+      {
+      if constexpr (!wgrid) return {0, 1};
+      size_t lo = max<size_t>(idx.minplane, p0),
+             hi = min<size_t>(idx.minplane+SUPP, p0+np);
+      return (hi>lo) ? make_pair(lo-p0, hi-p0) : make_pair(size_t(0), size_t(0));
+      }
+
     template<size_t SUPP, bool wgrid> [[gnu::hot]] void x2grid_c_helper
-      (size_t supp, vmav<complex<Tcalc>,2> &grid, size_t p0, double w0)
+      (size_t supp, const cmav<complex<Tms>,3> &ms_in,
+       vmav<complex<Tcalc>,3> &grid, size_t p0, size_t img)
       {
       if constexpr (SUPP>=8)
-        if (supp<=SUPP/2) return x2grid_c_helper<SUPP/2, wgrid>(supp, grid, p0, w0);
+        if (supp<=SUPP/2) return x2grid_c_helper<SUPP/2, wgrid>(supp, ms_in, grid, p0, img);
       if constexpr (SUPP>4)
-        if (supp<SUPP) return x2grid_c_helper<SUPP-1, wgrid>(supp, grid, p0, w0);
+        if (supp<SUPP) return x2grid_c_helper<SUPP-1, wgrid>(supp, ms_in, grid, p0, img);
       MR_assert(supp==SUPP, "requested support out of range");
 
-      vector<Mutex> locks(nu);
+      // the grid holds the planes p0 to p0+np-1, each with ncorr correlations
+      size_t np = grid.shape(0)/ncorr;
+      vector<vmav<complex<Tcalc>,3>> pgrid;
+      vector<vector<Mutex>> locks(np);
+      for (size_t q=0; q<np; ++q)
+        {
+        pgrid.push_back(subarray<3>(grid, {{q*ncorr, (q+1)*ncorr}, {}, {}}));
+        locks[q] = vector<Mutex>(nu);
+        }
 
-      execDynamic(blockstart.size(), nthreads, wgrid ? SUPP : 1, [&](Scheduler &sched)
+      execDynamic(img_bs[img+1]-img_bs[img], nthreads, wgrid ? SUPP : 1, [&](Scheduler &sched)
         {
         constexpr auto vlen=mysimd<Tacc>::size();
         constexpr auto NVEC((SUPP+vlen-1)/vlen);
-        HelperX2g2<SUPP,wgrid> hlp(this, grid, locks, w0, dw);
-        constexpr auto jump = hlp.lineJump();
-        const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
-        const auto * DUCC0_RESTRICT kv = hlp.buf.simd+NVEC;
+        using Hlp = HelperX2g2<SUPP,wgrid>;
+        // every block is gridded onto all planes of this pass it touches,
+        // so each thread needs one helper per plane
+        vector<optional<Hlp>> hlps(np);
+        for (size_t q=0; q<np; ++q)
+          hlps[q].emplace(this, pgrid[q], locks[q], wgrid ? wmin+(p0+q)*dw : -1., dw);
+        constexpr auto jump = Hlp::lineJump();
         vector<complex<Tcalc>> phases;
         vector<Tcalc> buf;
 
-        while (auto rng=sched.getNext()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
+        while (auto rng=sched.getNext()) for(auto ix=rng.lo+img_bs[img]; ix<rng.hi+img_bs[img]; ++ix)
           {
 //auto ix = ix_+ranges.size()/2; if (ix>=ranges.size()) ix -=ranges.size();
           const auto &uvwidx(blockstart[ix].first);
-          if ((!wgrid) || ((uvwidx.minplane+SUPP>p0)&&(uvwidx.minplane<=p0)))
+          auto [qlo, qhi] = touched_planes<SUPP,wgrid>(uvwidx, p0, np);
+          for (size_t q=qlo; q<qhi; ++q)
             {
-//bool lastplane = (!wgrid) || (uvwidx.minplane+SUPP-1==p0);
-            size_t nth = p0-uvwidx.minplane;
+            auto &hlp(*hlps[q]);
+            const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
+            const auto * DUCC0_RESTRICT kv = hlp.buf.simd+NVEC;
+            size_t nth = p0+q-uvwidx.minplane;
+            size_t rowbase = size_t(uvwidx.rowblock)<<log2_rowblock;
             size_t iend = (ix+1<blockstart.size()) ? blockstart[ix+1].second : ranges.size();
             for (size_t cnt=blockstart[ix].second; cnt<iend; ++cnt)
               {
@@ -1169,11 +1357,13 @@ timers.pop();
               if (cnt+1<iend)
                 {
                 const auto &nextrcr(ranges[cnt+1]);
-                DUCC0_PREFETCH_R(&wgt(nextrcr.row, nextrcr.ch_begin));
-                DUCC0_PREFETCH_R(&ms_in(nextrcr.row, nextrcr.ch_begin));
-                bl.prefetchRow(nextrcr.row);
+                size_t nextrow = rowbase + nextrcr.row;
+                DUCC0_PREFETCH_R(&wgt(nextrow, nextrcr.ch_begin));
+                for (size_t c=0; c<ncorr; ++c)
+                  DUCC0_PREFETCH_R(&ms_in(c, nextrow, nextrcr.ch_begin));
+                bl.prefetchRow(nextrow);
                 }
-              size_t row = rcr.row;
+              size_t row = rowbase + rcr.row;
               auto bcoord = bl.baseCoord(row);
               auto imflip = Tcalc(bcoord.FixW());
               if (shifting)
@@ -1181,45 +1371,51 @@ timers.pop();
               for (size_t ch=rcr.ch_begin; ch<rcr.ch_end; ++ch)
                 {
                 auto coord = bcoord*bl.ffact(ch);
+                // the kernel is evaluated once and used for all correlations
                 hlp.prep(coord, nth);
-                auto v(ms_in(row, ch));
-                if (shifting)
-                  v*=phases[ch-rcr.ch_begin];
-                v*=wgt(row, ch);
-
-                if constexpr (NVEC==1)
+                for (size_t c=0; c<ncorr; ++c)
                   {
-                  mysimd<Tacc> vr=v.real()*kv[0], vi=v.imag()*imflip*kv[0];
-                  for (size_t cu=0; cu<SUPP; ++cu)
+                  auto v(ms_in(c, row, ch));
+                  if (shifting)
+                    v*=phases[ch-rcr.ch_begin];
+                  v*=wgt(row, ch);
+                  auto * DUCC0_RESTRICT p0r = hlp.p0r+c*hlp.cstride;
+                  auto * DUCC0_RESTRICT p0i = hlp.p0i+c*hlp.cstride;
+
+                  if constexpr (NVEC==1)
                     {
-                    auto * DUCC0_RESTRICT pxr = hlp.p0r+cu*jump;
-                    auto * DUCC0_RESTRICT pxi = hlp.p0i+cu*jump;
-                    auto tr = mysimd<Tacc>(pxr,element_aligned_tag());
-                    auto ti = mysimd<Tacc>(pxi,element_aligned_tag());
-                    tr += vr*ku[cu];
-                    ti += vi*ku[cu];
-                    tr.copy_to(pxr,element_aligned_tag());
-                    ti.copy_to(pxi,element_aligned_tag());
-                    }
-                  }
-                else
-                  {
-                  mysimd<Tacc> vr(v.real()), vi(v.imag()*imflip);
-                  for (size_t cu=0; cu<SUPP; ++cu)
-                    {
-                    mysimd<Tacc> tmpr=vr*ku[cu], tmpi=vi*ku[cu];
-                    for (size_t cv=0; cv<NVEC; ++cv)
+                    mysimd<Tacc> vr=v.real()*kv[0], vi=v.imag()*imflip*kv[0];
+                    for (size_t cu=0; cu<SUPP; ++cu)
                       {
-                      auto * DUCC0_RESTRICT pxr = hlp.p0r+cu*jump+cv*hlp.vlen;
-                      auto * DUCC0_RESTRICT pxi = hlp.p0i+cu*jump+cv*hlp.vlen;
+                      auto * DUCC0_RESTRICT pxr = p0r+cu*jump;
+                      auto * DUCC0_RESTRICT pxi = p0i+cu*jump;
                       auto tr = mysimd<Tacc>(pxr,element_aligned_tag());
-                      tr += tmpr*kv[cv];
+                      auto ti = mysimd<Tacc>(pxi,element_aligned_tag());
+                      tr += vr*ku[cu];
+                      ti += vi*ku[cu];
                       tr.copy_to(pxr,element_aligned_tag());
-                      auto ti = mysimd<Tacc>(pxi, element_aligned_tag());
-                      ti += tmpi*kv[cv];
                       ti.copy_to(pxi,element_aligned_tag());
                       }
                     }
+                  else
+                    {
+                    mysimd<Tacc> vr(v.real()), vi(v.imag()*imflip);
+                    for (size_t cu=0; cu<SUPP; ++cu)
+                      {
+                      mysimd<Tacc> tmpr=vr*ku[cu], tmpi=vi*ku[cu];
+                      for (size_t cv=0; cv<NVEC; ++cv)
+                        {
+                        auto * DUCC0_RESTRICT pxr = p0r+cu*jump+cv*hlp.vlen;
+                        auto * DUCC0_RESTRICT pxi = p0i+cu*jump+cv*hlp.vlen;
+                        auto tr = mysimd<Tacc>(pxr,element_aligned_tag());
+                        tr += tmpr*kv[cv];
+                        tr.copy_to(pxr,element_aligned_tag());
+                        auto ti = mysimd<Tacc>(pxi, element_aligned_tag());
+                        ti += tmpi*kv[cv];
+                        ti.copy_to(pxi,element_aligned_tag());
+                        }
+                      }
+                    }
                   }
                 }
               }
@@ -1228,43 +1424,61 @@ timers.pop();
         });
       }
 
-    template<bool wgrid> void x2grid_c(vmav<complex<Tcalc>,2> &grid,
-      size_t p0, double w0=-1)
+    // grids onto the planes p0 to p0+grid.shape(0)/ncorr-1 in a single pass
+    template<bool wgrid> void x2grid_c(const cmav<complex<Tms>,3> &ms_in,
+      vmav<complex<Tcalc>,3> &grid, size_t p0, size_t img)
       {
-      checkShape(grid.shape(), {nu, nv});
+      MR_assert((grid.shape(0)%ncorr==0) && (wgrid || (grid.shape(0)==ncorr)),
+        "bad grid dimensions");
+      checkShape(grid.shape(), {grid.shape(0), nu, nv});
       constexpr size_t maxsupp = is_same<Tacc, double>::value ? 16 : 8;
-      x2grid_c_helper<maxsupp, wgrid>(supp, grid, p0, w0);
+      x2grid_c_helper<maxsupp, wgrid>(supp, ms_in, grid, p0, img);
       }
 
     template<size_t SUPP, bool wgrid> [[gnu::hot]] void grid2x_c_helper
-      (size_t supp, const cmav<complex<Tcalc>,2> &grid, size_t p0, double w0)
+      (size_t supp, const cmav<complex<Tcalc>,3> &grid,
+       vmav<complex<Tms>,3> &ms_out, size_t p0, size_t img)
       {
       if constexpr (SUPP>=8)
-        if (supp<=SUPP/2) return grid2x_c_helper<SUPP/2, wgrid>(supp, grid, p0, w0);
+        if (supp<=SUPP/2) return grid2x_c_helper<SUPP/2, wgrid>(supp, grid, ms_out, p0, img);
       if constexpr (SUPP>4)
-        if (supp<SUPP) return grid2x_c_helper<SUPP-1, wgrid>(supp, grid, p0, w0);
+        if (supp<SUPP) return grid2x_c_helper<SUPP-1, wgrid>(supp, grid, ms_out, p0, img);
       MR_assert(supp==SUPP, "requested support out of range");
 
+      // the grid holds the planes p0 to p0+np-1, each with ncorr correlations
+      size_t np = grid.shape(0)/ncorr;
+      vector<cmav<complex<Tcalc>,3>> pgrid;
+      for (size_t q=0; q<np; ++q)
+        pgrid.push_back(subarray<3>(grid, {{q*ncorr, (q+1)*ncorr}, {}, {}}));
+
       // Loop over sampling points
-      execDynamic(blockstart.size(), nthreads, wgrid ? SUPP : 1, [&](Scheduler &sched)
+      execDynamic(img_bs[img+1]-img_bs[img], nthreads, wgrid ? SUPP : 1, [&](Scheduler &sched)
         {
         constexpr size_t vlen=mysimd<Tcalc>::size();
         constexpr size_t NVEC((SUPP+vlen-1)/vlen);
-        HelperG2x2<SUPP,wgrid> hlp(this, grid, w0, dw);
-        constexpr int jump = hlp.lineJump();
-        const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
-        const auto * DUCC0_RESTRICT kv = hlp.buf.simd+NVEC;
+        using Hlp = HelperG2x2<SUPP,wgrid>;
+        // the planes touched by a block are processed in ascending order by
+        // the same thread, since they all contribute to the same visibilities
+        vector<optional<Hlp>> hlps(np);
+        for (size_t q=0; q<np; ++q)
+          hlps[q].emplace(this, pgrid[q], wgrid ? wmin+(p0+q)*dw : -1., dw);
+        constexpr int jump = Hlp::lineJump();
         vector<complex<Tcalc>> phases;
         vector<Tcalc> buf;
 
-        while (auto rng=sched.getNext()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
+        while (auto rng=sched.getNext()) for(auto ix=rng.lo+img_bs[img]; ix<rng.hi+img_bs[img]; ++ix)
           {
           const auto &uvwidx(blockstart[ix].first);
-          if ((!wgrid) || ((uvwidx.minplane+SUPP>p0)&&(uvwidx.minplane<=p0)))
+          auto [qlo, qhi] = touched_planes<SUPP,wgrid>(uvwidx, p0, np);
+          for (size_t q=qlo; q<qhi; ++q)
             {
-            bool firstplane = (!wgrid) || (uvwidx.minplane==p0);
-            bool lastplane = (!wgrid) || (uvwidx.minplane+SUPP-1==p0);
-            size_t nth = p0-uvwidx.minplane;
+            auto &hlp(*hlps[q]);
+            const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
+            const auto * DUCC0_RESTRICT kv = hlp.buf.simd+NVEC;
+            bool firstplane = (!wgrid) || (uvwidx.minplane==p0+q);
+            bool lastplane = (!wgrid) || (uvwidx.minplane+SUPP-1==p0+q);
+            size_t nth = p0+q-uvwidx.minplane;
+            size_t rowbase = size_t(uvwidx.rowblock)<<log2_rowblock;
             size_t iend = (ix+1<blockstart.size()) ? blockstart[ix+1].second : ranges.size();
             for (size_t cnt=blockstart[ix].second; cnt<iend; ++cnt)
               {
@@ -1272,57 +1486,72 @@ timers.pop();
               if (cnt+1<iend)
                 {
                 const auto &nextrcr(ranges[cnt+1]);
-                DUCC0_PREFETCH_R(&wgt(nextrcr.row, nextrcr.ch_begin));
-                DUCC0_PREFETCH_R(&ms_out(nextrcr.row, nextrcr.ch_begin));
-                DUCC0_PREFETCH_W(&ms_out(nextrcr.row, nextrcr.ch_begin));
-                bl.prefetchRow(nextrcr.row);
+                size_t nextrow = rowbase + nextrcr.row;
+                DUCC0_PREFETCH_R(&wgt(nextrow, nextrcr.ch_begin));
+                for (size_t c=0; c<ncorr; ++c)
+                  {
+                  DUCC0_PREFETCH_R(&ms_out(c, nextrow, nextrcr.ch_begin));
+                  DUCC0_PREFETCH_W(&ms_out(c, nextrow, nextrcr.ch_begin));
+                  }
+                bl.prefetchRow(nextrow);
                 }
-              size_t row = rcr.row;
+              size_t row = rowbase + rcr.row;
               auto bcoord = bl.baseCoord(row);
               auto imflip = Tcalc(bcoord.FixW());
-              if (shifting&&lastplane)
+              if (shifting&&(lastplane||add_ms))
                 compute_phases(phases, buf, -imflip, bcoord, rcr);
               for (size_t ch=rcr.ch_begin; ch<rcr.ch_end; ++ch)
                 {
                 auto coord = bcoord*bl.ffact(ch);
+                // the kernel is evaluated once and used for all correlations
                 hlp.prep(coord, nth);
-                mysimd<Tcalc> rr=0, ri=0;
-                if constexpr (NVEC==1)
+                for (size_t c=0; c<ncorr; ++c)
                   {
-                  for (size_t cu=0; cu<SUPP; ++cu)
+                  const auto * DUCC0_RESTRICT p0r = hlp.p0r+c*hlp.cstride;
+                  const auto * DUCC0_RESTRICT p0i = hlp.p0i+c*hlp.cstride;
+                  mysimd<Tcalc> rr=0, ri=0;
+                  if constexpr (NVEC==1)
                     {
-                    const auto * DUCC0_RESTRICT pxr = hlp.p0r + cu*jump;
-                    const auto * DUCC0_RESTRICT pxi = hlp.p0i + cu*jump;
-                    rr += mysimd<Tcalc>(pxr,element_aligned_tag())*ku[cu];
-                    ri += mysimd<Tcalc>(pxi,element_aligned_tag())*ku[cu];
+                    for (size_t cu=0; cu<SUPP; ++cu)
+                      {
+                      const auto * DUCC0_RESTRICT pxr = p0r + cu*jump;
+                      const auto * DUCC0_RESTRICT pxi = p0i + cu*jump;
+                      rr += mysimd<Tcalc>(pxr,element_aligned_tag())*ku[cu];
+                      ri += mysimd<Tcalc>(pxi,element_aligned_tag())*ku[cu];
+                      }
+                    rr *= kv[0];
+                    ri *= kv[0];
                     }
-                  rr *= kv[0];
-                  ri *= kv[0];
-                  }
-                else
-                  {
-                  for (size_t cu=0; cu<SUPP; ++cu)
+                  else
                     {
-                    mysimd<Tcalc> tmpr(0), tmpi(0);
-                    for (size_t cv=0; cv<NVEC; ++cv)
+                    for (size_t cu=0; cu<SUPP; ++cu)
                       {
-                      const auto * DUCC0_RESTRICT pxr = hlp.p0r + cu*jump + hlp.vlen*cv;
-                      const auto * DUCC0_RESTRICT pxi = hlp.p0i + cu*jump + hlp.vlen*cv;
-                      tmpr += kv[cv]*mysimd<Tcalc>(pxr,element_aligned_tag());
-                      tmpi += kv[cv]*mysimd<Tcalc>(pxi,element_aligned_tag());
+                      mysimd<Tcalc> tmpr(0), tmpi(0);
+                      for (size_t cv=0; cv<NVEC; ++cv)
+                        {
+                        const auto * DUCC0_RESTRICT pxr = p0r + cu*jump + hlp.vlen*cv;
+                        const auto * DUCC0_RESTRICT pxi = p0i + cu*jump + hlp.vlen*cv;
+                        tmpr += kv[cv]*mysimd<Tcalc>(pxr,element_aligned_tag());
+                        tmpi += kv[cv]*mysimd<Tcalc>(pxi,element_aligned_tag());
+                        }
+                      rr += ku[cu]*tmpr;
+                      ri += ku[cu]*tmpi;
                       }
-                    rr += ku[cu]*tmpr;
-                    ri += ku[cu]*tmpi;
                     }
+                  ri *= imflip;
+                  auto r = hsum_cmplx<Tcalc>(rr,ri);
+                  // when adding to the visibilities, the contribution of
+                  // every plane is weighted and added on its own
+                  if (!(firstplane||add_ms)) r += ms_out(c, row, ch);
+                  if (lastplane||add_ms)
+                    r *= shifting ?
+                      complex<Tms>(phases[ch-rcr.ch_begin]*Tcalc(wgt(row, ch))) :
+                      wgt(row, ch);
+                  if (add_ms)
+                    ms_out(c, row, ch) += r;
+                  else
+                    ms_out(c, row, ch) = r;
                   }
-                ri *= imflip;
-                auto r = hsum_cmplx<Tcalc>(rr,ri);
-                if (!firstplane) r += ms_out(row, ch);
-                if (lastplane)
-                  r *= shifting ?
-                    complex<Tms>(phases[ch-rcr.ch_begin]*Tcalc(wgt(row, ch))) :
-                    wgt(row, ch);
-                ms_out(row, ch) = r;
                 }
               }
             }
@@ -1330,15 +1559,18 @@ timers.pop();
         });
       }
 
-    template<bool wgrid> void grid2x_c(const cmav<complex<Tcalc>,2> &grid,
-      size_t p0, double w0=-1)
+    // degrids from the planes p0 to p0+grid.shape(0)/ncorr-1 in a single pass
+    template<bool wgrid> void grid2x_c(const cmav<complex<Tcalc>,3> &grid,
+      vmav<complex<Tms>,3> &ms_out, size_t p0, size_t img)
       {
-      checkShape(grid.shape(), {nu, nv});
+      MR_assert((grid.shape(0)%ncorr==0) && (wgrid || (grid.shape(0)==ncorr)),
+        "bad grid dimensions");
+      checkShape(grid.shape(), {grid.shape(0), nu, nv});
       constexpr size_t maxsupp = is_same<Tcalc, double>::value ? 16 : 8;
-      grid2x_c_helper<maxsupp, wgrid>(supp, grid, p0, w0);
+      grid2x_c_helper<maxsupp, wgrid>(supp, grid, ms_out, p0, img);
       }
 
-    void apply_global_corrections(vmav<Timg,2> &dirty)
+    void apply_global_corrections(vmav<Timg,3> &dirty)
       {
       timers.push("global corrections");
       double x0 = lshift-0.5*nxdirty*pixsize_x,
@@ -1370,21 +1602,25 @@ timers.pop();
               {
               auto i2=min(i, nxdirty-i), j2=min(j, nydirty-j);
               fct *= cfu[nxdirty/2-i2]*cfv[nydirty/2-j2];
-              dirty(i,j)*=Timg(fct);
+              for (size_t c=0; c<ncorr; ++c)
+                dirty(c,i,j)*=Timg(fct);
               }
             else
               {
               fct *= cfu[nxdirty/2-i]*cfv[nydirty/2-j];
               size_t i2 = nxdirty-i, j2 = nydirty-j;
-              dirty(i,j)*=Timg(fct);
-              if ((i>0)&&(i<i2))
+              for (size_t c=0; c<ncorr; ++c)
                 {
-                dirty(i2,j)*=Timg(fct);
+                dirty(c,i,j)*=Timg(fct);
+                if ((i>0)&&(i<i2))
+                  {
+                  dirty(c,i2,j)*=Timg(fct);
+                  if ((j>0)&&(j<j2))
+                    dirty(c,i2,j2)*=Timg(fct);
+                  }
                 if ((j>0)&&(j<j2))
-                  dirty(i2,j2)*=Timg(fct);
+                  dirty(c,i,j2)*=Timg(fct);
                 }
-              if ((j>0)&&(j<j2))
-                dirty(i,j2)*=Timg(fct);
               }
             }
           }
@@ -1392,50 +1628,92 @@ timers.pop();
       timers.pop();
       }
 
-    void report()
+    void report(const string &title)
       {
       if (verbosity==0) return;
-      cout << (gridding ? "Gridding:" : "Degridding:") << endl
+      cout << title << endl
            << "  nthreads=" << nthreads << ", "
-           << "dirty=(" << nxdirty << "x" << nydirty << "), "
+           << "dirty=(";
+      if (ncorr>1) cout << ncorr << "x";
+      cout << nxdirty << "x" << nydirty << "), "
            << "grid=(" << nu << "x" << nv;
       if (do_wgridding) cout << "x" << nplanes;
       cout << "), supp=" << supp
            << ", eps=" << epsilon
            << endl;
       cout << "  nrow=" << bl.Nrows() << ", nchan=" << bl.Nchannels()
-           << ", nvis=" << nvis << "/" << (bl.Nrows()*bl.Nchannels()) << endl;
+           << ", nvis=" << nvis << "/" << (bl.Nrows()*bl.Nchannels());
+      if (nimg>1) cout << ", nimages=" << nimg;
+      cout << endl;
       if (do_wgridding)
         cout << "  w=[" << wmin_d << "; " << wmax_d << "], min(n-1)=" << nm1min
              << ", dw=" << dw << ", (wmax-wmin)/dw=" << (wmax_d-wmin_d)/dw << endl;
       size_t ovh0 = ranges.size()*sizeof(ranges[0]);
       ovh0 += blockstart.size()*sizeof(blockstart[0]);
-      size_t ovh1 = nu*nv*sizeof(complex<Tcalc>);             // grid
+      size_t ovh1 = ncorr*nu*nv*sizeof(complex<Tcalc>);       // grid
+      if (do_wgridding)
+        ovh1 *= planes_in_flight(nplanes);
       if (!do_wgridding)
         ovh1 += nu*nv*sizeof(Tcalc);                          // rgrid
       if (!gridding)
-        ovh1 += nxdirty*nydirty*sizeof(Timg);                 // tdirty
+        ovh1 += ncorr*nxdirty*nydirty*sizeof(Timg);           // tdirty
       cout << "  memory overhead: "
            << ovh0/double(1<<30) << "GB (index) + "
            << ovh1/double(1<<30) << "GB (2D arrays)" << endl;
       }
 
-    void x2dirty()
+    // minimum number of 1D transforms per thread in a pass of a 2D FFT;
+    // with fewer, the threads mostly wait for each other
+    static constexpr size_t min_lines_per_thread = 128;
+
+    // Returns how many threads the FFT of a single w plane can keep busy.
+    // Each pass of the 2D FFT of a plane consists of about ncorr*min(nu,nv)
+    // 1D transforms (fewer after pruning, more along the longer axis).
+    size_t threads_per_plane() const
+      { return max<size_t>(1, ncorr*min(nu,nv)/min_lines_per_thread); }
+
+    // Returns how many of \a npl w planes are gridded, transformed and
+    // w-screened together. This only pays off when the FFTs of a single plane
+    // do not keep all threads busy. Every plane in flight needs its own
+    // uv grid, so their number is also limited by the available memory
+    // (unless it is fixed via setGridderOverrides()).
+    size_t planes_in_flight(size_t npl) const
       {
+      auto fixed = getGridderOverrides().planes_in_flight;
+      if (fixed>0) return max<size_t>(1, min(npl, fixed));
+      size_t nwanted = min(npl, nthreads/threads_per_plane());
+      if (nwanted<=1) return 1;
+      size_t planesize = ncorr*nu*nv*sizeof(complex<Tcalc>);
+      return max<size_t>(1, min(nwanted, gridder_memory_budget()/planesize));
+      }
+
+    // grids the visibilities belonging to image \a img
+    void x2dirty(const cmav<complex<Tms>,3> &ms_in, vmav<Timg,3> &dirty_out,
+      size_t img=0)
+      {
+      if (img_bs[img]==img_bs[img+1])
+        {
+        mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty_out);
+        return;
+        }
       if (do_wgridding)
         {
         timers.push("zeroing dirty image");
         mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty_out);
+        auto [plo, phi] = planes_img[img];
+        size_t np = planes_in_flight(phi-plo);
         timers.poppush("allocating grid");
-        auto grid = vmav<complex<Tcalc>,2>::build_noncritical({nu,nv});
+        auto grid = vmav<complex<Tcalc>,3>::build_noncritical({np*ncorr,nu,nv});
         timers.pop();
-        for (size_t pl=0; pl<nplanes; ++pl)
+        for (size_t pl=plo; pl<phi; pl+=np)
           {
+          size_t npcur = min(np, phi-pl);
+          auto sgrid = subarray<3>(grid, {{0, npcur*ncorr}, {}, {}});
           double w = wmin+pl*dw;
           timers.push("gridding proper");
-          x2grid_c<true>(grid, pl, w);
+          x2grid_c<true>(ms_in, sgrid, pl, img);
           timers.pop();
-          grid2dirty_c_overwrite_wscreen_add(grid, dirty_out, w, pl);
+          grid2dirty_c_overwrite_wscreen_add(sgrid, dirty_out, w, img*nplanes+pl);
           }
         // correct for w gridding etc.
         apply_global_corrections(dirty_out);
@@ -1443,37 +1721,50 @@ timers.pop();
       else
         {
         timers.push("allocating grid");
-        auto grid = vmav<complex<Tcalc>,2>::build_noncritical({nu,nv});
+        auto grid = vmav<complex<Tcalc>,3>::build_noncritical({ncorr,nu,nv});
         timers.poppush("gridding proper");
-        x2grid_c<false>(grid, 0);
+        x2grid_c<false>(ms_in, grid, 0, img);
         timers.poppush("allocating rgrid");
-        auto rgrid = vmav<Tcalc,2>::build_noncritical(grid.shape(), UNINITIALIZED);
-        timers.poppush("complex2hartley");
-        complex2hartley(grid, rgrid, nthreads);
+        auto rgrid = vmav<Tcalc,2>::build_noncritical({nu,nv}, UNINITIALIZED);
         timers.pop();
-        grid2dirty_overwrite(rgrid, dirty_out);
+        for (size_t c=0; c<ncorr; ++c)
+          {
+          auto subgrid = subarray<2>(grid, {{c}, {}, {}});
+          auto subdirty = subarray<2>(dirty_out, {{c}, {}, {}});
+          timers.push("complex2hartley");
+          complex2hartley(subgrid, rgrid, nthreads);
+          timers.pop();
+          grid2dirty_overwrite(rgrid, subdirty);
+          }
         }
       }
 
-    void dirty2x()
+    // degrids image \a img into the visibilities belonging to it
+    void dirty2x(const cmav<Timg,3> &dirty_in, vmav<complex<Tms>,3> &ms_out,
+      size_t img=0)
       {
+      if (img_bs[img]==img_bs[img+1]) return;
       if (do_wgridding)
         {
         timers.push("copying dirty image");
-        vmav<Timg,2> tdirty({nxdirty,nydirty}, UNINITIALIZED);
+        vmav<Timg,3> tdirty({ncorr,nxdirty,nydirty}, UNINITIALIZED);
         mav_apply([](Timg &a, const Timg &b) {a=b;}, nthreads, tdirty, dirty_in);
         timers.pop();
         // correct for w gridding etc.
         apply_global_corrections(tdirty);
+        auto [plo, phi] = planes_img[img];
+        size_t np = planes_in_flight(phi-plo);
         timers.push("allocating grid");
-        auto grid = vmav<complex<Tcalc>,2>::build_noncritical({nu,nv}, UNINITIALIZED);
+        auto grid = vmav<complex<Tcalc>,3>::build_noncritical({np*ncorr,nu,nv}, UNINITIALIZED);
         timers.pop();
-        for (size_t pl=0; pl<nplanes; ++pl)
+        for (size_t pl=plo; pl<phi; pl+=np)
           {
+          size_t npcur = min(np, phi-pl);
+          auto sgrid = subarray<3>(grid, {{0, npcur*ncorr}, {}, {}});
           double w = wmin+pl*dw;
-          dirty2grid_c_wscreen(tdirty, grid, w, pl);
+          dirty2grid_c_wscreen(tdirty, sgrid, w, img*nplanes+pl);
           timers.push("degridding proper");
-          grid2x_c<true>(grid, pl, w);
+          grid2x_c<true>(sgrid, ms_out, pl, img);
           timers.pop();
           }
         }
@@ -1481,14 +1772,18 @@ timers.pop();
         {
         timers.push("allocating grid");
         auto rgrid = vmav<Tcalc,2>::build_noncritical({nu,nv}, UNINITIALIZED);
+        auto grid = vmav<complex<Tcalc>,3>::build_noncritical({ncorr,nu,nv});
         timers.pop();
-        dirty2grid(dirty_in, rgrid);
-        timers.push("allocating grid");
-        auto grid = vmav<complex<Tcalc>,2>::build_noncritical(rgrid.shape());
-        timers.poppush("hartley2complex");
-        hartley2complex(rgrid, grid, nthreads);
-        timers.poppush("degridding proper");
-        grid2x_c<false>(grid, 0);
+        for (size_t c=0; c<ncorr; ++c)
+          {
+          auto subgrid = subarray<2>(grid, {{c}, {}, {}});
+          dirty2grid(subarray<2>(dirty_in, {{c}, {}, {}}), rgrid);
+          timers.push("hartley2complex");
+          hartley2complex(rgrid, subgrid, nthreads);
+          timers.pop();
+          }
+        timers.push("degridding proper");
+        grid2x_c<false>(grid, ms_out, 0, img);
         timers.pop();
         }
       }
@@ -1519,8 +1814,8 @@ timers.pop();
 
       auto idx = getAvailableKernels<Tcalc>(epsilon, do_wgridding ? 3 : 2, sigma_min, sigma_max);
       double mincost = 1e300;
-      constexpr double nref_fft=2048;
-      constexpr double costref_fft=0.0693;
+      const auto model = getGriddingCostModel();
+      constexpr bool singleprec = is_same<Tcalc, float>::value;
       size_t minnu=0, minnv=0, minidx=~(size_t(0));
       size_t vlen = gridding ? mysimd<Tacc>::size() : mysimd<Tcalc>::size();
       for (size_t i=0; i<idx.size(); ++i)
@@ -1533,9 +1828,9 @@ timers.pop();
         size_t nv=2*good_size_complex(size_t(nydirty*ofactor*0.5)+1);
         nu = max<size_t>(nu,16);
         nv = max<size_t>(nv,16);
-        double logterm = log(nu*nv)/log(nref_fft*nref_fft);
-        double fftcost = nu/nref_fft*nv/nref_fft*logterm*costref_fft;
-        double gridcost = 2.2e-10*nvis*(supp*nvec*vlen + ((2*nvec+1)*(supp+3)*vlen));
+        double fftcost = ncorr*nimg*model.fftTime(double(nu)*nv, singleprec);
+        // kernel evaluation is shared by all correlations, accumulation is not
+        double gridcost = model.griddingCost(singleprec)*nvis*(ncorr*supp*nvec*vlen + ((2*nvec+1)*(supp+3)*vlen));
         if (gridding) gridcost *= sizeof(Tacc)/sizeof(Tcalc);
         if (do_wgridding)
           {
@@ -1546,15 +1841,7 @@ timers.pop();
           }
         // FIXME: heuristics could be improved
         gridcost /= nthreads;  // assume perfect scaling for now
-        constexpr double max_fft_scaling = 6;
-        constexpr double scaling_power=2;
-        auto sigmoid = [](double x, double m, double s)
-          {
-          auto x2 = x-1;
-          auto m2 = m-1;
-          return 1.+x2/pow((1.+pow(x2/m2,s)),1./s);
-          };
-        fftcost /= sigmoid(nthreads, max_fft_scaling, scaling_power);
+        fftcost /= model.fftSpeedup(nthreads);
         double cost = fftcost+gridcost;
         if (cost<mincost)
           {
@@ -1570,14 +1857,20 @@ timers.pop();
       return minidx;
       }
 
-    void scanData()
+    // Determines the visibilities to be processed. Visibilities whose value
+    // in ms_in is zero for all correlations are skipped; entries of ms_out
+    // (if not empty) that are not processed are set to zero.
+    void scanData(const cmav<complex<Tms>,3> &ms_in,
+      vmav<complex<Tms>,3> &ms_out, const cmav<uint8_t,2> &mask)
       {
       timers.push("Initial scan");
       size_t nrow=bl.Nrows(),
              nchan=bl.Nchannels();
       checkShape(wgt.shape(),{nrow,nchan});
-      checkShape(ms_in.shape(), {nrow,nchan});
+      checkShape(ms_in.shape(), {ncorr,nrow,nchan});
       checkShape(mask.shape(), {nrow,nchan});
+      if (ms_out.size()!=0) checkShape(ms_out.shape(), {ncorr,nrow,nchan});
+      bool zero_out = (ms_out.size()!=0) && (!add_ms);
 
       nvis=0;
       wmin_d=1e300;
@@ -1589,8 +1882,12 @@ timers.pop();
         size_t lnvis=0;
         for(auto irow=lo; irow<hi; ++irow)
           for (size_t ichan=0; ichan<nchan; ++ichan)
-//            if (mask(irow,ichan) && (wgt(irow, ichan)!=0) && (norm(ms_in(irow,ichan)!=0)))
-            if (norm(ms_in(irow,ichan))*wgt(irow,ichan)*mask(irow,ichan) != 0)
+            {
+            Tms nrm = 0;
+            for (size_t c=0; c<ncorr; ++c)
+              nrm += norm(ms_in(c,irow,ichan));
+//            if (mask(irow,ichan) && (wgt(irow, ichan)!=0) && (nrm!=0))
+            if (nrm*wgt(irow,ichan)*mask(irow,ichan) != 0)
               {
               lmask(irow, ichan)=1;
               ++lnvis;
@@ -1600,8 +1897,11 @@ timers.pop();
               }
             else
               {
-              if (!gridding) ms_out(irow, ichan)=0;
+              if (zero_out)
+                for (size_t c=0; c<ncorr; ++c)
+                  ms_out(c, irow, ichan)=0;
               }
+            }
         {
         LockGuard lock(mut);
         wmin_d = min(wmin_d, lwmin_d);
@@ -1612,45 +1912,10 @@ timers.pop();
       timers.pop();
       }
 
-  public:
-    Wgridder(const cmav<double,2> &uvw, const cmav<double,1> &freq,
-           const cmav<complex<Tms>,2> &ms_in_, vmav<complex<Tms>,2> &ms_out_,
-           const cmav<Timg,2> &dirty_in_, vmav<Timg,2> &dirty_out_,
-           const cmav<Tms,2> &wgt_, const cmav<uint8_t,2> &mask_,
-           double pixsize_x_, double pixsize_y_, double epsilon_,
-           bool do_wgridding_, size_t nthreads_, size_t verbosity_,
-           bool negate_v_, bool divide_by_n_, double sigma_min_,
-           double sigma_max_, double center_x, double center_y, bool allow_nshift)
-      : gridding(ms_out_.size()==0),
-        timers(gridding ? "gridding" : "degridding"),
-        ms_in(ms_in_), ms_out(ms_out_),
-        dirty_in(dirty_in_), dirty_out(dirty_out_),
-        wgt(wgt_), mask(mask_),
-        lmask(gridding ? ms_in.shape() : ms_out.shape()),
-        pixsize_x(pixsize_x_), pixsize_y(pixsize_y_),
-        nxdirty(gridding ? dirty_out.shape(0) : dirty_in.shape(0)),
-        nydirty(gridding ? dirty_out.shape(1) : dirty_in.shape(1)),
-        epsilon(epsilon_),
-        do_wgridding(do_wgridding_),
-        nthreads(adjust_nthreads(nthreads_)),
-        verbosity(verbosity_),
-        negate_v(negate_v_), divide_by_n(divide_by_n_),
-        sigma_min(sigma_min_), sigma_max(sigma_max_),
-        lshift(center_x), mshift(negate_v ? -center_y : center_y),
-        lmshift((lshift!=0) || (mshift!=0)),
-        no_nshift(!allow_nshift)
+    // computes everything that depends only on the visibility coordinates,
+    // weights and mask: kernel, grid dimensions and the visibility index
+    void setup()
       {
-      timers.push("Baseline construction");
-      bl = Baselines(uvw, freq, negate_v);
-      MR_assert(bl.Nrows()<(uint64_t(1)<<32), "too many rows in the MS");
-      MR_assert(bl.Nchannels()<(uint64_t(1)<<16), "too many channels in the MS");
-      timers.pop();
-      scanData();
-      if (nvis==0)
-        {
-        if (gridding) mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty_out);
-        return;
-        }
       auto kidx = getNuNv();
       MR_assert((nu>>log2tile)<(size_t(1)<<16), "nu too large");
       MR_assert((nv>>log2tile)<(size_t(1)<<16), "nv too large");
@@ -1680,91 +1945,448 @@ timers.pop();
       MR_assert(pixsize_x>0, "pixsize_x must be positive");
       MR_assert(pixsize_y>0, "pixsize_y must be positive");
       countRanges();
-      report();
-      gridding ? x2dirty() : dirty2x();
+      }
+
+    Wgridder(bool gridding_, const cmav<double,2> &uvw,
+           const cmav<double,1> &freq, const cmav<Tms,2> &wgt_,
+           size_t ncorr_, size_t nxdirty_, size_t nydirty_,
+           double pixsize_x_, double pixsize_y_, double epsilon_,
+           bool do_wgridding_, size_t nthreads_, size_t verbosity_,
+           bool negate_v_, bool divide_by_n_, double sigma_min_,
+           double sigma_max_, double center_x, double center_y, bool allow_nshift)
+      : gridding(gridding_),
+        timers(gridding ? "gridding" : "degridding"),
+        wgt(wgt_),
+        lmask({uvw.shape(0), freq.shape(0)}),
+        pixsize_x(pixsize_x_), pixsize_y(pixsize_y_),
+        nxdirty(nxdirty_), nydirty(nydirty_),
+        ncorr(ncorr_),
+        epsilon(epsilon_),
+        do_wgridding(do_wgridding_),
+        nthreads(adjust_nthreads(nthreads_)),
+        verbosity(verbosity_),
+        negate_v(negate_v_), divide_by_n(divide_by_n_),
+        sigma_min(sigma_min_), sigma_max(sigma_max_),
+        nimg(1), chan2img(freq.shape(0), 0),
+        lshift(center_x), mshift(negate_v ? -center_y : center_y),
+        lmshift((lshift!=0) || (mshift!=0)),
+        no_nshift(!allow_nshift)
+      {
+      MR_assert(ncorr>0, "need at least one correlation");
+      timers.push("Baseline construction");
+      bl = Baselines(uvw, freq, negate_v);
+      MR_assert(bl.Nchannels()<(uint64_t(1)<<16), "too many channels in the MS");
+      timers.pop();
+      }
+
+  public:
+    /// Carries out a single gridding (if \a ms_out is empty) or degridding
+    /// operation. The leading axis of the visibility and image arrays
+    /// enumerates the correlations, which share weights and mask.
+    /// If \a add_ms_ is true, degridding adds to \a ms_out.
+    Wgridder(const cmav<double,2> &uvw, const cmav<double,1> &freq,
+           const cmav<complex<Tms>,3> &ms_in, vmav<complex<Tms>,3> &ms_out,
+           const cmav<Timg,3> &dirty_in, vmav<Timg,3> &dirty_out,
+           const cmav<Tms,2> &wgt_, const cmav<uint8_t,2> &mask,
+           double pixsize_x_, double pixsize_y_, double epsilon_,
+           bool do_wgridding_, size_t nthreads_, size_t verbosity_,
+           bool negate_v_, bool divide_by_n_, double sigma_min_,
+           double sigma_max_, double center_x, double center_y, bool allow_nshift,
+           bool add_ms_=false)
+      : Wgridder(ms_out.size()==0, uvw, freq, wgt_,
+          (ms_out.size()==0) ? dirty_out.shape(0) : dirty_in.shape(0),
+          (ms_out.size()==0) ? dirty_out.shape(1) : dirty_in.shape(1),
+          (ms_out.size()==0) ? dirty_out.shape(2) : dirty_in.shape(2),
+          pixsize_x_, pixsize_y_, epsilon_, do_wgridding_, nthreads_,
+          verbosity_, negate_v_, divide_by_n_, sigma_min_, sigma_max_,
+          center_x, center_y, allow_nshift)
+      {
+      add_ms = add_ms_;
+      scanData(ms_in, ms_out, mask);
+      if (nvis==0)
+        {
+        if (gridding) mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty_out);
+        return;
+        }
+      setup();
+      report(gridding ? "Gridding:" : "Degridding:");
+      gridding ? x2dirty(ms_in, dirty_out) : dirty2x(dirty_in, ms_out);
+
+      if (verbosity>0)
+        timers.report(cout);
+      }
+
+    /*! Prepares gridding and degridding of visibilities with the given
+     *  coordinates, weights and mask to and from a dirty image of
+     *  \a npix_x x \a npix_y pixels. Afterwards, ms2dirty() and dirty2ms()
+     *  can be called any number of times; they only need the visibility or
+     *  image data.
+     *  Visibilities and images carry a leading axis of length \a ncorr_
+     *  (e.g. for the four correlations of full-polarization data); kernel
+     *  evaluation, indexing and w-screens are shared between them.
+     *  If \a chan2img_ is not empty, it assigns every channel to an image
+     *  of a spectral cube, which is then produced by ms2dirty_cube() and
+     *  consumed by dirty2ms_cube(); the cube has max(chan2img_)+1 images.
+     *  \note Empty \a wgt_ or \a mask_ arrays are treated as all ones.
+     *  \note Concurrent calls on the same object are not allowed. */
+    Wgridder(const cmav<double,2> &uvw, const cmav<double,1> &freq,
+           const cmav<Tms,2> &wgt_, const cmav<uint8_t,2> &mask_,
+           size_t npix_x, size_t npix_y,
+           double pixsize_x_, double pixsize_y_, double epsilon_,
+           bool do_wgridding_, size_t nthreads_, size_t verbosity_,
+           bool negate_v_=false, bool divide_by_n_=true, double sigma_min_=1.1,
+           double sigma_max_=2.6, double center_x=0, double center_y=0,
+           bool allow_nshift=true, size_t ncorr_=1,
+           const cmav<size_t,1> &chan2img_=vmav<size_t,1>::build_empty())
+      : Wgridder(true, uvw, freq,
+          (wgt_.size()!=0) ? wgt_ : wgt_.build_uniform({uvw.shape(0), freq.shape(0)}, 1.),
+          ncorr_, npix_x, npix_y, pixsize_x_, pixsize_y_, epsilon_, do_wgridding_,
+          nthreads_, verbosity_, negate_v_, divide_by_n_, sigma_min_,
+          sigma_max_, center_x, center_y, allow_nshift)
+      {
+      timers.reset("planning");
+      if (chan2img_.size()!=0)
+        {
+        checkShape(chan2img_.shape(), {bl.Nchannels()});
+        for (size_t i=0; i<chan2img.size(); ++i)
+          {
+          chan2img[i] = chan2img_(i);
+          nimg = max(nimg, chan2img[i]+1);
+          }
+        MR_assert((nimg==1) || (ncorr==1),
+          "spectral cubes are only supported for a single correlation");
+        }
+      auto shp = wgt.shape();
+      auto mask(mask_.size()!=0 ? mask_ : mask_.build_uniform(shp, 1));
+      auto ms_in(cmav<complex<Tms>,3>::build_uniform({ncorr, shp[0], shp[1]}, 1.));
+      auto ms_out(vmav<complex<Tms>,3>::build_empty());
+      scanData(ms_in, ms_out, mask);
+      if (nvis==0) return;
+      setup();
+      report("Planning:");
+      if (verbosity>0)
+        timers.report(cout);
+      }
 
+    /// Grids the visibilities \a ms onto \a dirty.
+    void ms2dirty(const cmav<complex<Tms>,3> &ms, vmav<Timg,3> &dirty,
+      size_t verbosity_=0)
+      {
+      MR_assert(nimg==1, "this plan produces a spectral cube");
+      checkShape(ms.shape(), {ncorr, bl.Nrows(), bl.Nchannels()});
+      checkShape(dirty.shape(), {ncorr, nxdirty, nydirty});
+      gridding = true;
+      verbosity = verbosity_;
+      timers.reset("gridding");
+      if (nvis==0)
+        {
+        mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty);
+        return;
+        }
+      x2dirty(ms, dirty);
+      if (verbosity>0)
+        timers.report(cout);
+      }
+
+    /// Degrids \a dirty into the visibilities \a ms.
+    void dirty2ms(const cmav<Timg,3> &dirty, vmav<complex<Tms>,3> &ms,
+      size_t verbosity_=0)
+      {
+      MR_assert(nimg==1, "this plan consumes a spectral cube");
+      checkShape(dirty.shape(), {ncorr, nxdirty, nydirty});
+      checkShape(ms.shape(), {ncorr, bl.Nrows(), bl.Nchannels()});
+      gridding = false;
+      verbosity = verbosity_;
+      timers.reset("degridding");
+      if (nvis<bl.Nrows()*bl.Nchannels())
+        {
+        timers.push("zeroing visibilities");
+        mav_apply([](complex<Tms> &v){v=complex<Tms>(0);}, nthreads, ms);
+        timers.pop();
+        }
+      if (nvis==0) return;
+      dirty2x(dirty, ms);
+      if (verbosity>0)
+        timers.report(cout);
+      }
+
+    /// Variant of ms2dirty() for plans with a single correlation.
+    void ms2dirty(const cmav<complex<Tms>,2> &ms, vmav<Timg,2> &dirty,
+      size_t verbosity_=0)
+      {
+      auto dirty3 = dirty.prepend_1();
+      ms2dirty(ms.prepend_1(), dirty3, verbosity_);
+      }
+
+    /// Variant of dirty2ms() for plans with a single correlation.
+    void dirty2ms(const cmav<Timg,2> &dirty, vmav<complex<Tms>,2> &ms,
+      size_t verbosity_=0)
+      {
+      auto ms3 = ms.prepend_1();
+      dirty2ms(dirty.prepend_1(), ms3, verbosity_);
+      }
+
+    /// Grids the visibilities \a ms onto the images of \a cube, according
+    /// to the channel-to-image map given at construction.
+    void ms2dirty_cube(const cmav<complex<Tms>,2> &ms, vmav<Timg,3> &cube,
+      size_t verbosity_=0)
+      {
+      checkShape(ms.shape(), {bl.Nrows(), bl.Nchannels()});
+      checkShape(cube.shape(), {nimg, nxdirty, nydirty});
+      gridding = true;
+      verbosity = verbosity_;
+      timers.reset("gridding");
+      auto ms3 = ms.prepend_1();
+      for (size_t i=0; i<nimg; ++i)
+        {
+        auto dirty = subarray<2>(cube, {{i}, {}, {}}).prepend_1();
+        x2dirty(ms3, dirty, i);
+        }
+      if (verbosity>0)
+        timers.report(cout);
+      }
+
+    /// Degrids the images of \a cube into the visibilities \a ms, according
+    /// to the channel-to-image map given at construction.
+    void dirty2ms_cube(const cmav<Timg,3> &cube, vmav<complex<Tms>,2> &ms,
+      size_t verbosity_=0)
+      {
+      checkShape(cube.shape(), {nimg, nxdirty, nydirty});
+      checkShape(ms.shape(), {bl.Nrows(), bl.Nchannels()});
+      gridding = false;
+      verbosity = verbosity_;
+      timers.reset("degridding");
+      if (nvis<bl.Nrows()*bl.Nchannels())
+        {
+        timers.push("zeroing visibilities");
+        mav_apply([](complex<Tms> &v){v=complex<Tms>(0);}, nthreads, ms);
+        timers.pop();
+        }
+      auto ms3 = ms.prepend_1();
+      for (size_t i=0; i<nimg; ++i)
+        dirty2x(subarray<2>(cube, {{i}, {}, {}}).prepend_1(), ms3, i);
       if (verbosity>0)
         timers.report(cout);
       }
   };
 
+/// Grids visibilities of shape (ncorr, nrow, nchan) onto \a ncorr dirty
+/// images in a single pass.
 template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void ms2dirty(const cmav<double,2> &uvw,
-  const cmav<double,1> &freq, const cmav<complex<Tms>,2> &ms,
+  const cmav<double,1> &freq, const cmav<complex<Tms>,3> &ms,
   const cmav<Tms,2> &wgt_, const cmav<uint8_t,2> &mask_, double pixsize_x, double pixsize_y, double epsilon,
-  bool do_wgridding, size_t nthreads, vmav<Timg,2> &dirty, size_t verbosity,
+  bool do_wgridding, size_t nthreads, vmav<Timg,3> &dirty, size_t verbosity,
   bool negate_v=false, bool divide_by_n=true, double sigma_min=1.1,
   double sigma_max=2.6, double center_x=0, double center_y=0, bool allow_nshift=true)
   {
-  auto ms_out(vmav<complex<Tms>,2>::build_empty());
-  auto dirty_in(vmav<Timg,2>::build_empty());
-  auto wgt(wgt_.size()!=0 ? wgt_ : wgt_.build_uniform(ms.shape(), 1.));
-  auto mask(mask_.size()!=0 ? mask_ : mask_.build_uniform(ms.shape(), 1));
+  auto ms_out(vmav<complex<Tms>,3>::build_empty());
+  auto dirty_in(vmav<Timg,3>::build_empty());
+  auto wgt(wgt_.size()!=0 ? wgt_ : wgt_.build_uniform({ms.shape(1), ms.shape(2)}, 1.));
+  auto mask(mask_.size()!=0 ? mask_ : mask_.build_uniform({ms.shape(1), ms.shape(2)}, 1));
   Wgridder<Tcalc, Tacc, Tms, Timg> par(uvw, freq, ms, ms_out, dirty_in, dirty, wgt, mask, pixsize_x,
     pixsize_y, epsilon, do_wgridding, nthreads, verbosity, negate_v,
     divide_by_n, sigma_min, sigma_max, center_x, center_y, allow_nshift);
   }
 
+template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void ms2dirty(const cmav<double,2> &uvw,
+  const cmav<double,1> &freq, const cmav<complex<Tms>,2> &ms,
+  const cmav<Tms,2> &wgt_, const cmav<uint8_t,2> &mask_, double pixsize_x, double pixsize_y, double epsilon,
+  bool do_wgridding, size_t nthreads, vmav<Timg,2> &dirty, size_t verbosity,
+  bool negate_v=false, bool divide_by_n=true, double sigma_min=1.1,
+  double sigma_max=2.6, double center_x=0, double center_y=0, bool allow_nshift=true)
+  {
+  auto dirty3 = dirty.prepend_1();
+  ms2dirty<Tcalc,Tacc>(uvw, freq, ms.prepend_1(), wgt_, mask_, pixsize_x,
+    pixsize_y, epsilon, do_wgridding, nthreads, dirty3, verbosity, negate_v,
+    divide_by_n, sigma_min, sigma_max, center_x, center_y, allow_nshift);
+  }
+
+/// Degrids \a ncorr dirty images into visibilities of shape
+/// (ncorr, nrow, nchan) in a single pass. If \a add_ms is true, the result
+/// is added to \a ms.
 template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void dirty2ms(const cmav<double,2> &uvw,
-  const cmav<double,1> &freq, const cmav<Timg,2> &dirty,
+  const cmav<double,1> &freq, const cmav<Timg,3> &dirty,
   const cmav<Tms,2> &wgt_, const cmav<uint8_t,2> &mask_, double pixsize_x, double pixsize_y,
-  double epsilon, bool do_wgridding, size_t nthreads, vmav<complex<Tms>,2> &ms,
+  double epsilon, bool do_wgridding, size_t nthreads, vmav<complex<Tms>,3> &ms,
   size_t verbosity, bool negate_v=false, bool divide_by_n=true,
-  double sigma_min=1.1, double sigma_max=2.6, double center_x=0, double center_y=0, bool allow_nshift=true)
+  double sigma_min=1.1, double sigma_max=2.6, double center_x=0, double center_y=0, bool allow_nshift=true,
+  bool add_ms=false)
   {
   if (ms.size()==0) return;  // nothing to do
   auto ms_in(ms.build_uniform(ms.shape(),1.));
-  auto dirty_out(vmav<Timg,2>::build_empty());
-  auto wgt(wgt_.size()!=0 ? wgt_ : wgt_.build_uniform(ms.shape(), 1.));
-  auto mask(mask_.size()!=0 ? mask_ : mask_.build_uniform(ms.shape(), 1));
+  auto dirty_out(vmav<Timg,3>::build_empty());
+  auto wgt(wgt_.size()!=0 ? wgt_ : wgt_.build_uniform({ms.shape(1), ms.shape(2)}, 1.));
+  auto mask(mask_.size()!=0 ? mask_ : mask_.build_uniform({ms.shape(1), ms.shape(2)}, 1));
   Wgridder<Tcalc, Tacc, Tms, Timg> par(uvw, freq, ms_in, ms, dirty, dirty_out, wgt, mask, pixsize_x,
     pixsize_y, epsilon, do_wgridding, nthreads, verbosity, negate_v,
-    divide_by_n, sigma_min, sigma_max, center_x, center_y, allow_nshift);
+    divide_by_n, sigma_min, sigma_max, center_x, center_y, allow_nshift, add_ms);
+  }
+
+template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void dirty2ms(const cmav<double,2> &uvw,
+  const cmav<double,1> &freq, const cmav<Timg,2> &dirty,
+  const cmav<Tms,2> &wgt_, const cmav<uint8_t,2> &mask_, double pixsize_x, double pixsize_y,
+  double epsilon, bool do_wgridding, size_t nthreads, vmav<complex<Tms>,2> &ms,
+  size_t verbosity, bool negate_v=false, bool divide_by_n=true,
+  double sigma_min=1.1, double sigma_max=2.6, double center_x=0, double center_y=0, bool allow_nshift=true,
+  bool add_ms=false)
+  {
+  auto ms3 = ms.prepend_1();
+  dirty2ms<Tcalc,Tacc>(uvw, freq, dirty.prepend_1(), wgt_, mask_, pixsize_x,
+    pixsize_y, epsilon, do_wgridding, nthreads, ms3, verbosity, negate_v,
+    divide_by_n, sigma_min, sigma_max, center_x, center_y, allow_nshift, add_ms);
+  }
+
+/// Grids visibilities onto a spectral cube of shape (nimage, nx, ny);
+/// channel \a i contributes to image \a chan2img(i).
+template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void ms2dirty_cube(const cmav<double,2> &uvw,
+  const cmav<double,1> &freq, const cmav<complex<Tms>,2> &ms,
+  const cmav<size_t,1> &chan2img, const cmav<Tms,2> &wgt_, const cmav<uint8_t,2> &mask_,
+  double pixsize_x, double pixsize_y, double epsilon,
+  bool do_wgridding, size_t nthreads, vmav<Timg,3> &dirty, size_t verbosity,
+  bool negate_v=false, bool divide_by_n=true, double sigma_min=1.1,
+  double sigma_max=2.6, double center_x=0, double center_y=0, bool allow_nshift=true)
+  {
+  for (size_t i=0; i<chan2img.shape(0); ++i)
+    MR_assert(chan2img(i)<dirty.shape(0), "image index out of range");
+  // trailing images without channels are not known to the plan
+  mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty);
+  size_t nimg = 0;
+  for (size_t i=0; i<chan2img.shape(0); ++i)
+    nimg = max(nimg, chan2img(i)+1);
+  if (nimg==0) return;
+  Wgridder<Tcalc, Tacc, Tms, Timg> plan(uvw, freq, wgt_, mask_,
+    dirty.shape(1), dirty.shape(2), pixsize_x, pixsize_y, epsilon,
+    do_wgridding, nthreads, verbosity, negate_v, divide_by_n, sigma_min,
+    sigma_max, center_x, center_y, allow_nshift, 1, chan2img);
+  auto subdirty = subarray<3>(dirty, {{0, nimg}, {}, {}});
+  plan.ms2dirty_cube(ms, subdirty, verbosity);
+  }
+
+/// Degrids a spectral cube of shape (nimage, nx, ny) into visibilities;
+/// channel \a i is computed from image \a chan2img(i).
+template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void dirty2ms_cube(const cmav<double,2> &uvw,
+  const cmav<double,1> &freq, const cmav<Timg,3> &dirty,
+  const cmav<size_t,1> &chan2img, const cmav<Tms,2> &wgt_, const cmav<uint8_t,2> &mask_,
+  double pixsize_x, double pixsize_y, double epsilon,
+  bool do_wgridding, size_t nthreads, vmav<complex<Tms>,2> &ms, size_t verbosity,
+  bool negate_v=false, bool divide_by_n=true, double sigma_min=1.1,
+  double sigma_max=2.6, double center_x=0, double center_y=0, bool allow_nshift=true)
+  {
+  if (ms.size()==0) return;  // nothing to do
+  size_t nimg = 0;
+  for (size_t i=0; i<chan2img.shape(0); ++i)
+    {
+    MR_assert(chan2img(i)<dirty.shape(0), "image index out of range");
+    nimg = max(nimg, chan2img(i)+1);
+    }
+  Wgridder<Tcalc, Tacc, Tms, Timg> plan(uvw, freq, wgt_, mask_,
+    dirty.shape(1), dirty.shape(2), pixsize_x, pixsize_y, epsilon,
+    do_wgridding, nthreads, verbosity, negate_v, divide_by_n, sigma_min,
+    sigma_max, center_x, center_y, allow_nshift, 1, chan2img);
+  plan.dirty2ms_cube(subarray<3>(dirty, {{0, nimg}, {}, {}}), ms, verbosity);
   }
 
 tuple<size_t, size_t, size_t, size_t, double, double>
  get_facet_data(size_t npix_x, size_t npix_y, size_t nfx, size_t nfy, size_t ifx, size_t ify,
   double pixsize_x, double pixsize_y, double center_x, double center_y);
 
+/// Returns how many facets should be processed concurrently, given that every
+/// concurrently processed facet needs \a bytes_per_facet bytes of additional
+/// memory. Each of them gets nthreads/result threads.
+size_t get_facet_concurrency(size_t nfacets, size_t nthreads,
+  size_t bytes_per_facet, size_t verbosity);
+
+/// Returns an estimate of the memory (in bytes) needed for gridding or
+/// degridding one of \a nfx*nfy facets of an \a npix_x*npix_y image on a
+/// single thread: the oversampled grid (for the largest allowed oversampling
+/// factor), the copy of the facet image, and the visibility mask and index,
+/// which has at most one entry per visibility.
+template<typename Tcalc, typename Timg> size_t get_facet_memory(size_t npix_x,
+  size_t npix_y, size_t nfx, size_t nfy, size_t nvis, double sigma_max,
+  bool do_wgridding)
+  {
+  size_t nxf = (npix_x+nfx-1)/nfx, nyf = (npix_y+nfy-1)/nfy;
+  size_t nu = max<size_t>(16, 2*good_size_complex(size_t(nxf*sigma_max*0.5)+1)),
+         nv = max<size_t>(16, 2*good_size_complex(size_t(nyf*sigma_max*0.5)+1));
+  size_t res = nu*nv*sizeof(complex<Tcalc>);          // grid
+  if (!do_wgridding)
+    res += nu*nv*sizeof(Tcalc);                        // rgrid
+  res += nxf*nyf*sizeof(Timg);                         // tdirty
+  res += nvis*(1+sizeof(RowchanRange)+sizeof(pair<Uvwidx, size_t>));
+  return res;
+  }
+
+/// Grids visibilities facet by facet. Up to \a nconc facets are processed
+/// concurrently, using nthreads/nconc threads each. (With the default thread
+/// pool, nested parallel regions run on a single thread, so this only makes
+/// a difference for \a nconc==1.)
 template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void ms2dirty_faceted(size_t nfx, size_t nfy, const cmav<double,2> &uvw,
   const cmav<double,1> &freq, const cmav<complex<Tms>,2> &ms,
   const cmav<Tms,2> &wgt_, const cmav<uint8_t,2> &mask_, double pixsize_x, double pixsize_y, double epsilon,
   bool do_wgridding, size_t nthreads, vmav<Timg,2> &dirty, size_t verbosity,
   bool negate_v=false, bool divide_by_n=true, double sigma_min=1.1,
-  double sigma_max=2.6, double center_x=0, double center_y=0)
+  double sigma_max=2.6, double center_x=0, double center_y=0, size_t nconc=1)
   {
   size_t npix_x=dirty.shape(0), npix_y=dirty.shape(1);
-  for (size_t i=0; i<nfx; ++i)
-    for (size_t j=0; j<nfy; ++j)
+  nconc = max<size_t>(1, min(nconc, nfx*nfy));
+  size_t nthreads_facet = max<size_t>(1, nthreads/nconc);
+  size_t verbosity_facet = (nconc>1) ? 0 : verbosity;
+  // the facets write to disjoint parts of the dirty image
+  execDynamic(nfx*nfy, nconc, 1, [&](Scheduler &sched)
+    {
+    while (auto rng=sched.getNext()) for(auto ifct=rng.lo; ifct<rng.hi; ++ifct)
       {
-      auto [startx, starty, stopx, stopy, cx, cy] = get_facet_data(npix_x, npix_y, nfx, nfy, i, j, pixsize_x, pixsize_y, center_x, center_y);
+      auto [startx, starty, stopx, stopy, cx, cy] = get_facet_data(npix_x, npix_y, nfx, nfy, ifct/nfy, ifct%nfy, pixsize_x, pixsize_y, center_x, center_y);
       auto subdirty=subarray<2>(dirty, {{startx, stopx}, {starty, stopy}});
-      ms2dirty<Tcalc,Tacc>(uvw, freq, ms, wgt_, mask_, pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads, subdirty, verbosity, negate_v, divide_by_n, sigma_min, sigma_max, cx, cy, true);
+      ms2dirty<Tcalc,Tacc>(uvw, freq, ms, wgt_, mask_, pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads_facet, subdirty, verbosity_facet, negate_v, divide_by_n, sigma_min, sigma_max, cx, cy, true);
       }
+    });
   }
 
+/// Degrids visibilities facet by facet. Up to \a nconc facets are processed
+/// concurrently, using nthreads/nconc threads each (see ms2dirty_faceted());
+/// every thread adds the visibilities of its facets to its own accumulator,
+/// and the accumulators are summed at the end.
 template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void dirty2ms_faceted(size_t nfx,size_t nfy, const cmav<double,2> &uvw,
   const cmav<double,1> &freq, const cmav<Timg,2> &dirty,
   const cmav<Tms,2> &wgt_, const cmav<uint8_t,2> &mask_, double pixsize_x, double pixsize_y,
   double epsilon, bool do_wgridding, size_t nthreads, vmav<complex<Tms>,2> &ms,
   size_t verbosity, bool negate_v=false, bool divide_by_n=true,
-  double sigma_min=1.1, double sigma_max=2.6, double center_x=0, double center_y=0)
+  double sigma_min=1.1, double sigma_max=2.6, double center_x=0, double center_y=0,
+  size_t nconc=1)
   {
   size_t npix_x=dirty.shape(0), npix_y=dirty.shape(1);
-  size_t istep = (npix_x+nfx-1) / nfx;
-  istep += istep%2;  // make even
-  size_t jstep = (npix_y+nfy-1) / nfy;
-  jstep += jstep%2;  // make even
+  nconc = max<size_t>(1, min(nconc, nfx*nfy));
+  size_t nthreads_facet = max<size_t>(1, nthreads/nconc);
+  size_t verbosity_facet = (nconc>1) ? 0 : verbosity;
 
-  vmav<complex<Tms>,2> ms2(ms.shape(), UNINITIALIZED);
+  // visibility accumulators of the individual threads; the first one is the
+  // output array itself, the others are allocated when needed
   mav_apply([](complex<Tms> &v){v=complex<Tms>(0);},nthreads,ms);
-  for (size_t i=0; i<nfx; ++i)
-    for (size_t j=0; j<nfy; ++j)
+  vector<vmav<complex<Tms>,2>> acc(nconc);
+  acc[0].assign(ms);
+  vector<uint8_t> used(nconc, 0);
+  used[0] = 1;
+  execDynamic(nfx*nfy, nconc, 1, [&](Scheduler &sched)
+    {
+    auto ithr = sched.thread_num();
+    while (auto rng=sched.getNext()) for(auto ifct=rng.lo; ifct<rng.hi; ++ifct)
       {
-      auto [startx, starty, stopx, stopy, cx, cy] = get_facet_data(npix_x, npix_y, nfx, nfy, i, j, pixsize_x, pixsize_y, center_x, center_y);
+      auto [startx, starty, stopx, stopy, cx, cy] = get_facet_data(npix_x, npix_y, nfx, nfy, ifct/nfy, ifct%nfy, pixsize_x, pixsize_y, center_x, center_y);
       auto subdirty=subarray<2>(dirty, {{startx, stopx}, {starty, stopy}});
-      dirty2ms<Tcalc,Tacc>(uvw, freq, subdirty, wgt_, mask_, pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads, ms2, verbosity, negate_v, divide_by_n, sigma_min, sigma_max, cx, cy, true);
-      mav_apply([](complex<Tms> &v1, const complex<Tms> &v2){v1+=v2;},nthreads,ms,ms2);
+      if (!used[ithr])
+        {
+        vmav<complex<Tms>,2> tacc(ms.shape());
+        acc[ithr].assign(tacc);
+        used[ithr] = 1;
+        }
+      dirty2ms<Tcalc,Tacc>(uvw, freq, subdirty, wgt_, mask_, pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads_facet, acc[ithr], verbosity_facet, negate_v, divide_by_n, sigma_min, sigma_max, cx, cy, true, true);
       }
+    });
+  // final reduction
+  for (size_t i=1; i<nconc; ++i)
+    if (used[i])
+      mav_apply([](complex<Tms> &v1, const complex<Tms> &v2){v1+=v2;},nthreads,ms,acc[i]);
   }
 
 tuple<vmav<uint8_t,2>,size_t,size_t, size_t>  get_tuning_parameters(const cmav<double,2> &uvw,
@@ -1807,7 +2429,10 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void ms2dir
     else
       ms2dirty_faceted<Tcalc,Tacc>(nfx, nfy, uvw, freq, ms, wgt_, mask_, pixsize_x, pixsize_y, epsilon,
                do_wgridding, nthreads, dirty, verbosity, negate_v, divide_by_n,
-               sigma_min, sigma_max, center_x, center_y);
+               sigma_min, sigma_max, center_x, center_y,
+               get_facet_concurrency(nfx*nfy, nthreads,
+                 get_facet_memory<Tcalc,Timg>(dirty.shape(0), dirty.shape(1),
+                   nfx, nfy, ms.size(), sigma_max, do_wgridding), verbosity));
     }
   else
     {
@@ -1817,7 +2442,10 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void ms2dir
     mav_apply([&](uint8_t i1, uint8_t i2, uint8_t &out) { out = (i1!=0) && (i2>=icut_local); }, nthreads, mask, bin, mask2);
     ms2dirty_faceted<Tcalc,Tacc>(nfx, nfy, uvw, freq, ms, wgt_, mask2, pixsize_x, pixsize_y, epsilon,
              do_wgridding, nthreads, dirty, verbosity, negate_v, divide_by_n,
-             sigma_min, sigma_max, center_x, center_y);
+             sigma_min, sigma_max, center_x, center_y,
+             get_facet_concurrency(nfx*nfy, nthreads,
+               get_facet_memory<Tcalc,Timg>(dirty.shape(0), dirty.shape(1),
+                 nfx, nfy, ms.size(), sigma_max, do_wgridding), verbosity));
     vmav<Timg,2> dirty2(dirty.shape(), UNINITIALIZED);
     mav_apply([&](uint8_t i1, uint8_t i2, uint8_t &out) { out = (i1!=0) && (i2<icut_local); }, nthreads, mask, bin, mask2);
     ms2dirty<Tcalc,Tacc>(uvw, freq, ms, wgt_, mask2, pixsize_x, pixsize_y, epsilon,
@@ -1855,7 +2483,11 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void dirty2
     if (nfx==0)  // traditional algorithm
       dirty2ms<Tcalc,Tacc>(uvw, freq, dirty, wgt_, mask_, pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads, ms, verbosity, negate_v, divide_by_n, sigma_min, sigma_max, center_x, center_y, true);
     else
-      dirty2ms_faceted<Tcalc,Tacc>(nfx, nfy, uvw, freq, dirty, wgt_, mask_, pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads, ms, verbosity, negate_v, divide_by_n, sigma_min, sigma_max, center_x, center_y);
+      dirty2ms_faceted<Tcalc,Tacc>(nfx, nfy, uvw, freq, dirty, wgt_, mask_, pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads, ms, verbosity, negate_v, divide_by_n, sigma_min, sigma_max, center_x, center_y,
+        get_facet_concurrency(nfx*nfy, nthreads,
+          get_facet_memory<Tcalc,Timg>(dirty.shape(0), dirty.shape(1), nfx,
+            nfy, ms.size(), sigma_max, do_wgridding)
+          + ms.size()*sizeof(complex<Tms>), verbosity));
     }
   else
     {
@@ -1863,20 +2495,28 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void dirty2
     vmav<uint8_t,2> mask2({uvw.shape(0),freq.shape(0)}, UNINITIALIZED);
     auto icut_local = icut; // FIXME: stupid hack to work around an oversight in the standard(?)
     mav_apply([&](uint8_t i1, uint8_t i2, uint8_t &out) { out = (i1!=0) && (i2>=icut_local); }, nthreads, mask, bin, mask2);
-    dirty2ms_faceted<Tcalc,Tacc>(nfx, nfy, uvw, freq, dirty, wgt_, mask2, pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads, ms, verbosity, negate_v, divide_by_n, sigma_min, sigma_max, center_x, center_y);
+    dirty2ms_faceted<Tcalc,Tacc>(nfx, nfy, uvw, freq, dirty, wgt_, mask2, pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads, ms, verbosity, negate_v, divide_by_n, sigma_min, sigma_max, center_x, center_y,
+      get_facet_concurrency(nfx*nfy, nthreads,
+        get_facet_memory<Tcalc,Timg>(dirty.shape(0), dirty.shape(1), nfx,
+          nfy, ms.size(), sigma_max, do_wgridding)
+        + ms.size()*sizeof(complex<Tms>), verbosity));
     mav_apply([&](uint8_t i1, uint8_t i2, uint8_t &out) { out = (i1!=0) && (i2<icut_local); }, nthreads, mask, bin, mask2);
-    vmav<complex<Tms>,2> tms(ms.shape(), UNINITIALIZED);
-    dirty2ms<Tcalc,Tacc>(uvw, freq, dirty, wgt_, mask2, pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads, tms, verbosity, negate_v, divide_by_n, sigma_min, sigma_max, center_x, center_y, true);
-    mav_apply([&](complex<Tms> &v1, complex<Tms> v2) {v1+=v2;}, nthreads, ms, tms);
+    dirty2ms<Tcalc,Tacc>(uvw, freq, dirty, wgt_, mask2, pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads, ms, verbosity, negate_v, divide_by_n, sigma_min, sigma_max, center_x, center_y, true, true);
     }
   }
 } // namespace detail_gridder
 
 // public names
+using detail_gridder::Wgridder;
 using detail_gridder::ms2dirty;
 using detail_gridder::dirty2ms;
+using detail_gridder::ms2dirty_cube;
+using detail_gridder::dirty2ms_cube;
 using detail_gridder::ms2dirty_tuning;
 using detail_gridder::dirty2ms_tuning;
+using detail_gridder::GridderOverrides;
+using detail_gridder::getGridderOverrides;
+using detail_gridder::setGridderOverrides;
 
 } // namespace ducc0
 